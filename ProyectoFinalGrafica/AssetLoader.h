@@ -0,0 +1,307 @@
+#pragma once
+
+#include <deque>
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <functional>
+#include <condition_variable>
+
+#include <assimp/Importer.hpp>
+
+using namespace std;
+
+/*
+	Parallel loading phase.
+
+	Every asset is split into a CPU-only part (Assimp import, mesh processing, image decoding) that runs on a pool of
+	worker threads, and a GL part (buffer and texture creation) that has to run on the thread that owns the context.
+	Workers push the GL part into an upload queue once the CPU part is done, and Finish() drains that queue on the
+	context thread until every enqueued asset has been uploaded. While streaming, Poll() runs the uploads that are
+	ready once per frame instead, so the frame never waits for a worker.
+
+	Each worker owns its own Assimp::Importer, since an importer (and the scene it returns) can't be shared between threads.
+
+	A CPU part can split its own work with ParallelFor (ObjLoader does it with the chunks of a large file). The pieces
+	go to the idle workers, ahead of the queued assets, instead of to threads of their own, so several large files
+	loading at once never use more threads than the pool.
+*/
+class AssetLoader
+{
+public:
+	typedef function<void(Assimp::Importer &)> CpuWork;
+	typedef function<void()> GpuWork;
+
+	static AssetLoader &Get()
+	{
+		static AssetLoader loader;
+		return loader;
+	}
+
+	~AssetLoader()
+	{
+		this->stopWorkers();
+	}
+
+	// Starts the worker pool. By default it uses one thread per core minus the one that keeps the GL context.
+	void Start(unsigned numThreads = 0)
+	{
+		if (this->active)
+		{
+			return;
+		}
+
+		if (numThreads == 0)
+		{
+			unsigned cores = thread::hardware_concurrency();
+			numThreads = cores > 1 ? cores - 1 : 1;
+		}
+
+		this->active = true;
+		this->stopping = false;
+		for (unsigned i = 0; i < numThreads; i++)
+		{
+			this->workers.push_back(thread(&AssetLoader::workerLoop, this));
+		}
+	}
+
+	// True between Start() and Finish(): assets should be enqueued instead of loaded synchronously.
+	bool IsActive() const
+	{
+		return this->active;
+	}
+
+	unsigned NumThreads() const
+	{
+		return (unsigned)this->workers.size();
+	}
+
+	// Queues an asset. cpuWork runs on a worker, gpuWork later runs on the GL thread inside Finish().
+	void Enqueue(CpuWork cpuWork, GpuWork gpuWork)
+	{
+		{
+			lock_guard<mutex> lock(this->jobsMutex);
+			Job job;
+			job.cpuWork = cpuWork;
+			job.gpuWork = gpuWork;
+			this->jobs.push_back(job);
+		}
+		{
+			lock_guard<mutex> lock(this->uploadsMutex);
+			this->pending++;
+		}
+		this->jobsReady.notify_one();
+	}
+
+	// Must be called from the GL thread. Runs the upload of each asset as soon as its worker is done with it and
+	// returns once everything enqueued so far is on the GPU. The worker pool is shut down afterwards.
+	void Finish()
+	{
+		this->Wait();
+		this->stopWorkers();
+		this->active = false;
+	}
+
+	// Like Finish(), but the workers keep running so more assets can be enqueued later (streaming).
+	void Wait()
+	{
+		for (;;)
+		{
+			GpuWork upload;
+			{
+				unique_lock<mutex> lock(this->uploadsMutex);
+				this->uploadsReady.wait(lock, [this] { return !this->uploads.empty() || this->pending == 0; });
+				if (this->uploads.empty())
+				{
+					break;
+				}
+				upload = this->uploads.front();
+				this->uploads.pop_front();
+			}
+
+			this->runUpload(upload);
+		}
+	}
+
+	// Must be called from the GL thread, once per frame while streaming. Runs the uploads whose CPU part is
+	// already done, without waiting for the rest. Returns how many ran.
+	unsigned Poll()
+	{
+		unsigned count = 0;
+		for (;;)
+		{
+			GpuWork upload;
+			{
+				lock_guard<mutex> lock(this->uploadsMutex);
+				if (this->uploads.empty())
+				{
+					return count;
+				}
+				upload = this->uploads.front();
+				this->uploads.pop_front();
+			}
+
+			this->runUpload(upload);
+			count++;
+		}
+	}
+
+	// Enqueued assets whose upload hasn't run yet
+	size_t Pending()
+	{
+		lock_guard<mutex> lock(this->uploadsMutex);
+		return this->pending;
+	}
+
+	// Threads a ParallelFor can use at most: the workers and the calling thread, or just the caller without the pool
+	unsigned Parallelism() const
+	{
+		return this->active ? this->NumThreads() + 1 : 1;
+	}
+
+	// Calls work(0) to work(count - 1) on the calling thread and on the workers that are idle, and returns once all of
+	// them are done. When every worker is busy the calling thread makes all the calls itself, and without the pool
+	// they just run one after another.
+	void ParallelFor(size_t count, const function<void(size_t)> &work)
+	{
+		if (count <= 1 || !this->active)
+		{
+			for (size_t i = 0; i < count; i++)
+			{
+				work(i);
+			}
+			return;
+		}
+
+		shared_ptr<Split> split = make_shared<Split>();
+		split->work = &work;
+		split->count = count;
+		{
+			lock_guard<mutex> lock(this->jobsMutex);
+			for (size_t i = 1; i < count; i++)
+			{
+				this->tasks.push_back([split]() { runSplit(*split); });
+			}
+		}
+		this->jobsReady.notify_all();
+
+		runSplit(*split);
+		unique_lock<mutex> lock(split->doneMutex);
+		split->finished.wait(lock, [&split] { return split->done == split->count; });
+	}
+
+private:
+	struct Job
+	{
+		CpuWork cpuWork;
+		GpuWork gpuWork;
+	};
+
+	// Calls of one ParallelFor, each taken by the first thread that gets to it. A worker that comes after the last
+	// one was taken finds nothing left and never touches work, which belongs to the caller.
+	struct Split
+	{
+		const function<void(size_t)> *work = nullptr;
+		size_t count = 0;
+		atomic<size_t> next{ 0 };
+		size_t done = 0;
+		mutex doneMutex;
+		condition_variable finished;
+	};
+
+	vector<thread> workers;
+	bool active = false;
+	bool stopping = false;
+
+	deque<Job> jobs;
+	deque<function<void()> > tasks; // Pieces of a ParallelFor, taken before the jobs
+	mutex jobsMutex;
+	condition_variable jobsReady;
+
+	deque<GpuWork> uploads;
+	size_t pending = 0; // Enqueued assets whose upload hasn't run yet
+	mutex uploadsMutex;
+	condition_variable uploadsReady;
+
+	void workerLoop()
+	{
+		Assimp::Importer importer;
+
+		for (;;)
+		{
+			Job job;
+			function<void()> task;
+			{
+				unique_lock<mutex> lock(this->jobsMutex);
+				this->jobsReady.wait(lock, [this] { return this->stopping || !this->jobs.empty() || !this->tasks.empty(); });
+				if (!this->tasks.empty())
+				{
+					task = this->tasks.front();
+					this->tasks.pop_front();
+				}
+				else if (this->jobs.empty())
+				{
+					return;
+				}
+				else
+				{
+					job = this->jobs.front();
+					this->jobs.pop_front();
+				}
+			}
+
+			if (task)
+			{
+				task();
+				continue;
+			}
+
+			job.cpuWork(importer);
+
+			{
+				lock_guard<mutex> lock(this->uploadsMutex);
+				this->uploads.push_back(job.gpuWork);
+			}
+			this->uploadsReady.notify_one();
+		}
+	}
+
+	static void runSplit(Split &split)
+	{
+		for (size_t i = split.next++; i < split.count; i = split.next++)
+		{
+			(*split.work)(i);
+
+			lock_guard<mutex> lock(split.doneMutex);
+			if (++split.done == split.count)
+			{
+				split.finished.notify_all();
+			}
+		}
+	}
+
+	void runUpload(GpuWork &upload)
+	{
+		upload();
+
+		lock_guard<mutex> lock(this->uploadsMutex);
+		this->pending--;
+	}
+
+	void stopWorkers()
+	{
+		{
+			lock_guard<mutex> lock(this->jobsMutex);
+			this->stopping = true;
+		}
+		this->jobsReady.notify_all();
+
+		for (size_t i = 0; i < this->workers.size(); i++)
+		{
+			this->workers[i].join();
+		}
+		this->workers.clear();
+	}
+};
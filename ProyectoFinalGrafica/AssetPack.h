@@ -0,0 +1,405 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstring>
+#include <cstdint>
+#include <cctype>
+#include <iostream>
+#include <algorithm>
+
+#include <assimp/IOStream.hpp>
+#include <assimp/IOSystem.hpp>
+#include <assimp/DefaultIOSystem.h>
+
+#include "MappedFile.h"
+
+using namespace std;
+
+/*
+	Single-file archive of the source assets (models, materials and images), written by zoo-cook --pack and mapped
+	once at startup, so loading reads straight from memory instead of opening hundreds of small files.
+
+	Layout of the file:
+		AssetPackHeader
+		the contents of every file, each one starting at a multiple of ASSET_PACK_ALIGNMENT
+		AssetPackEntry[numEntries], sorted by name
+		the names, not null terminated
+
+	Names are canonical paths (CanonicalPath) lowercased, so a lookup is a binary search and behaves the same on
+	every platform. While the pack is open it takes precedence over the loose files; anything it doesn't have is
+	read from disk as before.
+*/
+
+#define ASSET_PACK_FILE "assets.zpak"
+#define ASSET_PACK_VERSION 1
+#define ASSET_PACK_ALIGNMENT 64
+
+struct AssetPackHeader
+{
+	char magic[4]; // "ZPAK"
+	uint32_t version;
+	uint32_t numEntries;
+	uint32_t namesSize;
+	uint64_t indexOffset;
+};
+
+struct AssetPackEntry
+{
+	uint64_t offset;
+	uint64_t size;
+	int64_t mtime; // Of the loose file when it was packed, so derived data keeps matching its source
+	uint32_t nameOffset;
+	uint32_t nameLength;
+};
+
+class AssetPack
+{
+public:
+	static AssetPack &Get()
+	{
+		static AssetPack pack;
+		return pack;
+	}
+
+	bool enabled = true; // false ignores the pack and reads every file from disk
+
+	// Maps the pack. Call once before any asset is loaded; a missing pack just leaves the loose files in use.
+	bool Open(const string &path)
+	{
+		this->Close();
+		if (!this->enabled || !this->file.Open(path))
+		{
+			return false;
+		}
+
+		const unsigned char *data = this->file.Data();
+		size_t size = this->file.Size();
+		const AssetPackHeader *header = (const AssetPackHeader *)data;
+		if (size < sizeof(AssetPackHeader) || memcmp(header->magic, "ZPAK", 4) != 0 || header->version != ASSET_PACK_VERSION ||
+			header->indexOffset > size || (size - header->indexOffset) / sizeof(AssetPackEntry) < header->numEntries ||
+			size - header->indexOffset - header->numEntries * sizeof(AssetPackEntry) < header->namesSize)
+		{
+			cout << "ERROR::ASSET_PACK::INVALID_FILE " << path << endl;
+			this->Close();
+			return false;
+		}
+
+		this->entries = (const AssetPackEntry *)(data + header->indexOffset);
+		this->numEntries = header->numEntries;
+		this->names = (const char *)(this->entries + header->numEntries);
+		for (uint32_t i = 0; i < this->numEntries; i++)
+		{
+			const AssetPackEntry &entry = this->entries[i];
+			if (entry.offset > header->indexOffset || entry.size > header->indexOffset - entry.offset ||
+				(uint64_t)entry.nameOffset + entry.nameLength > header->namesSize)
+			{
+				cout << "ERROR::ASSET_PACK::INVALID_FILE " << path << endl;
+				this->Close();
+				return false;
+			}
+		}
+
+		cout << "Paquete de assets: " << this->numEntries << " archivos (" << size / (1024 * 1024) << " MB) en " << path << endl;
+		return true;
+	}
+
+	void Close()
+	{
+		this->file.Close();
+		this->entries = nullptr;
+		this->names = nullptr;
+		this->numEntries = 0;
+	}
+
+	bool IsOpen() const
+	{
+		return this->entries != nullptr;
+	}
+
+	// Contents of a packed file, or nullptr if the pack is closed or doesn't have it
+	const AssetPackEntry *Find(const string &path) const
+	{
+		if (!this->IsOpen())
+		{
+			return nullptr;
+		}
+
+		string name = Name(path);
+		const AssetPackEntry *first = this->entries, *last = this->entries + this->numEntries;
+		const AssetPackEntry *it = lower_bound(first, last, name, [this](const AssetPackEntry &entry, const string &key)
+		{
+			return this->compare(entry, key) < 0;
+		});
+		return it != last && this->compare(*it, name) == 0 ? it : nullptr;
+	}
+
+	const unsigned char *Data(const AssetPackEntry &entry) const
+	{
+		return this->file.Data() + entry.offset;
+	}
+
+	// Writes a pack with the given loose files. Returns false if one of them can't be read or the pack can't be written.
+	static bool Write(const string &path, const vector<string> &files)
+	{
+		// Sorted by name; the same file reached through two spellings is stored once
+		vector<pair<string, string> > sorted;
+		for (size_t i = 0; i < files.size(); i++)
+		{
+			sorted.push_back(make_pair(Name(files[i]), files[i]));
+		}
+		sort(sorted.begin(), sorted.end());
+		sorted.erase(unique(sorted.begin(), sorted.end(), [](const pair<string, string> &a, const pair<string, string> &b) { return a.first == b.first; }), sorted.end());
+
+		string temporaryPath = path + ".tmp";
+		FILE *out = fopen(temporaryPath.c_str(), "wb");
+		if (!out)
+		{
+			return false;
+		}
+
+		AssetPackHeader header;
+		memcpy(header.magic, "ZPAK", 4);
+		header.version = ASSET_PACK_VERSION;
+		header.numEntries = (uint32_t)sorted.size();
+		header.namesSize = 0;
+		header.indexOffset = 0;
+
+		vector<AssetPackEntry> entries(sorted.size());
+		string names;
+		uint64_t offset = sizeof(AssetPackHeader);
+		bool ok = fwrite(&header, sizeof(header), 1, out) == 1;
+		for (size_t i = 0; ok && i < sorted.size(); i++)
+		{
+			MappedFile source;
+			FileStamp stamp;
+			ok = source.Open(sorted[i].second) && GetFileStamp(sorted[i].second, stamp);
+			if (!ok)
+			{
+				cout << "ERROR::ASSET_PACK::CANNOT_READ " << sorted[i].second << endl;
+				break;
+			}
+
+			ok = writePadding(out, offset);
+			entries[i].offset = offset;
+			entries[i].size = source.Size();
+			entries[i].mtime = stamp.mtime;
+			entries[i].nameOffset = (uint32_t)names.size();
+			entries[i].nameLength = (uint32_t)sorted[i].first.size();
+			names += sorted[i].first;
+
+			ok = ok && fwrite(source.Data(), 1, source.Size(), out) == source.Size();
+			offset += source.Size();
+		}
+
+		ok = ok && writePadding(out, offset);
+		header.indexOffset = offset;
+		header.namesSize = (uint32_t)names.size();
+		ok = ok && (entries.empty() || fwrite(entries.data(), sizeof(AssetPackEntry), entries.size(), out) == entries.size());
+		ok = ok && fwrite(names.data(), 1, names.size(), out) == names.size();
+		ok = ok && fseek(out, 0, SEEK_SET) == 0 && fwrite(&header, sizeof(header), 1, out) == 1;
+		ok = (fclose(out) == 0) && ok;
+
+		if (!ok)
+		{
+			remove(temporaryPath.c_str());
+			return false;
+		}
+		remove(path.c_str());
+		return rename(temporaryPath.c_str(), path.c_str()) == 0;
+	}
+
+private:
+	MappedFile file;
+	const AssetPackEntry *entries = nullptr;
+	const char *names = nullptr;
+	uint32_t numEntries = 0;
+
+	static string Name(const string &path)
+	{
+		string name = CanonicalPath(path);
+		for (size_t i = 0; i < name.size(); i++)
+		{
+			name[i] = (char)tolower((unsigned char)name[i]);
+		}
+		return name;
+	}
+
+	int compare(const AssetPackEntry &entry, const string &name) const
+	{
+		int result = memcmp(this->names + entry.nameOffset, name.data(), min((size_t)entry.nameLength, name.size()));
+		if (result != 0)
+		{
+			return result;
+		}
+		return entry.nameLength < name.size() ? -1 : (entry.nameLength > name.size() ? 1 : 0);
+	}
+
+	static bool writePadding(FILE *out, uint64_t &offset)
+	{
+		static const char zeros[ASSET_PACK_ALIGNMENT] = { 0 };
+		size_t padding = (size_t)((ASSET_PACK_ALIGNMENT - offset % ASSET_PACK_ALIGNMENT) % ASSET_PACK_ALIGNMENT);
+		offset += padding;
+		return fwrite(zeros, 1, padding, out) == padding;
+	}
+};
+
+// A read-only view of an asset: the packed copy when the pack has it, the mapped loose file otherwise
+class AssetFile
+{
+public:
+	AssetFile() {}
+
+	bool Open(const string &path)
+	{
+		this->Close();
+		const AssetPackEntry *entry = AssetPack::Get().Find(path);
+		if (entry)
+		{
+			this->data = AssetPack::Get().Data(*entry);
+			this->size = (size_t)entry->size;
+			return true;
+		}
+		if (!this->file.Open(path))
+		{
+			return false;
+		}
+		this->data = this->file.Data();
+		this->size = this->file.Size();
+		return true;
+	}
+
+	void Close()
+	{
+		this->file.Close();
+		this->data = nullptr;
+		this->size = 0;
+	}
+
+	bool IsOpen() const
+	{
+		return this->data != nullptr;
+	}
+
+	const unsigned char *Data() const
+	{
+		return this->data;
+	}
+
+	size_t Size() const
+	{
+		return this->size;
+	}
+
+	AssetFile(const AssetFile &) = delete;
+	AssetFile &operator=(const AssetFile &) = delete;
+
+private:
+	MappedFile file;
+	const unsigned char *data = nullptr;
+	size_t size = 0;
+};
+
+// Stamp of an asset as GetFileStamp, taken from the pack when it has the file
+inline bool GetAssetStamp(const string &path, FileStamp &stamp)
+{
+	const AssetPackEntry *entry = AssetPack::Get().Find(path);
+	if (entry)
+	{
+		stamp.size = entry->size;
+		stamp.mtime = entry->mtime;
+		return true;
+	}
+	return GetFileStamp(path, stamp);
+}
+
+// Assimp stream over a packed file. Reads copy straight from the mapping; nothing is opened or buffered.
+class AssetPackIOStream : public Assimp::IOStream
+{
+public:
+	AssetPackIOStream(const unsigned char *data, size_t size) : data(data), size(size), position(0) {}
+
+	size_t Read(void *buffer, size_t elementSize, size_t count) override
+	{
+		if (elementSize == 0)
+		{
+			return 0;
+		}
+		size_t elements = min(count, (this->size - this->position) / elementSize);
+		memcpy(buffer, this->data + this->position, elements * elementSize);
+		this->position += elements * elementSize;
+		return elements;
+	}
+
+	size_t Write(const void *, size_t, size_t) override
+	{
+		return 0;
+	}
+
+	aiReturn Seek(size_t offset, aiOrigin origin) override
+	{
+		// Like Assimp's MemoryIOStream, an offset from the end counts backwards
+		if (origin == aiOrigin_END)
+		{
+			if (offset > this->size)
+			{
+				return aiReturn_FAILURE;
+			}
+			this->position = this->size - offset;
+			return aiReturn_SUCCESS;
+		}
+
+		size_t base = origin == aiOrigin_SET ? 0 : this->position;
+		if (offset > this->size - base)
+		{
+			return aiReturn_FAILURE;
+		}
+		this->position = base + offset;
+		return aiReturn_SUCCESS;
+	}
+
+	size_t Tell() const override
+	{
+		return this->position;
+	}
+
+	size_t FileSize() const override
+	{
+		return this->size;
+	}
+
+	void Flush() override
+	{
+	}
+
+private:
+	const unsigned char *data;
+	size_t size;
+	size_t position;
+};
+
+// Lets Assimp (and the .mtl files an .obj pulls in) read from the pack, falling back to disk for the rest
+class AssetPackIOSystem : public Assimp::DefaultIOSystem
+{
+public:
+	bool Exists(const char *path) const override
+	{
+		return AssetPack::Get().Find(path) != nullptr || Assimp::DefaultIOSystem::Exists(path);
+	}
+
+	Assimp::IOStream *Open(const char *path, const char *mode = "rb") override
+	{
+		const AssetPackEntry *entry = strchr(mode, 'w') == nullptr ? AssetPack::Get().Find(path) : nullptr;
+		if (entry)
+		{
+			return new AssetPackIOStream(AssetPack::Get().Data(*entry), (size_t)entry->size);
+		}
+		return Assimp::DefaultIOSystem::Open(path, mode);
+	}
+
+	void Close(Assimp::IOStream *stream) override
+	{
+		delete stream;
+	}
+};
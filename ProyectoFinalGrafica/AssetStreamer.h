@@ -0,0 +1,279 @@
+#pragma once
+
+#include <set>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <iostream>
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include "Model.h"
+#include "AssetLoader.h"
+
+using namespace std;
+
+/*
+	Habitat streaming.
+
+	Every model created between BeginUnit() and EndUnit() belongs to that streaming unit and is not loaded by its
+	constructor. Update() runs once per frame on the GL thread, after giving the UploadQueue its budget for the frame:
+		- a unit whose center is closer to the camera than its load radius is enqueued on the AssetLoader, and its
+		  models stay hidden (their draws are skipped) until every one of them is uploaded;
+		- while the resident units take more than either memory budget, the farthest unit beyond its unload radius
+		  is evicted. Units inside their unload radius are never evicted, so a budget smaller than what is around
+		  the camera only stops further units from being kept, not the ones in view.
+
+	The GPU budget counts the GPU bytes of the models (buffers plus textures), which are allocated as soon as a model
+	is uploaded. The CPU budget counts the heap the meshes keep after their upload, which is nothing with the default
+	MESH_MIRROR_DROP but the positions and indices (compact) or the whole loaded mesh (full) with --cpu-mirror.
+	Pages mapped from the cache or the .glb files are left out, the system can drop them.
+*/
+
+enum StreamingState
+{
+	STREAMING_UNLOADED,
+	STREAMING_LOADING,
+	STREAMING_RESIDENT
+};
+
+struct StreamingUnit
+{
+	string name;
+	glm::vec3 center;
+	float loadRadius;
+	float unloadRadius; // Larger than loadRadius so a unit at the edge isn't loaded and evicted over and over
+	vector<Model *> models;
+
+	StreamingState state = STREAMING_UNLOADED;
+	chrono::steady_clock::time_point loadStart;
+};
+
+class AssetStreamer
+{
+public:
+	static AssetStreamer &Get()
+	{
+		static AssetStreamer streamer;
+		return streamer;
+	}
+
+	// Maximum GPU bytes the streaming units may keep resident. 0 means no limit.
+	void SetBudget(size_t bytes)
+	{
+		this->budget = bytes;
+	}
+
+	// Maximum heap bytes the CPU mirrors of the streaming units may keep. 0 means no limit.
+	void SetCpuBudget(size_t bytes)
+	{
+		this->cpuBudget = bytes;
+	}
+
+	// Models created until EndUnit() belong to the unit and are loaded by Update()
+	void BeginUnit(const string &name, glm::vec3 center, float loadRadius, float unloadRadius)
+	{
+		StreamingUnit unit;
+		unit.name = name;
+		unit.center = center;
+		unit.loadRadius = loadRadius;
+		unit.unloadRadius = unloadRadius;
+		this->units.push_back(unit);
+
+		Model::DeferredModels() = &this->units.back().models;
+	}
+
+	void EndUnit()
+	{
+		Model::DeferredModels() = nullptr;
+	}
+
+	// Once per frame, from the GL thread
+	void Update(glm::vec3 cameraPosition)
+	{
+		AssetLoader::Get().Poll();
+		UploadQueue::Get().Process();
+
+		for (size_t i = 0; i < this->units.size(); i++)
+		{
+			StreamingUnit &unit = this->units[i];
+			float distance = Distance(unit, cameraPosition);
+
+			if (unit.state == STREAMING_UNLOADED && distance < unit.loadRadius)
+			{
+				this->load(unit);
+			}
+			if (unit.state == STREAMING_LOADING && this->isReady(unit))
+			{
+				unit.state = STREAMING_RESIDENT;
+				for (size_t j = 0; j < unit.models.size(); j++)
+				{
+					unit.models[j]->hidden = false;
+				}
+				cout << "Habitat " << unit.name << " listo en " << elapsedMs(unit.loadStart) << " ms ("
+					<< UnitBytes(unit) / (1024.0 * 1024.0) << " MB, RAM " << UnitCpuBytes(unit) / (1024.0 * 1024.0) << " MB)" << endl;
+			}
+		}
+
+		this->enforceBudget(cameraPosition);
+	}
+
+	// GPU bytes of every unit that is loading or resident
+	size_t ResidentBytes() const
+	{
+		size_t bytes = 0;
+		for (size_t i = 0; i < this->units.size(); i++)
+		{
+			bytes += UnitBytes(this->units[i]);
+		}
+		return bytes;
+	}
+
+	// Heap bytes kept by the CPU mirrors of every unit that is loading or resident
+	size_t ResidentCpuBytes() const
+	{
+		size_t bytes = 0;
+		for (size_t i = 0; i < this->units.size(); i++)
+		{
+			bytes += UnitCpuBytes(this->units[i]);
+		}
+		return bytes;
+	}
+
+	void PrintSummary() const
+	{
+		cout << "Streaming: ";
+		for (size_t i = 0; i < this->units.size(); i++)
+		{
+			const char *state = this->units[i].state == STREAMING_RESIDENT ? "residente" :
+				this->units[i].state == STREAMING_LOADING ? "cargando" : "descargado";
+			cout << this->units[i].name << " " << state << (i + 1 < this->units.size() ? ", " : "");
+		}
+		cout << " | " << this->ResidentBytes() / (1024.0 * 1024.0) << " MB";
+		if (this->budget > 0)
+		{
+			cout << " de " << this->budget / (1024.0 * 1024.0) << " MB";
+		}
+		cout << " | RAM " << this->ResidentCpuBytes() / (1024.0 * 1024.0) << " MB";
+		if (this->cpuBudget > 0)
+		{
+			cout << " de " << this->cpuBudget / (1024.0 * 1024.0) << " MB";
+		}
+		cout << endl;
+	}
+
+private:
+	vector<StreamingUnit> units;
+	size_t budget = 256 * 1024 * 1024;
+	size_t cpuBudget = 256 * 1024 * 1024;
+
+	void load(StreamingUnit &unit)
+	{
+		unit.state = STREAMING_LOADING;
+		unit.loadStart = chrono::steady_clock::now();
+		for (size_t i = 0; i < unit.models.size(); i++)
+		{
+			unit.models[i]->hidden = true;
+			unit.models[i]->Load();
+		}
+	}
+
+	void unload(StreamingUnit &unit)
+	{
+		size_t bytes = UnitBytes(unit);
+		unit.state = STREAMING_UNLOADED;
+		for (size_t i = 0; i < unit.models.size(); i++)
+		{
+			unit.models[i]->Unload();
+		}
+		cout << "Habitat " << unit.name << " descargado (" << bytes / (1024.0 * 1024.0) << " MB)" << endl;
+	}
+
+	bool isReady(const StreamingUnit &unit) const
+	{
+		for (size_t i = 0; i < unit.models.size(); i++)
+		{
+			if (!unit.models[i]->IsReady())
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	// Evicts the farthest units that are out of their unload radius until the resident bytes fit both budgets
+	void enforceBudget(glm::vec3 cameraPosition)
+	{
+		if (this->budget == 0 && this->cpuBudget == 0)
+		{
+			return;
+		}
+
+		while (this->overBudget())
+		{
+			StreamingUnit *farthest = nullptr;
+			float farthestDistance = 0.0f;
+			for (size_t i = 0; i < this->units.size(); i++)
+			{
+				StreamingUnit &unit = this->units[i];
+				float distance = Distance(unit, cameraPosition);
+				if (unit.state != STREAMING_UNLOADED && distance > unit.unloadRadius && distance > farthestDistance)
+				{
+					farthest = &unit;
+					farthestDistance = distance;
+				}
+			}
+			if (!farthest)
+			{
+				return;
+			}
+
+			this->unload(*farthest);
+		}
+	}
+
+	bool overBudget() const
+	{
+		return (this->budget > 0 && this->ResidentBytes() > this->budget) || (this->cpuBudget > 0 && this->ResidentCpuBytes() > this->cpuBudget);
+	}
+
+	// Distance on the ground plane, the height of the camera doesn't matter
+	static float Distance(const StreamingUnit &unit, glm::vec3 position)
+	{
+		float dx = position.x - unit.center.x;
+		float dz = position.z - unit.center.z;
+		return sqrtf(dx * dx + dz * dz);
+	}
+
+	// Each shared asset is counted once per unit (e.g. the three lotos of the Selva)
+	static size_t UnitBytes(const StreamingUnit &unit)
+	{
+		return SumAssets(unit, &ModelAsset::gpuBytes);
+	}
+
+	static size_t UnitCpuBytes(const StreamingUnit &unit)
+	{
+		return SumAssets(unit, &ModelAsset::cpuBytes);
+	}
+
+	static size_t SumAssets(const StreamingUnit &unit, size_t ModelAsset::*field)
+	{
+		set<const ModelAsset *> assets;
+		size_t bytes = 0;
+		for (size_t i = 0; i < unit.models.size(); i++)
+		{
+			const ModelAsset *asset = unit.models[i]->Asset();
+			if (asset && assets.insert(asset).second)
+			{
+				bytes += asset->*field;
+			}
+		}
+		return bytes;
+	}
+
+	static double elapsedMs(chrono::steady_clock::time_point start)
+	{
+		return chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+	}
+};
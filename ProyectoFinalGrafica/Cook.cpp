@@ -0,0 +1,882 @@
+/*
+================================================================================
+	ZOO-COOK - COCINADO DE ASSETS
+	Herramienta fuera de línea del Zoológico Virtual
+================================================================================
+
+DESCRIPCIÓN:
+	Recorre Models/, images/ e images/skybox/ y convierte cada fuente a un
+	formato listo para la GPU dentro de Cooked/:
+		- .obj -> malla procesada (.zmc): soldada, optimizada para la caché de
+		  vértices, overdraw y lectura, con sus niveles de detalle. Es el mismo
+		  formato que Cache/Meshes, así que el juego la mapea y la sube tal cual.
+		- imágenes -> .dds DXT1 (sin alfa) o DXT5 (con alfa) con toda la
+		  cadena de mipmaps ya generada. De cada textura cocinada se imprime el
+		  error visual (PSNR y error máximo por canal, ver TextureCooker.h) y
+		  cuánta memoria de video ahorra frente a RGBA8.
+	Cooked/manifest.txt relaciona cada fuente con su archivo cocinado (ver
+	CookedAssets.h). El juego prefiere lo cocinado y usa Assimp/SOIL solo
+	cuando falta o la fuente cambió.
+
+COCINADO INCREMENTAL:
+	Cada fuente se identifica por el hash de su contenido (para un .obj también
+	el de sus .mtl). Solo se vuelve a cocinar lo que cambió de hash o cuyo
+	archivo cocinado ya no existe; lo demás solo actualiza su fecha en el
+	manifiesto. Las fuentes que desaparecieron se borran de Cooked/.
+
+USO (desde la carpeta del proyecto, igual que el juego):
+	zoo-cook [--force] [--threads N] [--pack] [--native-obj]
+		--force      Cocina todo aunque no haya cambiado
+		--threads N  Hilos de trabajo (por defecto uno por núcleo)
+		--native-obj Lee los .obj con ObjLoader en lugar de Assimp, como el
+		             juego con la misma opción
+		--pack       Además empaqueta Models/ e images/ completos en assets.zpak
+		             (ver AssetPack.h), que el juego mapea una sola vez al iniciar
+	zoo-cook --bench-obj
+		No cocina nada: lee cada .obj de Models/ con Assimp y con ObjLoader,
+		compara el tiempo de ambos y comprueba que las mallas sean iguales
+	zoo-cook --check-obj
+		Solo la comprobación de --bench-obj, leyendo cada archivo una vez.
+		Termina con error si alguna malla de ObjLoader no es la de Assimp
+	zoo-cook --bench-dxt [--threads N]
+		No cocina nada: comprime cada imagen de images/ y Models/ con el
+		codificador DXT escalar, con el SSE2 en un hilo y con el SSE2 en N
+		hilos, compara el tiempo y comprueba que los bloques sean iguales (o
+		que el PSNR no cambie más de DXT_BENCH_TOLERANCE dB)
+================================================================================
+*/
+
+#include <map>
+#include <cmath>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <algorithm>
+
+#include <GL/glew.h>
+#include "stb_image.h"
+
+#include "Model.h"
+#include "MappedFile.h"
+#include "MeshCache.h"
+#include "CookedAssets.h"
+#include "DdsFile.h"
+#include "TextureCooker.h"
+#include "AssetPack.h"
+#include "ObjLoader.h"
+#include "GlbFile.h"
+
+#ifdef _WIN32
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+using namespace std;
+
+// Resultado de cada fuente
+enum CookResult
+{
+	COOK_UP_TO_DATE,
+	COOK_COOKED,
+	COOK_FAILED
+};
+
+struct CookJob
+{
+	CookedKind kind;
+	string source;      // Ruta canónica de la fuente
+	CookedEntry entry;  // Entrada del manifiesto tras procesarla
+	CookResult result;
+	TextureCookStats stats; // De una textura recién cocinada
+};
+
+static bool EndsWith(const string &text, const string &suffix)
+{
+	if (text.size() < suffix.size())
+	{
+		return false;
+	}
+	for (size_t i = 0; i < suffix.size(); i++)
+	{
+		if (tolower((unsigned char)text[text.size() - suffix.size() + i]) != suffix[i])
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+// Bibliotecas de materiales que nombra un .obj ya mapeado (líneas "mtllib archivo.mtl"), con la carpeta del .obj
+static vector<string> MaterialLibraries(const string &obj, const MappedFile &file)
+{
+	vector<string> libraries;
+	string directory = obj.substr(0, obj.find_last_of('/'));
+	const char *data = (const char *)file.Data();
+	size_t size = file.Size();
+	for (size_t i = 0; i + 7 < size; i++)
+	{
+		if ((i == 0 || data[i - 1] == '\n') && strncmp(data + i, "mtllib ", 7) == 0)
+		{
+			size_t end = i + 7;
+			while (end < size && data[end] != '\n' && data[end] != '\r')
+			{
+				end++;
+			}
+			libraries.push_back(directory + "/" + string(data + i + 7, end - i - 7));
+		}
+	}
+	return libraries;
+}
+
+// Hash del contenido de la fuente. Un .obj incluye sus bibliotecas de materiales, que deciden sus texturas.
+static bool ContentHash(const CookJob &job, uint64_t &hash)
+{
+	MappedFile file;
+	if (!file.Open(job.source))
+	{
+		return false;
+	}
+	hash = HashBytes(file.Data(), file.Size());
+	if (job.kind != COOKED_MESH)
+	{
+		return true;
+	}
+
+	vector<string> libraries = MaterialLibraries(job.source, file);
+	for (size_t i = 0; i < libraries.size(); i++)
+	{
+		MappedFile material;
+		if (material.Open(libraries[i]))
+		{
+			hash = (hash ^ HashBytes(material.Data(), material.Size())) * 1099511628211ULL;
+		}
+	}
+	return true;
+}
+
+static bool CookMesh(const string &source, const string &cookedPath)
+{
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+
+	Assimp::Importer importer;
+	vector<MeshData> meshes;
+	if (!Model::ImportScene(source, importer, meshes))
+	{
+		return false;
+	}
+
+	double importMs = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+	return MeshCache::WriteFile(cookedPath, source, meshes, importMs);
+}
+
+// Decide si la fuente cambió y, si hace falta, la cocina
+// Las texturas grandes se comprimen en hasta stripThreads franjas en el AssetLoader (ver TextureCooker::Compress)
+static void ProcessJob(CookJob &job, const CookedManifest &previous, bool force, unsigned stripThreads)
+{
+	job.result = COOK_FAILED;
+
+	uint64_t hash;
+	FileStamp stamp;
+	if (!GetFileStamp(job.source, stamp) || !ContentHash(job, hash))
+	{
+		return;
+	}
+
+	FileStamp cookedStamp;
+	const CookedEntry *old = previous.Find(job.source);
+	if (!force && old && old->kind == job.kind && old->contentHash == hash && GetFileStamp(old->cooked, cookedStamp))
+	{
+		job.entry = *old;
+		job.entry.stamp = stamp;
+		job.result = COOK_UP_TO_DATE;
+		return;
+	}
+
+	job.entry.kind = job.kind;
+	job.entry.source = job.source;
+	job.entry.contentHash = hash;
+	job.entry.stamp = stamp;
+	job.entry.channels = 0;
+	job.entry.cooked = CookedFilePath(job.source, job.kind);
+
+	bool ok = job.kind == COOKED_MESH ? CookMesh(job.source, job.entry.cooked) :
+		TextureCooker::Cook(job.source, job.entry.cooked, job.entry.channels, job.stats, stripThreads);
+	job.result = ok ? COOK_COOKED : COOK_FAILED;
+}
+
+// Tolerancia al comparar: los dos lectores convierten los decimales con algoritmos distintos
+static bool NearlyEqual(float a, float b, float scale)
+{
+	return fabs(a - b) <= 1e-5f * max(1.0f, scale);
+}
+
+static bool SameVertex(const Vertex &a, const Vertex &b)
+{
+	for (int k = 0; k < 3; k++)
+	{
+		if (!NearlyEqual(a.Position[k], b.Position[k], fabs(a.Position[k])) || !NearlyEqual(a.Normal[k], b.Normal[k], 1.0f))
+		{
+			return false;
+		}
+	}
+	return NearlyEqual(a.TexCoords.x, b.TexCoords.x, 1.0f) && NearlyEqual(a.TexCoords.y, b.TexCoords.y, 1.0f);
+}
+
+static double TriangleArea(const MeshData &mesh, size_t triangle)
+{
+	const glm::vec3 &a = mesh.vertices[mesh.indices[triangle * 3]].Position;
+	const glm::vec3 &b = mesh.vertices[mesh.indices[triangle * 3 + 1]].Position;
+	const glm::vec3 &c = mesh.vertices[mesh.indices[triangle * 3 + 2]].Position;
+	return 0.5 * glm::length(glm::cross(b - a, c - a));
+}
+
+// Resultado de comparar las mallas de ObjLoader con las de Assimp
+enum MeshComparison
+{
+	MESHES_IDENTICAL,
+	MESHES_EQUIVALENT, // Solo cambia la diagonal con la que se partieron algunos poligonos: mismos triangulos y misma area
+	MESHES_DIFFERENT
+};
+
+// Compara triangulo por triangulo y en orden, con los valores de sus vertices (no los indices)
+static MeshComparison CompareMeshes(const vector<MeshData> &expected, const vector<MeshData> &actual, string &difference)
+{
+	if (expected.size() != actual.size())
+	{
+		difference = to_string(expected.size()) + " mallas con Assimp y " + to_string(actual.size()) + " con ObjLoader";
+		return MESHES_DIFFERENT;
+	}
+
+	MeshComparison result = MESHES_IDENTICAL;
+	for (size_t m = 0; m < expected.size(); m++)
+	{
+		const MeshData &a = expected[m], &b = actual[m];
+		string malla = "malla " + to_string(m) + ": ";
+
+		bool sameTextures = a.textures.size() == b.textures.size();
+		for (size_t t = 0; sameTextures && t < a.textures.size(); t++)
+		{
+			sameTextures = a.textures[t].type == b.textures[t].type && a.textures[t].path == b.textures[t].path;
+		}
+		if (!sameTextures)
+		{
+			difference = malla + "texturas distintas";
+			return MESHES_DIFFERENT;
+		}
+		if (a.indices.size() / 3 != b.indices.size() / 3)
+		{
+			difference = malla + to_string(a.indices.size() / 3) + " triangulos con Assimp y " + to_string(b.indices.size() / 3) + " con ObjLoader";
+			return MESHES_DIFFERENT;
+		}
+
+		size_t mismatched = 0;
+		double areaA = 0.0, areaB = 0.0;
+		for (size_t t = 0; t < a.indices.size() / 3; t++)
+		{
+			bool same = true;
+			for (int k = 0; k < 3 && same; k++)
+			{
+				same = SameVertex(a.vertices[a.indices[t * 3 + k]], b.vertices[b.indices[t * 3 + k]]);
+			}
+			if (!same)
+			{
+				mismatched++;
+				areaA += TriangleArea(a, t);
+				areaB += TriangleArea(b, t);
+			}
+		}
+		if (mismatched == 0)
+		{
+			continue;
+		}
+		if (fabs(areaA - areaB) > 1e-4 * max(areaA, 1e-6))
+		{
+			difference = malla + to_string(mismatched) + " triangulos distintos";
+			return MESHES_DIFFERENT;
+		}
+		difference = malla + to_string(mismatched) + " triangulos con otra diagonal";
+		result = MESHES_EQUIVALENT;
+	}
+	return result;
+}
+
+static double ElapsedMs(chrono::steady_clock::time_point start)
+{
+	return chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+}
+
+// Todos los .obj de Models/, ordenados
+static vector<string> ListObjs()
+{
+	vector<string> files, objs;
+	ListFiles("Models", true, files);
+	for (size_t i = 0; i < files.size(); i++)
+	{
+		if (EndsWith(files[i], ".obj"))
+		{
+			objs.push_back(CanonicalPath(files[i]));
+		}
+	}
+	sort(objs.begin(), objs.end());
+	return objs;
+}
+
+// Lee cada .obj de Models/ con los dos lectores y compara el resultado. Con timed se mide el mejor de
+// OBJ_BENCH_RUNS intentos; sin el, cada archivo se lee una vez y solo se comprueba.
+// ObjLoader reparte los archivos grandes en el AssetLoader, asi que aqui tambien se parten en trozos.
+#define OBJ_BENCH_RUNS 3
+static int BenchObj(bool timed)
+{
+	vector<string> objs = ListObjs();
+	AssetLoader::Get().Start();
+
+	double totalAssimp = 0.0, totalNative = 0.0;
+	GLuint identical = 0, equivalent = 0, different = 0;
+	for (size_t i = 0; i < objs.size(); i++)
+	{
+		vector<MeshData> expected, actual;
+		double assimpMs = 1e30, nativeMs = 1e30;
+		for (int run = 0; run < (timed ? OBJ_BENCH_RUNS : 1); run++)
+		{
+			Assimp::Importer importer;
+			chrono::steady_clock::time_point start = chrono::steady_clock::now();
+			Model::ReadMeshes(objs[i], importer, false, expected);
+			assimpMs = min(assimpMs, ElapsedMs(start));
+
+			start = chrono::steady_clock::now();
+			ObjLoader::Load(objs[i], actual);
+			nativeMs = min(nativeMs, ElapsedMs(start));
+		}
+		totalAssimp += assimpMs;
+		totalNative += nativeMs;
+
+		string difference;
+		MeshComparison comparison = CompareMeshes(expected, actual, difference);
+		(comparison == MESHES_IDENTICAL ? identical : (comparison == MESHES_EQUIVALENT ? equivalent : different))++;
+
+		cout << objs[i] << ": ";
+		if (timed)
+		{
+			cout << "Assimp " << assimpMs << " ms | ObjLoader " << nativeMs << " ms | x" << assimpMs / max(nativeMs, 1e-3) << " | ";
+		}
+		cout << (comparison == MESHES_IDENTICAL ? "iguales" : (comparison == MESHES_EQUIVALENT ? "equivalentes (" + difference + ")" : "DISTINTAS (" + difference + ")")) << endl;
+	}
+	AssetLoader::Get().Finish();
+
+	cout << (timed ? "bench-obj: " : "check-obj: ") << objs.size() << " archivos | ";
+	if (timed)
+	{
+		cout << "Assimp " << totalAssimp << " ms | ObjLoader " << totalNative << " ms | x" << totalAssimp / max(totalNative, 1e-3) << " | ";
+	}
+	cout << identical << " iguales, " << equivalent << " equivalentes, " << different << " distintas" << endl;
+	return different > 0 ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+// Procesa el .obj como lo hace el juego (ObjLoader, optimizacion y niveles de detalle) y lo guarda como .glb.
+// El .glb anota el .obj, sus .mtl y sus texturas para saber cuando queda viejo (ver GlbFile::Current).
+static bool ConvertToGlb(const string &obj)
+{
+	Assimp::Importer importer;
+	vector<MeshData> meshes;
+	MappedFile file;
+	if (!file.Open(obj) || !Model::ImportScene(obj, importer, meshes))
+	{
+		return false;
+	}
+
+	vector<string> dependencies = MaterialLibraries(obj, file);
+	dependencies.insert(dependencies.begin(), obj);
+	string directory = obj.substr(0, obj.find_last_of('/'));
+	for (size_t m = 0; m < meshes.size(); m++)
+	{
+		for (size_t t = 0; t < meshes[m].textures.size(); t++)
+		{
+			string texture = directory + "/" + meshes[m].textures[t].path;
+			if (find(dependencies.begin(), dependencies.end(), texture) == dependencies.end())
+			{
+				dependencies.push_back(texture);
+			}
+		}
+	}
+	return GlbFile::Write(GlbFile::PathFor(obj), meshes, dependencies);
+}
+
+// El .glb del .obj existe y sigue al dia con sus archivos y con el procesado de esta version
+static bool GlbUpToDate(const string &obj)
+{
+	FileStamp stamp;
+	GlbFile glb;
+	return GetFileStamp(GlbFile::PathFor(obj), stamp) && glb.Open(GlbFile::PathFor(obj)) && glb.Current();
+}
+
+// Convierte los .obj cuyo .glb falta o quedo viejo (todos con force)
+static int ToGlb(bool force)
+{
+	vector<string> objs = ListObjs();
+	GLuint failed = 0, upToDate = 0;
+	for (size_t i = 0; i < objs.size(); i++)
+	{
+		if (!force && GlbUpToDate(objs[i]))
+		{
+			upToDate++;
+			continue;
+		}
+		bool ok = ConvertToGlb(objs[i]);
+		failed += ok ? 0 : 1;
+		cout << (ok ? "Convertido " : "ERROR::COOK::FAILED ") << GlbFile::PathFor(objs[i]) << endl;
+	}
+	cout << "to-glb: " << objs.size() - failed - upToDate << " convertidos, " << upToDate << " al dia, " << failed << " errores" << endl;
+	return failed > 0 ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+// Pico de memoria residente del proceso en bytes. Nunca baja, asi que cada fase mide lo que sube sobre la anterior.
+static size_t PeakMemory()
+{
+#ifdef _WIN32
+	PROCESS_MEMORY_COUNTERS counters;
+	return GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)) ? counters.PeakWorkingSetSize : 0;
+#else
+	struct rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+	return (size_t)usage.ru_maxrss * 1024;
+#endif
+}
+
+// Suma de los vertices e indices, para que ninguna de las dos rutas se quede sin leer sus datos
+static uint64_t Touch(const vector<MeshData> &meshes)
+{
+	uint64_t sum = 0;
+	for (size_t m = 0; m < meshes.size(); m++)
+	{
+		const uint32_t *words = (const uint32_t *)meshes[m].vertexData;
+		for (size_t i = 0; i < meshes[m].numVertices * sizeof(Vertex) / sizeof(uint32_t); i++)
+		{
+			sum += words[i];
+		}
+		for (GLuint i = 0; i < meshes[m].numIndices; i++)
+		{
+			sum += meshes[m].indexData[i];
+		}
+	}
+	return sum;
+}
+
+// Las dos rutas deben dar exactamente los mismos bytes: el .glb guarda el resultado del procesado tal cual
+static bool SameMeshes(const vector<MeshData> &expected, const vector<MeshData> &actual, string &difference)
+{
+	if (expected.size() != actual.size())
+	{
+		difference = to_string(expected.size()) + " mallas del .obj y " + to_string(actual.size()) + " del .glb";
+		return false;
+	}
+	for (size_t m = 0; m < expected.size(); m++)
+	{
+		const MeshData &a = expected[m], &b = actual[m];
+		string malla = "malla " + to_string(m) + ": ";
+		if (a.numVertices != b.numVertices || a.numIndices != b.numIndices || memcmp(a.vertexData, b.vertexData, a.numVertices * sizeof(Vertex)) != 0 ||
+			memcmp(a.indexData, b.indexData, a.numIndices * sizeof(GLuint)) != 0)
+		{
+			difference = malla + "geometria distinta";
+			return false;
+		}
+		bool sameLods = a.numLods == b.numLods;
+		for (GLuint l = 0; sameLods && l < a.numLods; l++)
+		{
+			sameLods = a.lods[l].firstIndex == b.lods[l].firstIndex && a.lods[l].numIndices == b.lods[l].numIndices;
+		}
+		if (!sameLods)
+		{
+			difference = malla + "niveles de detalle distintos";
+			return false;
+		}
+		bool sameTextures = a.textures.size() == b.textures.size();
+		for (size_t t = 0; sameTextures && t < a.textures.size(); t++)
+		{
+			sameTextures = a.textures[t].type == b.textures[t].type && a.textures[t].path == b.textures[t].path;
+		}
+		if (!sameTextures)
+		{
+			difference = malla + "texturas distintas";
+			return false;
+		}
+	}
+	return true;
+}
+
+// Compara la carga de cada .glb (mapeado, sin copias) con la de su .obj (leido y procesado, como sin cache).
+// La ruta .glb se mide primero para que el pico de memoria de la otra no la tape.
+static int BenchGlb()
+{
+	vector<string> objs = ListObjs();
+	for (size_t i = 0; i < objs.size(); i++)
+	{
+		if (!GlbUpToDate(objs[i]) && !ConvertToGlb(objs[i]))
+		{
+			cout << "ERROR::COOK::FAILED " << GlbFile::PathFor(objs[i]) << endl;
+			return EXIT_FAILURE;
+		}
+	}
+
+	uint64_t glbSum = 0, objSum = 0;
+	vector<double> glbMs(objs.size()), objMs(objs.size());
+	size_t basePeak = PeakMemory();
+	for (size_t i = 0; i < objs.size(); i++)
+	{
+		chrono::steady_clock::time_point start = chrono::steady_clock::now();
+		GlbFile glb;
+		vector<MeshData> meshes;
+		if (!glb.Open(GlbFile::PathFor(objs[i])) || !glb.ReadMeshes(meshes))
+		{
+			return EXIT_FAILURE;
+		}
+		glbSum += Touch(meshes);
+		glbMs[i] = ElapsedMs(start);
+	}
+	size_t glbPeak = PeakMemory();
+
+	// Los mensajes del optimizador no son parte de la medida
+	streambuf *output = cout.rdbuf(nullptr);
+	for (size_t i = 0; i < objs.size(); i++)
+	{
+		chrono::steady_clock::time_point start = chrono::steady_clock::now();
+		Assimp::Importer importer;
+		vector<MeshData> meshes;
+		Model::ImportScene(objs[i], importer, meshes);
+		objSum += Touch(meshes);
+		objMs[i] = ElapsedMs(start);
+	}
+	size_t objPeak = PeakMemory();
+
+	// Fidelidad: las mismas mallas por las dos rutas
+	vector<string> differences(objs.size());
+	for (size_t i = 0; i < objs.size(); i++)
+	{
+		Assimp::Importer importer;
+		GlbFile glb;
+		vector<MeshData> expected, actual;
+		if (!Model::ImportScene(objs[i], importer, expected) || !glb.Open(GlbFile::PathFor(objs[i])) || !glb.ReadMeshes(actual))
+		{
+			differences[i] = "no se pudo leer";
+		}
+		else if (!SameMeshes(expected, actual, differences[i]) && differences[i].empty())
+		{
+			differences[i] = "distintas";
+		}
+	}
+	cout.rdbuf(output);
+
+	double totalGlb = 0.0, totalObj = 0.0;
+	GLuint different = 0;
+	for (size_t i = 0; i < objs.size(); i++)
+	{
+		totalGlb += glbMs[i];
+		totalObj += objMs[i];
+		different += differences[i].empty() ? 0 : 1;
+		cout << objs[i] << ": .obj " << objMs[i] << " ms | .glb " << glbMs[i] << " ms | x" << objMs[i] / max(glbMs[i], 1e-3) << " | "
+			<< (differences[i].empty() ? "iguales" : "DISTINTAS (" + differences[i] + ")") << endl;
+	}
+
+	cout << "bench-glb: " << objs.size() << " archivos | .obj " << totalObj << " ms | .glb " << totalGlb << " ms | x" << totalObj / max(totalGlb, 1e-3)
+		<< " | pico de memoria .glb +" << (glbPeak - basePeak) / (1024 * 1024) << " MB, .obj +" << (objPeak - glbPeak) / (1024 * 1024) << " MB sobre el anterior"
+		<< " | " << different << " distintas" << (glbSum == objSum ? "" : " (las sumas de los datos no coinciden)") << endl;
+	return different > 0 || glbSum != objSum ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+// Comprime el nivel base de cada imagen de images/ y Models/ con el codificador escalar, con el SSE2 en un hilo y con
+// el SSE2 en numThreads hilos (el mejor de DXT_BENCH_RUNS intentos), y compara los bloques con los del escalar
+#define DXT_BENCH_RUNS 3
+#define DXT_BENCH_TOLERANCE 0.05
+static int BenchDxt(unsigned numThreads)
+{
+	vector<string> files, images;
+	ListFiles("images", true, files);
+	ListFiles("Models", true, files);
+	for (size_t i = 0; i < files.size(); i++)
+	{
+		if (TextureCooker::IsImage(files[i]))
+		{
+			images.push_back(CanonicalPath(files[i]));
+		}
+	}
+	sort(images.begin(), images.end());
+
+	// Escalar, SSE2 en un hilo, SSE2 en todos
+	const int simd[3] = { 0, 1, 1 };
+	const unsigned threads[3] = { 1, 1, numThreads };
+	double totalMs[3] = { 0.0, 0.0, 0.0 };
+	double megapixels = 0.0;
+	GLuint identical = 0, tolerated = 0, different = 0;
+	int previous = DXT_use_SIMD(1);
+
+	// Las franjas van al AssetLoader: con el hilo que llama son numThreads
+	AssetLoader::Get().Start(max(numThreads - 1, 1u));
+	for (size_t i = 0; i < images.size(); i++)
+	{
+		MappedFile file;
+		int width, height, channels;
+		unsigned char *data = file.Open(images[i]) ? stbi_load_from_memory(file.Data(), (int)file.Size(), &width, &height, &channels, 0) : nullptr;
+		if (!data)
+		{
+			cout << "ERROR::COOK::FAILED " << images[i] << endl;
+			continue;
+		}
+		vector<unsigned char> pixels(data, data + (size_t)width * height * channels);
+		stbi_image_free(data);
+		GLenum format = (channels & 1) ? GL_COMPRESSED_RGB_S3TC_DXT1_EXT : GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+
+		vector<unsigned char> blocks[3];
+		double ms[3] = { 1e30, 1e30, 1e30 };
+		for (int run = 0; run < DXT_BENCH_RUNS; run++)
+		{
+			for (int k = 0; k < 3; k++)
+			{
+				DXT_use_SIMD(simd[k]);
+				chrono::steady_clock::time_point start = chrono::steady_clock::now();
+				TextureCooker::Compress(pixels.data(), width, height, channels, format, threads[k], blocks[k]);
+				ms[k] = min(ms[k], ElapsedMs(start));
+			}
+		}
+		megapixels += (double)width * height / 1e6;
+		for (int k = 0; k < 3; k++)
+		{
+			totalMs[k] += ms[k];
+		}
+
+		// Los bloques deberian ser los mismos; si el compilador fusiono multiplicaciones y sumas en uno de los dos
+		// caminos pueden cambiar algunos, y basta con que la calidad no cambie
+		string comparison = "iguales";
+		if (blocks[1] != blocks[0] || blocks[2] != blocks[0])
+		{
+			double psnr = TextureCooker::Psnr(pixels, width, height, channels, blocks[0], format);
+			double worst = min(TextureCooker::Psnr(pixels, width, height, channels, blocks[1], format),
+				TextureCooker::Psnr(pixels, width, height, channels, blocks[2], format));
+			bool withinTolerance = isinf(psnr) ? isinf(worst) : psnr - worst <= DXT_BENCH_TOLERANCE;
+			comparison = (withinTolerance ? "distintas dentro de tolerancia (PSNR " : "DISTINTAS (PSNR ") + to_string(psnr) + " -> " + to_string(worst) + " dB)";
+			(withinTolerance ? tolerated : different)++;
+		}
+		else
+		{
+			identical++;
+		}
+
+		cout << images[i] << ": " << width << "x" << height << (format == GL_COMPRESSED_RGB_S3TC_DXT1_EXT ? " DXT1" : " DXT5") << " | escalar " << ms[0]
+			<< " ms | SSE2 " << ms[1] << " ms (x" << ms[0] / max(ms[1], 1e-3) << ") | SSE2 " << numThreads << " hilos " << ms[2] << " ms (x"
+			<< ms[0] / max(ms[2], 1e-3) << ") | " << comparison << endl;
+	}
+	DXT_use_SIMD(previous);
+	AssetLoader::Get().Finish();
+
+	cout << "bench-dxt: " << images.size() << " imagenes, " << megapixels << " Mpx | escalar " << megapixels * 1000.0 / max(totalMs[0], 1e-3)
+		<< " Mpx/s | SSE2 " << megapixels * 1000.0 / max(totalMs[1], 1e-3) << " Mpx/s | SSE2 " << numThreads << " hilos "
+		<< megapixels * 1000.0 / max(totalMs[2], 1e-3) << " Mpx/s | " << identical << " iguales, " << tolerated << " dentro de tolerancia, "
+		<< different << " distintas" << endl;
+	return different > 0 ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+int main(int argc, char *argv[])
+{
+	bool force = false;
+	bool pack = false;
+	bool benchDxt = false;
+	bool toGlb = false;
+	unsigned numThreads = thread::hardware_concurrency();
+	for (int i = 1; i < argc; i++)
+	{
+		string opcion = argv[i];
+		if (opcion == "--force")
+		{
+			force = true;
+		}
+		else if (opcion == "--pack")
+		{
+			pack = true;
+		}
+		else if (opcion == "--native-obj")
+		{
+			Model::Options().nativeObj = true;
+		}
+		else if (opcion == "--bench-dxt")
+		{
+			benchDxt = true;
+		}
+		else if (opcion == "--bench-obj")
+		{
+			return BenchObj(true);
+		}
+		else if (opcion == "--check-obj")
+		{
+			return BenchObj(false);
+		}
+		else if (opcion == "--to-glb")
+		{
+			toGlb = true;
+		}
+		else if (opcion == "--bench-glb")
+		{
+			return BenchGlb();
+		}
+		else if (opcion == "--threads" && i + 1 < argc)
+		{
+			numThreads = (unsigned)atoi(argv[++i]);
+		}
+	}
+	numThreads = max(numThreads, 1u);
+	if (toGlb)
+	{
+		return ToGlb(force);
+	}
+	if (benchDxt)
+	{
+		return BenchDxt(numThreads);
+	}
+	// Los nucleos que no tienen un archivo propio ayudan con las franjas de las texturas
+	unsigned stripThreads = max(thread::hardware_concurrency() / numThreads, 1u);
+
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+
+	// Fuentes: todos los .obj e imágenes de Models/ y las imágenes de images/ e images/skybox/
+	vector<string> files;
+	ListFiles("Models", true, files);
+	ListFiles("images", false, files);
+	ListFiles("images/skybox", false, files);
+
+	vector<CookJob> jobs;
+	for (size_t i = 0; i < files.size(); i++)
+	{
+		CookJob job;
+		job.source = CanonicalPath(files[i]);
+		if (EndsWith(job.source, ".obj"))
+		{
+			job.kind = COOKED_MESH;
+		}
+		else if (TextureCooker::IsImage(job.source))
+		{
+			job.kind = COOKED_TEXTURE;
+		}
+		else
+		{
+			continue;
+		}
+		jobs.push_back(job);
+	}
+	if (jobs.empty())
+	{
+		cout << "zoo-cook: no se encontraron fuentes, ejecutalo desde la carpeta del proyecto" << endl;
+		return EXIT_FAILURE;
+	}
+
+	// Un manifiesto de otra version no sirve: se cocina todo de nuevo
+	CookedManifest previous;
+	previous.Load(COOKED_MANIFEST);
+	MakeDirectories(string(COOKED_DIRECTORY) + "/Meshes");
+	MakeDirectories(string(COOKED_DIRECTORY) + "/Textures");
+
+	// Las mallas grandes primero, para que no queden solas al final en un hilo
+	stable_sort(jobs.begin(), jobs.end(), [](const CookJob &a, const CookJob &b) { return a.kind == COOKED_MESH && b.kind != COOKED_MESH; });
+
+	// Los trabajadores del AssetLoader solo comprimen franjas de las texturas de estos hilos
+	AssetLoader::Get().Start();
+
+	atomic<size_t> next(0);
+	mutex outputMutex;
+	vector<thread> workers;
+	for (unsigned t = 0; t < numThreads; t++)
+	{
+		workers.push_back(thread([&]()
+		{
+			for (size_t i = next++; i < jobs.size(); i = next++)
+			{
+				ProcessJob(jobs[i], previous, force, stripThreads);
+				if (jobs[i].result != COOK_UP_TO_DATE)
+				{
+					lock_guard<mutex> lock(outputMutex);
+					cout << (jobs[i].result == COOK_COOKED ? "Cocinado " : "ERROR::COOK::FAILED ") << jobs[i].source;
+					if (jobs[i].result == COOK_COOKED && jobs[i].kind == COOKED_TEXTURE)
+					{
+						cout << ": " << jobs[i].stats.Describe();
+					}
+					cout << endl;
+				}
+			}
+		}));
+	}
+	for (size_t t = 0; t < workers.size(); t++)
+	{
+		workers[t].join();
+	}
+	AssetLoader::Get().Finish();
+
+	CookedManifest manifest;
+	GLuint cooked = 0, upToDate = 0, failed = 0, removed = 0;
+	const CookJob *worstTexture = nullptr;
+	size_t uncompressedBytes = 0, cookedBytes = 0;
+	for (size_t i = 0; i < jobs.size(); i++)
+	{
+		if (jobs[i].result == COOK_FAILED)
+		{
+			failed++;
+			continue;
+		}
+		(jobs[i].result == COOK_COOKED ? cooked : upToDate)++;
+		manifest.Set(jobs[i].entry);
+
+		if (jobs[i].result == COOK_COOKED && jobs[i].kind == COOKED_TEXTURE)
+		{
+			uncompressedBytes += jobs[i].stats.uncompressedBytes;
+			cookedBytes += jobs[i].stats.cookedBytes;
+			worstTexture = !worstTexture || jobs[i].stats.psnr < worstTexture->stats.psnr ? &jobs[i] : worstTexture;
+		}
+	}
+
+	// Calidad de las texturas cocinadas en esta pasada (--force las mide todas)
+	if (worstTexture)
+	{
+		cout << "Texturas: memoria de video " << uncompressedBytes / (1024.0 * 1024.0) << " MB en RGBA8 -> " << cookedBytes / (1024.0 * 1024.0)
+			<< " MB en DXT (x" << (double)uncompressedBytes / max(cookedBytes, (size_t)1) << ") | peor PSNR " << worstTexture->source << ": "
+			<< worstTexture->stats.Describe() << endl;
+	}
+
+	// Fuentes que ya no existen (o ya no se pueden cocinar): se borra su archivo cocinado
+	const map<string, CookedEntry> &entries = previous.Entries();
+	for (map<string, CookedEntry>::const_iterator it = entries.begin(); it != entries.end(); ++it)
+	{
+		const CookedEntry *current = manifest.Find(it->first);
+		if (!current || current->cooked != it->second.cooked)
+		{
+			remove(it->second.cooked.c_str());
+			removed++;
+		}
+	}
+
+	if (!manifest.Save(COOKED_MANIFEST))
+	{
+		cout << "ERROR::COOK::CANNOT_WRITE " << COOKED_MANIFEST << endl;
+		return EXIT_FAILURE;
+	}
+
+	// Todas las fuentes, incluidos los .mtl y las imagenes que no se cocinan, en un solo archivo
+	if (pack)
+	{
+		vector<string> packed;
+		ListFiles("Models", true, packed);
+		ListFiles("images", true, packed);
+		if (!AssetPack::Write(ASSET_PACK_FILE, packed))
+		{
+			cout << "ERROR::COOK::CANNOT_WRITE " << ASSET_PACK_FILE << endl;
+			return EXIT_FAILURE;
+		}
+		cout << "Empaquetados " << packed.size() << " archivos en " << ASSET_PACK_FILE << endl;
+	}
+
+	double elapsed = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+	cout << "zoo-cook: " << cooked << " cocinados, " << upToDate << " sin cambios, " << failed << " errores, " << removed
+		<< " eliminados en " << elapsed << " ms (" << numThreads << " hilos)" << endl;
+	return failed > 0 ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,328 @@
+#pragma once
+
+#include <map>
+#include <mutex>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstdint>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+
+#include <GL/glew.h>
+
+#include "MappedFile.h"
+#include "AssetPack.h"
+#include "MeshCache.h"
+#include "AssetLoader.h"
+#include "TextureCooker.h"
+
+using namespace std;
+
+/*
+	Assets prepared offline by zoo-cook (Cook.cpp).
+
+	The cooker turns every .obj into a processed mesh file (the MeshCache layout: welded, optimized, with levels of
+	detail) and every image into a DXT1/DXT5 DDS with its mip chain (DdsFile.h), all under Cooked/, and lists them
+	in Cooked/manifest.txt:
+		zoo-cook <COOKED_FORMAT_VERSION> <MESH_CACHE_VERSION>
+		<kind> <content hash> <source size> <source mtime> <source channels> <source path>\t<cooked path>
+
+	The content hash is what the cooker uses to decide what to rebuild. At runtime the size and modification time
+	are enough to tell whether a cooked file still matches its source; when it doesn't (or nothing was cooked) the
+	loaders fall back to Assimp and SOIL as before.
+
+	Textures can also be cooked by the game itself on its first run (CookedAssets::CookTextures), into the same
+	files and the same manifest, so a later zoo-cook finds them up to date.
+*/
+
+#define COOKED_DIRECTORY "Cooked"
+#define COOKED_MANIFEST "Cooked/manifest.txt"
+#define COOKED_FORMAT_VERSION 1
+
+enum CookedKind
+{
+	COOKED_MESH,
+	COOKED_TEXTURE
+};
+
+// Cooked/Meshes/models_loto_loto.obj.zmc, Cooked/Textures/images_pasto.jpg.dds
+inline string CookedFilePath(const string &source, CookedKind kind)
+{
+	string name = source;
+	for (size_t i = 0; i < name.size(); i++)
+	{
+		if (name[i] == '/' || name[i] == '\\' || name[i] == ':')
+		{
+			name[i] = '_';
+		}
+	}
+	return kind == COOKED_MESH ? string(COOKED_DIRECTORY) + "/Meshes/" + name + ".zmc" : string(COOKED_DIRECTORY) + "/Textures/" + name + ".dds";
+}
+
+struct CookedEntry
+{
+	CookedKind kind;
+	string source;        // Canonical path of the source file
+	uint64_t contentHash; // Of the source (for meshes, also of the materials next to it)
+	FileStamp stamp;      // Of the source when it was cooked or last found unchanged
+	GLuint channels;      // Channels of the source image, 0 for meshes
+	string cooked;        // Path of the cooked file
+};
+
+class CookedManifest
+{
+public:
+	// Returns false if the file is missing or was written for another format, leaving the manifest empty
+	bool Load(const string &path)
+	{
+		this->entries.clear();
+
+		ifstream file(path.c_str());
+		string line;
+		if (!file || !getline(file, line))
+		{
+			return false;
+		}
+
+		stringstream header(line);
+		string tool;
+		int formatVersion = 0, meshVersion = 0;
+		header >> tool >> formatVersion >> meshVersion;
+		if (tool != "zoo-cook" || formatVersion != COOKED_FORMAT_VERSION || meshVersion != MESH_CACHE_VERSION)
+		{
+			return false;
+		}
+
+		while (getline(file, line))
+		{
+			// The paths go last, separated by a tab, so they may contain spaces
+			size_t tab = line.find('\t');
+			if (tab == string::npos)
+			{
+				continue;
+			}
+
+			stringstream fields(line.substr(0, tab));
+			string kind, hash;
+			CookedEntry entry;
+			fields >> kind >> hash >> entry.stamp.size >> entry.stamp.mtime >> entry.channels;
+			if (!fields || (kind != "mesh" && kind != "texture"))
+			{
+				continue;
+			}
+			fields >> ws;
+			getline(fields, entry.source);
+
+			entry.kind = kind == "mesh" ? COOKED_MESH : COOKED_TEXTURE;
+			entry.contentHash = strtoull(hash.c_str(), nullptr, 16);
+			entry.cooked = line.substr(tab + 1);
+			this->entries[entry.source] = entry;
+		}
+		return true;
+	}
+
+	bool Save(const string &path) const
+	{
+		string temporaryPath = path + ".tmp";
+		{
+			ofstream file(temporaryPath.c_str(), ios::trunc);
+			if (!file)
+			{
+				return false;
+			}
+
+			file << "zoo-cook " << COOKED_FORMAT_VERSION << " " << MESH_CACHE_VERSION << "\n";
+			for (map<string, CookedEntry>::const_iterator it = this->entries.begin(); it != this->entries.end(); ++it)
+			{
+				const CookedEntry &entry = it->second;
+				char hash[17];
+				snprintf(hash, sizeof(hash), "%016llx", (unsigned long long)entry.contentHash);
+				file << (entry.kind == COOKED_MESH ? "mesh" : "texture") << " " << hash << " " << entry.stamp.size << " "
+					<< entry.stamp.mtime << " " << entry.channels << " " << entry.source << "\t" << entry.cooked << "\n";
+			}
+			if (!file)
+			{
+				return false;
+			}
+		}
+		remove(path.c_str());
+		return rename(temporaryPath.c_str(), path.c_str()) == 0;
+	}
+
+	const CookedEntry *Find(const string &source) const
+	{
+		map<string, CookedEntry>::const_iterator it = this->entries.find(source);
+		return it == this->entries.end() ? nullptr : &it->second;
+	}
+
+	void Set(const CookedEntry &entry)
+	{
+		this->entries[entry.source] = entry;
+	}
+
+	void Remove(const string &source)
+	{
+		this->entries.erase(source);
+	}
+
+	const map<string, CookedEntry> &Entries() const
+	{
+		return this->entries;
+	}
+
+private:
+	map<string, CookedEntry> entries;
+};
+
+// Runtime side: which sources have an up-to-date cooked file
+class CookedAssets
+{
+public:
+	static CookedAssets &Get()
+	{
+		static CookedAssets assets;
+		return assets;
+	}
+
+	bool enabled = true; // false ignores Cooked/ and loads every source
+
+	// Reads the manifest. Call once on the GL thread after glewInit, before any asset is loaded.
+	void Load()
+	{
+		this->compressedTextures = GLEW_EXT_texture_compression_s3tc != 0;
+		if (!this->enabled)
+		{
+			return;
+		}
+
+		if (!this->manifest.Load(COOKED_MANIFEST))
+		{
+			cout << "Assets cocinados: no hay (ejecuta zoo-cook para generarlos)" << endl;
+			return;
+		}
+
+		GLuint meshes = 0, textures = 0;
+		const map<string, CookedEntry> &entries = this->manifest.Entries();
+		for (map<string, CookedEntry>::const_iterator it = entries.begin(); it != entries.end(); ++it)
+		{
+			(it->second.kind == COOKED_MESH ? meshes : textures)++;
+		}
+		cout << "Assets cocinados: " << meshes << " mallas, " << textures << " texturas"
+			<< (this->compressedTextures ? "" : " (sin soporte DXT, las texturas se cargan de la fuente)") << endl;
+	}
+
+	// First-run conversion: cooks every image under Models/, images/ and images/skybox/ without an up-to-date DDS,
+	// on the AssetLoader workers (started for the cook if they weren't running), and saves them in the manifest.
+	// Meshes are left to zoo-cook. Call it after Load and before any texture is loaded. Returns how many textures
+	// were cooked.
+	GLuint CookTextures()
+	{
+		if (!this->enabled || !this->compressedTextures)
+		{
+			return 0;
+		}
+		chrono::steady_clock::time_point start = chrono::steady_clock::now();
+
+		vector<string> files, sources;
+		ListFiles("Models", true, files);
+		ListFiles("images", false, files);
+		ListFiles("images/skybox", false, files);
+		for (size_t i = 0; i < files.size(); i++)
+		{
+			string source = CanonicalPath(files[i]);
+			FileStamp stamp, cookedStamp;
+			const CookedEntry *entry = this->manifest.Find(source);
+			bool upToDate = entry && entry->kind == COOKED_TEXTURE && GetFileStamp(source, stamp) && stamp.size == entry->stamp.size &&
+				stamp.mtime == entry->stamp.mtime && GetFileStamp(entry->cooked, cookedStamp);
+			if (TextureCooker::IsImage(source) && !upToDate)
+			{
+				sources.push_back(source);
+			}
+		}
+		if (sources.empty())
+		{
+			return 0;
+		}
+		MakeDirectories(string(COOKED_DIRECTORY) + "/Textures");
+
+		AssetLoader &loader = AssetLoader::Get();
+		bool started = !loader.IsActive();
+		loader.Start();
+
+		// One piece per image; with fewer images than threads, the idle workers take strips of the large levels
+		unsigned stripThreads = loader.Parallelism();
+		mutex manifestMutex;
+		GLuint cooked = 0;
+		size_t uncompressedBytes = 0, cookedBytes = 0;
+		loader.ParallelFor(sources.size(), [&](size_t i)
+		{
+			MappedFile file;
+			CookedEntry entry;
+			TextureCookStats stats;
+			entry.kind = COOKED_TEXTURE;
+			entry.source = sources[i];
+			entry.cooked = CookedFilePath(sources[i], COOKED_TEXTURE);
+			bool ok = GetFileStamp(sources[i], entry.stamp) && file.Open(sources[i]);
+			if (ok)
+			{
+				entry.contentHash = HashBytes(file.Data(), file.Size());
+				file.Close();
+				ok = TextureCooker::Cook(sources[i], entry.cooked, entry.channels, stats, stripThreads);
+			}
+
+			lock_guard<mutex> lock(manifestMutex);
+			if (!ok)
+			{
+				cout << "ERROR::COOK::FAILED " << sources[i] << endl;
+				return;
+			}
+			this->manifest.Set(entry);
+			cooked++;
+			uncompressedBytes += stats.uncompressedBytes;
+			cookedBytes += stats.cookedBytes;
+			cout << "Cocinada " << sources[i] << ": " << stats.Describe() << endl;
+		});
+		if (started)
+		{
+			loader.Finish();
+		}
+
+		if (!this->manifest.Save(COOKED_MANIFEST))
+		{
+			cout << "ERROR::COOK::CANNOT_WRITE " << COOKED_MANIFEST << endl;
+		}
+		cout << "Texturas cocinadas al iniciar: " << cooked << " en " << chrono::duration<double, milli>(chrono::steady_clock::now() - start).count()
+			<< " ms | memoria de video " << uncompressedBytes / (1024.0 * 1024.0) << " MB -> " << cookedBytes / (1024.0 * 1024.0) << " MB" << endl;
+		return cooked;
+	}
+
+	// Cooked version of a source, or nullptr if there is none or the source changed since it was cooked.
+	// A missing source is fine: a build may ship only the cooked files.
+	const CookedEntry *Find(const string &sourcePath, CookedKind kind) const
+	{
+		if (!this->enabled || (kind == COOKED_TEXTURE && !this->compressedTextures))
+		{
+			return nullptr;
+		}
+
+		const CookedEntry *entry = this->manifest.Find(CanonicalPath(sourcePath));
+		if (!entry || entry->kind != kind)
+		{
+			return nullptr;
+		}
+
+		FileStamp stamp;
+		if (GetAssetStamp(sourcePath, stamp) && (stamp.size != entry->stamp.size || stamp.mtime != entry->stamp.mtime))
+		{
+			return nullptr;
+		}
+		return entry;
+	}
+
+private:
+	CookedManifest manifest;
+	bool compressedTextures = false;
+};
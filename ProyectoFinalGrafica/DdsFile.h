@@ -0,0 +1,165 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstring>
+
+#include <GL/glew.h>
+
+extern "C"
+{
+#include "SOIL2/image_DXT.h"
+}
+
+using namespace std;
+
+/*
+	DXT1/DXT5 DDS files with a full mip chain, as written by zoo-cook and uploaded by the TextureManager.
+
+	Only what the cooker produces is understood: a DDS_header (see SOIL2/image_DXT.h) with a DXT1 or DXT5 FourCC,
+	followed by every mip level from the largest to 1x1, each one a tightly packed run of 4x4 blocks.
+*/
+
+struct DdsLevel
+{
+	GLsizei width;
+	GLsizei height;
+	size_t offset; // From the start of the file
+	size_t size;
+};
+
+struct DdsImage
+{
+	GLenum format = 0; // GL_COMPRESSED_RGB_S3TC_DXT1_EXT or GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+	GLsizei width = 0;
+	GLsizei height = 0;
+	vector<DdsLevel> levels;
+
+	// Bytes of every level together
+	size_t Bytes() const
+	{
+		size_t bytes = 0;
+		for (size_t i = 0; i < this->levels.size(); i++)
+		{
+			bytes += this->levels[i].size;
+		}
+		return bytes;
+	}
+
+	static size_t BlockBytes(GLenum format)
+	{
+		return format == GL_COMPRESSED_RGB_S3TC_DXT1_EXT ? 8 : 16;
+	}
+
+	static size_t LevelBytes(GLenum format, GLsizei width, GLsizei height)
+	{
+		return (size_t)((width + 3) / 4) * ((height + 3) / 4) * BlockBytes(format);
+	}
+
+	// Reads the header and locates every level. Returns false if the data isn't a DDS the cooker could have written.
+	static bool Parse(const unsigned char *data, size_t size, DdsImage &image)
+	{
+		image.levels.clear();
+
+		DDS_header header;
+		if (size < sizeof(header))
+		{
+			return false;
+		}
+		memcpy(&header, data, sizeof(header));
+
+		const unsigned int magic = FourCC('D', 'D', 'S', ' ');
+		if (header.dwMagic != magic || header.dwSize != 124 || !(header.sPixelFormat.dwFlags & DDPF_FOURCC) ||
+			header.dwWidth == 0 || header.dwHeight == 0)
+		{
+			return false;
+		}
+
+		if (header.sPixelFormat.dwFourCC == FourCC('D', 'X', 'T', '1'))
+		{
+			image.format = GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+		}
+		else if (header.sPixelFormat.dwFourCC == FourCC('D', 'X', 'T', '5'))
+		{
+			image.format = GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+		}
+		else
+		{
+			return false;
+		}
+
+		image.width = (GLsizei)header.dwWidth;
+		image.height = (GLsizei)header.dwHeight;
+		GLuint numLevels = (header.dwFlags & DDSD_MIPMAPCOUNT) && header.dwMipMapCount > 0 ? header.dwMipMapCount : 1;
+
+		size_t offset = sizeof(header);
+		GLsizei width = image.width, height = image.height;
+		for (GLuint i = 0; i < numLevels; i++)
+		{
+			DdsLevel level;
+			level.width = width;
+			level.height = height;
+			level.offset = offset;
+			level.size = LevelBytes(image.format, width, height);
+			if (offset + level.size > size)
+			{
+				image.levels.clear();
+				return false;
+			}
+			image.levels.push_back(level);
+
+			offset += level.size;
+			width = width > 1 ? width / 2 : 1;
+			height = height > 1 ? height / 2 : 1;
+		}
+		return true;
+	}
+
+	// Writes the levels (largest first, already compressed to format) as a DDS file
+	static bool Write(const string &path, GLenum format, GLsizei width, GLsizei height, const vector<vector<unsigned char> > &levels)
+	{
+		DDS_header header;
+		memset(&header, 0, sizeof(header));
+		header.dwMagic = FourCC('D', 'D', 'S', ' ');
+		header.dwSize = 124;
+		header.dwFlags = DDSD_CAPS | DDSD_HEIGHT | DDSD_WIDTH | DDSD_PIXELFORMAT | DDSD_LINEARSIZE | DDSD_MIPMAPCOUNT;
+		header.dwWidth = (unsigned int)width;
+		header.dwHeight = (unsigned int)height;
+		header.dwPitchOrLinearSize = levels.empty() ? 0 : (unsigned int)levels[0].size();
+		header.dwMipMapCount = (unsigned int)levels.size();
+		header.sPixelFormat.dwSize = 32;
+		header.sPixelFormat.dwFlags = DDPF_FOURCC;
+		header.sPixelFormat.dwFourCC = format == GL_COMPRESSED_RGB_S3TC_DXT1_EXT ? FourCC('D', 'X', 'T', '1') : FourCC('D', 'X', 'T', '5');
+		header.sCaps.dwCaps1 = DDSCAPS_TEXTURE | (levels.size() > 1 ? DDSCAPS_COMPLEX | DDSCAPS_MIPMAP : 0);
+
+		// Through a temporary file, so an interrupted cook never leaves a truncated texture behind
+		string temporaryPath = path + ".tmp";
+		FILE *out = fopen(temporaryPath.c_str(), "wb");
+		if (!out)
+		{
+			return false;
+		}
+		bool ok = fwrite(&header, sizeof(header), 1, out) == 1;
+		for (size_t i = 0; ok && i < levels.size(); i++)
+		{
+			ok = fwrite(levels[i].data(), 1, levels[i].size(), out) == levels[i].size();
+		}
+		ok = (fclose(out) == 0) && ok;
+
+		if (!ok)
+		{
+			remove(temporaryPath.c_str());
+			return false;
+		}
+		remove(path.c_str());
+		return rename(temporaryPath.c_str(), path.c_str()) == 0;
+	}
+
+private:
+	static unsigned int FourCC(char a, char b, char c, char d)
+	{
+		return (unsigned int)(unsigned char)a | ((unsigned int)(unsigned char)b << 8) |
+			((unsigned int)(unsigned char)c << 16) | ((unsigned int)(unsigned char)d << 24);
+	}
+};
@@ -0,0 +1,617 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstring>
+#include <cstddef>
+#include <cstdint>
+#include <sstream>
+#include <iostream>
+#include <algorithm>
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include "Mesh.h"
+#include "Json.h"
+#include "AssetPack.h"
+#include "MeshCache.h"
+#include "MeshSimplifier.h"
+
+using namespace std;
+
+/*
+	glTF 2.0 binary (.glb) meshes.
+
+	A .glb is a 12-byte header, a JSON chunk describing the scene and a BIN chunk with the data the JSON points
+	into through accessors and buffer views. Only what the models need is read: the triangle primitives of every
+	mesh (POSITION, NORMAL, TEXCOORD_0 and indices) and the base color texture of their material; node transforms,
+	animation, skins and embedded images are ignored.
+
+	zoo-cook --to-glb writes the processed meshes of every .obj (welded, optimized, with levels of detail) with
+	generator GLB_GENERATOR:
+		- the vertices of a mesh are one buffer view with a 32-byte stride and POSITION, NORMAL and TEXCOORD_0 at
+		  offsets 0, 12 and 24, which is exactly Vertex, so they are used straight from the mapped file;
+		- the indices are 32-bit; the primitive's own indices are the full mesh and "extras": {"lods": [...]} lists
+		  the accessors of the coarser levels, which follow it in the same buffer view;
+		- the specular texture goes in the material's "extras": {"specularTexture": index};
+		- the asset's "extras" hold the processing settings (ProcessingKey) and the size and modification time of
+		  every file the meshes were made from (the .obj, its .mtl libraries and its textures). Current() checks
+		  them the way the mesh cache checks its header, and the loader ignores a .glb that is stale.
+	Other viewers just see the full meshes with their base color. Files from elsewhere are read into the owned
+	vectors and go through the same optimization as any imported model.
+*/
+
+#define GLB_GENERATOR "zoo-cook"
+
+#define GLB_MAGIC 0x46546C67u      // "glTF"
+#define GLB_CHUNK_JSON 0x4E4F534Au // "JSON"
+#define GLB_CHUNK_BIN 0x004E4942u  // "BIN\0"
+
+#define GLTF_FLOAT 5126
+#define GLTF_UNSIGNED_INT 5125
+#define GLTF_UNSIGNED_SHORT 5123
+#define GLTF_UNSIGNED_BYTE 5121
+#define GLTF_TRIANGLES 4
+
+class GlbFile
+{
+public:
+	static bool IsGlb(const string &path)
+	{
+		size_t dot = path.find_last_of('.');
+		if (dot == string::npos)
+		{
+			return false;
+		}
+		string extension = path.substr(dot);
+		transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+		return extension == ".glb";
+	}
+
+	// The .glb that zoo-cook --to-glb writes next to a model
+	static string PathFor(const string &path)
+	{
+		size_t dot = path.find_last_of('.');
+		size_t slash = path.find_last_of('/');
+		return (dot == string::npos || (slash != string::npos && dot < slash) ? path : path.substr(0, dot)) + ".glb";
+	}
+
+	// Maps the file (from the asset pack when it has it) and parses its JSON
+	bool Open(const string &path)
+	{
+		this->path = path;
+		this->bin = nullptr;
+		this->binSize = 0;
+		if (!this->file.Open(path))
+		{
+			cout << "ERROR::GLB::FILE_NOT_FOUND " << path << endl;
+			return false;
+		}
+
+		const unsigned char *data = this->file.Data();
+		size_t size = this->file.Size();
+		uint32_t header[5];
+		if (size < sizeof(header))
+		{
+			return this->fail("INVALID_HEADER");
+		}
+		memcpy(header, data, sizeof(header));
+		if (header[0] != GLB_MAGIC || header[1] != 2 || header[2] > size || header[4] != GLB_CHUNK_JSON || header[3] > header[2] - 20)
+		{
+			return this->fail("INVALID_HEADER");
+		}
+		size = header[2];
+
+		if (!JsonValue::Parse((const char *)data + 20, header[3], this->json))
+		{
+			return this->fail("INVALID_JSON");
+		}
+
+		// The BIN chunk is optional
+		size_t binChunk = 20 + ((header[3] + 3) & ~3u);
+		if (binChunk + 8 <= size)
+		{
+			uint32_t chunk[2];
+			memcpy(chunk, data + binChunk, sizeof(chunk));
+			if (chunk[1] == GLB_CHUNK_BIN && chunk[0] <= size - binChunk - 8)
+			{
+				this->bin = data + binChunk + 8;
+				this->binSize = chunk[0];
+			}
+		}
+		return true;
+	}
+
+	size_t Size() const
+	{
+		return this->file.Size();
+	}
+
+	// Written by zoo-cook: the meshes are already processed and in the layout the loader can use in place
+	bool Processed() const
+	{
+		return this->json["asset"]["generator"].text == GLB_GENERATOR;
+	}
+
+	// Settings the processed meshes depend on besides their files: the cache format (which changes with the
+	// processing), the vertex layout and the parameters of MeshOptimizer and MeshSimplifier
+	static string ProcessingKey()
+	{
+		stringstream key;
+		key << "mesh " << MESH_CACHE_VERSION << ", vertex " << sizeof(Vertex) << ", vertex cache " << MESH_OPTIMIZER_CACHE_SIZE << ", lods " << MESH_MAX_LODS
+			<< " " << MESH_SIMPLIFIER_MIN_TRIANGLES << " " << Number(MESH_SIMPLIFIER_RATIO) << " " << Number(MESH_SIMPLIFIER_MIN_REDUCTION);
+		return key.str();
+	}
+
+	// Written by zoo-cook with this build's processing settings from files that haven't changed since then
+	bool Current() const
+	{
+		const JsonValue &extras = this->json["asset"]["extras"];
+		const JsonValue &dependencies = extras["dependencies"];
+		if (!this->Processed() || extras["processing"].text != ProcessingKey() || dependencies.Size() == 0)
+		{
+			return false;
+		}
+		for (size_t i = 0; i < dependencies.Size(); i++)
+		{
+			FileStamp stamp;
+			const JsonValue &dependency = dependencies[i];
+			if (!GetAssetStamp(dependency["path"].text, stamp) || (long long)stamp.size != dependency["size"].Int(-1) ||
+				(long long)stamp.mtime != dependency["mtime"].Int(-1))
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	// Fills one MeshData per triangle primitive. The vertices and indices point into the mapping when their layout
+	// already matches Vertex and 32-bit indices; anything else is converted into the owned vectors. With copy set,
+	// every mesh owns its geometry (so it outlives this object) and only the full level is kept.
+	bool ReadMeshes(vector<MeshData> &meshes, bool copy = false)
+	{
+		meshes.clear();
+		const JsonValue &jsonMeshes = this->json["meshes"];
+		for (size_t m = 0; m < jsonMeshes.Size(); m++)
+		{
+			const JsonValue &primitives = jsonMeshes[m]["primitives"];
+			for (size_t p = 0; p < primitives.Size(); p++)
+			{
+				const JsonValue &primitive = primitives[p];
+				if (primitive["mode"].Int(GLTF_TRIANGLES) != GLTF_TRIANGLES)
+				{
+					continue;
+				}
+
+				MeshData mesh;
+				if (!this->readVertices(primitive["attributes"], mesh, copy) || !this->readIndices(primitive, mesh, copy))
+				{
+					meshes.clear();
+					return false;
+				}
+				this->readTextures(primitive["material"], mesh);
+				meshes.push_back(move(mesh));
+			}
+		}
+		return true;
+	}
+
+	// Writes processed meshes (owned or mapped) as a .glb with generator GLB_GENERATOR. dependencies are the files
+	// they were made from; the stamps of the ones that exist are recorded for Current().
+	static bool Write(const string &path, const vector<MeshData> &meshes, const vector<string> &dependencies)
+	{
+		string binary;
+		stringstream accessors, views, jsonMeshes, nodes;
+		size_t numAccessors = 0, numViews = 0;
+
+		// Materials and images are shared between the meshes that use the same textures
+		vector<pair<string, string> > materials;
+		vector<string> images;
+
+		for (size_t i = 0; i < meshes.size(); i++)
+		{
+			const MeshData &mesh = meshes[i];
+
+			// Vertices, laid out as Vertex
+			size_t vertexView = numViews++;
+			views << (vertexView ? "," : "") << "{\"buffer\":0,\"byteOffset\":" << binary.size() << ",\"byteLength\":" << mesh.numVertices * sizeof(Vertex)
+				<< ",\"byteStride\":" << sizeof(Vertex) << ",\"target\":34962}";
+			binary.append((const char *)mesh.vertexData, mesh.numVertices * sizeof(Vertex));
+
+			glm::vec3 minimum(0.0f), maximum(0.0f);
+			for (GLuint v = 0; v < mesh.numVertices; v++)
+			{
+				for (int k = 0; k < 3; k++)
+				{
+					minimum[k] = v == 0 ? mesh.vertexData[v].Position[k] : min(minimum[k], mesh.vertexData[v].Position[k]);
+					maximum[k] = v == 0 ? mesh.vertexData[v].Position[k] : max(maximum[k], mesh.vertexData[v].Position[k]);
+				}
+			}
+			size_t position = numAccessors++, normal = numAccessors++, texCoord = numAccessors++;
+			accessors << (position ? "," : "") << "{\"bufferView\":" << vertexView << ",\"byteOffset\":0,\"componentType\":" << GLTF_FLOAT
+				<< ",\"count\":" << mesh.numVertices << ",\"type\":\"VEC3\",\"min\":[" << Number(minimum.x) << "," << Number(minimum.y) << "," << Number(minimum.z)
+				<< "],\"max\":[" << Number(maximum.x) << "," << Number(maximum.y) << "," << Number(maximum.z) << "]}";
+			accessors << ",{\"bufferView\":" << vertexView << ",\"byteOffset\":12,\"componentType\":" << GLTF_FLOAT << ",\"count\":" << mesh.numVertices << ",\"type\":\"VEC3\"}";
+			accessors << ",{\"bufferView\":" << vertexView << ",\"byteOffset\":24,\"componentType\":" << GLTF_FLOAT << ",\"count\":" << mesh.numVertices << ",\"type\":\"VEC2\"}";
+
+			// Indices of every level, one accessor per level
+			size_t indexView = numViews++;
+			views << ",{\"buffer\":0,\"byteOffset\":" << binary.size() << ",\"byteLength\":" << mesh.numIndices * sizeof(GLuint) << ",\"target\":34963}";
+			binary.append((const char *)mesh.indexData, mesh.numIndices * sizeof(GLuint));
+
+			size_t firstLodAccessor = numAccessors;
+			for (GLuint l = 0; l < mesh.numLods; l++)
+			{
+				accessors << ",{\"bufferView\":" << indexView << ",\"byteOffset\":" << mesh.lods[l].firstIndex * sizeof(GLuint) << ",\"componentType\":"
+					<< GLTF_UNSIGNED_INT << ",\"count\":" << mesh.lods[l].numIndices << ",\"type\":\"SCALAR\"}";
+				numAccessors++;
+			}
+
+			// Material
+			string diffuse, specular;
+			for (size_t t = 0; t < mesh.textures.size(); t++)
+			{
+				if (mesh.textures[t].type == "texture_diffuse" && diffuse.empty())
+				{
+					diffuse = mesh.textures[t].path;
+				}
+				else if (mesh.textures[t].type == "texture_specular" && specular.empty())
+				{
+					specular = mesh.textures[t].path;
+				}
+			}
+			pair<string, string> material(diffuse, specular);
+			size_t materialIndex = find(materials.begin(), materials.end(), material) - materials.begin();
+			if (materialIndex == materials.size())
+			{
+				materials.push_back(material);
+				for (int k = 0; k < 2; k++)
+				{
+					const string &image = k == 0 ? diffuse : specular;
+					if (!image.empty() && find(images.begin(), images.end(), image) == images.end())
+					{
+						images.push_back(image);
+					}
+				}
+			}
+
+			jsonMeshes << (i ? "," : "") << "{\"primitives\":[{\"attributes\":{\"POSITION\":" << position << ",\"NORMAL\":" << normal << ",\"TEXCOORD_0\":" << texCoord
+				<< "},\"indices\":" << firstLodAccessor << ",\"material\":" << materialIndex << ",\"mode\":" << GLTF_TRIANGLES;
+			if (mesh.numLods > 1)
+			{
+				jsonMeshes << ",\"extras\":{\"lods\":[";
+				for (GLuint l = 1; l < mesh.numLods; l++)
+				{
+					jsonMeshes << (l > 1 ? "," : "") << firstLodAccessor + l;
+				}
+				jsonMeshes << "]}";
+			}
+			jsonMeshes << "}]}";
+			nodes << (i ? "," : "") << "{\"mesh\":" << i << "}";
+		}
+
+		stringstream json;
+		json << "{\"asset\":{\"version\":\"2.0\",\"generator\":\"" << GLB_GENERATOR << "\",\"extras\":{\"processing\":" << JsonValue::Quote(ProcessingKey())
+			<< ",\"dependencies\":[";
+		size_t numDependencies = 0;
+		for (size_t i = 0; i < dependencies.size(); i++)
+		{
+			FileStamp stamp;
+			if (GetAssetStamp(dependencies[i], stamp))
+			{
+				json << (numDependencies++ ? "," : "") << "{\"path\":" << JsonValue::Quote(dependencies[i]) << ",\"size\":" << stamp.size << ",\"mtime\":" << stamp.mtime << "}";
+			}
+		}
+		json << "]}},\"scene\":0,\"scenes\":[{\"nodes\":[";
+		for (size_t i = 0; i < meshes.size(); i++)
+		{
+			json << (i ? "," : "") << i;
+		}
+		json << "]}],\"nodes\":[" << nodes.str() << "],\"meshes\":[" << jsonMeshes.str() << "],\"materials\":[";
+		for (size_t i = 0; i < materials.size(); i++)
+		{
+			json << (i ? "," : "") << "{\"pbrMetallicRoughness\":{\"metallicFactor\":0";
+			if (!materials[i].first.empty())
+			{
+				json << ",\"baseColorTexture\":{\"index\":" << find(images.begin(), images.end(), materials[i].first) - images.begin() << "}";
+			}
+			json << "}";
+			if (!materials[i].second.empty())
+			{
+				json << ",\"extras\":{\"specularTexture\":" << find(images.begin(), images.end(), materials[i].second) - images.begin() << "}";
+			}
+			json << "}";
+		}
+		// One texture per image, with the same index
+		json << "],\"textures\":[";
+		for (size_t i = 0; i < images.size(); i++)
+		{
+			json << (i ? "," : "") << "{\"source\":" << i << "}";
+		}
+		json << "],\"images\":[";
+		for (size_t i = 0; i < images.size(); i++)
+		{
+			json << (i ? "," : "") << "{\"uri\":" << JsonValue::Quote(EncodeUri(images[i])) << "}";
+		}
+		json << "],\"accessors\":[" << accessors.str() << "],\"bufferViews\":[" << views.str() << "],\"buffers\":[{\"byteLength\":" << binary.size() << "}]}";
+
+		// Chunks are padded to 4 bytes: the JSON with spaces, the binary data with zeros
+		string jsonChunk = json.str();
+		jsonChunk.append((4 - jsonChunk.size() % 4) % 4, ' ');
+		binary.append((4 - binary.size() % 4) % 4, '\0');
+		uint32_t header[5] = { GLB_MAGIC, 2, (uint32_t)(12 + 8 + jsonChunk.size() + 8 + binary.size()), (uint32_t)jsonChunk.size(), GLB_CHUNK_JSON };
+		uint32_t binHeader[2] = { (uint32_t)binary.size(), GLB_CHUNK_BIN };
+
+		string temporaryPath = path + ".tmp";
+		FILE *out = fopen(temporaryPath.c_str(), "wb");
+		if (!out)
+		{
+			return false;
+		}
+		bool ok = fwrite(header, sizeof(header), 1, out) == 1 && fwrite(jsonChunk.data(), 1, jsonChunk.size(), out) == jsonChunk.size() &&
+			fwrite(binHeader, sizeof(binHeader), 1, out) == 1 && fwrite(binary.data(), 1, binary.size(), out) == binary.size();
+		ok = (fclose(out) == 0) && ok;
+		if (!ok)
+		{
+			remove(temporaryPath.c_str());
+			return false;
+		}
+		remove(path.c_str());
+		return rename(temporaryPath.c_str(), path.c_str()) == 0;
+	}
+
+private:
+	AssetFile file;
+	string path;
+	JsonValue json;
+	const unsigned char *bin = nullptr;
+	size_t binSize = 0;
+
+	// Where the elements of an accessor are in the BIN chunk
+	struct AccessorData
+	{
+		const unsigned char *data;
+		size_t stride;
+		size_t count;
+		long long componentType;
+		int components;
+		long long view;
+	};
+
+	bool fail(const char *reason)
+	{
+		cout << "ERROR::GLB::" << reason << " " << this->path << endl;
+		this->file.Close();
+		return false;
+	}
+
+	static string Number(float value)
+	{
+		char text[32];
+		snprintf(text, sizeof(text), "%.9g", value);
+		return text;
+	}
+
+	// Spaces and percent signs are the only characters of the texture names that a URI can't hold as they are
+	static string EncodeUri(const string &path)
+	{
+		string uri;
+		for (size_t i = 0; i < path.size(); i++)
+		{
+			uri += path[i] == ' ' ? "%20" : (path[i] == '%' ? "%25" : string(1, path[i]));
+		}
+		return uri;
+	}
+
+	static string DecodeUri(const string &uri)
+	{
+		string path;
+		for (size_t i = 0; i < uri.size(); i++)
+		{
+			if (uri[i] == '%' && i + 2 < uri.size() && isxdigit((unsigned char)uri[i + 1]) && isxdigit((unsigned char)uri[i + 2]))
+			{
+				path += (char)strtol(uri.substr(i + 1, 2).c_str(), nullptr, 16);
+				i += 2;
+			}
+			else
+			{
+				path += uri[i];
+			}
+		}
+		return path;
+	}
+
+	bool accessor(const JsonValue &index, AccessorData &result) const
+	{
+		const JsonValue &accessor = this->json["accessors"][(size_t)index.Int(-1)];
+		const JsonValue &view = this->json["bufferViews"][(size_t)accessor["bufferView"].Int(-1)];
+		if (!index.IsNumber() || !accessor.IsObject() || !view.IsObject() || view["buffer"].Int(-1) != 0 || !this->bin)
+		{
+			return false;
+		}
+
+		static const char *types[] = { "SCALAR", "VEC2", "VEC3", "VEC4" };
+		result.components = 0;
+		for (int i = 0; i < 4; i++)
+		{
+			result.components = accessor["type"].text == types[i] ? i + 1 : result.components;
+		}
+		result.componentType = accessor["componentType"].Int();
+		size_t componentSize = result.componentType == GLTF_FLOAT || result.componentType == GLTF_UNSIGNED_INT ? 4 :
+			(result.componentType == GLTF_UNSIGNED_SHORT ? 2 : (result.componentType == GLTF_UNSIGNED_BYTE ? 1 : 0));
+		size_t elementSize = componentSize * result.components;
+		result.count = (size_t)accessor["count"].Int();
+		result.stride = (size_t)view["byteStride"].Int((long long)elementSize);
+		result.view = accessor["bufferView"].Int();
+
+		size_t viewOffset = (size_t)view["byteOffset"].Int(), viewLength = (size_t)view["byteLength"].Int();
+		size_t offset = (size_t)accessor["byteOffset"].Int();
+		if (elementSize == 0 || viewOffset > this->binSize || viewLength > this->binSize - viewOffset || offset > viewLength ||
+			(result.count > 0 && (viewLength - offset < elementSize || (result.count - 1) > (viewLength - offset - elementSize) / max(result.stride, (size_t)1))))
+		{
+			return false;
+		}
+		result.data = this->bin + viewOffset + offset;
+		return true;
+	}
+
+	bool readVertices(const JsonValue &attributes, MeshData &mesh, bool copy)
+	{
+		AccessorData position, normal, texCoord;
+		bool hasNormal = attributes.Has("NORMAL"), hasTexCoord = attributes.Has("TEXCOORD_0");
+		if (!this->accessor(attributes["POSITION"], position) || position.componentType != GLTF_FLOAT || position.components != 3 ||
+			(hasNormal && (!this->accessor(attributes["NORMAL"], normal) || normal.componentType != GLTF_FLOAT || normal.components != 3 || normal.count != position.count)) ||
+			(hasTexCoord && (!this->accessor(attributes["TEXCOORD_0"], texCoord) || texCoord.componentType != GLTF_FLOAT || texCoord.components != 2 || texCoord.count != position.count)))
+		{
+			return this->fail("UNSUPPORTED_ATTRIBUTES");
+		}
+		mesh.numVertices = (GLuint)position.count;
+
+		// The layout zoo-cook writes: interleaved Vertex, usable in place
+		if (!copy && hasNormal && hasTexCoord && position.stride == sizeof(Vertex) && normal.stride == sizeof(Vertex) && texCoord.stride == sizeof(Vertex) &&
+			normal.data == position.data + offsetof(Vertex, Normal) && texCoord.data == position.data + offsetof(Vertex, TexCoords) &&
+			((uintptr_t)position.data % sizeof(float)) == 0)
+		{
+			mesh.vertexData = (const Vertex *)position.data;
+			return true;
+		}
+
+		mesh.vertices.resize(position.count);
+		for (size_t i = 0; i < position.count; i++)
+		{
+			Vertex &vertex = mesh.vertices[i];
+			memcpy(&vertex.Position, position.data + i * position.stride, sizeof(glm::vec3));
+			vertex.Normal = glm::vec3(0.0f, 0.0f, 0.0f);
+			vertex.TexCoords = glm::vec2(0.0f, 0.0f);
+			if (hasNormal)
+			{
+				memcpy(&vertex.Normal, normal.data + i * normal.stride, sizeof(glm::vec3));
+			}
+			if (hasTexCoord)
+			{
+				memcpy(&vertex.TexCoords, texCoord.data + i * texCoord.stride, sizeof(glm::vec2));
+			}
+		}
+		mesh.vertexData = mesh.vertices.data();
+		return true;
+	}
+
+	bool readIndices(const JsonValue &primitive, MeshData &mesh, bool copy)
+	{
+		mesh.numLods = 1;
+		if (!primitive.Has("indices"))
+		{
+			// Non-indexed: every three vertices are a triangle
+			mesh.indices.resize(mesh.numVertices / 3 * 3);
+			for (size_t i = 0; i < mesh.indices.size(); i++)
+			{
+				mesh.indices[i] = (GLuint)i;
+			}
+			mesh.indexData = mesh.indices.data();
+			mesh.numIndices = (GLuint)mesh.indices.size();
+			mesh.lods[0].firstIndex = 0;
+			mesh.lods[0].numIndices = mesh.numIndices;
+			return true;
+		}
+
+		AccessorData indices;
+		if (!this->accessor(primitive["indices"], indices) || indices.components != 1 || indices.componentType == GLTF_FLOAT)
+		{
+			return this->fail("UNSUPPORTED_INDICES");
+		}
+
+		// The coarser levels of a processed file follow the full one in the same 32-bit buffer view
+		vector<AccessorData> levels(1, indices);
+		const JsonValue &lods = primitive["extras"]["lods"];
+		for (size_t l = 0; !copy && this->Processed() && l < lods.Size() && levels.size() < MESH_MAX_LODS; l++)
+		{
+			AccessorData level;
+			if (!this->accessor(lods[l], level) || level.componentType != GLTF_UNSIGNED_INT || level.view != indices.view ||
+				level.data < indices.data || (level.data - indices.data) % sizeof(GLuint) != 0)
+			{
+				break;
+			}
+			levels.push_back(level);
+		}
+
+		size_t total = 0;
+		for (size_t l = 0; l < levels.size(); l++)
+		{
+			mesh.lods[l].firstIndex = (GLuint)((levels[l].data - indices.data) / sizeof(GLuint));
+			mesh.lods[l].numIndices = (GLuint)levels[l].count;
+			total = max(total, (size_t)mesh.lods[l].firstIndex + levels[l].count);
+		}
+		mesh.numLods = (GLuint)levels.size();
+		mesh.numIndices = (GLuint)total;
+
+		if (!copy && indices.componentType == GLTF_UNSIGNED_INT && indices.stride == sizeof(GLuint) && ((uintptr_t)indices.data % sizeof(GLuint)) == 0)
+		{
+			mesh.indexData = (const GLuint *)indices.data;
+		}
+		else
+		{
+			size_t componentSize = indices.componentType == GLTF_UNSIGNED_INT ? 4 : (indices.componentType == GLTF_UNSIGNED_SHORT ? 2 : 1);
+			mesh.indices.resize(total);
+			for (size_t i = 0; i < total; i++)
+			{
+				const unsigned char *element = indices.data + i * indices.stride;
+				if (componentSize == 4)
+				{
+					memcpy(&mesh.indices[i], element, sizeof(GLuint));
+				}
+				else if (componentSize == 2)
+				{
+					uint16_t value;
+					memcpy(&value, element, sizeof(value));
+					mesh.indices[i] = value;
+				}
+				else
+				{
+					mesh.indices[i] = *element;
+				}
+			}
+			mesh.indexData = mesh.indices.data();
+		}
+
+		for (GLuint i = 0; i < mesh.numIndices; i++)
+		{
+			if (mesh.indexData[i] >= mesh.numVertices)
+			{
+				return this->fail("INVALID_INDEX");
+			}
+		}
+		return true;
+	}
+
+	void readTextures(const JsonValue &material, MeshData &mesh) const
+	{
+		if (!material.IsNumber())
+		{
+			return;
+		}
+		const JsonValue &definition = this->json["materials"][(size_t)material.Int()];
+		this->addTexture(definition["pbrMetallicRoughness"]["baseColorTexture"]["index"], "texture_diffuse", mesh);
+		this->addTexture(definition["extras"]["specularTexture"], "texture_specular", mesh);
+	}
+
+	void addTexture(const JsonValue &texture, const string &type, MeshData &mesh) const
+	{
+		if (!texture.IsNumber())
+		{
+			return;
+		}
+		const JsonValue &image = this->json["images"][(size_t)this->json["textures"][(size_t)texture.Int()]["source"].Int(-1)];
+		if (!image["uri"].IsString() || image["uri"].text.compare(0, 5, "data:") == 0)
+		{
+			cout << "ERROR::GLB::EMBEDDED_IMAGE_NOT_SUPPORTED " << this->path << endl;
+			return;
+		}
+
+		TextureRef ref;
+		ref.type = type;
+		ref.path = DecodeUri(image["uri"].text);
+		mesh.textures.push_back(ref);
+	}
+};
@@ -0,0 +1,260 @@
+#pragma once
+
+#include <vector>
+#include <algorithm>
+#include <cstddef>
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include "Model.h"
+#include "RenderQueue.h"
+
+using namespace std;
+
+/*
+	Every placement of one model file drawn with one instanced call per mesh.
+
+	The placements are given once (or whenever they change) and kept in a buffer of InstanceData, one per
+	placement: its model matrix and its normal matrix, which the shader would otherwise rebuild with an inverse
+	for every vertex. A VAO of the batch reads the model's vertices and indices from its MeshArena block like the
+	block's own VAO does, plus the instance buffer at locations INSTANCE_ATTRIBUTE_MODEL (a mat4 over four
+	locations) and INSTANCE_ATTRIBUTE_NORMAL (a mat3 over three), advancing once per instance. With the
+	"instanced" uniform set, lighting.vs takes the matrices from there instead of from the model uniform.
+
+	A frame costs the same for 3 placements as for thousands: one call per mesh, and the level of detail and the
+	depth of the RenderQueue key come from one sphere around every placement, computed when they change. That
+	sphere is what decides the level, so a batch spread over the whole zoo is drawn at the detail of its
+	nearest point.
+
+	The batch follows the model: nothing is drawn while it is hidden or loading, and the VAO is rebuilt when the
+	model's file is loaded again (e.g. after its habitat was streamed out and back in).
+*/
+
+#define INSTANCE_ATTRIBUTE_MODEL 3  // Locations 3 to 6
+#define INSTANCE_ATTRIBUTE_NORMAL 7 // Locations 7 to 9
+
+struct InstanceData
+{
+	glm::mat4 model;
+	glm::mat3 normal; // transpose(inverse(mat3(model)))
+};
+
+class InstanceBatch
+{
+public:
+	// The model drawn at every placement. Other Model objects of the same file can stay as they are or go away;
+	// this one decides when the batch is drawn.
+	explicit InstanceBatch(Model &model) : model(model) {}
+
+	InstanceBatch(const InstanceBatch &) = delete;
+	InstanceBatch &operator=(const InstanceBatch &) = delete;
+
+	~InstanceBatch()
+	{
+		// Destroyed after the context is gone (see ModelRegistry::Shutdown), the objects are left to the driver
+		if (!ModelRegistry::Get().ContextAlive())
+		{
+			return;
+		}
+		if (this->VAO)
+		{
+			glDeleteVertexArrays(1, &this->VAO);
+		}
+		if (this->instanceVBO)
+		{
+			glDeleteBuffers(1, &this->instanceVBO);
+		}
+	}
+
+	void Clear()
+	{
+		this->instances.clear();
+		this->dirty = true;
+	}
+
+	void Add(const glm::mat4 &model)
+	{
+		InstanceData instance;
+		instance.model = model;
+		instance.normal = glm::transpose(glm::inverse(glm::mat3(model)));
+		this->instances.push_back(instance);
+		this->dirty = true;
+	}
+
+	GLuint Size() const
+	{
+		return (GLuint)this->instances.size();
+	}
+
+	// Draws every placement, or queues one instanced command per mesh while the RenderQueue is recording
+	void Draw(Shader shader)
+	{
+		const ModelAsset *asset = this->model.Asset();
+		if (this->instances.empty() || this->model.hidden || !this->model.IsReady() || asset->meshes.empty())
+		{
+			return;
+		}
+
+		this->update(*asset);
+
+		RenderContext &context = RenderContext::Get();
+		glm::mat4 identity(1.0f);
+		this->lod = context.SelectLod(context.ScreenSize(identity, this->boundsCenter, this->boundsRadius), this->lod, asset->numLods);
+
+		const MaterialProgram &program = MaterialProgram::For(shader.Program);
+		const MeshBuffer &buffer = asset->buffer;
+		const vector<Mesh> &meshes = asset->meshes;
+		RenderQueue &queue = RenderQueue::Get();
+		GLsizei count = (GLsizei)this->instances.size();
+		size_t drawnTriangles = 0, fullTriangles = 0;
+
+		if (queue.IsRecording())
+		{
+			RenderCommand command;
+			command.program = &program;
+			command.VAO = this->VAO;
+			command.instances = count;
+			command.packed = buffer.packed;
+			command.positionOffset = buffer.positionOffset;
+			command.positionScale = buffer.positionScale;
+			float depth = context.Distance(identity, this->boundsCenter);
+
+			for (size_t i = 0; i < meshes.size(); i++)
+			{
+				const MeshLod &level = meshes[i].Lod(this->lod);
+				command.material = &meshes[i].material;
+				command.count = level.numIndices;
+				command.firstIndex = level.firstIndex;
+				command.baseVertex = meshes[i].BaseVertex();
+				queue.Submit(command, depth);
+				drawnTriangles += meshes[i].NumTriangles(this->lod) * count;
+				fullTriangles += meshes[i].NumTriangles(0) * count;
+			}
+		}
+		else
+		{
+			glUniform1i(program.instanced, 1);
+			if (buffer.packed)
+			{
+				glUniform1i(program.packedVertices, 1);
+				glUniform3f(program.positionOffset, buffer.positionOffset.x, buffer.positionOffset.y, buffer.positionOffset.z);
+				glUniform3f(program.positionScale, buffer.positionScale.x, buffer.positionScale.y, buffer.positionScale.z);
+			}
+
+			glBindVertexArray(this->VAO);
+			GLuint textureBinds = 0;
+			for (size_t i = 0; i < meshes.size(); i++)
+			{
+				const MeshLod &level = meshes[i].Lod(this->lod);
+				meshes[i].material.Bind(program);
+				glDrawElementsInstancedBaseVertex(GL_TRIANGLES, level.numIndices, GL_UNSIGNED_INT, (GLvoid *)(level.firstIndex * sizeof(GLuint)), count, meshes[i].BaseVertex());
+				textureBinds += meshes[i].material.NumBindings();
+				drawnTriangles += meshes[i].NumTriangles(this->lod) * count;
+				fullTriangles += meshes[i].NumTriangles(0) * count;
+			}
+			glBindVertexArray(0);
+
+			if (buffer.packed)
+			{
+				glUniform1i(program.packedVertices, 0);
+			}
+			glUniform1i(program.instanced, 0);
+			queue.CountImmediate((GLuint)meshes.size(), 2, textureBinds, (GLuint)meshes.size() + 2 + (buffer.packed ? 4 : 0));
+		}
+
+		if (asset->numLods > 1)
+		{
+			context.CountDraw(this->lod, drawnTriangles, fullTriangles);
+		}
+	}
+
+private:
+	Model &model;
+	vector<InstanceData> instances;
+	bool dirty = true;
+
+	GLuint VAO = 0;
+	GLuint instanceVBO = 0;
+	const ModelAsset *asset = nullptr; // What the VAO was built for
+	GLuint vertexVBO = 0, vertexEBO = 0;
+
+	glm::vec3 boundsCenter;  // World sphere around every placement
+	float boundsRadius = 0.0f;
+	GLuint lod = 0;
+
+	// Rebuilds the VAO for a newly loaded asset and uploads the placements if they changed
+	void update(const ModelAsset &asset)
+	{
+		const MeshBuffer &buffer = asset.buffer;
+		if (this->asset != &asset || this->vertexVBO != buffer.VBO || this->vertexEBO != buffer.EBO)
+		{
+			if (!this->VAO)
+			{
+				glGenVertexArrays(1, &this->VAO);
+				glGenBuffers(1, &this->instanceVBO);
+			}
+			this->asset = &asset;
+			this->vertexVBO = buffer.VBO;
+			this->vertexEBO = buffer.EBO;
+			this->dirty = true;
+
+			// The vertices and indices of the arena block, described as its own VAO does
+			glBindVertexArray(this->VAO);
+			glBindBuffer(GL_ARRAY_BUFFER, buffer.VBO);
+			MeshBuffer::Layout(buffer.packed).describe();
+			glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffer.EBO);
+
+			// One model matrix and one normal matrix per instance
+			glBindBuffer(GL_ARRAY_BUFFER, this->instanceVBO);
+			for (GLuint i = 0; i < 4; i++)
+			{
+				GLuint location = INSTANCE_ATTRIBUTE_MODEL + i;
+				glEnableVertexAttribArray(location);
+				glVertexAttribPointer(location, 4, GL_FLOAT, GL_FALSE, sizeof(InstanceData), (GLvoid *)(offsetof(InstanceData, model) + i * sizeof(glm::vec4)));
+				glVertexAttribDivisor(location, 1);
+			}
+			for (GLuint i = 0; i < 3; i++)
+			{
+				GLuint location = INSTANCE_ATTRIBUTE_NORMAL + i;
+				glEnableVertexAttribArray(location);
+				glVertexAttribPointer(location, 3, GL_FLOAT, GL_FALSE, sizeof(InstanceData), (GLvoid *)(offsetof(InstanceData, normal) + i * sizeof(glm::vec3)));
+				glVertexAttribDivisor(location, 1);
+			}
+			glBindVertexArray(0);
+			glBindBuffer(GL_ARRAY_BUFFER, 0);
+		}
+
+		if (!this->dirty)
+		{
+			return;
+		}
+		this->dirty = false;
+
+		glBindBuffer(GL_ARRAY_BUFFER, this->instanceVBO);
+		glBufferData(GL_ARRAY_BUFFER, this->instances.size() * sizeof(InstanceData), this->instances.data(), GL_STATIC_DRAW);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+		// Box around the sphere of every placement, then the sphere that holds all of them
+		glm::vec3 minimum(0.0f), maximum(0.0f);
+		vector<float> radii(this->instances.size());
+		vector<glm::vec3> centers(this->instances.size());
+		for (size_t i = 0; i < this->instances.size(); i++)
+		{
+			const glm::mat4 &model = this->instances[i].model;
+			centers[i] = glm::vec3(model * glm::vec4(asset.boundsCenter, 1.0f));
+			radii[i] = asset.boundsRadius * RenderContext::MaxScale(model);
+			for (int k = 0; k < 3; k++)
+			{
+				minimum[k] = i == 0 ? centers[i][k] - radii[i] : min(minimum[k], centers[i][k] - radii[i]);
+				maximum[k] = i == 0 ? centers[i][k] + radii[i] : max(maximum[k], centers[i][k] + radii[i]);
+			}
+		}
+		this->boundsCenter = (minimum + maximum) * 0.5f;
+		this->boundsRadius = 0.0f;
+		for (size_t i = 0; i < this->instances.size(); i++)
+		{
+			this->boundsRadius = max(this->boundsRadius, glm::length(centers[i] - this->boundsCenter) + radii[i]);
+		}
+	}
+};
@@ -0,0 +1,311 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <utility>
+
+using namespace std;
+
+/*
+	Minimal JSON reader and string escaping, enough for the glTF header of a .glb and the reports the tools write.
+
+	Parse builds a tree of JsonValue. Looking up a missing member or element gives a shared null value instead of
+	failing, so nested lookups read like the document: json["meshes"][0]["primitives"].
+*/
+
+class JsonValue
+{
+public:
+	enum Type
+	{
+		JSON_NULL,
+		JSON_BOOL,
+		JSON_NUMBER,
+		JSON_STRING,
+		JSON_ARRAY,
+		JSON_OBJECT
+	};
+
+	Type type = JSON_NULL;
+	bool boolean = false;
+	double number = 0.0;
+	string text;
+	vector<JsonValue> elements;
+	vector<pair<string, JsonValue> > members;
+
+	bool IsNull() const { return this->type == JSON_NULL; }
+	bool IsNumber() const { return this->type == JSON_NUMBER; }
+	bool IsString() const { return this->type == JSON_STRING; }
+	bool IsArray() const { return this->type == JSON_ARRAY; }
+	bool IsObject() const { return this->type == JSON_OBJECT; }
+
+	size_t Size() const
+	{
+		return this->type == JSON_ARRAY ? this->elements.size() : this->members.size();
+	}
+
+	const JsonValue &operator[](size_t index) const
+	{
+		return this->type == JSON_ARRAY && index < this->elements.size() ? this->elements[index] : Null();
+	}
+
+	const JsonValue &operator[](const char *name) const
+	{
+		if (this->type == JSON_OBJECT)
+		{
+			for (size_t i = 0; i < this->members.size(); i++)
+			{
+				if (this->members[i].first == name)
+				{
+					return this->members[i].second;
+				}
+			}
+		}
+		return Null();
+	}
+
+	bool Has(const char *name) const
+	{
+		return !(*this)[name].IsNull();
+	}
+
+	// The number as an integer, or fallback if it isn't one
+	long long Int(long long fallback = 0) const
+	{
+		return this->type == JSON_NUMBER ? (long long)this->number : fallback;
+	}
+
+	// Parses a whole document. Returns false on malformed input.
+	static bool Parse(const char *data, size_t size, JsonValue &value)
+	{
+		const char *p = data, *end = data + size;
+		if (!parseValue(p, end, value, 0))
+		{
+			return false;
+		}
+		skipSpaces(p, end);
+		return p == end;
+	}
+
+	// Quoted and escaped, ready to be written into a document
+	static string Quote(const string &text)
+	{
+		string result = "\"";
+		for (size_t i = 0; i < text.size(); i++)
+		{
+			unsigned char c = (unsigned char)text[i];
+			switch (c)
+			{
+			case '"': result += "\\\""; break;
+			case '\\': result += "\\\\"; break;
+			case '\n': result += "\\n"; break;
+			case '\r': result += "\\r"; break;
+			case '\t': result += "\\t"; break;
+			default:
+				if (c < 0x20)
+				{
+					char escaped[8];
+					snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+					result += escaped;
+				}
+				else
+				{
+					result += (char)c;
+				}
+			}
+		}
+		return result + "\"";
+	}
+
+private:
+	static const JsonValue &Null()
+	{
+		static const JsonValue null;
+		return null;
+	}
+
+	static void skipSpaces(const char *&p, const char *end)
+	{
+		while (p < end && (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r'))
+		{
+			p++;
+		}
+	}
+
+	static bool parseValue(const char *&p, const char *end, JsonValue &value, int depth)
+	{
+		skipSpaces(p, end);
+		if (p >= end || depth > 64)
+		{
+			return false;
+		}
+
+		switch (*p)
+		{
+		case '{':
+		{
+			value.type = JSON_OBJECT;
+			p++;
+			skipSpaces(p, end);
+			if (p < end && *p == '}')
+			{
+				p++;
+				return true;
+			}
+			while (true)
+			{
+				skipSpaces(p, end);
+				pair<string, JsonValue> member;
+				if (p >= end || *p != '"' || !parseString(p, end, member.first))
+				{
+					return false;
+				}
+				skipSpaces(p, end);
+				if (p >= end || *p++ != ':' || !parseValue(p, end, member.second, depth + 1))
+				{
+					return false;
+				}
+				value.members.push_back(move(member));
+				skipSpaces(p, end);
+				if (p < end && *p == ',')
+				{
+					p++;
+					continue;
+				}
+				return p < end && *p++ == '}';
+			}
+		}
+		case '[':
+		{
+			value.type = JSON_ARRAY;
+			p++;
+			skipSpaces(p, end);
+			if (p < end && *p == ']')
+			{
+				p++;
+				return true;
+			}
+			while (true)
+			{
+				JsonValue element;
+				if (!parseValue(p, end, element, depth + 1))
+				{
+					return false;
+				}
+				value.elements.push_back(move(element));
+				skipSpaces(p, end);
+				if (p < end && *p == ',')
+				{
+					p++;
+					continue;
+				}
+				return p < end && *p++ == ']';
+			}
+		}
+		case '"':
+			value.type = JSON_STRING;
+			return parseString(p, end, value.text);
+		case 't':
+		case 'f':
+		case 'n':
+		{
+			static const char *words[] = { "true", "false", "null" };
+			for (int i = 0; i < 3; i++)
+			{
+				size_t length = strlen(words[i]);
+				if ((size_t)(end - p) >= length && strncmp(p, words[i], length) == 0)
+				{
+					value.type = i == 2 ? JSON_NULL : JSON_BOOL;
+					value.boolean = i == 0;
+					p += length;
+					return true;
+				}
+			}
+			return false;
+		}
+		default:
+		{
+			// strtod needs a terminated string; numbers are short, so copy the candidate characters
+			char buffer[64];
+			size_t length = 0;
+			while (p + length < end && length < sizeof(buffer) - 1 && strchr("+-0123456789.eE", p[length]) != nullptr)
+			{
+				buffer[length] = p[length];
+				length++;
+			}
+			buffer[length] = '\0';
+			char *parsed;
+			value.number = strtod(buffer, &parsed);
+			if (parsed == buffer)
+			{
+				return false;
+			}
+			value.type = JSON_NUMBER;
+			p += parsed - buffer;
+			return true;
+		}
+		}
+	}
+
+	static bool parseString(const char *&p, const char *end, string &text)
+	{
+		p++; // Opening quote
+		while (p < end && *p != '"')
+		{
+			if (*p != '\\')
+			{
+				text += *p++;
+				continue;
+			}
+			if (++p >= end)
+			{
+				return false;
+			}
+			char c = *p++;
+			switch (c)
+			{
+			case 'n': text += '\n'; break;
+			case 'r': text += '\r'; break;
+			case 't': text += '\t'; break;
+			case 'b': text += '\b'; break;
+			case 'f': text += '\f'; break;
+			case 'u':
+			{
+				// Written as UTF-8; surrogate pairs are not combined
+				if (end - p < 4)
+				{
+					return false;
+				}
+				unsigned code = (unsigned)strtoul(string(p, p + 4).c_str(), nullptr, 16);
+				p += 4;
+				if (code < 0x80)
+				{
+					text += (char)code;
+				}
+				else if (code < 0x800)
+				{
+					text += (char)(0xC0 | (code >> 6));
+					text += (char)(0x80 | (code & 0x3F));
+				}
+				else
+				{
+					text += (char)(0xE0 | (code >> 12));
+					text += (char)(0x80 | ((code >> 6) & 0x3F));
+					text += (char)(0x80 | (code & 0x3F));
+				}
+				break;
+			}
+			default: text += c; break;
+			}
+		}
+		if (p >= end)
+		{
+			return false;
+		}
+		p++; // Closing quote
+		return true;
+	}
+};
@@ -0,0 +1,246 @@
+#pragma once
+
+#include <map>
+#include <mutex>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstdint>
+#include <iostream>
+#include <algorithm>
+
+#include "Json.h"
+
+using namespace std;
+
+/*
+	Where the startup time goes, per asset.
+
+	Every model, texture, cubemap, shader and the audio are recorded under their kind and name, with the time split
+	into stages and the bytes read from disk and uploaded to the GPU. Loads run on the loader threads as well as
+	the GL thread, so the stages of different assets overlap and their sum is larger than the wall time.
+
+	Files are mapped, so their pages are read the first time they are touched: hashing a texture file is its I/O,
+	but for an .obj the reading happens while it is parsed and is counted there.
+*/
+
+#define LOAD_PROFILE_FILE "load_profile.json"
+#define LOAD_PROFILE_TOP 15 // Assets listed by PrintReport
+
+enum LoadStage
+{
+	LOAD_IO,      // Opening, mapping, hashing and writing files
+	LOAD_PARSE,   // Turning file contents into meshes, pixels or source text
+	LOAD_CONVERT, // Processing them: mesh optimization and levels of detail, vertex packing, shader compilation
+	LOAD_UPLOAD,  // GL buffers and textures
+	LOAD_SETUP,   // Everything else, like starting the audio device
+	LOAD_NUM_STAGES
+};
+
+struct LoadRecord
+{
+	string kind;  // "model", "texture", "cubemap", "shader" or "audio"
+	string name;
+	string route; // Where it came from, e.g. "cache", "cooked" or "import" for a model
+	double ms[LOAD_NUM_STAGES];
+	uint64_t bytesRead = 0;
+	uint64_t bytesUploaded = 0;
+
+	LoadRecord()
+	{
+		fill(this->ms, this->ms + LOAD_NUM_STAGES, 0.0);
+	}
+
+	double TotalMs() const
+	{
+		double total = 0.0;
+		for (int i = 0; i < LOAD_NUM_STAGES; i++)
+		{
+			total += this->ms[i];
+		}
+		return total;
+	}
+};
+
+class LoadProfiler
+{
+public:
+	static LoadProfiler &Get()
+	{
+		static LoadProfiler profiler;
+		return profiler;
+	}
+
+	// Once the startup report is written, streaming doesn't need to keep adding records
+	void Stop()
+	{
+		lock_guard<mutex> lock(this->recordsMutex);
+		this->enabled = false;
+	}
+
+	// Times the rest of a scope and adds it to a stage of an asset
+	class Timer
+	{
+	public:
+		Timer(const string &kind, const string &name, LoadStage stage) : kind(kind), name(name), stage(stage), start(chrono::steady_clock::now()) {}
+
+		~Timer()
+		{
+			LoadProfiler::Get().AddTime(this->kind, this->name, this->stage, chrono::duration<double, milli>(chrono::steady_clock::now() - this->start).count());
+		}
+
+		Timer(const Timer &) = delete;
+		Timer &operator=(const Timer &) = delete;
+
+	private:
+		string kind;
+		string name;
+		LoadStage stage;
+		chrono::steady_clock::time_point start;
+	};
+
+	void AddTime(const string &kind, const string &name, LoadStage stage, double ms)
+	{
+		lock_guard<mutex> lock(this->recordsMutex);
+		if (!this->enabled)
+		{
+			return;
+		}
+		this->record(kind, name).ms[stage] += ms;
+	}
+
+	void AddBytes(const string &kind, const string &name, uint64_t bytesRead, uint64_t bytesUploaded)
+	{
+		lock_guard<mutex> lock(this->recordsMutex);
+		if (!this->enabled)
+		{
+			return;
+		}
+		LoadRecord &record = this->record(kind, name);
+		record.bytesRead += bytesRead;
+		record.bytesUploaded += bytesUploaded;
+	}
+
+	void SetRoute(const string &kind, const string &name, const string &route)
+	{
+		lock_guard<mutex> lock(this->recordsMutex);
+		if (!this->enabled)
+		{
+			return;
+		}
+		this->record(kind, name).route = route;
+	}
+
+	// The records, slowest first
+	vector<LoadRecord> Records()
+	{
+		lock_guard<mutex> lock(this->recordsMutex);
+		vector<LoadRecord> records;
+		for (map<string, LoadRecord>::const_iterator it = this->records.begin(); it != this->records.end(); ++it)
+		{
+			records.push_back(it->second);
+		}
+		stable_sort(records.begin(), records.end(), [](const LoadRecord &a, const LoadRecord &b) { return a.TotalMs() > b.TotalMs(); });
+		return records;
+	}
+
+	// Totals per kind and stage, then the LOAD_PROFILE_TOP slowest assets. wallMs is the startup time it is compared to.
+	void PrintReport(double wallMs)
+	{
+		vector<LoadRecord> records = this->Records();
+
+		map<string, LoadRecord> kinds;
+		map<string, size_t> counts;
+		LoadRecord total;
+		for (size_t i = 0; i < records.size(); i++)
+		{
+			add(kinds[records[i].kind], records[i]);
+			add(total, records[i]);
+			counts[records[i].kind]++;
+		}
+
+		cout << "Perfil de carga: " << records.size() << " assets en " << wallMs << " ms | io " << total.ms[LOAD_IO] << " ms, parseo " << total.ms[LOAD_PARSE]
+			<< " ms, conversion " << total.ms[LOAD_CONVERT] << " ms, subida " << total.ms[LOAD_UPLOAD] << " ms, otros " << total.ms[LOAD_SETUP] << " ms | leidos "
+			<< Megabytes(total.bytesRead) << " MB, subidos " << Megabytes(total.bytesUploaded) << " MB" << endl;
+		for (map<string, LoadRecord>::const_iterator it = kinds.begin(); it != kinds.end(); ++it)
+		{
+			cout << "  " << it->first << " (" << counts[it->first] << "): " << it->second.TotalMs() << " ms" << stages(it->second) << endl;
+		}
+		for (size_t i = 0; i < records.size() && i < LOAD_PROFILE_TOP; i++)
+		{
+			cout << "  " << i + 1 << ". " << records[i].TotalMs() << " ms " << records[i].kind << " " << records[i].name
+				<< (records[i].route.empty() ? "" : " [" + records[i].route + "]") << stages(records[i]) << endl;
+		}
+	}
+
+	// Every record, slowest first, for comparing runs with other tools
+	bool WriteJson(const string &path, double wallMs)
+	{
+		static const char *stageNames[LOAD_NUM_STAGES] = { "io", "parse", "convert", "upload", "setup" };
+
+		vector<LoadRecord> records = this->Records();
+		FILE *out = fopen(path.c_str(), "w");
+		if (!out)
+		{
+			cout << "ERROR::LOAD_PROFILER::CANNOT_WRITE " << path << endl;
+			return false;
+		}
+
+		fprintf(out, "{\n  \"wallMs\": %.3f,\n  \"assets\": [\n", wallMs);
+		for (size_t i = 0; i < records.size(); i++)
+		{
+			const LoadRecord &record = records[i];
+			fprintf(out, "    {\"kind\": %s, \"name\": %s, \"route\": %s, \"totalMs\": %.3f", JsonValue::Quote(record.kind).c_str(),
+				JsonValue::Quote(record.name).c_str(), JsonValue::Quote(record.route).c_str(), record.TotalMs());
+			for (int s = 0; s < LOAD_NUM_STAGES; s++)
+			{
+				fprintf(out, ", \"%sMs\": %.3f", stageNames[s], record.ms[s]);
+			}
+			fprintf(out, ", \"bytesRead\": %llu, \"bytesUploaded\": %llu}%s\n", (unsigned long long)record.bytesRead,
+				(unsigned long long)record.bytesUploaded, i + 1 < records.size() ? "," : "");
+		}
+		fprintf(out, "  ]\n}\n");
+		return fclose(out) == 0;
+	}
+
+private:
+	mutex recordsMutex;
+	map<string, LoadRecord> records; // By kind and name
+	bool enabled = true;
+
+	LoadRecord &record(const string &kind, const string &name)
+	{
+		LoadRecord &record = this->records[kind + "|" + name];
+		if (record.kind.empty())
+		{
+			record.kind = kind;
+			record.name = name;
+		}
+		return record;
+	}
+
+	static void add(LoadRecord &total, const LoadRecord &record)
+	{
+		for (int i = 0; i < LOAD_NUM_STAGES; i++)
+		{
+			total.ms[i] += record.ms[i];
+		}
+		total.bytesRead += record.bytesRead;
+		total.bytesUploaded += record.bytesUploaded;
+	}
+
+	static double Megabytes(uint64_t bytes)
+	{
+		return bytes / (1024.0 * 1024.0);
+	}
+
+	static string stages(const LoadRecord &record)
+	{
+		char text[256];
+		snprintf(text, sizeof(text), " | io %.1f, parseo %.1f, conversion %.1f, subida %.1f, otros %.1f | %.2f MB leidos, %.2f MB subidos",
+			record.ms[LOAD_IO], record.ms[LOAD_PARSE], record.ms[LOAD_CONVERT], record.ms[LOAD_UPLOAD], record.ms[LOAD_SETUP],
+			Megabytes(record.bytesRead), Megabytes(record.bytesUploaded));
+		return text;
+	}
+};
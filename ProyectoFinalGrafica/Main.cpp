@@ -49,7 +49,7 @@ LIBRERÍAS UTILIZADAS:
 ESTRUCTURA DEL CÓDIGO:
 	1. Declaración de funciones y variables globales
 	2. Función main() - Inicialización y bucle de renderizado
-	3. Funciones auxiliares (ConfigurarVAO, ConfigurarTexturaRepetible, DibujarPiso)
+	3. Funciones auxiliares (ConfigurarVAO, ConfigurarTexturaRepetible, MatrizPiso)
 	4. Funciones de callbacks (DoMovement, KeyCallback, MouseCallback)
 
 AUTORES: -Oscar Cruz Soria
@@ -74,6 +74,11 @@ FECHA: 12 Noviembre 2025
 #include "Shader.h"
 #include "Camera.h"
 #include "Model.h"
+#include "AssetStreamer.h"
+#include "MemoryReport.h"
+#include "TextureBench.h"
+#include "InstanceBatch.h"
+#include "StaticBatch.h"
 //Skybox
 #include "Texture.h"
 
@@ -94,7 +99,7 @@ CALLBACKS DE GLFW:
 FUNCIONES AUXILIARES DE RENDERIZADO:
 	- ConfigurarVAO: Configura Vertex Array Objects con sus VBOs para geometría
 	- ConfigurarTexturaRepetible: Establece parámetros de wrapping para texturas
-	- DibujarPiso: Renderiza superficies con texturas aplicadas y transformaciones
+	- MatrizPiso: Transformación de un piso o pared (el cubo unitario trasladado y escalado)
 */
 
 // Funciones prototipo para callbacks
@@ -107,7 +112,7 @@ void DoMovement();
 //Configurar funciones para repetir textura de piso
 void ConfigurarVAO(GLuint& VAO, GLuint& VBO, float* vertices, size_t size);
 void ConfigurarTexturaRepetible(GLuint textureID);
-void DibujarPiso(GLuint textureID, glm::vec3 posicion, glm::vec3 escala, GLuint VAO_Cubo, GLint modelLoc);
+glm::mat4 MatrizPiso(glm::vec3 posicion, glm::vec3 escala);
 
 
 /*
@@ -538,7 +543,7 @@ GLfloat lastFrame = 0.0f;
 		- Definición del área de renderizado
 	*/
 
-int main()
+int main(int argc, char *argv[])
 {
 	// =================================================================================
 	// INICIALIZACIÓN DE GLFW, GLEW Y VENTANA
@@ -581,6 +586,133 @@ int main()
 	// Define the viewport dimensions
 	glViewport(0, 0, SCREEN_WIDTH, SCREEN_HEIGHT);
 
+	// Opciones de linea de comandos:
+	//   --packed-vertices    Sube los modelos con vertices compactos de 16 bytes en lugar de 32
+	//   --validate-vertices  Igual que el anterior e imprime el error maximo de posicion y normal de cada modelo
+	//   --stream-budget-mb N Memoria de GPU que pueden ocupar los habitats cargados (por defecto 256 MB, 0 = sin limite)
+	//   --stream-cpu-budget-mb N  RAM que pueden ocupar las copias de las mallas de los habitats cargados (ver --cpu-mirror;
+	//                        por defecto 256 MB, 0 = sin limite)
+	//   --no-lod             Dibuja todos los modelos con su malla completa, para comparar contra los niveles de detalle
+	//   --no-cooked          Ignora Cooked/ (generado con zoo-cook) y carga todo desde los .obj y las imagenes
+	//   --no-pack            Ignora assets.zpak (generado con zoo-cook --pack) y lee cada archivo suelto del disco
+	//   --native-obj         Lee los .obj con ObjLoader en lugar de Assimp (hasta que zoo-cook --check-obj pase contra Assimp)
+	//   --glb                Carga el .glb junto a cada modelo (generado con zoo-cook --to-glb) cuando existe
+	//   --upload-budget-ms N Milisegundos por cuadro para subir geometria y texturas a la GPU (por defecto 2, 0 = sin limite)
+	//   --upload-budget-mb N Megabytes por cuadro para lo mismo (por defecto 16, 0 = sin limite)
+	//   --cpu-mirror M       Copia de las mallas que se queda en RAM tras subirlas: drop (nada, por defecto),
+	//                        compact (posiciones e indices del nivel completo) o full (la malla cargada completa)
+	//   --rgb-textures       Decodifica las texturas a 3 canales en lugar de 4 (RGBA se sube sin conversion)
+	//   --bench-textures     Mide texturas por segundo del camino anterior contra el de hilos y PBO, y sale
+	//   --cook-textures      Antes de cargar, comprime a DXT con mipmaps (en Cooked/) las imagenes que zoo-cook aun no
+	//                        cocino o que cambiaron, e imprime el error visual de cada una
+	//   --no-render-queue    Dibuja cada objeto en cuanto se pide, en el orden del codigo, sin ordenar por estado
+	//   --no-indirect        Con la cola, una llamada de dibujo por malla aunque el driver tenga glMultiDraw*Indirect
+	//   --no-static-batch    Dibuja pisos, paredes, bancas y adornos de la entrada uno por uno en lugar de hornearlos en lotes
+	bool benchTexturas = false;
+	bool cocinarTexturas = false;
+	for (int i = 1; i < argc; i++)
+	{
+		std::string opcion = argv[i];
+		if (opcion == "--packed-vertices")
+		{
+			Model::Options().packedVertices = true;
+		}
+		else if (opcion == "--validate-vertices")
+		{
+			Model::Options().packedVertices = true;
+			Model::Options().validateVertices = true;
+		}
+		else if (opcion == "--stream-budget-mb" && i + 1 < argc)
+		{
+			AssetStreamer::Get().SetBudget((size_t)atoi(argv[++i]) * 1024 * 1024);
+		}
+		else if (opcion == "--stream-cpu-budget-mb" && i + 1 < argc)
+		{
+			AssetStreamer::Get().SetCpuBudget((size_t)atoi(argv[++i]) * 1024 * 1024);
+		}
+		else if (opcion == "--no-lod")
+		{
+			RenderContext::Get().lodEnabled = false;
+		}
+		else if (opcion == "--no-cooked")
+		{
+			CookedAssets::Get().enabled = false;
+		}
+		else if (opcion == "--no-pack")
+		{
+			AssetPack::Get().enabled = false;
+		}
+		else if (opcion == "--native-obj")
+		{
+			Model::Options().nativeObj = true;
+		}
+		else if (opcion == "--glb")
+		{
+			Model::Options().preferGlb = true;
+		}
+		else if (opcion == "--upload-budget-ms" && i + 1 < argc)
+		{
+			UploadQueue::Get().budgetMs = atof(argv[++i]);
+		}
+		else if (opcion == "--upload-budget-mb" && i + 1 < argc)
+		{
+			UploadQueue::Get().budgetBytes = (size_t)(atof(argv[++i]) * 1024 * 1024);
+		}
+		else if (opcion == "--cpu-mirror" && i + 1 < argc)
+		{
+			std::string espejo = argv[++i];
+			Model::Options().cpuMirror = espejo == "full" ? MESH_MIRROR_FULL : (espejo == "compact" ? MESH_MIRROR_COMPACT : MESH_MIRROR_DROP);
+		}
+		else if (opcion == "--rgb-textures")
+		{
+			TextureManager::Get().rgbaUploads = false;
+		}
+		else if (opcion == "--bench-textures")
+		{
+			benchTexturas = true;
+		}
+		else if (opcion == "--cook-textures")
+		{
+			cocinarTexturas = true;
+		}
+		else if (opcion == "--no-render-queue")
+		{
+			RenderQueue::Get().enabled = false;
+		}
+		else if (opcion == "--no-indirect")
+		{
+			RenderQueue::Get().SetIndirect(false);
+		}
+		else if (opcion == "--no-static-batch")
+		{
+			StaticBatch::Enabled() = false;
+		}
+	}
+
+	// La cola dibuja cada grupo de mallas con el mismo estado en una sola llamada indirecta si el driver lo permite
+	if (RenderQueue::Get().enabled)
+	{
+		std::cout << "Dibujo indirecto: " << (!RenderQueue::Get().IndirectSupported() ? "no disponible (requiere GL 4.3 o ARB_multi_draw_indirect y ARB_base_instance)"
+			: (RenderQueue::Get().indirect ? "activo (F5 lo alterna)" : "desactivado (F5 lo activa)")) << std::endl;
+	}
+
+	// Modelos, materiales e imagenes empaquetados en un solo archivo que se mapea una vez; sin el se leen los archivos sueltos
+	AssetPack::Get().Open(ASSET_PACK_FILE);
+
+	// Mallas y texturas preparadas por zoo-cook; lo que no este cocinado se carga de la fuente
+	CookedAssets::Get().Load();
+	if (cocinarTexturas)
+	{
+		CookedAssets::Get().CookTextures();
+	}
+
+	if (benchTexturas)
+	{
+		TextureBench::Run();
+		glfwTerminate();
+		return 0;
+	}
+
 		/*
 	================================================================================
 		CARGA DE SHADERS Y MODELOS 3D
@@ -593,7 +725,8 @@ int main()
 	*/
 
 	// Cargar shaders
-	Shader lightingShader("Shader/lighting.vs", "Shader/lighting.frag");
+	// lighting.vs lee las matrices del dibujo indirecto con la distribucion que define RenderQueue
+	Shader lightingShader("Shader/lighting.vs", "Shader/lighting.frag", RenderQueue::ShaderDefines());
 	Shader lampShader("Shader/lamp.vs", "Shader/lamp.frag");
 	//Skybox
 	Shader skyboxShader("Shader/skybox.vs", "Shader/skybox.frag");
@@ -661,6 +794,21 @@ float skyboxVertices[] = {
 
 */
 
+	// =================================================================================
+	// 						CARGA PARALELA DE MODELOS
+	// =================================================================================
+	// Mientras el AssetLoader esta activo, cada Model solo encola su importacion (Assimp,
+	// procesado de mallas y decodificacion de texturas) en los hilos trabajadores. La
+	// creacion de buffers y texturas de OpenGL se hace en este hilo dentro de Wait() y,
+	// durante el recorrido, en AssetStreamer::Update().
+
+	double inicioCarga = glfwGetTime();
+	AssetLoader::Get().Start();
+
+	// Distancia (en el plano del piso) a la que se carga un habitat, y a partir de la cual puede descargarse
+	const float radioCargaHabitat = 16.0f;
+	const float radioDescargaHabitat = 20.0f;
+
 	// =================================================================================
 	// 						CARGA DE MODELO - Personaje camara
 	// =================================================================================
@@ -671,11 +819,16 @@ float skyboxVertices[] = {
 	// 						CARGA DE MODELOS - ENTRADA // ADORNOS
 	// =================================================================================
 	
+	// Bancas de los caminos: fuera de cualquier habitat, siempre residentes
+	Model BancaModel((char*)"Models/adornos/banca.obj");
+
 	std::cout << "Cargando modelos entrada..." << std::endl;
 
+	// Cada habitat es una unidad de streaming: sus modelos se cargan cuando la camara se acerca
+	// a su centro y se descargan si se excede el presupuesto de memoria (ver AssetStreamer.h)
+	AssetStreamer::Get().BeginUnit("Entrada", glm::vec3(0.0f, 0.0f, 17.5f), radioCargaHabitat, radioDescargaHabitat);
+
 	Model LetreroZoo((char*)"Models/adornos/zooletre.obj");
-	
-	Model BancaModel((char*)"Models/adornos/banca.obj");
 
 	Model Taquilla((char*)"Models/taquilla/taquilla.obj");
 	glm::vec3 taquillaPos(3.5f, 0.4f, 14.5f);
@@ -707,6 +860,7 @@ float skyboxVertices[] = {
 	glm::vec3 carruselScale(4.0f, 3.0f, 3.5f);
 	float carruselRot = 0.0f;
 
+	AssetStreamer::Get().EndUnit();
 	std::cout << "Modelos cargados entrada!" << std::endl;
 
 
@@ -715,6 +869,7 @@ float skyboxVertices[] = {
 	 =================================================================================*/
 	
 	std::cout << "Cargando modelos acuario..." << std::endl;
+	AssetStreamer::Get().BeginUnit("Acuario", glm::vec3(7.25f, 0.0f, -7.25f), radioCargaHabitat, radioDescargaHabitat);
 	 // Acuario escenario
 	Model EscenarioAcuario((char*)"Models/Acuario/escenarioacuario.obj");
 	// IGLU
@@ -746,6 +901,7 @@ float skyboxVertices[] = {
 	Model NutriaPataBL((char*)"Models/nutriaacuario/nutriapatatraseraizquierda.obj");
 	Model NutriaPataBR((char*)"Models/nutriaacuario/nutriapatatraseraderecha.obj");
 
+	AssetStreamer::Get().EndUnit();
 	std::cout << "Modelos cargados acuario!" << std::endl;
 
 	// =================================================================================
@@ -753,6 +909,7 @@ float skyboxVertices[] = {
 	// =================================================================================
 	
 	std::cout << "Cargando modelos selva..." << std::endl;
+	AssetStreamer::Get().BeginUnit("Selva", glm::vec3(7.25f, 0.0f, 7.25f), radioCargaHabitat, radioDescargaHabitat);
 	// ====== ESCENARIO ======
 	Model ArbolSelva((char*)"Models/arbolSelva/arbolSelva.obj");
 	glm::vec3 arbolSelvaPos(11.0f, -0.5f, 3.1f);
@@ -784,7 +941,7 @@ float skyboxVertices[] = {
 	glm::vec3 platano1Scale(5.0f, 5.0f, 5.0f);
 	float platano1Rot = 0.0f;
 
-	Model Platano2((char*)"Models/platano/platano.obj");
+	// Segunda colocacion del platano: se dibuja instanciada con Platano1 (ver "PROPS REPETIDOS")
 	glm::vec3 platano2Pos(7.6f, -0.4f, 9.8f);
 	glm::vec3 platano2Scale(5.0f, 5.0f, 5.0f);
 	float platano2Rot = 0.0f;
@@ -810,7 +967,7 @@ float skyboxVertices[] = {
 	float plantaSelva1Rot = 0.0f;
 	glm::vec3 plantaSelva3Pos(-3.8f, -0.3f, -3.1f);
 
-	Model PlantaSelva2((char*)"Models/plantaSelva/planta_selva.obj");
+	// Segunda planta: instanciada con PlantaSelva1
 	glm::vec3 plantaSelva2Pos(11.0f, -0.3f, 9.5f);
 	glm::vec3 plantaSelva2Scale(0.4f, 0.4f, 0.4f);
 	float plantaSelva2Rot = 0.0f;
@@ -820,12 +977,11 @@ float skyboxVertices[] = {
 	glm::vec3 loto1Scale(1.0f, 1.0f, 1.0f);
 	float loto1Rot = 0.0f;
 
-	Model Loto2((char*)"Models/loto/loto.obj");
+	// Lotos 2 y 3: instanciados con Loto1
 	glm::vec3 loto2Pos(5.0f, -0.21f, 3.1f);
 	glm::vec3 loto2Scale(1.0f, 1.0f, 1.0f);
 	float loto2Rot = 0.0f;
 
-	Model Loto3((char*)"Models/loto/loto.obj");
 	glm::vec3 loto3Pos(3.5f, -0.21f, 3.1f);
 	glm::vec3 loto3Scale(1.0f, 1.0f, 1.0f);
 	float loto3Rot = 0.0f;
@@ -852,12 +1008,14 @@ float skyboxVertices[] = {
 	Model Ave_AlaDer((char*)"Models/aveSelva/alaDerAve.obj");
 	Model Ave_AlaIzq((char*)"Models/aveSelva/alaIzqAve.obj");
 
+	AssetStreamer::Get().EndUnit();
 	std::cout << "Modelos cargados selva!" << std::endl;
 
 	// =================================================================================
 	// 						CARGA DE MODELOS - DESIERTO (-X,Z)
 	// =================================================================================
 	std::cout << "Cargando modelos desierto..." << std::endl;
+	AssetStreamer::Get().BeginUnit("Desierto", glm::vec3(-7.25f, 0.0f, 7.25f), radioCargaHabitat, radioDescargaHabitat);
 
 
 	// ====== ESCENARIO ======
@@ -902,6 +1060,7 @@ float skyboxVertices[] = {
 	Model CondorAla_Der((char*)"Models/condor/condor_ala_der.obj");
 	Model CondorAla_Izq((char*)"Models/condor/condor_ala_izq.obj");
 
+	AssetStreamer::Get().EndUnit();
 	std::cout << "Modelos cargados desierto!" << std::endl;
 
 
@@ -909,6 +1068,8 @@ float skyboxVertices[] = {
 	// 						CARGA DE MODELOS - AVIARIO (CENTRO)
 	// =================================================================================
 
+	AssetStreamer::Get().BeginUnit("Aviario", glm::vec3(0.0f, 0.0f, 0.0f), radioCargaHabitat, radioDescargaHabitat);
+
 	Model AviarioMadera((char*)"Models/Aviario/Aviariobase.obj");
 	Model AviarioVidrio((char*)"Models/Aviario/AviarioVidrio.obj");
 
@@ -920,6 +1081,8 @@ float skyboxVertices[] = {
 	Model AvePatas((char*)"Models/Aviario/patasave1.obj");
 	Model AveCola((char*)"Models/Aviario/colaave1.obj");
 
+	AssetStreamer::Get().EndUnit();
+
 
 
 	// =================================================================================
@@ -927,6 +1090,7 @@ float skyboxVertices[] = {
 	// =================================================================================
 
 	std::cout << "Cargando modelos sabana..." << std::endl;
+	AssetStreamer::Get().BeginUnit("Sabana", glm::vec3(-7.25f, 0.0f, -7.25f), radioCargaHabitat, radioDescargaHabitat);
 
 	// ====== ESCENARIO ======
 	
@@ -939,6 +1103,9 @@ float skyboxVertices[] = {
 
 	// ROCA
 	Model Roca((char*)"Models/roca/roca.obj");
+
+	// PLANTA (mismo archivo que las de la selva; comparte su asset si la selva esta cargada)
+	Model PlantaSabana((char*)"Models/plantaSelva/planta_selva.obj");
 	glm::vec3 RocaPos(-7.25f, -0.5f, -11.8f);
 	glm::vec3 RocaEScale(0.06f, 0.06f, 0.06f);
 	float RocaRot = 270.0f;
@@ -968,8 +1135,62 @@ float skyboxVertices[] = {
 	Model Cebra_PataTrasDer((char*)"Models/cebra/cebra_pata_der_atras.obj");
 	Model Cebra_PataTrasIzq((char*)"Models/cebra/cebra_pata_izq_atras.obj");
 
+	AssetStreamer::Get().EndUnit();
 	std::cout << "Modelos cargados sabana!" << std::endl;
 
+	// Encolar los habitats cercanos a la posicion inicial, esperar a los hilos trabajadores y subir
+	// a la GPU lo que vayan terminando. Los hilos siguen activos para el streaming del resto.
+	AssetStreamer::Get().Update(camera.GetPosition());
+	AssetLoader::Get().Wait();
+	// Durante la carga inicial no hay cuadros que cuidar: todo lo encolado se sube de una vez
+	UploadQueue::Get().Flush();
+	AssetStreamer::Get().Update(camera.GetPosition());
+	std::cout << "Modelos listos en " << (glfwGetTime() - inicioCarga) << " s (" << AssetLoader::Get().NumThreads() << " hilos)" << std::endl;
+	AssetStreamer::Get().PrintSummary();
+
+	// Resumen de la cache de mallas procesadas (arranque en frio vs. en caliente)
+	MeshCache::PrintSummary();
+	// Modelos repetidos (platanos, lotos, troncos, plantas) comparten buffers y texturas
+	ModelRegistry::Get().PrintSummary();
+	// Ocupacion de los buffers compartidos de geometria
+	MeshArena::Get().PrintSummary();
+
+	// =================================================================================
+	// 						PROPS REPETIDOS - INSTANCIAS
+	// =================================================================================
+	// Las colocaciones de un mismo modelo no se mueven: sus matrices se suben una vez a un buffer de
+	// instancias y cada lote se dibuja con una sola llamada instanciada por malla (ver InstanceBatch.h).
+	// El modelo de cada lote decide si se dibuja, segun el streaming de su habitat.
+	glm::mat4 colocacion;
+
+	// Platanos, plantas y lotos de la selva
+	InstanceBatch platanos(Platano1);
+	colocacion = glm::scale(glm::translate(glm::mat4(1.0f), platano1Pos), platano1Scale);
+	platanos.Add(glm::rotate(colocacion, glm::radians(platano1Rot), glm::vec3(0.0f, 1.0f, 0.0f)));
+	colocacion = glm::scale(glm::translate(glm::mat4(1.0f), platano2Pos), platano2Scale);
+	platanos.Add(glm::rotate(colocacion, glm::radians(platano2Rot), glm::vec3(0.0f, 1.0f, 0.0f)));
+
+	InstanceBatch plantasSelva(PlantaSelva1);
+	colocacion = glm::scale(glm::translate(glm::mat4(1.0f), plantaSelva1Pos), plantaSelva1Scale);
+	plantasSelva.Add(glm::rotate(colocacion, glm::radians(plantaSelva1Rot), glm::vec3(0.0f, 1.0f, 0.0f)));
+	colocacion = glm::scale(glm::translate(glm::mat4(1.0f), plantaSelva2Pos), plantaSelva2Scale);
+	plantasSelva.Add(glm::rotate(colocacion, glm::radians(plantaSelva2Rot), glm::vec3(0.0f, 1.0f, 0.0f)));
+
+	InstanceBatch lotos(Loto1);
+	colocacion = glm::scale(glm::translate(glm::mat4(1.0f), loto1Pos), loto1Scale);
+	lotos.Add(glm::rotate(colocacion, glm::radians(loto1Rot), glm::vec3(0.0f, 1.0f, 0.0f)));
+	colocacion = glm::scale(glm::translate(glm::mat4(1.0f), loto2Pos), loto2Scale);
+	lotos.Add(glm::rotate(colocacion, glm::radians(loto2Rot), glm::vec3(0.0f, 1.0f, 0.0f)));
+	colocacion = glm::scale(glm::translate(glm::mat4(1.0f), loto3Pos), loto3Scale);
+	lotos.Add(glm::rotate(colocacion, glm::radians(loto3Rot), glm::vec3(0.0f, 1.0f, 0.0f)));
+
+	// Arboles de la sabana
+	InstanceBatch arbolesSabana(ArbolSabana);
+	colocacion = glm::scale(glm::translate(glm::mat4(1.0f), arbolSabanaPos), arbolSabanaScale);
+	arbolesSabana.Add(glm::rotate(colocacion, glm::radians(arbolSabanaRot), glm::vec3(0.0f, 1.0f, 0.0f)));
+	colocacion = glm::scale(glm::translate(glm::mat4(1.0f), arbolSabanaPos2), arbolSabanaScale);
+	arbolesSabana.Add(glm::rotate(colocacion, glm::radians(arbolSabanaRot), glm::vec3(0.0f, 1.0f, 0.0f)));
+
 
 	/*
 	================================================================================
@@ -977,7 +1198,7 @@ float skyboxVertices[] = {
 	================================================================================
 
 	CARGA Y CONFIGURACIÓN:
-    - TextureFromFile(): Carga imágenes desde disco
+    - TextureFromFile(): Carga imágenes desde disco (decodificadas en los hilos trabajadores)
     - ConfigurarTexturaRepetible(): Establece parámetros de wrapping/filtering
 
 	TEXTURAS CARGADAS:
@@ -1108,6 +1329,92 @@ float skyboxVertices[] = {
 	faces.push_back("images/skybox/front.jpg");
 	GLuint cubeMapTexture = TextureLoading::LoadCubemap(faces);
 
+	// Texturas de modelos, pisos y skybox comparten el mismo administrador. Las de los pisos se decodifican
+	// en los hilos trabajadores mientras se decodifica el skybox; aqui se espera a que esten y se suben.
+	AssetLoader::Get().Wait();
+	UploadQueue::Get().Flush();
+	TextureManager::Get().PrintSummary();
+
+	// Si la imagen de un piso ya estaba cargada con otra ruta, se usa esa textura en lugar de una copia
+	GLuint *texturasPisos[] = { &pisoTextureID, &pisoEntradaID, &paredTextureID, &pisoPiedraTextureID,
+		&pisoAguaTextureID, &pisoSelvaTextureID, &pisoSabanaTextureID, &pisoArenaTextureID };
+	for (size_t i = 0; i < sizeof(texturasPisos) / sizeof(texturasPisos[0]); i++)
+	{
+		*texturasPisos[i] = TextureManager::Get().Resolve(*texturasPisos[i]);
+	}
+
+	// =================================================================================
+	// 						GEOMETRIA ESTATICA - LOTES POR MATERIAL
+	// =================================================================================
+	// Lo que nunca se mueve se agrega una vez con su transformacion. En cuanto sus modelos estan
+	// cargados, cada lote hornea la transformacion en los vertices y junta los triangulos de un mismo
+	// material en un solo dibujo (ver StaticBatch.h); los modelos ya no se dibujan por separado.
+	const Material &materialPiso = RenderQueue::Get().SurfaceMaterial(pisoTextureID, 32.0f);
+
+	// Pisos, paredes y bancas: siempre residentes
+	StaticBatch loteEscena("Escena");
+	loteEscena.AddSurface(vertices, 36, VAO_Cubo, MatrizPiso(glm::vec3(0.0f, -0.5f, 0.0f), glm::vec3(25.0f, 0.1f, 25.0f)), materialPiso);
+	loteEscena.AddSurface(vertices, 36, VAO_Cubo, MatrizPiso(glm::vec3(0.0f, -0.5f, 17.5f), glm::vec3(25.0f, 0.1f, 10.0f)),
+		RenderQueue::Get().SurfaceMaterial(pisoEntradaID, 32.0f));
+
+	// Acuario: mitad trasera (piedra) y mitad delantera (agua)
+	loteEscena.AddSurface(vertices, 36, VAO_Cubo, MatrizPiso(glm::vec3(7.25f, -0.49f, -9.875f), glm::vec3(10.5f, 0.1f, 5.25f)),
+		RenderQueue::Get().SurfaceMaterial(pisoPiedraTextureID, 32.0f));
+	loteEscena.AddSurface(vertices, 36, VAO_Cubo, MatrizPiso(glm::vec3(7.25f, -0.49f, -4.625f), glm::vec3(10.5f, 0.1f, 5.25f)),
+		RenderQueue::Get().SurfaceMaterial(pisoAguaTextureID, 32.0f));
+
+	// Selva, sabana y desierto
+	loteEscena.AddSurface(vertices, 36, VAO_Cubo, MatrizPiso(glm::vec3(7.25f, -0.49f, 7.25f), glm::vec3(10.5f, 0.1f, 10.5f)),
+		RenderQueue::Get().SurfaceMaterial(pisoSelvaTextureID, 32.0f));
+	loteEscena.AddSurface(vertices, 36, VAO_Cubo, MatrizPiso(glm::vec3(-7.25f, -0.49f, -7.25f), glm::vec3(10.5f, 0.1f, 10.5f)),
+		RenderQueue::Get().SurfaceMaterial(pisoSabanaTextureID, 32.0f));
+	loteEscena.AddSurface(vertices, 36, VAO_Cubo, MatrizPiso(glm::vec3(-7.25f, -0.49f, 7.25f), glm::vec3(10.5f, 0.1f, 10.5f)),
+		RenderQueue::Get().SurfaceMaterial(pisoArenaTextureID, 32.0f));
+
+	// Paredes: trasera (Z negativa), izquierda (X negativa), derecha (X positiva) y los dos lados de la entrada
+	const Material &materialPared = RenderQueue::Get().SurfaceMaterial(paredTextureID, 32.0f);
+	loteEscena.AddSurface(verticesPared, 36, VAO_Pared, MatrizPiso(glm::vec3(0.0f, alturaPared / 2 - 0.5f, -tamanoBase / 2),
+		glm::vec3(tamanoBase, alturaPared, 0.2f)), materialPared);
+	loteEscena.AddSurface(verticesPared, 36, VAO_Pared, MatrizPiso(glm::vec3(-tamanoBase / 2, alturaPared / 2 - 0.5f, 0.0f),
+		glm::vec3(0.2f, alturaPared, tamanoBase)), materialPared);
+	loteEscena.AddSurface(verticesPared, 36, VAO_Pared, MatrizPiso(glm::vec3(tamanoBase / 2, alturaPared / 2 - 0.5f, 0.0f),
+		glm::vec3(0.2f, alturaPared, tamanoBase)), materialPared);
+	loteEscena.AddSurface(verticesPared, 36, VAO_Pared, MatrizPiso(glm::vec3(-7.15f, alturaPared / 2 - 0.5f, 12.5f),
+		glm::vec3(10.50f, alturaPared, 0.2f)), materialPared);
+	loteEscena.AddSurface(verticesPared, 36, VAO_Pared, MatrizPiso(glm::vec3(7.15f, alturaPared / 2 - 0.5f, 12.5f),
+		glm::vec3(10.50f, alturaPared, 0.2f)), materialPared);
+
+	// Bancas 1 (Fondo), 2 (Camino Izquierdo) y 3 (Camino Derecho)
+	colocacion = glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, -0.5f, -11.7f));
+	colocacion = glm::rotate(colocacion, glm::radians(270.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+	loteEscena.AddModel(BancaModel, glm::scale(colocacion, glm::vec3(6.0f, 6.0f, 6.0f)));
+	colocacion = glm::translate(glm::mat4(1.0f), glm::vec3(-11.5f, -0.5f, 0.0f));
+	colocacion = glm::rotate(colocacion, glm::radians(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+	loteEscena.AddModel(BancaModel, glm::scale(colocacion, glm::vec3(6.0f, 6.0f, 6.0f)));
+	colocacion = glm::translate(glm::mat4(1.0f), glm::vec3(11.5f, -0.5f, 0.0f));
+	colocacion = glm::rotate(colocacion, glm::radians(180.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+	loteEscena.AddModel(BancaModel, glm::scale(colocacion, glm::vec3(6.0f, 6.0f, 6.0f)));
+
+	// Entrada: letrero, taquilla y adornos. Siguen a su unidad de streaming: si se descarga, el lote
+	// se vuelve a hornear cuando regresa.
+	StaticBatch loteEntrada("Entrada");
+	colocacion = glm::translate(glm::mat4(1.0f), glm::vec3(4.1f, 2.8f, 8.8f));
+	colocacion = glm::rotate(colocacion, glm::radians(90.0f), glm::vec3(1.0f, 0.0f, 0.0f));
+	colocacion = glm::rotate(colocacion, glm::radians(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+	loteEntrada.AddModel(LetreroZoo, glm::scale(colocacion, glm::vec3(0.8f, 0.8f, 0.8f)));
+	colocacion = glm::scale(glm::translate(glm::mat4(1.0f), taquillaPos), taquillaScale);
+	loteEntrada.AddModel(Taquilla, glm::rotate(colocacion, glm::radians(taquillaRot), glm::vec3(0.0f, 1.0f, 0.0f)));
+	colocacion = glm::scale(glm::translate(glm::mat4(1.0f), NarutoPos), NarutoScale);
+	loteEntrada.AddModel(Naruto, glm::rotate(colocacion, glm::radians(NarutoRot), glm::vec3(0.0f, 1.0f, 0.0f)));
+	colocacion = glm::scale(glm::translate(glm::mat4(1.0f), kittyPos), kittyScale);
+	loteEntrada.AddModel(Kitty, glm::rotate(colocacion, glm::radians(kittyRot), glm::vec3(0.0f, 1.0f, 0.0f)));
+	colocacion = glm::scale(glm::translate(glm::mat4(1.0f), monitoPos), monitoScale);
+	loteEntrada.AddModel(Monito, glm::rotate(colocacion, glm::radians(monitoRot), glm::vec3(0.0f, 1.0f, 0.0f)));
+	colocacion = glm::scale(glm::translate(glm::mat4(1.0f), cdmxPos), cdmxScale);
+	loteEntrada.AddModel(CDMX, glm::rotate(colocacion, glm::radians(cdmxRot), glm::vec3(0.0f, 1.0f, 0.0f)));
+	colocacion = glm::scale(glm::translate(glm::mat4(1.0f), carruselPos), carruselScale);
+	loteEntrada.AddModel(Carrusel, glm::rotate(colocacion, glm::radians(carruselRot), glm::vec3(0.0f, 1.0f, 0.0f)));
+
 	/*
 	================================================================================
 		SISTEMA DE AUDIO - miniaudio
@@ -1127,17 +1434,38 @@ float skyboxVertices[] = {
 
 	// Inicializar miniaudio para audio de fondo
 	ma_engine engine;
-	ma_result result = ma_engine_init(NULL, &engine);
+	ma_result result;
+	{
+		LoadProfiler::Timer timer("audio", "ma_engine", LOAD_SETUP);
+		result = ma_engine_init(NULL, &engine);
+	}
 	if (result != MA_SUCCESS) {
 		std::cout << "Error al inicializar audio" << std::endl;
 	}
 
 	// CAMBIAR A ESTO para que haga loop:
 	ma_sound sound;
-	ma_sound_init_from_file(&engine, "musica.mp3", 0, NULL, NULL, &sound);
+	{
+		// Sin MA_SOUND_FLAG_STREAM el archivo completo se lee a memoria aqui
+		LoadProfiler::Timer timer("audio", "musica.mp3", LOAD_IO);
+		ma_sound_init_from_file(&engine, "musica.mp3", 0, NULL, NULL, &sound);
+	}
+	FileStamp musica;
+	LoadProfiler::Get().AddBytes("audio", "musica.mp3", GetFileStamp("musica.mp3", musica) ? musica.size : 0, 0);
 	ma_sound_set_looping(&sound, MA_TRUE); 
 	ma_sound_start(&sound);
 
+	// Perfil del arranque: tiempo de cada asset por etapa (io, parseo, conversion, subida) y bytes leidos y subidos.
+	// Tambien se escribe en load_profile.json para comparar arranques en frio y en caliente.
+	double arranqueMs = glfwGetTime() * 1000.0;
+	LoadProfiler::Get().PrintReport(arranqueMs);
+	LoadProfiler::Get().WriteJson(LOAD_PROFILE_FILE, arranqueMs);
+	LoadProfiler::Get().Stop();
+
+	// Memoria de cada modelo y textura en la GPU y en RAM (memory_report.json tiene el detalle por malla)
+	MemoryReport::Print();
+	MemoryReport::WriteJson(MEMORY_REPORT_FILE);
+
 	// =================================================================================
 	// 								CICLO DE RENDERIZADO
 	// =================================================================================
@@ -1175,6 +1503,8 @@ float skyboxVertices[] = {
 		// Check if any events have been activiated (key pressed, mouse moved etc.) and call corresponding response functions
 		glfwPollEvents();
 		DoMovement();
+		// Cargar los habitats a los que se acerca la camara y subir lo que ya decodificaron los hilos
+		AssetStreamer::Get().Update(camera.GetPosition());
 		// Clear the colorbuffer
 		glClearColor(0.6f, 0.7f, 0.9f, 1.0f);
 		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
@@ -1348,11 +1678,17 @@ float skyboxVertices[] = {
 		glUniformMatrix4fv(viewLoc, 1, GL_FALSE, glm::value_ptr(view));
 		glUniformMatrix4fv(projLoc, 1, GL_FALSE, glm::value_ptr(projection));
 
+		// Camara del cuadro para elegir el nivel de detalle de cada modelo (F3 imprime los triangulos ahorrados)
+		// y descartar los lotes estaticos que quedan fuera de la vista
+		RenderContext::Get().BeginFrame(camera.GetPosition(), projection, view);
+
 		glm::mat4 model = glm::mat4(1.0f);
 		glm::mat4 modelTemp = glm::mat4(1.0f);
 
 		
 		lightingShader.Use();
+		// Los dibujos de la escena se encolan hasta Flush, que los ordena por estado (F4 imprime los cambios de estado ahorrados)
+		RenderQueue::Get().Begin(lightingShader.Program);
 
 
 	/*
@@ -1360,13 +1696,10 @@ float skyboxVertices[] = {
 		RENDERIZADO DE ESCENARIOS Y ESTRUCTURAS
 	================================================================================
 
-	FUNCIÓN DibujarPiso():
-		Parámetros:
-		- textureID: ID de textura a aplicar
-		- posicion: Centro del objeto en espacio mundo
-		- escala: Tamaño final (x, y, z)
-		- VAO_Cubo: Geometría a renderizar
-		- modelLoc: Location del uniform "model" en shader
+	LOTES ESTÁTICOS (StaticBatch.h):
+		Pisos, paredes, bancas y adornos de la entrada se hornean al cargar en coordenadas
+		de mundo y se agrupan por material; cada lote se dibuja con un dibujo por material
+		y se descarta por partes si queda fuera de la vista
 
 	PISOS RENDERIZADOS:
 		1. Piso General (Ladrillo): Base 25x25 unidades
@@ -1395,97 +1728,14 @@ float skyboxVertices[] = {
 		// 							DIBUJO DE ESCENARIOS
 		// ---------------------------------------------------------------------------------
 
-		// DIBUJO DEL PISO GENERAL LADRILLO
-		DibujarPiso(pisoTextureID, glm::vec3(0.0f, -0.5f, 0.0f), glm::vec3(25.0f, 0.1f, 25.0f), VAO_Cubo, modelLoc);
-
-		// DIBUJO DEL PASTO ENTRADA
-		DibujarPiso(pisoEntradaID, glm::vec3(0.0f, -0.5f, 17.5f), glm::vec3(25.0f, 0.1f, 10.0f), VAO_Cubo, modelLoc);
+		// Pisos, paredes y bancas, horneados en un solo lote por material
+		loteEscena.Draw(lightingShader);
 
 		// =================================================================================
 		// 							DIBUJO DE MODELOS - ENTRADA
 		// =================================================================================
-		
-		// Letrero ZOO
-		model = glm::mat4(1.0f);
-		model = glm::translate(model, glm::vec3(4.1f, 2.8f, 8.8f));
-		model = glm::rotate(model, glm::radians(90.0f), glm::vec3(1.0f, 0.0f, 0.0f));
-		model = glm::rotate(model, glm::radians(0.0f), glm::vec3(0.0f, 1.0f, 0.0f)); 
-		model = glm::scale(model, glm::vec3(0.8f, 0.8f, 0.8f));
-		glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
-		LetreroZoo.Draw(lightingShader);
-
-		// --- TAQUILLA ---
-		model = glm::mat4(1);
-		model = glm::translate(model, taquillaPos);
-		model = glm::scale(model, taquillaScale);
-		model = glm::rotate(model, glm::radians(taquillaRot), glm::vec3(0.0f, 1.0f, 0.0f));
-		glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
-		Taquilla.Draw(lightingShader);
-
-		// --- NARUTO ---
-		model = glm::mat4(1);
-		model = glm::translate(model, NarutoPos);
-		model = glm::scale(model, NarutoScale);
-		model = glm::rotate(model, glm::radians(NarutoRot), glm::vec3(0.0f, 1.0f, 0.0f));
-		glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
-		Naruto.Draw(lightingShader);
-
-		// --- HELLO KITTY ---
-		model = glm::mat4(1);
-		model = glm::translate(model, kittyPos);
-		model = glm::scale(model, kittyScale);
-		model = glm::rotate(model, glm::radians(kittyRot), glm::vec3(0.0f, 1.0f, 0.0f));
-		glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
-		Kitty.Draw(lightingShader);
-
-		// --- MONITO ---
-		model = glm::mat4(1);
-		model = glm::translate(model, monitoPos);
-		model = glm::scale(model, monitoScale);
-		model = glm::rotate(model, glm::radians(monitoRot), glm::vec3(0.0f, 1.0f, 0.0f));
-		glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
-		Monito.Draw(lightingShader);
-
-		// --- CDMX ---
-		model = glm::mat4(1);
-		model = glm::translate(model, cdmxPos);
-		model = glm::scale(model, cdmxScale);
-		model = glm::rotate(model, glm::radians(cdmxRot), glm::vec3(0.0f, 1.0f, 0.0f));
-		glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
-		CDMX.Draw(lightingShader);
-
-		// --- CARRUSEL ---
-		model = glm::mat4(1);
-		model = glm::translate(model, carruselPos);
-		model = glm::scale(model, carruselScale);
-		model = glm::rotate(model, glm::radians(carruselRot), glm::vec3(0.0f, 1.0f, 0.0f));
-		glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
-		Carrusel.Draw(lightingShader);
-
-
-		// =================================================================================
-		// 							DIBUJO DE PAREDES
-		// =================================================================================
-
-			// Pared trasera (Z negativa)
-		DibujarPiso(paredTextureID, glm::vec3(0.0f, alturaPared / 2 - 0.5f, -tamanoBase / 2),
-			glm::vec3(tamanoBase, alturaPared, 0.2f), VAO_Pared, modelLoc);
-
-		// Pared izquierda (X negativa)
-		DibujarPiso(paredTextureID, glm::vec3(-tamanoBase / 2, alturaPared / 2 - 0.5f, 0.0f),
-			glm::vec3(0.2f, alturaPared, tamanoBase), VAO_Pared, modelLoc);
-
-		// Pared derecha (X positiva)
-		DibujarPiso(paredTextureID, glm::vec3(tamanoBase / 2, alturaPared / 2 - 0.5f, 0.0f),
-			glm::vec3(0.2f, alturaPared, tamanoBase), VAO_Pared, modelLoc);
-
-		// Pared de entrada - Lado IZQUIERDO
-		DibujarPiso(paredTextureID, glm::vec3(-7.15f, alturaPared / 2 - 0.5f, 12.5f),
-			glm::vec3(10.50f, alturaPared, 0.2f), VAO_Pared, modelLoc);
-
-		// Pared de entrada - Lado DERECHO
-		DibujarPiso(paredTextureID, glm::vec3(7.15f, alturaPared / 2 - 0.5f, 12.5f),
-			glm::vec3(10.50f, alturaPared, 0.2f), VAO_Pared, modelLoc);
+		// Letrero, taquilla y adornos: lote estatico que se dibuja mientras la entrada este cargada
+		loteEntrada.Draw(lightingShader);
 
 		// Dibujar personaje en tercera persona
 		if (camera.GetCameraType() == THIRD_PERSON)
@@ -1503,38 +1753,12 @@ float skyboxVertices[] = {
 			model = glm::rotate(model, glm::radians(yawAngle), glm::vec3(0.0f, 1.0f, 0.0f));
 
 			model = glm::scale(model, glm::vec3(0.02f, 0.02f, 0.02f));
-			glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
+			SetModelMatrix(modelLoc, model);
 
 			PersonajeAlex.Draw(lightingShader);
 		}
 
 
-		// =================================================================================
-		// 							DIBUJO DE MODELOS - BANCAS
-		// =================================================================================
-		// --- Banca 1 (Fondo) ---
-		model = glm::mat4(1.0f);
-		model = glm::translate(model, glm::vec3(0.0f, -0.5f, -11.7f)); 
-		model = glm::rotate(model, glm::radians(270.0f), glm::vec3(0.0f, 1.0f, 0.0f)); 
-		model = glm::scale(model, glm::vec3(6.0f, 6.0f, 6.0f)); 
-		glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
-		BancaModel.Draw(lightingShader);
-
-		// --- Banca 2 (Camino Izquierdoo) ---
-		model = glm::mat4(1.0f);
-		model = glm::translate(model, glm::vec3(-11.5f, -0.5f, 0.0f)); 
-		model = glm::rotate(model, glm::radians(0.0f), glm::vec3(0.0f, 1.0f, 0.0f)); 
-		model = glm::scale(model, glm::vec3(6.0f, 6.0f, 6.0f)); 
-		glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
-		BancaModel.Draw(lightingShader);
-
-		// --- Banca 3 (Camino Derechoo) ---
-		model = glm::mat4(1.0f);
-		model = glm::translate(model, glm::vec3(11.5f, -0.5f, 0.0f)); 
-		model = glm::rotate(model, glm::radians(180.0f), glm::vec3(0.0f, 1.0f, 0.0f)); 
-		model = glm::scale(model, glm::vec3(6.0f, 6.0f, 6.0f)); 
-		glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
-		BancaModel.Draw(lightingShader);
 	
 
 	
@@ -1544,16 +1768,13 @@ float skyboxVertices[] = {
 		// 							DIBUJO DE ESCENARIO ACUARIO (x,-z)
 		// ---------------------------------------------------------------------------------
 
-		// 1. Mitad trasera (Piedra)
-		DibujarPiso(pisoPiedraTextureID, glm::vec3(7.25f, -0.49f, -9.875f), glm::vec3(10.5f, 0.1f, 5.25f), VAO_Cubo, modelLoc);
-		// 2. Mitad delantera (Agua)
-		DibujarPiso(pisoAguaTextureID, glm::vec3(7.25f, -0.49f, -4.625f), glm::vec3(10.5f, 0.1f, 5.25f), VAO_Cubo, modelLoc);
+		// Piso de piedra y agua: en el lote estatico de la escena
 
 		// --- FONDO DEL ACUARIO ---
 		model = glm::mat4(1.0f);
 		model = glm::translate(model, glm::vec3(5.25f, -0.5f, -12.5f)); 
 		model = glm::scale(model, glm::vec3(2.2f, 2.0f, 1.5f)); 
-		glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
+		SetModelMatrix(modelLoc, model);
 		EscenarioAcuario.Draw(lightingShader);
 
 
@@ -1565,7 +1786,7 @@ float skyboxVertices[] = {
 		model = glm::scale(model, glm::vec3(tortugaAcuarioScale));
 		modelTemp = model; 
 		model = glm::rotate(model, glm::radians(rotTortugaAcuarioCuerpo), glm::vec3(1.0f, 0.0f, 0.0f)); 
-		glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model)); 
+		SetModelMatrix(modelLoc, model); 
 		TortugaModel.Draw(lightingShader);
 
 		//Cabeza y cuello
@@ -1574,7 +1795,7 @@ float skyboxVertices[] = {
 		model = glm::translate(model, pivoteTortugaHead);
 		model = glm::rotate(model, glm::radians(rotTortugaAcuarioHead), glm::vec3(0.0f, 1.0f, 0.0f));
 		model = glm::translate(model, -pivoteTortugaHead);
-		glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
+		SetModelMatrix(modelLoc, model);
 		TortugaBody.Draw(lightingShader);
 
 		// Pata Delantera Izquierda
@@ -1583,7 +1804,7 @@ float skyboxVertices[] = {
 		model = glm::translate(model, pivoteTortugaFL);
 		model = glm::rotate(model, glm::radians(rotTortugaAcuarioFL), glm::vec3(1.0f, 0.0f, 1.0f)); 
 		model = glm::translate(model, -pivoteTortugaFL);
-		glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
+		SetModelMatrix(modelLoc, model);
 		TortugaPataFL.Draw(lightingShader);
 
 		// Pata Delantera Derecha
@@ -1592,7 +1813,7 @@ float skyboxVertices[] = {
 		model = glm::translate(model, pivoteTortugaFR);
 		model = glm::rotate(model, glm::radians(rotTortugaAcuarioFR), glm::vec3(1.0f, 0.0f, -1.0f)); 
 		model = glm::translate(model, -pivoteTortugaFR);
-		glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
+		SetModelMatrix(modelLoc, model);
 		TortugaPataFR.Draw(lightingShader);
 
 		// Pata Trasera Izquierda
@@ -1601,7 +1822,7 @@ float skyboxVertices[] = {
 		model = glm::translate(model, pivoteTortugaBL);
 		model = glm::rotate(model, glm::radians(rotTortugaAcuarioBL), glm::vec3(1.0f, 0.0f, 1.0f));
 		model = glm::translate(model, -pivoteTortugaBL);
-		glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
+		SetModelMatrix(modelLoc, model);
 		TortugaPataBL.Draw(lightingShader);
 
 		// Pata Trasera Derecha
@@ -1610,7 +1831,7 @@ float skyboxVertices[] = {
 		model = glm::translate(model, pivoteTortugaBR);
 		model = glm::rotate(model, glm::radians(rotTortugaAcuarioBR), glm::vec3(1.0f, 0.0f, -1.0f));
 		model = glm::translate(model, -pivoteTortugaBR);
-		glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
+		SetModelMatrix(modelLoc, model);
 		TortugaPataBR.Draw(lightingShader);
 
 		
@@ -1623,7 +1844,7 @@ float skyboxVertices[] = {
 		model = glm::scale(model, glm::vec3(nutriaScale));
 		model = glm::rotate(model, glm::radians(rotNutriaCuerpoX), glm::vec3(1.0f, 0.0f, 0.0f));
 		modelTemp = model;
-		glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
+		SetModelMatrix(modelLoc, model);
 		NutriaBody.Draw(lightingShader);
 
 		// Cabeza
@@ -1632,7 +1853,7 @@ float skyboxVertices[] = {
 		model = glm::translate(model, pivoteNutriaHead);
 		model = glm::rotate(model, glm::radians(rotNutriaHead), glm::vec3(0.0f, 1.0f, 0.0f));
 		model = glm::translate(model, -pivoteNutriaHead);
-		glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
+		SetModelMatrix(modelLoc, model);
 		NutriaHead.Draw(lightingShader);
 
 		// Cola
@@ -1641,7 +1862,7 @@ float skyboxVertices[] = {
 		model = glm::translate(model, pivoteNutriaCola);
 		model = glm::rotate(model, glm::radians(rotNutriaCola), glm::vec3(1.0f, 0.0f, 0.0f));
 		model = glm::translate(model, -pivoteNutriaCola);
-		glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
+		SetModelMatrix(modelLoc, model);
 		NutriaCola.Draw(lightingShader);
 
 		// Pata Delantera Izquierda
@@ -1650,7 +1871,7 @@ float skyboxVertices[] = {
 		model = glm::translate(model, pivoteNutriaFL);
 		model = glm::rotate(model, glm::radians(rotNutriaFL), glm::vec3(1.0f, 0.0f, 0.0f));
 		model = glm::translate(model, -pivoteNutriaFL);
-		glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
+		SetModelMatrix(modelLoc, model);
 		NutriaPataFL.Draw(lightingShader);
 
 		// Pata Delantera Derecha
@@ -1659,7 +1880,7 @@ float skyboxVertices[] = {
 		model = glm::translate(model, pivoteNutriaFR);
 		model = glm::rotate(model, glm::radians(rotNutriaFR), glm::vec3(1.0f, 0.0f, 0.0f));
 		model = glm::translate(model, -pivoteNutriaFR);
-		glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
+		SetModelMatrix(modelLoc, model);
 		NutriaPataFR.Draw(lightingShader);
 
 		// Pata Trasera Izquierda
@@ -1668,7 +1889,7 @@ float skyboxVertices[] = {
 		model = glm::translate(model, pivoteNutriaBL);
 		model = glm::rotate(model, glm::radians(rotNutriaBL), glm::vec3(1.0f, 0.0f, 0.0f));
 		model = glm::translate(model, -pivoteNutriaBL);
-		glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
+		SetModelMatrix(modelLoc, model);
 		NutriaPataBL.Draw(lightingShader);
 
 		// Pata Trasera Derecha
@@ -1677,7 +1898,7 @@ float skyboxVertices[] = {
 		model = glm::translate(model, pivoteNutriaBR);
 		model = glm::rotate(model, glm::radians(rotNutriaBR), glm::vec3(1.0f, 0.0f, 0.0f));
 		model = glm::translate(model, -pivoteNutriaBR);
-		glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
+		SetModelMatrix(modelLoc, model);
 		NutriaPataBR.Draw(lightingShader);
 
 		//IGLU
@@ -1685,7 +1906,7 @@ float skyboxVertices[] = {
 		model = glm::translate(model, glm::vec3(11.2f, -0.4f, -9.0f));
 		model = glm::rotate(model, glm::radians(220.0f), glm::vec3(0.0f, 1.0f, 0.0f));
 		model = glm::scale(model, glm::vec3(0.7f, 0.7f, 0.7f));  
-		glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
+		SetModelMatrix(modelLoc, model);
 		IgluModel.Draw(lightingShader);
 
 
@@ -1693,15 +1914,14 @@ float skyboxVertices[] = {
 		// 							DIBUJO DE MODELOS SELVA (x,z)
 		// ---------------------------------------------------------------------------------
 
-		// **** DIBUJO DEL PISO SELVA Y ACCESORIOS SELVA ****
-		DibujarPiso(pisoSelvaTextureID, glm::vec3(7.25f, -0.49f, 7.25f), glm::vec3(10.5f, 0.1f, 10.5f), VAO_Cubo, modelLoc);
+		// **** ACCESORIOS SELVA (el piso va en el lote estatico de la escena) ****
 
 		// --- ÁRBOL ---
 		model = glm::mat4(1);
 		model = glm::translate(model, arbolSelvaPos);
 		model = glm::scale(model, arbolSelvaScale);
 		model = glm::rotate(model, glm::radians(arbolSelvaRot), glm::vec3(0.0f, 1.0f, 0.0f));
-		glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
+		SetModelMatrix(modelLoc, model);
 		ArbolSelva.Draw(lightingShader);
 
 		// --- SANDÍA ---
@@ -1709,7 +1929,7 @@ float skyboxVertices[] = {
 		model = glm::translate(model, sandiaPos);
 		model = glm::scale(model, sandiaScale);
 		model = glm::rotate(model, glm::radians(sandiaRot), glm::vec3(0.0f, 1.0f, 0.0f));
-		glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
+		SetModelMatrix(modelLoc, model);
 		Sandia.Draw(lightingShader);
 
 		// --- TRONCO 1 ---
@@ -1717,7 +1937,7 @@ float skyboxVertices[] = {
 		model = glm::translate(model, troncoSelva1Pos);
 		model = glm::scale(model, troncoSelva1Scale);
 		model = glm::rotate(model, glm::radians(troncoSelva1Rot), glm::vec3(0.0f, 1.0f, 0.0f));
-		glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
+		SetModelMatrix(modelLoc, model);
 		TroncoSelva1.Draw(lightingShader);
 
 		// --- PELOTA ---
@@ -1725,31 +1945,18 @@ float skyboxVertices[] = {
 		model = glm::translate(model, pelotaPos);
 		model = glm::scale(model, pelotaScale);
 		model = glm::rotate(model, glm::radians(pelotaRot), glm::vec3(0.0f, 1.0f, 0.0f));
-		glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
+		SetModelMatrix(modelLoc, model);
 		Pelota.Draw(lightingShader);
 
-		// --- PLATANO 1 ---
-		model = glm::mat4(1);
-		model = glm::translate(model, platano1Pos);
-		model = glm::scale(model, platano1Scale);
-		model = glm::rotate(model, glm::radians(platano1Rot), glm::vec3(0.0f, 1.0f, 0.0f));
-		glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
-		Platano1.Draw(lightingShader);
-
-		// --- PLATANO 2 ---
-		model = glm::mat4(1);
-		model = glm::translate(model, platano2Pos);
-		model = glm::scale(model, platano2Scale);
-		model = glm::rotate(model, glm::radians(platano2Rot), glm::vec3(0.0f, 1.0f, 0.0f));
-		glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
-		Platano2.Draw(lightingShader);
+		// --- PLATANOS 1 Y 2 ---
+		platanos.Draw(lightingShader);
 
 		// --- GATO ---
 		model = glm::mat4(1);
 		model = glm::translate(model, gatoPos);
 		model = glm::scale(model, gatoScale);
 		model = glm::rotate(model, glm::radians(gatoRot), glm::vec3(0.0f, 1.0f, 0.0f));
-		glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
+		SetModelMatrix(modelLoc, model);
 		Gato.Draw(lightingShader);
 
 		// --- ÁRBOL MUERTO ---
@@ -1757,7 +1964,7 @@ float skyboxVertices[] = {
 		model = glm::translate(model, arbolRamaPos);
 		model = glm::scale(model, arbolRamaScale);
 		model = glm::rotate(model, glm::radians(arbolRamaRot), glm::vec3(0.0f, 1.0f, 0.0f));
-		glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
+		SetModelMatrix(modelLoc, model);
 		ArbolRama.Draw(lightingShader);
 
 		// --- RAMA ---
@@ -1765,48 +1972,14 @@ float skyboxVertices[] = {
 		model = glm::translate(model, ramaSelvaPos);
 		model = glm::scale(model, ramaSelvaScale);
 		model = glm::rotate(model, glm::radians(ramaSelvaRot), glm::vec3(0.0f, 1.0f, 0.0f));
-		glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
+		SetModelMatrix(modelLoc, model);
 		RamaSelva.Draw(lightingShader);
 
-		//--- PLANTA 1 ---
-		model = glm::mat4(1);
-		model = glm::translate(model, plantaSelva1Pos);
-		model = glm::scale(model, plantaSelva1Scale);
-		model = glm::rotate(model, glm::radians(plantaSelva1Rot), glm::vec3(0.0f, 1.0f, 0.0f));
-		glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
-		PlantaSelva1.Draw(lightingShader);
-
-		//--- PLANTA 2 ---
-		model = glm::mat4(1);
-		model = glm::translate(model, plantaSelva2Pos); 
-		model = glm::scale(model, plantaSelva2Scale);
-		model = glm::rotate(model, glm::radians(plantaSelva2Rot), glm::vec3(0.0f, 1.0f, 0.0f));
-		glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
-		PlantaSelva2.Draw(lightingShader);
+		//--- PLANTAS 1 Y 2 ---
+		plantasSelva.Draw(lightingShader);
 
-		// --- LOTO 1 ---
-		model = glm::mat4(1);
-		model = glm::translate(model, loto1Pos);
-		model = glm::scale(model, loto1Scale);
-		model = glm::rotate(model, glm::radians(loto1Rot), glm::vec3(0.0f, 1.0f, 0.0f));
-		glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
-		Loto1.Draw(lightingShader);
-
-		// --- LOTO 2 ---
-		model = glm::mat4(1);
-		model = glm::translate(model, loto2Pos);
-		model = glm::scale(model, loto2Scale);
-		model = glm::rotate(model, glm::radians(loto2Rot), glm::vec3(0.0f, 1.0f, 0.0f));
-		glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
-		Loto2.Draw(lightingShader);
-
-		// --- LOTO 3 ---
-		model = glm::mat4(1);
-		model = glm::translate(model, loto3Pos);
-		model = glm::scale(model, loto3Scale);
-		model = glm::rotate(model, glm::radians(loto3Rot), glm::vec3(0.0f, 1.0f, 0.0f));
-		glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
-		Loto3.Draw(lightingShader);
+		// --- LOTOS 1, 2 Y 3 ---
+		lotos.Draw(lightingShader);
 
 		// **** DIBUJO DEL CAPIBARA ****
 		model = glm::mat4(1);
@@ -1814,7 +1987,7 @@ float skyboxVertices[] = {
 		model = glm::rotate(model, glm::radians(rotCapibara), glm::vec3(0.0f, 1.0f, 0.0f));
 		model = glm::scale(model, glm::vec3(capibaraScale));
 		modelTemp = model;
-		glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
+		SetModelMatrix(modelLoc, model);
 		Capibara_Cuerpo.Draw(lightingShader);
 
 		// Cabeza
@@ -1823,7 +1996,7 @@ float skyboxVertices[] = {
 		model = glm::translate(model, capibaraPivotCabeza);
 		model = glm::rotate(model, glm::radians(capibaraCabezaRot), glm::vec3(0.0f, 1.0f, 0.0f));
 		model = glm::translate(model, -capibaraPivotCabeza);
-		glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
+		SetModelMatrix(modelLoc, model);
 		Capibara_Cabeza.Draw(lightingShader);
 
 		// Pata delantera derecha
@@ -1832,7 +2005,7 @@ float skyboxVertices[] = {
 		model = glm::translate(model, capibaraPivotPataDelDer);
 		model = glm::rotate(model, glm::radians(capibaraPataDelDer), glm::vec3(0.0f, 0.0f, 1.0f));
 		model = glm::translate(model, -capibaraPivotPataDelDer);
-		glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
+		SetModelMatrix(modelLoc, model);
 		Capibara_PataDelDer.Draw(lightingShader);
 
 		// Pata delantera izquierda
@@ -1841,7 +2014,7 @@ float skyboxVertices[] = {
 		model = glm::translate(model, capibaraPivotPataDelIzq);
 		model = glm::rotate(model, glm::radians(capibaraPataDelIzq), glm::vec3(0.0f, 0.0f, 1.0f));
 		model = glm::translate(model, -capibaraPivotPataDelIzq);
-		glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
+		SetModelMatrix(modelLoc, model);
 		Capibara_PataDelIzq.Draw(lightingShader);
 
 		// Pata trasera derecha
@@ -1850,7 +2023,7 @@ float skyboxVertices[] = {
 		model = glm::translate(model, capibaraPivotPataTrasDer);
 		model = glm::rotate(model, glm::radians(capibaraPataTrasDer), glm::vec3(0.0f, 0.0f, 1.0f));
 		model = glm::translate(model, -capibaraPivotPataTrasDer);
-		glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
+		SetModelMatrix(modelLoc, model);
 		Capibara_PataTrasDer.Draw(lightingShader);
 
 		// Pata trasera izquierda
@@ -1859,7 +2032,7 @@ float skyboxVertices[] = {
 		model = glm::translate(model, capibaraPivotPataTrasIzq);
 		model = glm::rotate(model, glm::radians(capibaraPataTrasIzq), glm::vec3(0.0f, 0.0f, 1.0f));
 		model = glm::translate(model, -capibaraPivotPataTrasIzq);
-		glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
+		SetModelMatrix(modelLoc, model);
 		Capibara_PataTrasIzq.Draw(lightingShader);
 
 		// Naranja
@@ -1868,7 +2041,7 @@ float skyboxVertices[] = {
 		model = glm::translate(model, capibaraPivotNaranja);
 		model = glm::rotate(model, glm::radians(capibaraNaranjaRot), glm::vec3(0.0f, 1.0f, 0.0f));
 		model = glm::translate(model, -capibaraPivotNaranja);
-		glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
+		SetModelMatrix(modelLoc, model);
 		Capibara_Naranja.Draw(lightingShader);
 
 		/*
@@ -1965,7 +2138,7 @@ float skyboxVertices[] = {
 		model = glm::rotate(model, glm::radians(rotMono), glm::vec3(0.0f, 1.0f, 0.0f));
 		model = glm::scale(model, glm::vec3(monoScale));
 		modelTemp = model;
-		glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
+		SetModelMatrix(modelLoc, model);
 		Mono_Cuerpo.Draw(lightingShader);
 
 		// Cola
@@ -1974,7 +2147,7 @@ float skyboxVertices[] = {
 		model = glm::translate(model, monoPivotCola);
 		model = glm::rotate(model, glm::radians(monoColaRot), glm::vec3(1.0f, 0.0f, 0.0f));
 		model = glm::translate(model, -monoPivotCola);
-		glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
+		SetModelMatrix(modelLoc, model);
 		Mono_Cola.Draw(lightingShader);
 
 		// Pata delantera derecha
@@ -1983,7 +2156,7 @@ float skyboxVertices[] = {
 		model = glm::translate(model, monoPivotPataDelDer);
 		model = glm::rotate(model, glm::radians(monoPataDelDer), glm::vec3(0.0f, 0.0f, 1.0f));
 		model = glm::translate(model, -monoPivotPataDelDer);
-		glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
+		SetModelMatrix(modelLoc, model);
 		Mono_PataDelDer.Draw(lightingShader);
 
 		// Pata delantera izquierda
@@ -1992,7 +2165,7 @@ float skyboxVertices[] = {
 		model = glm::translate(model, monoPivotPataDelIzq);
 		model = glm::rotate(model, glm::radians(monoPataDelIzq), glm::vec3(0.0f, 0.0f, 1.0f));
 		model = glm::translate(model, -monoPivotPataDelIzq);
-		glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
+		SetModelMatrix(modelLoc, model);
 		Mono_PataDelIzq.Draw(lightingShader);
 
 		// Pata trasera derecha
@@ -2001,7 +2174,7 @@ float skyboxVertices[] = {
 		model = glm::translate(model, monoPivotPataTrasDer);
 		model = glm::rotate(model, glm::radians(monoPataTrasDer), glm::vec3(0.0f, 0.0f, 1.0f));
 		model = glm::translate(model, -monoPivotPataTrasDer);
-		glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
+		SetModelMatrix(modelLoc, model);
 		Mono_PataTrasDer.Draw(lightingShader);
 
 		// Pata trasera izquierda
@@ -2010,7 +2183,7 @@ float skyboxVertices[] = {
 		model = glm::translate(model, monoPivotPataTrasIzq);
 		model = glm::rotate(model, glm::radians(monoPataTrasIzq), glm::vec3(0.0f, 0.0f, 1.0f));
 		model = glm::translate(model, -monoPivotPataTrasIzq);
-		glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
+		SetModelMatrix(modelLoc, model);
 		Mono_PataTrasIzq.Draw(lightingShader);
 
 		// MONO - ANIMACIÓN
@@ -2128,7 +2301,7 @@ float skyboxVertices[] = {
 		model = glm::rotate(model, glm::radians(rotGuacamaya), glm::vec3(0.0f, 1.0f, 0.0f));
 		model = glm::scale(model, glm::vec3(guacamayaScale));
 		modelTemp = model;
-		glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
+		SetModelMatrix(modelLoc, model);
 		Ave_Cuerpo.Draw(lightingShader);
 
 		// Ala derecha
@@ -2137,7 +2310,7 @@ float skyboxVertices[] = {
 		model = glm::translate(model, guacamayaPivotAlaDer);
 		model = glm::rotate(model, glm::radians(guacamayaAlaDer), glm::vec3(0.0f, 0.0f, 1.0f));
 		model = glm::translate(model, -guacamayaPivotAlaDer);
-		glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
+		SetModelMatrix(modelLoc, model);
 		Ave_AlaDer.Draw(lightingShader);
 
 		// Ala izquierda
@@ -2146,7 +2319,7 @@ float skyboxVertices[] = {
 		model = glm::translate(model, guacamayaPivotAlaIzq);
 		model = glm::rotate(model, glm::radians(guacamayaAlaIzq), glm::vec3(0.0f, 0.0f, 1.0f));
 		model = glm::translate(model, -guacamayaPivotAlaIzq);
-		glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
+		SetModelMatrix(modelLoc, model);
 		Ave_AlaIzq.Draw(lightingShader);
 
 		// GUACAMAYA - ANIMACIÓN
@@ -2197,39 +2370,25 @@ float skyboxVertices[] = {
 		// 							DIBUJO DE MODELOS SABANA (-x,-z)
 		// ---------------------------------------------------------------------------------
 
-		// **** DIBUJO DEL PISO SABANA Y ACCESORIOS SABANA ****
-		DibujarPiso(pisoSabanaTextureID, glm::vec3(-7.25f, -0.49f, -7.25f), glm::vec3(10.5f, 0.1f, 10.5f), VAO_Cubo, modelLoc);
+		// **** ACCESORIOS SABANA (el piso va en el lote estatico de la escena) ****
 
-		// --- Arbol ---
-		model = glm::mat4(1);
-		model = glm::translate(model, arbolSabanaPos);
-		model = glm::scale(model, arbolSabanaScale);
-		model = glm::rotate(model, glm::radians(arbolSabanaRot), glm::vec3(0.0f, 1.0f, 0.0f));
-		glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
-		ArbolSabana.Draw(lightingShader);
+		// --- Arboles 1 y 2 ---
+		arbolesSabana.Draw(lightingShader);
 		// --- Roca  ---
 		model = glm::mat4(1);
 		model = glm::translate(model, RocaPos);
 		model = glm::scale(model, RocaEScale);
 		model = glm::rotate(model, glm::radians(RocaRot), glm::vec3(0.0f, 1.0f, 0.0f));
-		glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
+		SetModelMatrix(modelLoc, model);
 		Roca.Draw(lightingShader);
 
-		// --- Arbol 2 ---
-		model = glm::mat4(1);
-		model = glm::translate(model, arbolSabanaPos2);
-		model = glm::scale(model, arbolSabanaScale);
-		model = glm::rotate(model, glm::radians(arbolSabanaRot), glm::vec3(0.0f, 1.0f, 0.0f));
-		glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
-		ArbolSabana.Draw(lightingShader);
-
 		//--- PLANTA ---
 		model = glm::mat4(1);
 		model = glm::translate(model, plantaSelva3Pos);
 		model = glm::scale(model, plantaSelva1Scale);
 		model = glm::rotate(model, glm::radians(plantaSelva1Rot), glm::vec3(0.0f, 1.0f, 0.0f));
-		glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
-		PlantaSelva1.Draw(lightingShader);
+		SetModelMatrix(modelLoc, model);
+		PlantaSabana.Draw(lightingShader);
 
 
 		// **** DIBUJO DE ANIMALES SABANA ****
@@ -2241,7 +2400,7 @@ float skyboxVertices[] = {
 		model = glm::rotate(model, glm::radians(rotElefanteLado), glm::vec3(0.0f, 0.0f, 1.0f));
 		model = glm::scale(model, glm::vec3(elefanteScale));
 		modelTemp = model;
-		glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
+		SetModelMatrix(modelLoc, model);
 		ElefanteBody.Draw(lightingShader);
 
 		// Trompa
@@ -2250,7 +2409,7 @@ float skyboxVertices[] = {
 		model = glm::translate(model, elefantePivotTrompa);
 		model = glm::rotate(model, glm::radians(elefanteTrompa), glm::vec3(1.0f, 0.0f, 0.0f));
 		model = glm::translate(model, -elefantePivotTrompa);
-		glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
+		SetModelMatrix(modelLoc, model);
 		ElefanteTrompa.Draw(lightingShader);
 
 		// Pierna delantera izquierda
@@ -2259,7 +2418,7 @@ float skyboxVertices[] = {
 		model = glm::translate(model, elefantePivotFL);
 		model = glm::rotate(model, glm::radians(elefanteLegFL), glm::vec3(1.0f, 0.0f, 0.0f));
 		model = glm::translate(model, -elefantePivotFL);
-		glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
+		SetModelMatrix(modelLoc, model);
 		ElefanteLeg_FL.Draw(lightingShader);
 
 		// Pierna delantera derecha
@@ -2268,7 +2427,7 @@ float skyboxVertices[] = {
 		model = glm::translate(model, elefantePivotFR);
 		model = glm::rotate(model, glm::radians(elefanteLegFR), glm::vec3(1.0f, 0.0f, 0.0f));
 		model = glm::translate(model, -elefantePivotFR);
-		glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
+		SetModelMatrix(modelLoc, model);
 		ElefanteLeg_FR.Draw(lightingShader);
 
 		// Pierna trasera izquierda
@@ -2277,7 +2436,7 @@ float skyboxVertices[] = {
 		model = glm::translate(model, elefantePivotBL);
 		model = glm::rotate(model, glm::radians(elefanteLegBL), glm::vec3(1.0f, 0.0f, 0.0f));
 		model = glm::translate(model, -elefantePivotBL);
-		glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
+		SetModelMatrix(modelLoc, model);
 		ElefanteLeg_BL.Draw(lightingShader);
 
 		// Pierna trasera derecha
@@ -2286,7 +2445,7 @@ float skyboxVertices[] = {
 		model = glm::translate(model, elefantePivotBR);
 		model = glm::rotate(model, glm::radians(elefanteLegBR), glm::vec3(1.0f, 0.0f, 0.0f));
 		model = glm::translate(model, -elefantePivotBR);
-		glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
+		SetModelMatrix(modelLoc, model);
 		ElefanteLeg_BR.Draw(lightingShader);
 
 		//ELEFANTE - ANIMACIÓN
@@ -2365,7 +2524,7 @@ float skyboxVertices[] = {
 		model = glm::rotate(model, glm::radians(rotJirafa), glm::vec3(0.0f, 1.0f, 0.0f));
 		model = glm::scale(model, glm::vec3(jirafaScale));
 		modelTemp = model;
-		glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
+		SetModelMatrix(modelLoc, model);
 		Jirafa_Cuerpo.Draw(lightingShader);
 
 		// Cabeza
@@ -2374,7 +2533,7 @@ float skyboxVertices[] = {
 		model = glm::translate(model, jirafaPivotCabeza);
 		model = glm::rotate(model, glm::radians(jirafaCabezaRot), glm::vec3(1.0f, 0.0f, 0.0f));
 		model = glm::translate(model, -jirafaPivotCabeza);
-		glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
+		SetModelMatrix(modelLoc, model);
 		Jirafa_Cabeza.Draw(lightingShader);
 
 		// Cola
@@ -2383,7 +2542,7 @@ float skyboxVertices[] = {
 		model = glm::translate(model, jirafaPivotCola);
 		model = glm::rotate(model, glm::radians(jirafaColaRot), glm::vec3(1.0f, 0.0f, 0.0f));
 		model = glm::translate(model, -jirafaPivotCola);
-		glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
+		SetModelMatrix(modelLoc, model);
 		Jirafa_Cola.Draw(lightingShader);
 
 		// Pata delantera derecha
@@ -2392,7 +2551,7 @@ float skyboxVertices[] = {
 		model = glm::translate(model, jirafaPivotPataDelDer);
 		model = glm::rotate(model, glm::radians(jirafaPataDelDer), glm::vec3(1.0f, 0.0f, 0.0f));
 		model = glm::translate(model, -jirafaPivotPataDelDer);
-		glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
+		SetModelMatrix(modelLoc, model);
 		Jirafa_PataDelDer.Draw(lightingShader);
 
 		// Pata delantera izquierda
@@ -2401,7 +2560,7 @@ float skyboxVertices[] = {
 		model = glm::translate(model, jirafaPivotPataDelIzq);
 		model = glm::rotate(model, glm::radians(jirafaPataDelIzq), glm::vec3(1.0f, 0.0f, 0.0f));
 		model = glm::translate(model, -jirafaPivotPataDelIzq);
-		glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
+		SetModelMatrix(modelLoc, model);
 		Jirafa_PataDelIzq.Draw(lightingShader);
 
 		// Pata trasera derecha
@@ -2410,7 +2569,7 @@ float skyboxVertices[] = {
 		model = glm::translate(model, jirafaPivotPataTrasDer);
 		model = glm::rotate(model, glm::radians(jirafaPataTrasDer), glm::vec3(1.0f, 0.0f, 0.0f));
 		model = glm::translate(model, -jirafaPivotPataTrasDer);
-		glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
+		SetModelMatrix(modelLoc, model);
 		Jirafa_PataTrasDer.Draw(lightingShader);
 
 		// Pata trasera izquierda
@@ -2419,7 +2578,7 @@ float skyboxVertices[] = {
 		model = glm::translate(model, jirafaPivotPataTrasIzq);
 		model = glm::rotate(model, glm::radians(jirafaPataTrasIzq), glm::vec3(1.0f, 0.0f, 0.0f));
 		model = glm::translate(model, -jirafaPivotPataTrasIzq);
-		glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
+		SetModelMatrix(modelLoc, model);
 		Jirafa_PataTrasIzq.Draw(lightingShader);
 
 		// JIRAFA - ANIMACIÓN
@@ -2487,7 +2646,7 @@ float skyboxVertices[] = {
 		model = glm::rotate(model, glm::radians(rotCebra), glm::vec3(0.0f, 1.0f, 0.0f));
 		model = glm::scale(model, glm::vec3(cebraScale));
 		modelTemp = model;
-		glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
+		SetModelMatrix(modelLoc, model);
 		Cebra_Cuerpo.Draw(lightingShader);
 
 		// Pata delantera derecha
@@ -2496,7 +2655,7 @@ float skyboxVertices[] = {
 		model = glm::translate(model, cebraPivotPataDelDer);
 		model = glm::rotate(model, glm::radians(cebraPataDelDer), glm::vec3(1.0f, 0.0f, 0.0f));
 		model = glm::translate(model, -cebraPivotPataDelDer);
-		glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
+		SetModelMatrix(modelLoc, model);
 		Cebra_PataDelDer.Draw(lightingShader);
 
 		// Pata delantera izquierda
@@ -2505,7 +2664,7 @@ float skyboxVertices[] = {
 		model = glm::translate(model, cebraPivotPataDelIzq);
 		model = glm::rotate(model, glm::radians(cebraPataDelIzq), glm::vec3(1.0f, 0.0f, 0.0f));
 		model = glm::translate(model, -cebraPivotPataDelIzq);
-		glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
+		SetModelMatrix(modelLoc, model);
 		Cebra_PataDelIzq.Draw(lightingShader);
 
 		// Pata trasera derecha
@@ -2514,7 +2673,7 @@ float skyboxVertices[] = {
 		model = glm::translate(model, cebraPivotPataTrasDer);
 		model = glm::rotate(model, glm::radians(cebraPataTrasDer), glm::vec3(1.0f, 0.0f, 0.0f));
 		model = glm::translate(model, -cebraPivotPataTrasDer);
-		glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
+		SetModelMatrix(modelLoc, model);
 		Cebra_PataTrasDer.Draw(lightingShader);
 
 		// Pata trasera izquierda
@@ -2523,7 +2682,7 @@ float skyboxVertices[] = {
 		model = glm::translate(model, cebraPivotPataTrasIzq);
 		model = glm::rotate(model, glm::radians(cebraPataTrasIzq), glm::vec3(1.0f, 0.0f, 0.0f));
 		model = glm::translate(model, -cebraPivotPataTrasIzq);
-		glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
+		SetModelMatrix(modelLoc, model);
 		Cebra_PataTrasIzq.Draw(lightingShader);
 
 
@@ -2677,16 +2836,14 @@ float skyboxVertices[] = {
 	// 							DIBUJO DE MODELOS DESIERTO (-x,z)
 	// ---------------------------------------------------------------------------------
 
-	// **** DIBUJO DEL PISO DESIERTO  Y COMPONENTES ****
-
-		DibujarPiso(pisoArenaTextureID, glm::vec3(-7.25f, -0.49f, 7.25f), glm::vec3(10.5f, 0.1f, 10.5f), VAO_Cubo, modelLoc);
+	// **** COMPONENTES DESIERTO (el piso va en el lote estatico de la escena) ****
 
 		// --- OASIS ---
 		model = glm::mat4(1);
 		model = glm::translate(model, oasisPos);
 		model = glm::scale(model, oasisScale);
 		model = glm::rotate(model, glm::radians(oasisRot), glm::vec3(0.0f, 1.0f, 0.0f));
-		glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
+		SetModelMatrix(modelLoc, model);
 		Oasis.Draw(lightingShader);
 
 		// --- HUESOS ---
@@ -2694,7 +2851,7 @@ float skyboxVertices[] = {
 		model = glm::translate(model, huesosPos);
 		model = glm::scale(model, huesosScale);
 		model = glm::rotate(model, glm::radians(huesosRot), glm::vec3(0.0f, 1.0f, 0.0f));
-		glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
+		SetModelMatrix(modelLoc, model);
 		Huesos.Draw(lightingShader);
 
 		// --- TRONCO ---
@@ -2702,7 +2859,7 @@ float skyboxVertices[] = {
 		model = glm::translate(model, troncoPos);
 		model = glm::scale(model, troncoScale);
 		model = glm::rotate(model, glm::radians(troncoRot), glm::vec3(0.0f, 1.0f, 0.0f));
-		glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
+		SetModelMatrix(modelLoc, model);
 		Tronco.Draw(lightingShader);
 
 		// --- CACTUS ---
@@ -2710,7 +2867,7 @@ float skyboxVertices[] = {
 		model = glm::translate(model, cactusPos);
 		model = glm::scale(model, cactusScale);
 		model = glm::rotate(model, glm::radians(cactusRot), glm::vec3(0.0f, 1.0f, 0.0f));
-		glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
+		SetModelMatrix(modelLoc, model);
 		Cactus.Draw(lightingShader);
 
 		// **** DIBUJO DE ANIMALES DESIERTO ****
@@ -2773,13 +2930,13 @@ float skyboxVertices[] = {
 		model = glm::rotate(model, glm::radians(rotCamel), glm::vec3(0.0f, 1.0f, 0.0f));
 		model = glm::scale(model, glm::vec3(camelScale));
 		modelTemp = model;
-		glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
+		SetModelMatrix(modelLoc, model);
 		CamelBody.Draw(lightingShader);
 
 		// Cabeza
 		model = modelTemp;
 		model = glm::rotate(model, glm::radians(camelHead), glm::vec3(1.0f, 0.0f, 0.0f));
-		glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
+		SetModelMatrix(modelLoc, model);
 		CamelHead.Draw(lightingShader);
 
 		// Pierna delantera izquierda
@@ -2788,7 +2945,7 @@ float skyboxVertices[] = {
 		model = glm::translate(model, camelPivotFL);
 		model = glm::rotate(model, glm::radians(camelLegFL), glm::vec3(1.0f, 0.0f, 0.0f));
 		model = glm::translate(model, -camelPivotFL);
-		glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
+		SetModelMatrix(modelLoc, model);
 		CamelLeg_FL.Draw(lightingShader);
 
 		// Pierna delantera derecha
@@ -2797,7 +2954,7 @@ float skyboxVertices[] = {
 		model = glm::translate(model, camelPivotFR);
 		model = glm::rotate(model, glm::radians(camelLegFR), glm::vec3(1.0f, 0.0f, 0.0f));
 		model = glm::translate(model, -camelPivotFR);
-		glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
+		SetModelMatrix(modelLoc, model);
 		CamelLeg_FR.Draw(lightingShader);
 
 		// Pierna trasera izquierda
@@ -2806,7 +2963,7 @@ float skyboxVertices[] = {
 		model = glm::translate(model, camelPivotBL);
 		model = glm::rotate(model, glm::radians(camelLegBL), glm::vec3(1.0f, 0.0f, 0.0f));
 		model = glm::translate(model, -camelPivotBL);
-		glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
+		SetModelMatrix(modelLoc, model);
 		CamelLeg_BL.Draw(lightingShader);
 
 		// Pierna trasera derecha
@@ -2815,7 +2972,7 @@ float skyboxVertices[] = {
 		model = glm::translate(model, camelPivotBR);
 		model = glm::rotate(model, glm::radians(camelLegBR), glm::vec3(1.0f, 0.0f, 0.0f));
 		model = glm::translate(model, -camelPivotBR);
-		glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
+		SetModelMatrix(modelLoc, model);
 		CamelLeg_BR.Draw(lightingShader);
 
 
@@ -2836,13 +2993,13 @@ float skyboxVertices[] = {
 		model = glm::rotate(model, glm::radians(rotCondor), glm::vec3(0.0f, 1.0f, 0.0f));
 		model = glm::scale(model, glm::vec3(condorScale));
 		modelTemp = model;
-		glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
+		SetModelMatrix(modelLoc, model);
 		CondorBody.Draw(lightingShader);
 
 		// Cabeza
 		model = modelTemp;
 		model = glm::rotate(model, glm::radians(condorHead), glm::vec3(1.0f, 0.0f, 0.0f));
-		glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
+		SetModelMatrix(modelLoc, model);
 		CondorHead.Draw(lightingShader);
 
 		// Ala izquierda
@@ -2851,7 +3008,7 @@ float skyboxVertices[] = {
 		model = glm::translate(model, condorPivotAlaIzq);
 		model = glm::rotate(model, glm::radians(condorAlaIzq), glm::vec3(0.0f, 0.0f, 1.0f));
 		model = glm::translate(model, -condorPivotAlaIzq);
-		glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
+		SetModelMatrix(modelLoc, model);
 		CondorAla_Izq.Draw(lightingShader);
 
 		// Ala derecha
@@ -2860,7 +3017,7 @@ float skyboxVertices[] = {
 		model = glm::translate(model, condorPivotAlaDer);
 		model = glm::rotate(model, glm::radians(condorAlaDer), glm::vec3(0.0f, 0.0f, 1.0f));
 		model = glm::translate(model, -condorPivotAlaDer);
-		glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
+		SetModelMatrix(modelLoc, model);
 		CondorAla_Der.Draw(lightingShader);
 
 		//TORTUGA - ANIMACIÓN
@@ -2909,7 +3066,7 @@ float skyboxVertices[] = {
 		model = glm::rotate(model, glm::radians(rotTortuga), glm::vec3(0.0f, 1.0f, 0.0f));
 		model = glm::scale(model, glm::vec3(tortugaScale));
 		modelTemp = model;
-		glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
+		SetModelMatrix(modelLoc, model);
 		TortugaBody1.Draw(lightingShader);
 
 		// Pata delantera izquierda
@@ -2918,7 +3075,7 @@ float skyboxVertices[] = {
 		model = glm::translate(model, tortugaPivotFL);
 		model = glm::rotate(model, glm::radians(tortugaLegFL), glm::vec3(1.0f, 0.0f, 0.0f));
 		model = glm::translate(model, -tortugaPivotFL);
-		glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
+		SetModelMatrix(modelLoc, model);
 		TortugaLeg_FL1.Draw(lightingShader);
 
 		// Pata delantera derecha
@@ -2927,7 +3084,7 @@ float skyboxVertices[] = {
 		model = glm::translate(model, tortugaPivotFR);
 		model = glm::rotate(model, glm::radians(tortugaLegFR), glm::vec3(1.0f, 0.0f, 0.0f));
 		model = glm::translate(model, -tortugaPivotFR);
-		glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
+		SetModelMatrix(modelLoc, model);
 		TortugaLeg_FR1.Draw(lightingShader);
 
 
@@ -3194,29 +3351,27 @@ float skyboxVertices[] = {
 		model = glm::mat4(1.0f);
 		model = glm::translate(model, glm::vec3(0.0f, -0.5f, 0.0f));
 		model = glm::scale(model, glm::vec3(0.5f, 0.5f, 0.5f));
-		glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
+		SetModelMatrix(modelLoc, model);
 		AviarioMadera.Draw(lightingShader); 
 
 		//  (Vidrio)
-		glEnable(GL_BLEND);
-		glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-		glUniform1i(glGetUniformLocation(lightingShader.Program, "transparency"), 1);
+		RenderQueue::Get().SetPass(RENDER_PASS_BLEND_CUTOUT);
 		model = glm::mat4(1.0f);
 		model = glm::translate(model, glm::vec3(0.0f, -0.5f, 0.0f));
 		model = glm::scale(model, glm::vec3(0.5f, 0.5f, 0.5f));
-		glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
+		SetModelMatrix(modelLoc, model);
 		AviarioVidrio.Draw(lightingShader); 
 
 
 		// --- DIBUJAR EL AVE ---
 	
-		glUniform1i(glGetUniformLocation(lightingShader.Program, "transparency"), 0);
+		RenderQueue::Get().SetPass(RENDER_PASS_BLEND);
 		// Cuerpo
 		model = glm::mat4(1.0f);
 		model = glm::translate(model, avePos);
 		model = glm::scale(model, glm::vec3(0.5f)); 
 		modelTemp = model; 
-		glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
+		SetModelMatrix(modelLoc, model);
 		AveCuerpo.Draw(lightingShader);
 
 		// Cabeza
@@ -3225,7 +3380,7 @@ float skyboxVertices[] = {
 		model = glm::translate(model, pivoteCabeza);
 		model = glm::rotate(model, glm::radians(rotCabeza), glm::vec3(0.0f, 1.0f, 0.0f)); 
 		model = glm::translate(model, -pivoteCabeza);
-		glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
+		SetModelMatrix(modelLoc, model);
 		AveCabeza.Draw(lightingShader);
 
 		// Ala Izquierda
@@ -3234,7 +3389,7 @@ float skyboxVertices[] = {
 		model = glm::translate(model, pivoteAlaIzq);
 		model = glm::rotate(model, glm::radians(rotAlaIzq), glm::vec3(0.0f, 0.0f, 1.0f)); 
 		model = glm::translate(model, -pivoteAlaIzq);
-		glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
+		SetModelMatrix(modelLoc, model);
 		AveAlaIzq.Draw(lightingShader);
 
 		// Ala Derecha
@@ -3243,7 +3398,7 @@ float skyboxVertices[] = {
 		model = glm::translate(model, pivoteAlaDer);
 		model = glm::rotate(model, glm::radians(rotAlaDer), glm::vec3(0.0f, 0.0f, 1.0f)); 
 		model = glm::translate(model, -pivoteAlaDer);
-		glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
+		SetModelMatrix(modelLoc, model);
 		AveAlaDer.Draw(lightingShader);
 
 		// Cola
@@ -3251,7 +3406,7 @@ float skyboxVertices[] = {
 		model = modelTemp;
 		model = glm::translate(model, pivoteCola);
 		model = glm::translate(model, -pivoteCola);
-		glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
+		SetModelMatrix(modelLoc, model);
 		AveCola.Draw(lightingShader);
 
 		// Patas
@@ -3259,10 +3414,9 @@ float skyboxVertices[] = {
 		model = modelTemp;
 		model = glm::translate(model, pivotePatas);
 		model = glm::translate(model, -pivotePatas);
-		glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
+		SetModelMatrix(modelLoc, model);
 		AvePatas.Draw(lightingShader);
-		glDisable(GL_BLEND);
-		glUniform1i(glGetUniformLocation(lightingShader.Program, "transparency"), 0);
+		RenderQueue::Get().SetPass(RENDER_PASS_OPAQUE);
 
 
 		// --- DIBUJAR PINGUINO ---
@@ -3279,7 +3433,7 @@ float skyboxVertices[] = {
 		model = glm::translate(model, glm::vec3(0.0f, 0.5f, 0.0f)); 
 		model = glm::rotate(model, glm::radians(rotCuerpoPingu), glm::vec3(0.0f, 0.0f, 1.0f)); // Rotar en Z
 		model = glm::translate(model, glm::vec3(0.0f, -0.5f, 0.0f)); // Volver a la posición original
-		glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
+		SetModelMatrix(modelLoc, model);
 		PinguCuerpo.Draw(lightingShader);
 
 		// Aleta Izquierda
@@ -3288,7 +3442,7 @@ float skyboxVertices[] = {
 		model = glm::translate(model, pivoteAletaIzq);
 		model = glm::rotate(model, glm::radians(rotAletaIzqPingu), glm::vec3(1.0f, 0.0f, 0.0f)); // Rota en X
 		model = glm::translate(model, -pivoteAletaIzq);
-		glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
+		SetModelMatrix(modelLoc, model);
 		PinguAletaIzq.Draw(lightingShader);
 
 		// Aleta Derecha
@@ -3297,7 +3451,7 @@ float skyboxVertices[] = {
 		model = glm::translate(model, pivoteAletaDer);
 		model = glm::rotate(model, glm::radians(rotAletaDerPingu), glm::vec3(1.0f, 0.0f, 0.0f)); // Rota en X
 		model = glm::translate(model, -pivoteAletaDer);
-		glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
+		SetModelMatrix(modelLoc, model);
 		PinguAletaDer.Draw(lightingShader);
 
 		// Pata Izquierda
@@ -3306,7 +3460,7 @@ float skyboxVertices[] = {
 		model = glm::translate(model, pivotePataIzq);
 		model = glm::rotate(model, glm::radians(rotPataIzqPingu), glm::vec3(1.0f, 0.0f, 0.0f)); // Rota en X
 		model = glm::translate(model, -pivotePataIzq);
-		glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
+		SetModelMatrix(modelLoc, model);
 		PinguPataIzq.Draw(lightingShader);
 
 		// Pata Derecha
@@ -3315,9 +3469,11 @@ float skyboxVertices[] = {
 		model = glm::translate(model, pivotePataDer);
 		model = glm::rotate(model, glm::radians(rotPataDerPingu), glm::vec3(1.0f, 0.0f, 0.0f)); // Rota en X
 		model = glm::translate(model, -pivotePataDer);
-		glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
+		SetModelMatrix(modelLoc, model);
 		PinguPataDer.Draw(lightingShader);
 
+		// Dibujar todo lo encolado en el orden que menos estado cambia
+		RenderQueue::Get().Flush();
 
 		lightingShader.Use(); // shader de iluminación 
 
@@ -3369,6 +3525,16 @@ float skyboxVertices[] = {
 		glfwSwapBuffers(window);
 	}
 
+	// Stop the streaming workers before the context goes away
+	AssetLoader::Get().Finish();
+	// Costo por cuadro de las subidas del streaming
+	UploadQueue::Get().PrintSummary();
+	// Huecos que dejaron los habitats descargados en los buffers de geometria
+	MeshArena::Get().PrintSummary();
+
+	// The models are destroyed after the context is gone, so their GL objects are left to the driver
+	ModelRegistry::Get().Shutdown();
+
 	// Terminate GLFW, clearing any resources allocated by GLFW.
 	glfwTerminate();
 
@@ -3456,57 +3622,25 @@ void ConfigurarTexturaRepetible(GLuint textureID)
 
 /*
 ================================================================================
-	FUNCIÓN: DibujarPiso
+	FUNCIÓN: MatrizPiso
 ================================================================================
 PROPÓSITO:
-	Renderiza una superficie con textura aplicada
+	Transformación de una superficie (piso o pared) hecha con el cubo unitario
 
 PARÁMETROS:
-	- textureID: Textura a aplicar
 	- posicion: Posición central del objeto
 	- escala: Dimensiones (x, y, z)
-	- VAO_Cubo: Geometría a usar
-	- modelLoc: Location del uniform "model"
-
-PROCESO:
-	1. Activa y vincula textura en units 0 y 1
-	2. Vincula VAO
-	3. Habilita atributos de vértice
-	4. Construye matriz model (traslación + escala)
-	5. Envía matriz al shader
-	6. Dibuja 36 vértices (12 triángulos = 6 caras)
-	7. Desvincula VAO
 
 USO:
-	Llamar para cada superficie (pisos, paredes, etc.)
+	Cada piso y pared se agrega una vez con esta matriz al lote estático de la escena
+	(ver StaticBatch.h), que la hornea en sus vértices
 */
-// --- Función para dibujar pisos con textura ---
-void DibujarPiso(GLuint textureID, glm::vec3 posicion, glm::vec3 escala, GLuint VAO_Cubo, GLint modelLoc)
+glm::mat4 MatrizPiso(glm::vec3 posicion, glm::vec3 escala)
 {
-	// Activar y enlazar la textura
-	glActiveTexture(GL_TEXTURE0);
-	glBindTexture(GL_TEXTURE_2D, textureID);
-	glActiveTexture(GL_TEXTURE1);
-	glBindTexture(GL_TEXTURE_2D, textureID);
-
-	// Enlazar el VAO del cubo
-	glBindVertexArray(VAO_Cubo);
-
-	// Habilitar los atributos necesarios
-	glEnableVertexAttribArray(0); // Posición
-	glEnableVertexAttribArray(1); // Normal
-	glEnableVertexAttribArray(2); // TexCoords
-
-	// Crear matriz de transformación para el piso
 	glm::mat4 model_piso = glm::mat4(1.0f);
 	model_piso = glm::translate(model_piso, posicion);
 	model_piso = glm::scale(model_piso, escala);
-	glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model_piso));
-
-	// Dibujar el cubo (piso)
-	glDrawArrays(GL_TRIANGLES, 0, 36);
-
-	glBindVertexArray(0);
+	return model_piso;
 }
 
 	/*
@@ -3723,6 +3857,25 @@ void KeyCallback(GLFWwindow* window, int key, int scancode, int action, int mode
 		glfwSetWindowShouldClose(window, GL_TRUE);
 	}
 
+	// Triangulos dibujados y ahorrados por los niveles de detalle en el ultimo cuadro
+	if (GLFW_KEY_F3 == key && GLFW_PRESS == action)
+	{
+		RenderContext::Get().PrintLodStats();
+	}
+
+	// Dibujos, binds y cambios de estado del ultimo cuadro, en orden de envio contra la cola ordenada
+	if (GLFW_KEY_F4 == key && GLFW_PRESS == action)
+	{
+		RenderQueue::Get().PrintStats();
+	}
+
+	// Alterna el dibujo indirecto para comparar el tiempo de envio que imprime F4
+	if (GLFW_KEY_F5 == key && GLFW_PRESS == action && RenderQueue::Get().IndirectSupported())
+	{
+		RenderQueue::Get().SetIndirect(!RenderQueue::Get().indirect);
+		std::cout << "Dibujo indirecto " << (RenderQueue::Get().indirect ? "activo" : "desactivado") << std::endl;
+	}
+
 	if (key >= 0 && key < 1024)
 	{
 		if (action == GLFW_PRESS)
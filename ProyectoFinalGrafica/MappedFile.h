@@ -0,0 +1,324 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cctype>
+#include <cstdint>
+#include <cstdio>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#include <direct.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#endif
+
+// Size and modification time of a file on disk, used to detect stale derived data.
+struct FileStamp
+{
+	uint64_t size;
+	int64_t mtime;
+};
+
+// Fills the stamp of the given file. Returns false if the file does not exist.
+inline bool GetFileStamp(const std::string &path, FileStamp &stamp)
+{
+#ifdef _WIN32
+	struct _stat64 info;
+	if (_stat64(path.c_str(), &info) != 0)
+	{
+		return false;
+	}
+#else
+	struct stat info;
+	if (stat(path.c_str(), &info) != 0)
+	{
+		return false;
+	}
+#endif
+	stamp.size = (uint64_t)info.st_size;
+	stamp.mtime = (int64_t)info.st_mtime;
+	return true;
+}
+
+// Canonical form of a relative or absolute path: forward slashes, no "." segments and ".." folded into its parent,
+// so every spelling of a file maps to the same key. Paths are case-insensitive on Windows, so they are lowercased there.
+inline std::string CanonicalPath(const std::string &path)
+{
+	std::vector<std::string> parts;
+	std::string part;
+	bool absolute = !path.empty() && (path[0] == '/' || path[0] == '\\');
+
+	for (size_t i = 0; i <= path.size(); i++)
+	{
+		char c = i < path.size() ? path[i] : '/';
+		if (c != '/' && c != '\\')
+		{
+#ifdef _WIN32
+			c = (char)tolower((unsigned char)c);
+#endif
+			part.push_back(c);
+			continue;
+		}
+
+		if (part == "..")
+		{
+			if (!parts.empty() && parts.back() != "..")
+			{
+				parts.pop_back();
+			}
+			else
+			{
+				parts.push_back(part);
+			}
+		}
+		else if (!part.empty() && part != ".")
+		{
+			parts.push_back(part);
+		}
+		part.clear();
+	}
+
+	std::string canonical = absolute ? "/" : "";
+	for (size_t i = 0; i < parts.size(); i++)
+	{
+		canonical += (i > 0 ? "/" : "") + parts[i];
+	}
+	return canonical.empty() ? "." : canonical;
+}
+
+// 64-bit FNV-1a hash of a block of bytes, used to recognise identical files stored under different paths
+inline uint64_t HashBytes(const unsigned char *data, size_t size)
+{
+	uint64_t hash = 14695981039346656037ULL;
+	for (size_t i = 0; i < size; i++)
+	{
+		hash ^= data[i];
+		hash *= 1099511628211ULL;
+	}
+	return hash;
+}
+
+// Creates every directory of the given path ("a/b/c"). Existing directories are left untouched.
+inline void MakeDirectories(const std::string &path)
+{
+	for (size_t i = 1; i <= path.size(); i++)
+	{
+		if (i == path.size() || path[i] == '/' || path[i] == '\\')
+		{
+			std::string partial = path.substr(0, i);
+#ifdef _WIN32
+			_mkdir(partial.c_str());
+#else
+			mkdir(partial.c_str(), 0755);
+#endif
+		}
+	}
+}
+
+// Appends the files inside a directory to files ("directory/name"), descending into subdirectories if recursive.
+inline void ListFiles(const std::string &directory, bool recursive, std::vector<std::string> &files)
+{
+	std::vector<std::string> subdirectories;
+#ifdef _WIN32
+	WIN32_FIND_DATAA entry;
+	HANDLE find = FindFirstFileA((directory + "/*").c_str(), &entry);
+	if (find == INVALID_HANDLE_VALUE)
+	{
+		return;
+	}
+	do
+	{
+		std::string name = entry.cFileName;
+		if (name == "." || name == "..")
+		{
+			continue;
+		}
+		if (entry.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
+		{
+			subdirectories.push_back(directory + "/" + name);
+		}
+		else
+		{
+			files.push_back(directory + "/" + name);
+		}
+	} while (FindNextFileA(find, &entry));
+	FindClose(find);
+#else
+	DIR *dir = opendir(directory.c_str());
+	if (!dir)
+	{
+		return;
+	}
+	while (struct dirent *entry = readdir(dir))
+	{
+		std::string name = entry->d_name;
+		if (name == "." || name == "..")
+		{
+			continue;
+		}
+		struct stat info;
+		std::string path = directory + "/" + name;
+		if (stat(path.c_str(), &info) == 0 && S_ISDIR(info.st_mode))
+		{
+			subdirectories.push_back(path);
+		}
+		else
+		{
+			files.push_back(path);
+		}
+	}
+	closedir(dir);
+#endif
+
+	if (recursive)
+	{
+		for (size_t i = 0; i < subdirectories.size(); i++)
+		{
+			ListFiles(subdirectories[i], true, files);
+		}
+	}
+}
+
+// Read-only memory mapping of a whole file. The mapped bytes stay valid until Close() or destruction,
+// so pointers into Data() can be handed straight to glBufferData without an intermediate copy.
+class MappedFile
+{
+public:
+	MappedFile() : data(nullptr), size(0)
+	{
+#ifdef _WIN32
+		this->file = INVALID_HANDLE_VALUE;
+		this->mapping = NULL;
+#endif
+	}
+
+	~MappedFile()
+	{
+		this->Close();
+	}
+
+	bool Open(const std::string &path)
+	{
+		this->Close();
+#ifdef _WIN32
+		this->file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+		if (this->file == INVALID_HANDLE_VALUE)
+		{
+			return false;
+		}
+
+		LARGE_INTEGER fileSize;
+		if (!GetFileSizeEx(this->file, &fileSize) || fileSize.QuadPart == 0)
+		{
+			this->Close();
+			return false;
+		}
+		this->size = (size_t)fileSize.QuadPart;
+
+		this->mapping = CreateFileMappingA(this->file, NULL, PAGE_READONLY, 0, 0, NULL);
+		if (this->mapping == NULL)
+		{
+			this->Close();
+			return false;
+		}
+
+		this->data = (const unsigned char *)MapViewOfFile(this->mapping, FILE_MAP_READ, 0, 0, 0);
+		if (this->data == nullptr)
+		{
+			this->Close();
+			return false;
+		}
+#else
+		int fd = open(path.c_str(), O_RDONLY);
+		if (fd < 0)
+		{
+			return false;
+		}
+
+		struct stat info;
+		if (fstat(fd, &info) != 0 || info.st_size == 0)
+		{
+			close(fd);
+			return false;
+		}
+		this->size = (size_t)info.st_size;
+
+		void *view = mmap(nullptr, this->size, PROT_READ, MAP_PRIVATE, fd, 0);
+		close(fd);
+		if (view == MAP_FAILED)
+		{
+			this->size = 0;
+			return false;
+		}
+		this->data = (const unsigned char *)view;
+#endif
+		return true;
+	}
+
+	void Close()
+	{
+#ifdef _WIN32
+		if (this->data != nullptr)
+		{
+			UnmapViewOfFile(this->data);
+		}
+		if (this->mapping != NULL)
+		{
+			CloseHandle(this->mapping);
+		}
+		if (this->file != INVALID_HANDLE_VALUE)
+		{
+			CloseHandle(this->file);
+		}
+		this->file = INVALID_HANDLE_VALUE;
+		this->mapping = NULL;
+#else
+		if (this->data != nullptr)
+		{
+			munmap((void *)this->data, this->size);
+		}
+#endif
+		this->data = nullptr;
+		this->size = 0;
+	}
+
+	bool IsOpen() const
+	{
+		return this->data != nullptr;
+	}
+
+	const unsigned char *Data() const
+	{
+		return this->data;
+	}
+
+	size_t Size() const
+	{
+		return this->size;
+	}
+
+	MappedFile(const MappedFile &) = delete;
+	MappedFile &operator=(const MappedFile &) = delete;
+
+private:
+	const unsigned char *data;
+	size_t size;
+#ifdef _WIN32
+	HANDLE file;
+	HANDLE mapping;
+#endif
+};
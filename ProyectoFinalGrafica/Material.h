@@ -0,0 +1,224 @@
+#pragma once
+
+#include <map>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+#include <GL/glew.h>
+#include <assimp/scene.h>
+
+using namespace std;
+
+/*
+	What a mesh sets before its draw, resolved once instead of on every draw.
+
+	A Material is built when its mesh is uploaded and never changes: the textures it binds, each already paired
+	with its texture unit, and its shininess. Units are fixed by sampler name rather than by the order of the
+	textures in the mesh: texture_diffuseN always goes to unit N - 1 and texture_specularN to
+	MATERIAL_SPECULAR_UNIT + N - 1. Since the unit of a sampler no longer depends on the mesh, the sampler uniforms
+	are set once per program, when its MaterialProgram is created, and drawing a mesh is only its texture binds
+	and one glUniform1f.
+
+	MaterialProgram holds the uniform locations of one shader program that the meshes and models set. It is
+	created the first time the program draws a model and kept for the rest of the run, so no uniform is looked up
+	by name while drawing.
+
+	The first unit of each kind is always bound, to texture 0 if the mesh has none, so a mesh without a diffuse
+	map samples black as it did when every draw unbound its textures afterwards. The other units are left as the
+	previous draw left them; no shader samples them without the mesh binding them.
+*/
+
+#define MATERIAL_MAX_SAMPLERS 4   // Per kind: texture_diffuse1..4 and texture_specular1..4
+#define MATERIAL_SPECULAR_UNIT 4  // First unit of the specular samplers
+#define MATERIAL_DEFAULT_SHININESS 16.0f
+#define MATERIAL_DRAW_DATA_UNIT (MATERIAL_SPECULAR_UNIT + MATERIAL_MAX_SAMPLERS) // Per-draw matrices of RenderQueue's multi-draw calls
+
+struct Texture
+{
+	GLuint id;
+	string type;
+	aiString path;
+};
+
+// Uniform locations of a shader program, -1 for the uniforms it doesn't have
+struct MaterialProgram
+{
+	GLuint program = 0;
+	GLuint index = 0;          // Order in which the program was first used, small enough for a sort key
+	GLint model = -1;
+	GLint transparency = -1;   // 1 discards the fragments of low alpha, see RenderPass
+	GLint shininess = -1;      // material.shininess
+	GLint packedVertices = -1; // Dequantization of PackedVertex, see MeshBuffer
+	GLint positionOffset = -1;
+	GLint positionScale = -1;
+	GLint instanced = -1;      // The model and normal matrices come from instance attributes, see InstanceBatch
+	GLint indirect = -1;       // They come from the drawData buffer texture, see RenderQueue
+
+	// The program's locations, resolving them (and setting its samplers to their fixed units) on first use
+	static const MaterialProgram &For(GLuint program)
+	{
+		static map<GLuint, MaterialProgram> programs;
+
+		map<GLuint, MaterialProgram>::iterator it = programs.find(program);
+		if (it == programs.end())
+		{
+			it = programs.insert(make_pair(program, MaterialProgram(program, (GLuint)programs.size()))).first;
+		}
+		return it->second;
+	}
+
+private:
+	MaterialProgram(GLuint program, GLuint index)
+	{
+		this->program = program;
+		this->index = index;
+		this->model = glGetUniformLocation(program, "model");
+		this->transparency = glGetUniformLocation(program, "transparency");
+		this->shininess = glGetUniformLocation(program, "material.shininess");
+		this->packedVertices = glGetUniformLocation(program, "packedVertices");
+		this->positionOffset = glGetUniformLocation(program, "positionOffset");
+		this->positionScale = glGetUniformLocation(program, "positionScale");
+		this->instanced = glGetUniformLocation(program, "instanced");
+		this->indirect = glGetUniformLocation(program, "indirect");
+
+		// Sampler values are state of the program, so it is made current for the time it takes to set them
+		GLint current = 0;
+		glGetIntegerv(GL_CURRENT_PROGRAM, &current);
+		glUseProgram(program);
+		for (GLuint i = 0; i < MATERIAL_MAX_SAMPLERS; i++)
+		{
+			char name[32];
+			snprintf(name, sizeof(name), "texture_diffuse%u", i + 1);
+			glUniform1i(glGetUniformLocation(program, name), i);
+			snprintf(name, sizeof(name), "texture_specular%u", i + 1);
+			glUniform1i(glGetUniformLocation(program, name), MATERIAL_SPECULAR_UNIT + i);
+		}
+		glUniform1i(glGetUniformLocation(program, "drawData"), MATERIAL_DRAW_DATA_UNIT);
+		glUseProgram(current);
+	}
+};
+
+class Material
+{
+public:
+	Material() : Material(vector<Texture>()) {}
+
+	// Pairs every texture with the unit of its sampler. Textures past MATERIAL_MAX_SAMPLERS of a kind, or of a
+	// kind no shader samples, are left out.
+	explicit Material(const vector<Texture> &textures, GLfloat shininess = MATERIAL_DEFAULT_SHININESS)
+	{
+		this->shininess = shininess;
+
+		GLuint diffuseNr = 0, specularNr = 0;
+		this->bindings.push_back(Binding(0, 0));
+		this->bindings.push_back(Binding(MATERIAL_SPECULAR_UNIT, 0));
+		for (size_t i = 0; i < textures.size(); i++)
+		{
+			GLuint unit;
+			if (textures[i].type == "texture_diffuse" && diffuseNr < MATERIAL_MAX_SAMPLERS)
+			{
+				unit = diffuseNr++;
+			}
+			else if (textures[i].type == "texture_specular" && specularNr < MATERIAL_MAX_SAMPLERS)
+			{
+				unit = MATERIAL_SPECULAR_UNIT + specularNr++;
+			}
+			else
+			{
+				continue;
+			}
+
+			if (unit == 0 || unit == MATERIAL_SPECULAR_UNIT)
+			{
+				this->bindings[unit == 0 ? 0 : 1].id = textures[i].id;
+			}
+			else
+			{
+				this->bindings.push_back(Binding(unit, textures[i].id));
+			}
+		}
+	}
+
+	// Binds the textures and sets the shininess. The program must be the one in use.
+	// Unit 0 goes last, so it is the active unit afterwards as the rest of the frame expects.
+	void Bind(const MaterialProgram &program) const
+	{
+		for (size_t i = this->bindings.size(); i-- > 0;)
+		{
+			glActiveTexture(GL_TEXTURE0 + this->bindings[i].unit);
+			glBindTexture(GL_TEXTURE_2D, this->bindings[i].id);
+		}
+		glUniform1f(program.shininess, this->shininess);
+	}
+
+	GLuint NumBindings() const
+	{
+		return (GLuint)this->bindings.size();
+	}
+
+	// The i-th texture bind of Bind, for callers that skip the binds already in place (see RenderQueue)
+	void GetBinding(GLuint i, GLuint &unit, GLuint &id) const
+	{
+		unit = this->bindings[i].unit;
+		id = this->bindings[i].id;
+	}
+
+	// Materials with the same first diffuse texture get the same id, so sorting by it groups their binds
+	GLuint SortId() const
+	{
+		return this->bindings[0].id;
+	}
+
+	// Texture bound to a unit, 0 if the material leaves it unbound
+	GLuint TextureAt(GLuint unit) const
+	{
+		for (size_t i = 0; i < this->bindings.size(); i++)
+		{
+			if (this->bindings[i].unit == unit)
+			{
+				return this->bindings[i].id;
+			}
+		}
+		return 0;
+	}
+
+	GLfloat Shininess() const
+	{
+		return this->shininess;
+	}
+
+	// Binds the same textures to the same units and sets the same shininess, so draws of either need no state in between
+	bool SameAs(const Material &other) const
+	{
+		if (this == &other)
+		{
+			return true;
+		}
+		if (this->shininess != other.shininess || this->bindings.size() != other.bindings.size())
+		{
+			return false;
+		}
+		for (size_t i = 0; i < this->bindings.size(); i++)
+		{
+			if (this->bindings[i].unit != other.bindings[i].unit || this->bindings[i].id != other.bindings[i].id)
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+private:
+	struct Binding
+	{
+		GLuint unit;
+		GLuint id;
+
+		Binding(GLuint unit, GLuint id) : unit(unit), id(id) {}
+	};
+
+	vector<Binding> bindings; // First diffuse, first specular, then the rest in the order of the mesh
+	GLfloat shininess = MATERIAL_DEFAULT_SHININESS;
+};
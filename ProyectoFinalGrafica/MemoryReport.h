@@ -0,0 +1,120 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <memory>
+#include <iostream>
+#include <algorithm>
+
+#include "Json.h"
+#include "MeshArena.h"
+#include "UploadQueue.h"
+#include "ModelRegistry.h"
+#include "TextureManager.h"
+
+using namespace std;
+
+/*
+	Where the memory of the loaded assets is, in RAM and in the GPU.
+
+	Per model: the vertex and index ranges it took in the MeshArena, the textures it references (shared textures
+	are counted once in the totals) and what its meshes keep in RAM after the upload, which depends on
+	ModelLoadOptions::cpuMirror. Heap and mapped bytes are kept apart: mapped pages belong to the cache or .glb
+	files and the system can drop them. Data waiting in the UploadQueue is also held in RAM until it is copied.
+*/
+
+#define MEMORY_REPORT_FILE "memory_report.json"
+#define MEMORY_REPORT_TOP 10 // Models listed by Print
+
+class MemoryReport
+{
+public:
+	static void Print()
+	{
+		vector<shared_ptr<ModelAsset> > assets = ModelRegistry::Get().Assets();
+		vector<TextureMemory> textures = TextureManager::Get().Textures();
+
+		size_t geometryBytes = 0, cpuBytes = 0, mappedBytes = 0, textureBytes = 0;
+		for (size_t i = 0; i < assets.size(); i++)
+		{
+			geometryBytes += assets[i]->geometryBytes;
+			cpuBytes += assets[i]->cpuBytes;
+			mappedBytes += assets[i]->mappedBytes;
+		}
+		for (size_t i = 0; i < textures.size(); i++)
+		{
+			textureBytes += textures[i].gpuBytes;
+		}
+
+		cout << "Memoria: GPU " << Megabytes(geometryBytes + textureBytes) << " MB (geometria " << Megabytes(geometryBytes) << ", texturas "
+			<< Megabytes(textureBytes) << ") | RAM espejos " << Megabytes(cpuBytes) << " MB, mapeados " << Megabytes(mappedBytes) << " MB | en espera de subida "
+			<< Megabytes(UploadQueue::Get().PendingBytes()) << " MB (pico " << Megabytes(UploadQueue::Get().Stats().peakPendingBytes) << " MB)" << endl;
+
+		stable_sort(assets.begin(), assets.end(), [](const shared_ptr<ModelAsset> &a, const shared_ptr<ModelAsset> &b)
+			{ return a->gpuBytes + a->cpuBytes > b->gpuBytes + b->cpuBytes; });
+		for (size_t i = 0; i < assets.size() && i < MEMORY_REPORT_TOP; i++)
+		{
+			const ModelAsset &asset = *assets[i];
+			cout << "  " << i + 1 << ". " << asset.path << ": " << asset.meshes.size() << " mallas, GPU " << Megabytes(asset.geometryBytes) << " MB + texturas "
+				<< Megabytes(asset.gpuBytes - asset.geometryBytes) << " MB, RAM " << Megabytes(asset.cpuBytes) << " MB" << endl;
+		}
+	}
+
+	// Every model with its meshes and textures, and every texture, for comparing runs with other tools
+	static bool WriteJson(const string &path)
+	{
+		vector<shared_ptr<ModelAsset> > assets = ModelRegistry::Get().Assets();
+		vector<TextureMemory> textures = TextureManager::Get().Textures();
+
+		FILE *out = fopen(path.c_str(), "w");
+		if (!out)
+		{
+			cout << "ERROR::MEMORY_REPORT::CANNOT_WRITE " << path << endl;
+			return false;
+		}
+
+		fprintf(out, "{\n  \"pendingUploadBytes\": %llu,\n  \"peakPendingUploadBytes\": %llu,\n  \"models\": [\n",
+			(unsigned long long)UploadQueue::Get().PendingBytes(), (unsigned long long)UploadQueue::Get().Stats().peakPendingBytes);
+		for (size_t i = 0; i < assets.size(); i++)
+		{
+			const ModelAsset &asset = *assets[i];
+			fprintf(out, "    {\"path\": %s, \"instances\": %u, \"gpuBytes\": %llu, \"geometryBytes\": %llu, \"cpuBytes\": %llu, \"mappedBytes\": %llu, \"meshes\": [",
+				JsonValue::Quote(asset.path).c_str(), asset.instances, (unsigned long long)asset.gpuBytes, (unsigned long long)asset.geometryBytes,
+				(unsigned long long)asset.cpuBytes, (unsigned long long)asset.mappedBytes);
+			for (size_t m = 0; m < asset.meshes.size(); m++)
+			{
+				const Mesh &mesh = asset.meshes[m];
+				fprintf(out, "%s{\"gpuBytes\": %llu, \"cpuBytes\": %llu, \"mappedBytes\": %llu, \"textures\": [", m ? ", " : "",
+					(unsigned long long)mesh.GpuBytes(), (unsigned long long)mesh.mirror.HeapBytes(), (unsigned long long)mesh.mirror.MappedBytes());
+				// The material keeps an empty binding on the units the mesh has no texture for
+				for (GLuint b = 0, t = 0; b < mesh.material.NumBindings(); b++)
+				{
+					GLuint unit, id;
+					mesh.material.GetBinding(b, unit, id);
+					if (id != 0)
+					{
+						fprintf(out, "%s%u", t++ ? ", " : "", id);
+					}
+				}
+				fprintf(out, "]}");
+			}
+			fprintf(out, "]}%s\n", i + 1 < assets.size() ? "," : "");
+		}
+
+		fprintf(out, "  ],\n  \"textures\": [\n");
+		for (size_t i = 0; i < textures.size(); i++)
+		{
+			fprintf(out, "    {\"id\": %u, \"path\": %s, \"refs\": %u, \"gpuBytes\": %llu}%s\n", textures[i].id, JsonValue::Quote(textures[i].path).c_str(),
+				textures[i].refs, (unsigned long long)textures[i].gpuBytes, i + 1 < textures.size() ? "," : "");
+		}
+		fprintf(out, "  ]\n}\n");
+		return fclose(out) == 0;
+	}
+
+private:
+	static double Megabytes(size_t bytes)
+	{
+		return bytes / (1024.0 * 1024.0);
+	}
+};
@@ -5,6 +5,8 @@
 #include <sstream>
 #include <iostream>
 #include <vector>
+#include <memory>
+#include <algorithm>
 
 #include <GL/glew.h>
 #include <glm/glm.hpp>
@@ -16,6 +18,9 @@
 
 
 #include "Shader.h"
+#include "Material.h"
+#include "MeshArena.h"
+#include "UploadQueue.h"
 
 using namespace std;
 
@@ -29,105 +34,174 @@ struct Vertex
 	glm::vec2 TexCoords;
 };
 
-struct Texture
+// Compact alternative to Vertex (16 bytes instead of 32), see VertexPacking.h
+struct PackedVertex
+{
+	// Position quantized to 16 bits against the bounds of the model (w is padding)
+	GLushort Position[4];
+	// Octahedral-encoded normal, signed normalized 16 bits
+	GLshort Normal[2];
+	// Half-float texture coordinates
+	GLushort TexCoords[2];
+};
+
+#define MESH_MAX_LODS 4 // Full mesh plus up to three simplified levels, see MeshSimplifier.h
+
+// Range of the index data drawn for one level of detail
+struct MeshLod
+{
+	GLuint firstIndex;
+	GLuint numIndices;
+};
+
+// Texture referenced by a mesh before it is loaded: its sampler type (texture_diffuse, ...) and its path relative to the model
+struct TextureRef
 {
-	GLuint id;
 	string type;
-	aiString path;
+	string path;
 };
 
-class Mesh
+// CPU-side result of importing a mesh, produced off the GL thread and turned into a Mesh once uploaded.
+// The geometry either lives in the vectors (Assimp path) or points into a mapped mesh cache file.
+struct MeshData
 {
-public:
-	/*  Mesh Data  */
 	vector<Vertex> vertices;
 	vector<GLuint> indices;
-	vector<Texture> textures;
+	vector<TextureRef> textures;
 
-	/*  Functions  */
-	// Constructor
-	Mesh(vector<Vertex> vertices, vector<GLuint> indices, vector<Texture> textures)
+	// Geometry to upload: points into the vectors above or into the mapped cache
+	const Vertex *vertexData = nullptr;
+	const GLuint *indexData = nullptr;
+	GLuint numVertices = 0;
+	GLuint numIndices = 0;  // Every level, the index data holds them one after another
+
+	// Levels of detail, level 0 being the full mesh. All of them index the same vertices.
+	GLuint numLods = 1;
+	MeshLod lods[MESH_MAX_LODS] = {};
+
+	MeshData() {}
+	MeshData(MeshData &&) = default;
+	MeshData &operator=(MeshData &&) = default;
+	MeshData(const MeshData &) = delete; // The pointers would dangle in a copy
+	MeshData &operator=(const MeshData &) = delete;
+
+	// Makes the owned vectors the geometry to upload
+	void UseOwnedGeometry()
 	{
-		this->vertices = vertices;
-		this->indices = indices;
-		this->textures = textures;
+		this->vertexData = this->vertices.data();
+		this->indexData = this->indices.data();
+		this->numVertices = (GLuint)this->vertices.size();
+		this->numIndices = (GLuint)this->indices.size();
 
-		// Now that we have all the required data, set the vertex buffers and its attribute pointers.
-		this->setupMesh();
+		// Without generated levels the whole index data is the full mesh
+		if (this->numLods <= 1)
+		{
+			this->numLods = 1;
+			this->lods[0].firstIndex = 0;
+			this->lods[0].numIndices = this->numIndices;
+		}
 	}
+};
+
+/*
+	Vertex and index ranges of all the meshes of a model.
+
+	Every mesh of the model is appended to one range of vertices and one range of indices that the model gets
+	from the MeshArena, and the VAO of the arena block describes them. A mesh is then just a range of that index
+	buffer (first index + count) plus the base vertex its indices are relative to, so drawing the whole model
+	needs one VAO bind, which is the same for every model with the same vertex layout.
+*/
+class MeshBuffer
+{
+public:
+	GLuint VAO = 0, VBO = 0, EBO = 0; // Of the arena block that holds the ranges
+
+	bool packed = false;          // Vertices are PackedVertex instead of Vertex
+	glm::vec3 positionOffset;     // Dequantization of packed positions: position * positionScale + positionOffset
+	glm::vec3 positionScale;
+	uint64_t uploadTicket = 0;    // The geometry is in the buffers once the UploadQueue is done with this ticket
 
-	// Render the mesh
-	void Draw(Shader shader)
+	// Allocates the ranges and queues the geometry of every mesh on the UploadQueue. firstIndex and baseVertex
+	// receive where each mesh ended up in the block. With packedVertices the vertex range is filled from it (one
+	// PackedVertex per vertex of every mesh, in order) instead of from the Vertex data of the meshes. owner keeps
+	// the data of the meshes alive until it is copied; profileName is the record of the model in the LoadProfiler.
+	void Setup(const vector<MeshData> &meshes, vector<GLuint> &firstIndex, vector<GLint> &baseVertex, const PackedVertex *packedVertices,
+		const shared_ptr<const void> &owner, const string &profileName)
 	{
-		// Bind appropriate textures
-		GLuint diffuseNr = 1;
-		GLuint specularNr = 1;
+		GLuint numVertices = 0, numIndices = 0;
+		for (size_t i = 0; i < meshes.size(); i++)
+		{
+			numVertices += meshes[i].numVertices;
+			numIndices += meshes[i].numIndices;
+		}
 
-		for (GLuint i = 0; i < this->textures.size(); i++)
+		this->packed = packedVertices != nullptr;
+		const VertexLayout &layout = Layout(this->packed);
+		MeshArena &arena = MeshArena::Get();
+		this->allocation = arena.Allocate(layout, numVertices, numIndices);
+		this->VAO = arena.VAO(this->allocation);
+		this->VBO = arena.VBO(this->allocation);
+		this->EBO = arena.EBO(this->allocation);
+		this->gpuBytes = (size_t)numVertices * layout.stride + (size_t)numIndices * sizeof(GLuint);
+
+		// The indices are kept relative to their own mesh; glDrawElementsBaseVertex adds the offset at draw time
+		firstIndex.resize(meshes.size());
+		baseVertex.resize(meshes.size());
+		GLuint vertex = this->allocation.firstVertex, index = this->allocation.firstIndex;
+		for (size_t i = 0; i < meshes.size(); i++)
 		{
-			glActiveTexture(GL_TEXTURE0 + i); // Active proper texture unit before binding
-											  // Retrieve texture number (the N in diffuse_textureN)
-			stringstream ss;
-			string number;
-			string name = this->textures[i].type;
+			firstIndex[i] = index;
+			baseVertex[i] = (GLint)vertex;
+			vertex += meshes[i].numVertices;
+			index += meshes[i].numIndices;
+		}
 
-			if (name == "texture_diffuse")
+		UploadQueue &queue = UploadQueue::Get();
+		if (this->packed && numVertices > 0)
+		{
+			this->uploadTicket = queue.EnqueueBuffer(this->VBO, this->allocation.firstVertex * sizeof(PackedVertex), packedVertices, numVertices * sizeof(PackedVertex), owner, profileName);
+		}
+		for (size_t i = 0; i < meshes.size(); i++)
+		{
+			if (!this->packed && meshes[i].numVertices > 0)
 			{
-				ss << diffuseNr++; // Transfer GLuint to stream
+				this->uploadTicket = queue.EnqueueBuffer(this->VBO, baseVertex[i] * sizeof(Vertex), meshes[i].vertexData, meshes[i].numVertices * sizeof(Vertex), owner, profileName);
 			}
-			else if (name == "texture_specular")
+			if (meshes[i].numIndices > 0)
 			{
-				ss << specularNr++; // Transfer GLuint to stream
+				this->uploadTicket = queue.EnqueueBuffer(this->EBO, firstIndex[i] * sizeof(GLuint), meshes[i].indexData, meshes[i].numIndices * sizeof(GLuint), owner, profileName);
 			}
-
-			number = ss.str();
-			// Now set the sampler to the correct texture unit
-			glUniform1i(glGetUniformLocation(shader.Program, (name + number).c_str()), i);
-			// And finally bind the texture
-			glBindTexture(GL_TEXTURE_2D, this->textures[i].id);
 		}
+	}
 
-		// Also set each mesh's shininess property to a default value (if you want you could extend this to another mesh property and possibly change this value)
-		glUniform1f(glGetUniformLocation(shader.Program, "material.shininess"), 16.0f);
+	// Gives the ranges back to the arena. Only the owner (the ModelAsset) calls this.
+	void Release()
+	{
+		MeshArena::Get().Free(this->allocation);
+		this->VAO = this->VBO = this->EBO = 0;
+		this->gpuBytes = 0;
+	}
 
-		// Draw mesh
-		glBindVertexArray(this->VAO);
-		glDrawElements(GL_TRIANGLES, this->indices.size(), GL_UNSIGNED_INT, 0);
-		glBindVertexArray(0);
+	// Bytes of the vertex and index ranges
+	size_t GpuBytes() const
+	{
+		return this->gpuBytes;
+	}
 
-		// Always good practice to set everything back to defaults once configured.
-		for (GLuint i = 0; i < this->textures.size(); i++)
-		{
-			glActiveTexture(GL_TEXTURE0 + i);
-			glBindTexture(GL_TEXTURE_2D, 0);
-		}
+	// The arena layouts of Vertex and PackedVertex
+	static const VertexLayout &Layout(bool packed)
+	{
+		static const VertexLayout full = { 0, "Vertex", sizeof(Vertex), DescribeVertex };
+		static const VertexLayout compact = { 1, "PackedVertex", sizeof(PackedVertex), DescribePackedVertex };
+		return packed ? compact : full;
 	}
 
 private:
-	/*  Render data  */
-	GLuint VAO, VBO, EBO;
+	MeshAllocation allocation;
+	size_t gpuBytes = 0;
 
-	/*  Functions    */
-	// Initializes all the buffer objects/arrays
-	void setupMesh()
+	static void DescribeVertex()
 	{
-		// Create buffers/arrays
-		glGenVertexArrays(1, &this->VAO);
-		glGenBuffers(1, &this->VBO);
-		glGenBuffers(1, &this->EBO);
-
-		glBindVertexArray(this->VAO);
-		// Load data into vertex buffers
-		glBindBuffer(GL_ARRAY_BUFFER, this->VBO);
-		// A great thing about structs is that their memory layout is sequential for all its items.
-		// The effect is that we can simply pass a pointer to the struct and it translates perfectly to a glm::vec3/2 array which
-		// again translates to 3/2 floats which translates to a byte array.
-		glBufferData(GL_ARRAY_BUFFER, this->vertices.size() * sizeof(Vertex), &this->vertices[0], GL_STATIC_DRAW);
-
-		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, this->EBO);
-		glBufferData(GL_ELEMENT_ARRAY_BUFFER, this->indices.size() * sizeof(GLuint), &this->indices[0], GL_STATIC_DRAW);
-
-		// Set the vertex attribute pointers
 		// Vertex Positions
 		glEnableVertexAttribArray(0);
 		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (GLvoid *)0);
@@ -137,7 +211,165 @@ private:
 		// Vertex Texture Coords
 		glEnableVertexAttribArray(2);
 		glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (GLvoid *)offsetof(Vertex, TexCoords));
+	}
+
+	static void DescribePackedVertex()
+	{
+		// Vertex Positions: [0, 1] in the bounds of the model, the shader applies positionScale/positionOffset
+		glEnableVertexAttribArray(0);
+		glVertexAttribPointer(0, 3, GL_UNSIGNED_SHORT, GL_TRUE, sizeof(PackedVertex), (GLvoid *)0);
+		// Vertex Normals: octahedral [-1, 1] pair, decoded by the shader
+		glEnableVertexAttribArray(1);
+		glVertexAttribPointer(1, 2, GL_SHORT, GL_TRUE, sizeof(PackedVertex), (GLvoid *)offsetof(PackedVertex, Normal));
+		// Vertex Texture Coords
+		glEnableVertexAttribArray(2);
+		glVertexAttribPointer(2, 2, GL_HALF_FLOAT, GL_FALSE, sizeof(PackedVertex), (GLvoid *)offsetof(PackedVertex, TexCoords));
+	}
+};
 
-		glBindVertexArray(0);
+// What a mesh keeps in RAM once its geometry is in the GPU
+enum MeshMirrorPolicy
+{
+	MESH_MIRROR_DROP,    // Nothing: the loaded data is freed (or unmapped) as soon as the UploadQueue has copied it
+	MESH_MIRROR_COMPACT, // Positions and the triangles of the full level, 12 bytes per vertex instead of 32, e.g. for picking
+	MESH_MIRROR_FULL     // The loaded mesh as it is, every level included; the model keeps its ModelData alive
+};
+
+// CPU copy of a mesh kept after its upload, in either form of MeshMirrorPolicy
+struct MeshMirror
+{
+	const MeshData *source = nullptr; // MESH_MIRROR_FULL
+	vector<glm::vec3> positions;      // MESH_MIRROR_COMPACT
+	vector<GLuint> indices;
+
+	MeshMirror() {}
+	MeshMirror(MeshMirror &&) = default;
+	MeshMirror &operator=(MeshMirror &&) = default;
+	MeshMirror(const MeshMirror &) = delete;
+	MeshMirror &operator=(const MeshMirror &) = delete;
+
+	GLuint NumVertices() const
+	{
+		return this->source ? this->source->numVertices : (GLuint)this->positions.size();
 	}
-};
\ No newline at end of file
+
+	glm::vec3 Position(GLuint i) const
+	{
+		return this->source ? this->source->vertexData[i].Position : this->positions[i];
+	}
+
+	// Indices of the full level, relative to the mesh's own vertices
+	GLuint NumIndices() const
+	{
+		return this->source ? this->source->lods[0].numIndices : (GLuint)this->indices.size();
+	}
+
+	GLuint Index(GLuint i) const
+	{
+		return this->source ? this->source->indexData[this->source->lods[0].firstIndex + i] : this->indices[i];
+	}
+
+	// Allocated for the mirror, or held by the model for it in the case of a full mirror of owned vectors
+	size_t HeapBytes() const
+	{
+		if (this->source)
+		{
+			return this->source->vertexData == this->source->vertices.data() ? this->source->vertices.size() * sizeof(Vertex) + this->source->indices.size() * sizeof(GLuint) : 0;
+		}
+		return this->positions.size() * sizeof(glm::vec3) + this->indices.size() * sizeof(GLuint);
+	}
+
+	// Full mirror of a mesh that lives in a mapped cache or .glb: file pages the system can drop and read back
+	size_t MappedBytes() const
+	{
+		return this->source && this->source->vertexData != this->source->vertices.data() ?
+			(size_t)this->source->numVertices * sizeof(Vertex) + (size_t)this->source->numIndices * sizeof(GLuint) : 0;
+	}
+};
+
+// One mesh of a model: its material and the ranges of its levels inside the MeshBuffer of the model
+class Mesh
+{
+public:
+	/*  Mesh Data  */
+	Material material; // Textures already paired with their units, see Material.h
+	MeshMirror mirror; // What is left of the geometry in RAM, see MeshMirrorPolicy
+
+	/*  Functions  */
+	// Constructor. firstIndex is where the index data of the mesh starts in the index buffer of the model's arena block.
+	// vertexStride is the size of a vertex in the MeshBuffer. With MESH_MIRROR_FULL, data must outlive the mesh.
+	Mesh(GLuint firstIndex, GLint baseVertex, const MeshData &data, const vector<Texture> &textures, GLsizei vertexStride, MeshMirrorPolicy mirrorPolicy)
+	{
+		this->numLods = max(data.numLods, 1u);
+		for (GLuint i = 0; i < this->numLods; i++)
+		{
+			this->lods[i].firstIndex = firstIndex + data.lods[i].firstIndex;
+			this->lods[i].numIndices = data.lods[i].numIndices;
+		}
+		this->baseVertex = baseVertex;
+		this->material = Material(textures);
+		this->gpuBytes = (size_t)data.numVertices * vertexStride + (size_t)data.numIndices * sizeof(GLuint);
+
+		if (mirrorPolicy == MESH_MIRROR_FULL)
+		{
+			this->mirror.source = &data;
+		}
+		else if (mirrorPolicy == MESH_MIRROR_COMPACT)
+		{
+			this->mirror.positions.resize(data.numVertices);
+			for (GLuint i = 0; i < data.numVertices; i++)
+			{
+				this->mirror.positions[i] = data.vertexData[i].Position;
+			}
+			this->mirror.indices.assign(data.indexData + data.lods[0].firstIndex, data.indexData + data.lods[0].firstIndex + data.lods[0].numIndices);
+		}
+	}
+
+	Mesh(Mesh &&) = default;
+	Mesh &operator=(Mesh &&) = default;
+
+	GLuint NumLods() const
+	{
+		return this->numLods;
+	}
+
+	// Bytes of the vertex and index ranges of the mesh (every level)
+	size_t GpuBytes() const
+	{
+		return this->gpuBytes;
+	}
+
+	// Triangles drawn at a level (levels past the last one draw the last one)
+	GLuint NumTriangles(GLuint lod) const
+	{
+		return this->lods[min(lod, this->numLods - 1)].numIndices / 3;
+	}
+
+	// Range drawn at a level (levels past the last one draw the last one)
+	const MeshLod &Lod(GLuint lod) const
+	{
+		return this->lods[min(lod, this->numLods - 1)];
+	}
+
+	GLint BaseVertex() const
+	{
+		return this->baseVertex;
+	}
+
+	// Render the mesh at a level of detail. The VAO of the model's MeshBuffer and the program must be bound.
+	void Draw(const MaterialProgram &program, GLuint lod = 0) const
+	{
+		this->material.Bind(program);
+
+		// Draw mesh
+		const MeshLod &level = this->Lod(lod);
+		glDrawElementsBaseVertex(GL_TRIANGLES, level.numIndices, GL_UNSIGNED_INT, (GLvoid *)(level.firstIndex * sizeof(GLuint)), this->baseVertex);
+	}
+
+private:
+	/*  Render data  */
+	MeshLod lods[MESH_MAX_LODS]; // Ranges inside the index buffer of the arena block
+	GLuint numLods;
+	GLint baseVertex;   // Added to every index to reach the mesh's vertices
+	size_t gpuBytes;
+};
@@ -0,0 +1,336 @@
+#pragma once
+
+#include <map>
+#include <vector>
+#include <iostream>
+#include <algorithm>
+
+#include <GL/glew.h>
+
+#include "UploadQueue.h"
+
+using namespace std;
+
+/*
+	Vertex and index storage shared by every model.
+
+	Instead of buffers of their own, models get ranges of a few large blocks. A block is one vertex buffer, one
+	index buffer and the VAO that describes them, all for a single vertex layout, so every model with that layout
+	is drawn with the same VAO bound. Ranges are counted in vertices and indices: the first vertex of a range is
+	the base vertex of its draws and the first index is where its index data starts.
+
+	Free ranges are kept sorted by offset and merged with their neighbours when a range is freed, so unloading a
+	habitat gives its space back as one hole that the next habitat of similar size fits in. Allocation is first
+	fit. A new block is created when no block has room (one larger than MESH_ARENA_*_BLOCK_BYTES if a single
+	model needs it), and blocks that become empty are deleted as long as another block of the layout remains.
+*/
+
+#define MESH_ARENA_VERTEX_BLOCK_BYTES (32 * 1024 * 1024)
+#define MESH_ARENA_INDEX_BLOCK_BYTES (16 * 1024 * 1024)
+
+// Free ranges of a buffer, in elements
+class RangeAllocator
+{
+public:
+	void Reset(GLuint capacity)
+	{
+		this->capacity = capacity;
+		this->used = 0;
+		this->ranges.clear();
+		if (capacity > 0)
+		{
+			this->ranges[0] = capacity;
+		}
+	}
+
+	// First fit. Returns false if no free range is large enough.
+	bool Allocate(GLuint count, GLuint &offset)
+	{
+		for (map<GLuint, GLuint>::iterator it = this->ranges.begin(); it != this->ranges.end(); ++it)
+		{
+			if (it->second < count)
+			{
+				continue;
+			}
+			offset = it->first;
+			GLuint remaining = it->second - count;
+			this->ranges.erase(it);
+			if (remaining > 0)
+			{
+				this->ranges[offset + count] = remaining;
+			}
+			this->used += count;
+			return true;
+		}
+		return false;
+	}
+
+	bool Fits(GLuint count) const
+	{
+		return count == 0 || this->LargestFree() >= count;
+	}
+
+	void Free(GLuint offset, GLuint count)
+	{
+		if (count == 0)
+		{
+			return;
+		}
+		this->used -= count;
+
+		// Merge with the free ranges right after and right before it
+		map<GLuint, GLuint>::iterator next = this->ranges.lower_bound(offset);
+		if (next != this->ranges.end() && next->first == offset + count)
+		{
+			count += next->second;
+			next = this->ranges.erase(next);
+		}
+		if (next != this->ranges.begin())
+		{
+			map<GLuint, GLuint>::iterator previous = next;
+			--previous;
+			if (previous->first + previous->second == offset)
+			{
+				previous->second += count;
+				return;
+			}
+		}
+		this->ranges[offset] = count;
+	}
+
+	GLuint Capacity() const { return this->capacity; }
+	GLuint Used() const { return this->used; }
+	size_t NumFreeRanges() const { return this->ranges.size(); }
+
+	GLuint LargestFree() const
+	{
+		GLuint largest = 0;
+		for (map<GLuint, GLuint>::const_iterator it = this->ranges.begin(); it != this->ranges.end(); ++it)
+		{
+			largest = max(largest, it->second);
+		}
+		return largest;
+	}
+
+private:
+	GLuint capacity = 0;
+	GLuint used = 0;
+	map<GLuint, GLuint> ranges; // Offset -> size
+};
+
+// A vertex layout: the size of a vertex and the attribute pointers that describe it, set with the block's VAO and
+// vertex buffer bound
+struct VertexLayout
+{
+	GLuint id;
+	const char *name;
+	GLsizei stride;
+	void (*describe)();
+};
+
+// The ranges a model got. block is -1 while it has none.
+struct MeshAllocation
+{
+	int block = -1;
+	GLuint firstVertex = 0, numVertices = 0;
+	GLuint firstIndex = 0, numIndices = 0;
+};
+
+// Occupancy of the blocks of one layout
+struct MeshArenaStats
+{
+	GLuint blocks = 0;
+	size_t reservedBytes = 0;
+	size_t usedBytes = 0;
+	size_t freeRanges = 0;
+	size_t largestFreeBytes = 0;  // Of the vertex buffers, where the large allocations are
+	size_t freeVertexBytes = 0;
+
+	// Share of the free vertex space that the largest hole can't use: 0 when all of it is one range
+	double Fragmentation() const
+	{
+		return this->freeVertexBytes == 0 ? 0.0 : 1.0 - (double)this->largestFreeBytes / this->freeVertexBytes;
+	}
+};
+
+class MeshArena
+{
+public:
+	static MeshArena &Get()
+	{
+		static MeshArena arena;
+		return arena;
+	}
+
+	// Reserves numVertices and numIndices in a block of the layout, creating one if none has room
+	MeshAllocation Allocate(const VertexLayout &layout, GLuint numVertices, GLuint numIndices)
+	{
+		MeshAllocation allocation;
+		int block = -1;
+		for (size_t i = 0; i < this->blocks.size() && block < 0; i++)
+		{
+			if (this->blocks[i].VAO != 0 && this->blocks[i].layout == layout.id && this->blocks[i].vertices.Fits(numVertices) && this->blocks[i].indices.Fits(numIndices))
+			{
+				block = (int)i;
+			}
+		}
+		if (block < 0)
+		{
+			block = this->createBlock(layout, numVertices, numIndices);
+		}
+
+		Block &target = this->blocks[block];
+		if (numVertices > 0)
+		{
+			target.vertices.Allocate(numVertices, allocation.firstVertex);
+		}
+		if (numIndices > 0)
+		{
+			target.indices.Allocate(numIndices, allocation.firstIndex);
+		}
+		allocation.block = block;
+		allocation.numVertices = numVertices;
+		allocation.numIndices = numIndices;
+		return allocation;
+	}
+
+	// Gives the ranges back. Uploads still queued for them are dropped.
+	void Free(MeshAllocation &allocation)
+	{
+		if (allocation.block < 0 || (size_t)allocation.block >= this->blocks.size() || this->blocks[allocation.block].VAO == 0)
+		{
+			return;
+		}
+
+		Block &block = this->blocks[allocation.block];
+		UploadQueue::Get().CancelRange(block.VBO, (size_t)allocation.firstVertex * block.stride, (size_t)allocation.numVertices * block.stride);
+		UploadQueue::Get().CancelRange(block.EBO, (size_t)allocation.firstIndex * sizeof(GLuint), (size_t)allocation.numIndices * sizeof(GLuint));
+		block.vertices.Free(allocation.firstVertex, allocation.numVertices);
+		block.indices.Free(allocation.firstIndex, allocation.numIndices);
+
+		if (block.vertices.Used() == 0 && block.indices.Used() == 0 && this->numBlocks(block.layout) > 1)
+		{
+			this->deleteBlock(block);
+		}
+		allocation = MeshAllocation();
+	}
+
+	GLuint VAO(const MeshAllocation &allocation) const { return this->blocks[allocation.block].VAO; }
+	GLuint VBO(const MeshAllocation &allocation) const { return this->blocks[allocation.block].VBO; }
+	GLuint EBO(const MeshAllocation &allocation) const { return this->blocks[allocation.block].EBO; }
+
+	MeshArenaStats Stats(GLuint layout) const
+	{
+		MeshArenaStats stats;
+		for (size_t i = 0; i < this->blocks.size(); i++)
+		{
+			const Block &block = this->blocks[i];
+			if (block.VAO == 0 || block.layout != layout)
+			{
+				continue;
+			}
+			stats.blocks++;
+			stats.reservedBytes += (size_t)block.vertices.Capacity() * block.stride + (size_t)block.indices.Capacity() * sizeof(GLuint);
+			stats.usedBytes += (size_t)block.vertices.Used() * block.stride + (size_t)block.indices.Used() * sizeof(GLuint);
+			stats.freeRanges += block.vertices.NumFreeRanges() + block.indices.NumFreeRanges();
+			stats.largestFreeBytes = max(stats.largestFreeBytes, (size_t)block.vertices.LargestFree() * block.stride);
+			stats.freeVertexBytes += (size_t)(block.vertices.Capacity() - block.vertices.Used()) * block.stride;
+		}
+		return stats;
+	}
+
+	void PrintSummary() const
+	{
+		cout << "Arena de mallas:";
+		bool first = true;
+		for (size_t i = 0; i < this->layouts.size(); i++)
+		{
+			MeshArenaStats stats = this->Stats(this->layouts[i].id);
+			if (stats.blocks == 0)
+			{
+				continue;
+			}
+			cout << (first ? " " : " | ") << this->layouts[i].name << " " << stats.blocks << " bloques, " << stats.usedBytes / (1024.0 * 1024.0) << " de "
+				<< stats.reservedBytes / (1024.0 * 1024.0) << " MB usados (" << 100.0 * stats.usedBytes / stats.reservedBytes << "%), "
+				<< stats.freeRanges << " huecos, fragmentacion " << 100.0 * stats.Fragmentation() << "%";
+			first = false;
+		}
+		cout << (first ? " vacia" : "") << endl;
+	}
+
+private:
+	struct Block
+	{
+		GLuint VAO = 0, VBO = 0, EBO = 0;
+		GLuint layout = 0;
+		GLsizei stride = 0;
+		RangeAllocator vertices;
+		RangeAllocator indices;
+	};
+
+	vector<Block> blocks; // Deleted blocks keep their slot (with VAO 0) so the block numbers of allocations stay valid
+	vector<VertexLayout> layouts;
+
+	GLuint numBlocks(GLuint layout) const
+	{
+		GLuint count = 0;
+		for (size_t i = 0; i < this->blocks.size(); i++)
+		{
+			count += this->blocks[i].VAO != 0 && this->blocks[i].layout == layout ? 1 : 0;
+		}
+		return count;
+	}
+
+	int createBlock(const VertexLayout &layout, GLuint numVertices, GLuint numIndices)
+	{
+		bool known = false;
+		for (size_t i = 0; i < this->layouts.size(); i++)
+		{
+			known = known || this->layouts[i].id == layout.id;
+		}
+		if (!known)
+		{
+			this->layouts.push_back(layout);
+		}
+
+		size_t slot = 0;
+		while (slot < this->blocks.size() && this->blocks[slot].VAO != 0)
+		{
+			slot++;
+		}
+		if (slot == this->blocks.size())
+		{
+			this->blocks.push_back(Block());
+		}
+
+		Block &block = this->blocks[slot];
+		block.layout = layout.id;
+		block.stride = layout.stride;
+		block.vertices.Reset(max(numVertices, (GLuint)(MESH_ARENA_VERTEX_BLOCK_BYTES / layout.stride)));
+		block.indices.Reset(max(numIndices, (GLuint)(MESH_ARENA_INDEX_BLOCK_BYTES / sizeof(GLuint))));
+
+		glGenVertexArrays(1, &block.VAO);
+		glGenBuffers(1, &block.VBO);
+		glGenBuffers(1, &block.EBO);
+
+		glBindVertexArray(block.VAO);
+		glBindBuffer(GL_ARRAY_BUFFER, block.VBO);
+		glBufferData(GL_ARRAY_BUFFER, (size_t)block.vertices.Capacity() * block.stride, NULL, GL_STATIC_DRAW);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, block.EBO);
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, (size_t)block.indices.Capacity() * sizeof(GLuint), NULL, GL_STATIC_DRAW);
+		layout.describe();
+		glBindVertexArray(0);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+		return (int)slot;
+	}
+
+	void deleteBlock(Block &block)
+	{
+		UploadQueue::Get().Cancel(block.VBO, false);
+		UploadQueue::Get().Cancel(block.EBO, false);
+		glDeleteVertexArrays(1, &block.VAO);
+		glDeleteBuffers(1, &block.VBO);
+		glDeleteBuffers(1, &block.EBO);
+		block = Block();
+	}
+};
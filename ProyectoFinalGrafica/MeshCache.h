@@ -0,0 +1,397 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstring>
+#include <cstdint>
+#include <iostream>
+
+#include "MappedFile.h"
+#include "AssetPack.h"
+#include "Mesh.h"
+
+using namespace std;
+
+/*
+	Processed-mesh cache.
+
+	Every model loaded through Assimp is written to Cache/Meshes/ in the exact layout the GPU consumes, so the next
+	launch can map the file and hand the vertex/index blobs straight to glBufferData. A cache file is only used when
+	the source path, size and modification time recorded in it still match the .obj on disk and the format version
+	and Vertex size are the ones this build expects; otherwise the model falls back to Assimp and the cache is rewritten.
+
+	File layout (native endianness, every blob 16-byte aligned):
+		MeshCacheHeader
+		MeshCacheEntry[numMeshes] (with the index range of every level of detail)
+		MeshCacheTexture[numTextures]
+		string table (source path, texture types and paths, NUL terminated)
+		per mesh: Vertex[numVertices], GLuint[numIndices]
+*/
+
+#define MESH_CACHE_VERSION 3 // 2: meshes are welded and reordered by MeshOptimizer, 3: levels of detail
+#define MESH_CACHE_DIRECTORY "Cache/Meshes"
+
+struct MeshCacheHeader
+{
+	char magic[4];
+	uint32_t version;
+	uint32_t vertexSize;
+	uint32_t numMeshes;
+	uint32_t numTextures;
+	uint32_t sourcePathOffset;
+	uint64_t sourceSize;
+	int64_t sourceMtime;
+	uint64_t stringsOffset;
+	uint64_t stringsSize;
+	double importMs; // Time the cold load through Assimp took, used to report the time saved on warm starts
+};
+
+struct MeshCacheEntry
+{
+	uint64_t vertexOffset;
+	uint64_t indexOffset;
+	uint32_t numVertices;
+	uint32_t numIndices;
+	uint32_t firstTexture;
+	uint32_t numTextures;
+	uint32_t numLods;
+	uint32_t reserved;
+	MeshLod lods[MESH_MAX_LODS]; // Ranges of the index blob, relative to its start
+};
+
+struct MeshCacheTexture
+{
+	uint32_t typeOffset;
+	uint32_t pathOffset;
+};
+
+// Accumulated over the whole startup so main() can print a single summary line.
+struct MeshCacheStats
+{
+	int hits;
+	int misses;
+	int cooked;        // Hits that came from a zoo-cook file instead of Cache/Meshes
+	double warmMs;     // Time spent loading models from the cache
+	double coldMsSaved; // Assimp time recorded for those same models on their cold start
+	double missMs;     // Time spent loading models through Assimp
+
+	MeshCacheStats() : hits(0), misses(0), cooked(0), warmMs(0.0), coldMsSaved(0.0), missMs(0.0) {}
+};
+
+class MeshCache
+{
+public:
+	static MeshCacheStats &Stats()
+	{
+		static MeshCacheStats stats;
+		return stats;
+	}
+
+	// Cache file that belongs to a source model, e.g. Models/loto/loto.obj -> Cache/Meshes/Models_loto_loto.obj.zmc
+	static string CachePath(const string &sourcePath)
+	{
+		string name = sourcePath;
+		for (size_t i = 0; i < name.size(); i++)
+		{
+			if (name[i] == '/' || name[i] == '\\' || name[i] == ':')
+			{
+				name[i] = '_';
+			}
+		}
+		return string(MESH_CACHE_DIRECTORY) + "/" + name + ".zmc";
+	}
+
+	// Maps the cache file of sourcePath. Returns false (and leaves the object closed) if it is missing or stale.
+	bool Open(const string &sourcePath)
+	{
+		this->Close();
+
+		FileStamp stamp;
+		if (!GetAssetStamp(sourcePath, stamp))
+		{
+			return false;
+		}
+		return this->open(CachePath(sourcePath), sourcePath, &stamp);
+	}
+
+	// Maps a mesh file written by zoo-cook. The manifest has already matched it to the source, so its stamp isn't checked.
+	bool OpenCooked(const string &cookedPath, const string &sourcePath)
+	{
+		this->Close();
+		return this->open(cookedPath, sourcePath, nullptr);
+	}
+
+	void Close()
+	{
+		this->file.Close();
+		this->header = nullptr;
+		this->entries = nullptr;
+		this->textures = nullptr;
+		this->strings = nullptr;
+	}
+
+	GLuint NumMeshes() const
+	{
+		return this->header->numMeshes;
+	}
+
+	const MeshCacheEntry &Entry(GLuint mesh) const
+	{
+		return this->entries[mesh];
+	}
+
+	const Vertex *Vertices(GLuint mesh) const
+	{
+		return (const Vertex *)(this->file.Data() + this->entries[mesh].vertexOffset);
+	}
+
+	const GLuint *Indices(GLuint mesh) const
+	{
+		return (const GLuint *)(this->file.Data() + this->entries[mesh].indexOffset);
+	}
+
+	const char *TextureType(GLuint texture) const
+	{
+		return this->String(this->textures[texture].typeOffset);
+	}
+
+	const char *TexturePath(GLuint texture) const
+	{
+		return this->String(this->textures[texture].pathOffset);
+	}
+
+	double ImportMs() const
+	{
+		return this->header->importMs;
+	}
+
+	size_t FileSize() const
+	{
+		return this->file.Size();
+	}
+
+	// Writes the processed meshes of sourcePath. importMs is the cold load time, reported back on later warm starts.
+	static bool Write(const string &sourcePath, const vector<MeshData> &meshes, double importMs)
+	{
+		MakeDirectories(MESH_CACHE_DIRECTORY);
+		return WriteFile(CachePath(sourcePath), sourcePath, meshes, importMs);
+	}
+
+	// Same layout at any path (zoo-cook writes its meshes with it)
+	static bool WriteFile(const string &path, const string &sourcePath, const vector<MeshData> &meshes, double importMs)
+	{
+		FileStamp stamp;
+		if (!GetAssetStamp(sourcePath, stamp))
+		{
+			return false;
+		}
+
+		// String table: source path first, then the type and path of every texture
+		string strings;
+		vector<MeshCacheEntry> entries(meshes.size());
+		vector<MeshCacheTexture> textures;
+
+		uint32_t sourcePathOffset = AddString(strings, sourcePath);
+		for (size_t i = 0; i < meshes.size(); i++)
+		{
+			entries[i].numVertices = meshes[i].numVertices;
+			entries[i].numIndices = meshes[i].numIndices;
+			entries[i].firstTexture = (uint32_t)textures.size();
+			entries[i].numTextures = (uint32_t)meshes[i].textures.size();
+			entries[i].numLods = meshes[i].numLods;
+			entries[i].reserved = 0;
+			memcpy(entries[i].lods, meshes[i].lods, sizeof(entries[i].lods));
+
+			for (size_t j = 0; j < meshes[i].textures.size(); j++)
+			{
+				MeshCacheTexture texture;
+				texture.typeOffset = AddString(strings, meshes[i].textures[j].type);
+				texture.pathOffset = AddString(strings, meshes[i].textures[j].path);
+				textures.push_back(texture);
+			}
+		}
+
+		MeshCacheHeader header;
+		memset(&header, 0, sizeof(header));
+		memcpy(header.magic, "ZMSH", 4);
+		header.version = MESH_CACHE_VERSION;
+		header.vertexSize = sizeof(Vertex);
+		header.numMeshes = (uint32_t)meshes.size();
+		header.numTextures = (uint32_t)textures.size();
+		header.sourcePathOffset = sourcePathOffset;
+		header.sourceSize = stamp.size;
+		header.sourceMtime = stamp.mtime;
+		header.stringsOffset = sizeof(MeshCacheHeader) + entries.size() * sizeof(MeshCacheEntry) + textures.size() * sizeof(MeshCacheTexture);
+		header.stringsSize = strings.size();
+		header.importMs = importMs;
+
+		// Place every blob on a 16-byte boundary so the mapped pointers are suitably aligned for Vertex/GLuint
+		uint64_t offset = Align(header.stringsOffset + header.stringsSize);
+		for (size_t i = 0; i < meshes.size(); i++)
+		{
+			entries[i].vertexOffset = offset;
+			offset = Align(offset + entries[i].numVertices * sizeof(Vertex));
+			entries[i].indexOffset = offset;
+			offset = Align(offset + entries[i].numIndices * sizeof(GLuint));
+		}
+
+		// Write to a temporary file first so an interrupted run never leaves a truncated cache behind
+		string temporaryPath = path + ".tmp";
+		FILE *out = fopen(temporaryPath.c_str(), "wb");
+		if (!out)
+		{
+			cout << "ERROR::MESH_CACHE::CANNOT_WRITE " << temporaryPath << endl;
+			return false;
+		}
+
+		bool ok = fwrite(&header, sizeof(header), 1, out) == 1;
+		ok = ok && (entries.empty() || fwrite(&entries[0], sizeof(MeshCacheEntry), entries.size(), out) == entries.size());
+		ok = ok && (textures.empty() || fwrite(&textures[0], sizeof(MeshCacheTexture), textures.size(), out) == textures.size());
+		ok = ok && (strings.empty() || fwrite(strings.data(), 1, strings.size(), out) == strings.size());
+
+		for (size_t i = 0; ok && i < meshes.size(); i++)
+		{
+			ok = Pad(out, entries[i].vertexOffset);
+			ok = ok && (meshes[i].numVertices == 0 || fwrite(meshes[i].vertexData, sizeof(Vertex), meshes[i].numVertices, out) == meshes[i].numVertices);
+			ok = ok && Pad(out, entries[i].indexOffset);
+			ok = ok && (meshes[i].numIndices == 0 || fwrite(meshes[i].indexData, sizeof(GLuint), meshes[i].numIndices, out) == meshes[i].numIndices);
+		}
+		ok = ok && Pad(out, offset);
+		ok = (fclose(out) == 0) && ok;
+
+		if (!ok)
+		{
+			cout << "ERROR::MESH_CACHE::CANNOT_WRITE " << temporaryPath << endl;
+			remove(temporaryPath.c_str());
+			return false;
+		}
+
+		remove(path.c_str());
+		return rename(temporaryPath.c_str(), path.c_str()) == 0;
+	}
+
+	// Prints the startup summary: how many models came from the cache and how much Assimp time that avoided.
+	static void PrintSummary()
+	{
+		const MeshCacheStats &stats = Stats();
+		cout << "Cache de mallas: " << stats.hits << " aciertos (" << stats.cooked << " cocinados), " << stats.misses << " fallos";
+		if (stats.hits > 0)
+		{
+			cout << " | cache " << stats.warmMs << " ms (Assimp: " << stats.coldMsSaved << " ms) | ahorro "
+				<< (stats.coldMsSaved - stats.warmMs) << " ms";
+		}
+		if (stats.misses > 0)
+		{
+			cout << " | Assimp " << stats.missMs << " ms";
+		}
+		cout << endl;
+	}
+
+private:
+	MappedFile file;
+	const MeshCacheHeader *header = nullptr;
+	const MeshCacheEntry *entries = nullptr;
+	const MeshCacheTexture *textures = nullptr;
+	const char *strings = nullptr;
+
+	// Maps path and validates it against the source. stamp is null for cooked files.
+	bool open(const string &path, const string &sourcePath, const FileStamp *stamp)
+	{
+		if (!this->file.Open(path))
+		{
+			return false;
+		}
+
+		const unsigned char *base = this->file.Data();
+		size_t size = this->file.Size();
+
+		if (size < sizeof(MeshCacheHeader))
+		{
+			this->Close();
+			return false;
+		}
+
+		this->header = (const MeshCacheHeader *)base;
+		if (memcmp(this->header->magic, "ZMSH", 4) != 0 || this->header->version != MESH_CACHE_VERSION ||
+			this->header->vertexSize != sizeof(Vertex) || this->header->stringsOffset + this->header->stringsSize > size ||
+			(stamp && (this->header->sourceSize != stamp->size || this->header->sourceMtime != stamp->mtime)))
+		{
+			this->Close();
+			return false;
+		}
+
+		size_t tablesEnd = sizeof(MeshCacheHeader) + this->header->numMeshes * sizeof(MeshCacheEntry) +
+			this->header->numTextures * sizeof(MeshCacheTexture);
+		if (tablesEnd > this->header->stringsOffset)
+		{
+			this->Close();
+			return false;
+		}
+
+		this->entries = (const MeshCacheEntry *)(base + sizeof(MeshCacheHeader));
+		this->textures = (const MeshCacheTexture *)(this->entries + this->header->numMeshes);
+		this->strings = (const char *)(base + this->header->stringsOffset);
+
+		// Two different sources can never share a cache file name, but a renamed Models/ folder could point at an old one
+		if (this->header->sourcePathOffset >= this->header->stringsSize || sourcePath != this->String(this->header->sourcePathOffset))
+		{
+			this->Close();
+			return false;
+		}
+
+		for (GLuint i = 0; i < this->header->numMeshes; i++)
+		{
+			const MeshCacheEntry &entry = this->entries[i];
+			if (entry.vertexOffset + (uint64_t)entry.numVertices * sizeof(Vertex) > size ||
+				entry.indexOffset + (uint64_t)entry.numIndices * sizeof(GLuint) > size ||
+				entry.firstTexture + entry.numTextures > this->header->numTextures ||
+				entry.numLods == 0 || entry.numLods > MESH_MAX_LODS)
+			{
+				this->Close();
+				return false;
+			}
+			for (GLuint j = 0; j < entry.numLods; j++)
+			{
+				if ((uint64_t)entry.lods[j].firstIndex + entry.lods[j].numIndices > entry.numIndices)
+				{
+					this->Close();
+					return false;
+				}
+			}
+		}
+
+		return true;
+	}
+
+	const char *String(uint32_t offset) const
+	{
+		return this->strings + offset;
+	}
+
+	static uint32_t AddString(string &strings, const string &value)
+	{
+		uint32_t offset = (uint32_t)strings.size();
+		strings.append(value);
+		strings.push_back('\0');
+		return offset;
+	}
+
+	static uint64_t Align(uint64_t offset)
+	{
+		return (offset + 15) & ~(uint64_t)15;
+	}
+
+	// Zero-fills the file up to the given offset
+	static bool Pad(FILE *out, uint64_t offset)
+	{
+		static const char zeros[16] = { 0 };
+		long position = ftell(out);
+		if (position < 0 || (uint64_t)position > offset)
+		{
+			return false;
+		}
+		size_t count = (size_t)(offset - (uint64_t)position);
+		return count == 0 || fwrite(zeros, 1, count, out) == count;
+	}
+};
@@ -0,0 +1,424 @@
+#pragma once
+
+#include <cmath>
+#include <string>
+#include <vector>
+#include <cstring>
+#include <sstream>
+#include <algorithm>
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include "Mesh.h"
+#include "MappedFile.h"
+
+using namespace std;
+
+/*
+	Mesh optimization stage, run once per mesh at import time (the result is what ends up in the mesh cache).
+
+	1. Welding: OBJ files give every face corner its own vertex, so identical vertices are merged and the indices
+	   remapped to the unique ones.
+	2. Vertex cache: triangles are reordered with Tom Forsyth's linear-speed algorithm so vertices are reused while
+	   they are still in the post-transform cache.
+	3. Overdraw: the cache-friendly order is cut into clusters wherever the cache starts cold, and the clusters are
+	   sorted so the ones facing outwards are drawn first and occlude the rest. Triangles keep their order inside
+	   a cluster, so the cache efficiency is kept.
+	4. Vertex fetch: vertices are renumbered in the order the indices first use them, so the vertex buffer is read
+	   front to back.
+
+	The efficiency is measured with a FIFO cache simulation:
+		ACMR (average cache miss ratio) = transformed vertices / triangles  (0.5 is ideal, 3 is the worst)
+		ATVR (average transformed vertex ratio) = transformed vertices / vertices  (1 is ideal)
+*/
+
+#define MESH_OPTIMIZER_CACHE_SIZE 32
+
+// Accumulated over all the meshes of a model
+struct MeshOptimizerStats
+{
+	size_t verticesBefore = 0;
+	size_t verticesAfter = 0;
+	size_t triangles = 0;
+	size_t missesBefore = 0; // Transformed vertices in the FIFO simulation before the optimization
+	size_t missesAfter = 0;
+
+	double AcmrBefore() const { return this->triangles ? (double)this->missesBefore / this->triangles : 0.0; }
+	double AcmrAfter() const { return this->triangles ? (double)this->missesAfter / this->triangles : 0.0; }
+	double AtvrBefore() const { return this->verticesBefore ? (double)this->missesBefore / this->verticesBefore : 0.0; }
+	double AtvrAfter() const { return this->verticesAfter ? (double)this->missesAfter / this->verticesAfter : 0.0; }
+
+	// One line for the console, e.g. "Models/oasis/oasis.obj: vertices 90000 -> 16000 | ACMR 3.00 -> 0.68 | ATVR 1.00 -> 1.21"
+	string Report(const string &name) const
+	{
+		stringstream ss;
+		ss.setf(ios::fixed);
+		ss.precision(2);
+		ss << "Optimizacion " << name << ": vertices " << this->verticesBefore << " -> " << this->verticesAfter
+			<< " | ACMR " << this->AcmrBefore() << " -> " << this->AcmrAfter()
+			<< " | ATVR " << this->AtvrBefore() << " -> " << this->AtvrAfter();
+		return ss.str();
+	}
+};
+
+class MeshOptimizer
+{
+public:
+	// Runs the whole stage on a mesh that owns its geometry (MeshData::vertices/indices)
+	static void Optimize(MeshData &mesh, MeshOptimizerStats &stats)
+	{
+		vector<Vertex> &vertices = mesh.vertices;
+		vector<GLuint> &indices = mesh.indices;
+
+		stats.verticesBefore += vertices.size();
+		stats.triangles += indices.size() / 3;
+		stats.missesBefore += CacheMisses(indices, vertices.size());
+
+		WeldVertices(vertices, indices);
+		OptimizeVertexCache(indices, vertices.size());
+		OptimizeOverdraw(indices, vertices);
+		OptimizeVertexFetch(vertices, indices);
+
+		stats.verticesAfter += vertices.size();
+		stats.missesAfter += CacheMisses(indices, vertices.size());
+
+		mesh.UseOwnedGeometry();
+	}
+
+	// Number of vertices a FIFO post-transform cache of MESH_OPTIMIZER_CACHE_SIZE entries has to transform
+	static size_t CacheMisses(const vector<GLuint> &indices, size_t numVertices)
+	{
+		vector<GLuint> timestamp(numVertices, 0);
+		GLuint time = MESH_OPTIMIZER_CACHE_SIZE + 1;
+		size_t misses = 0;
+
+		for (size_t i = 0; i < indices.size(); i++)
+		{
+			GLuint v = indices[i];
+			if (time - timestamp[v] > MESH_OPTIMIZER_CACHE_SIZE)
+			{
+				timestamp[v] = time++;
+				misses++;
+			}
+		}
+		return misses;
+	}
+
+	// Merges vertices whose position, normal and texture coordinates are exactly the same
+	static void WeldVertices(vector<Vertex> &vertices, vector<GLuint> &indices)
+	{
+		const GLuint empty = 0xFFFFFFFF;
+
+		// Open addressing table from vertex contents to its index in welded
+		size_t tableSize = 1;
+		while (tableSize < vertices.size() * 2)
+		{
+			tableSize <<= 1;
+		}
+		vector<GLuint> table(tableSize, empty);
+		vector<GLuint> remap(vertices.size());
+		vector<Vertex> welded;
+		welded.reserve(vertices.size());
+
+		for (size_t i = 0; i < vertices.size(); i++)
+		{
+			size_t slot = (size_t)HashBytes((const unsigned char *)&vertices[i], sizeof(Vertex)) & (tableSize - 1);
+			while (table[slot] != empty && memcmp(&welded[table[slot]], &vertices[i], sizeof(Vertex)) != 0)
+			{
+				slot = (slot + 1) & (tableSize - 1);
+			}
+			if (table[slot] == empty)
+			{
+				table[slot] = (GLuint)welded.size();
+				welded.push_back(vertices[i]);
+			}
+			remap[i] = table[slot];
+		}
+
+		for (size_t i = 0; i < indices.size(); i++)
+		{
+			indices[i] = remap[indices[i]];
+		}
+		vertices.swap(welded);
+	}
+
+	// Reorders the triangles for the post-transform vertex cache (Forsyth, "Linear-Speed Vertex Cache Optimisation")
+	static void OptimizeVertexCache(vector<GLuint> &indices, size_t numVertices)
+	{
+		const GLuint none = 0xFFFFFFFF;
+		size_t numTriangles = indices.size() / 3;
+		if (numTriangles == 0)
+		{
+			return;
+		}
+
+		// Triangles that still have to be emitted, per vertex
+		vector<GLuint> activeTriangles(numVertices, 0);
+		for (size_t i = 0; i < numTriangles * 3; i++)
+		{
+			activeTriangles[indices[i]]++;
+		}
+		vector<GLuint> adjacencyOffset(numVertices + 1, 0);
+		for (size_t v = 0; v < numVertices; v++)
+		{
+			adjacencyOffset[v + 1] = adjacencyOffset[v] + activeTriangles[v];
+		}
+		vector<GLuint> adjacency(numTriangles * 3);
+		vector<GLuint> fill(adjacencyOffset.begin(), adjacencyOffset.end() - 1);
+		for (size_t t = 0; t < numTriangles; t++)
+		{
+			for (int k = 0; k < 3; k++)
+			{
+				adjacency[fill[indices[t * 3 + k]]++] = (GLuint)t;
+			}
+		}
+
+		vector<int> cachePosition(numVertices, -1);
+		vector<float> vertexScore(numVertices);
+		for (size_t v = 0; v < numVertices; v++)
+		{
+			vertexScore[v] = VertexScore(-1, activeTriangles[v]);
+		}
+
+		vector<float> triangleScore(numTriangles);
+		vector<char> emitted(numTriangles, 0);
+		GLuint best = 0;
+		for (size_t t = 0; t < numTriangles; t++)
+		{
+			triangleScore[t] = vertexScore[indices[t * 3]] + vertexScore[indices[t * 3 + 1]] + vertexScore[indices[t * 3 + 2]];
+			if (triangleScore[t] > triangleScore[best])
+			{
+				best = (GLuint)t;
+			}
+		}
+
+		vector<GLuint> cache, newCache;
+		cache.reserve(MESH_OPTIMIZER_CACHE_SIZE + 3);
+		newCache.reserve(MESH_OPTIMIZER_CACHE_SIZE + 3);
+		vector<GLuint> result;
+		result.reserve(numTriangles * 3);
+		size_t cursor = 0; // Every triangle before it has been emitted
+
+		for (size_t n = 0; n < numTriangles; n++)
+		{
+			// Nothing in the cache touches a pending triangle: continue with the first one left
+			if (best == none)
+			{
+				while (emitted[cursor])
+				{
+					cursor++;
+				}
+				best = (GLuint)cursor;
+			}
+
+			emitted[best] = 1;
+			newCache.clear();
+			for (int k = 0; k < 3; k++)
+			{
+				GLuint v = indices[best * 3 + k];
+				result.push_back(v);
+
+				// Remove the triangle from the pending ones of the vertex
+				GLuint *triangles = &adjacency[adjacencyOffset[v]];
+				for (GLuint j = 0; j < activeTriangles[v]; j++)
+				{
+					if (triangles[j] == best)
+					{
+						triangles[j] = triangles[activeTriangles[v] - 1];
+						activeTriangles[v]--;
+						break;
+					}
+				}
+
+				if (find(newCache.begin(), newCache.end(), v) == newCache.end())
+				{
+					newCache.push_back(v);
+				}
+			}
+			for (size_t i = 0; i < cache.size(); i++)
+			{
+				if (find(newCache.begin(), newCache.end(), cache[i]) == newCache.end())
+				{
+					newCache.push_back(cache[i]);
+				}
+			}
+
+			// Rescore every vertex whose cache position changed (including the ones pushed out) and their triangles
+			for (size_t i = 0; i < newCache.size(); i++)
+			{
+				GLuint v = newCache[i];
+				cachePosition[v] = i < MESH_OPTIMIZER_CACHE_SIZE ? (int)i : -1;
+
+				float score = VertexScore(cachePosition[v], activeTriangles[v]);
+				float delta = score - vertexScore[v];
+				vertexScore[v] = score;
+
+				const GLuint *triangles = &adjacency[adjacencyOffset[v]];
+				for (GLuint j = 0; j < activeTriangles[v]; j++)
+				{
+					triangleScore[triangles[j]] += delta;
+				}
+			}
+			if (newCache.size() > MESH_OPTIMIZER_CACHE_SIZE)
+			{
+				newCache.resize(MESH_OPTIMIZER_CACHE_SIZE);
+			}
+			cache.swap(newCache);
+
+			// The next triangle is the best one among those that use a cached vertex
+			best = none;
+			float bestScore = -1.0f;
+			for (size_t i = 0; i < cache.size(); i++)
+			{
+				GLuint v = cache[i];
+				const GLuint *triangles = &adjacency[adjacencyOffset[v]];
+				for (GLuint j = 0; j < activeTriangles[v]; j++)
+				{
+					if (triangleScore[triangles[j]] > bestScore)
+					{
+						bestScore = triangleScore[triangles[j]];
+						best = triangles[j];
+					}
+				}
+			}
+		}
+
+		// Any trailing indices that don't form a triangle are dropped, as they were never drawn
+		indices.swap(result);
+	}
+
+	// Sorts cache-friendly clusters of triangles so the outward facing ones are drawn first
+	static void OptimizeOverdraw(vector<GLuint> &indices, const vector<Vertex> &vertices)
+	{
+		size_t numTriangles = indices.size() / 3;
+		if (numTriangles < 2)
+		{
+			return;
+		}
+
+		// A new cluster starts where a triangle misses the cache with all three vertices, so cutting there costs nothing
+		vector<size_t> clusterStart;
+		vector<GLuint> timestamp(vertices.size(), 0);
+		GLuint time = MESH_OPTIMIZER_CACHE_SIZE + 1;
+		for (size_t t = 0; t < numTriangles; t++)
+		{
+			int misses = 0;
+			for (int k = 0; k < 3; k++)
+			{
+				GLuint v = indices[t * 3 + k];
+				if (time - timestamp[v] > MESH_OPTIMIZER_CACHE_SIZE)
+				{
+					timestamp[v] = time++;
+					misses++;
+				}
+			}
+			if (t == 0 || misses == 3)
+			{
+				clusterStart.push_back(t);
+			}
+		}
+		if (clusterStart.size() < 2)
+		{
+			return;
+		}
+		clusterStart.push_back(numTriangles);
+
+		// Centroid of the whole mesh, then centroid and area-weighted normal of every cluster
+		glm::vec3 meshCentroid(0.0f);
+		for (size_t t = 0; t < numTriangles; t++)
+		{
+			meshCentroid += TriangleCentroid(indices, vertices, t);
+		}
+		meshCentroid /= (float)numTriangles;
+
+		size_t numClusters = clusterStart.size() - 1;
+		vector<float> sortKey(numClusters);
+		for (size_t c = 0; c < numClusters; c++)
+		{
+			glm::vec3 centroid(0.0f), normal(0.0f);
+			for (size_t t = clusterStart[c]; t < clusterStart[c + 1]; t++)
+			{
+				const glm::vec3 &a = vertices[indices[t * 3]].Position;
+				const glm::vec3 &b = vertices[indices[t * 3 + 1]].Position;
+				const glm::vec3 &c2 = vertices[indices[t * 3 + 2]].Position;
+				centroid += TriangleCentroid(indices, vertices, t);
+				normal += glm::cross(b - a, c2 - a);
+			}
+			centroid /= (float)(clusterStart[c + 1] - clusterStart[c]);
+
+			float length = glm::length(normal);
+			sortKey[c] = length > 0.0f ? glm::dot(centroid - meshCentroid, normal / length) : 0.0f;
+		}
+
+		vector<size_t> order(numClusters);
+		for (size_t c = 0; c < numClusters; c++)
+		{
+			order[c] = c;
+		}
+		stable_sort(order.begin(), order.end(), [&sortKey](size_t a, size_t b) { return sortKey[a] > sortKey[b]; });
+
+		vector<GLuint> result;
+		result.reserve(numTriangles * 3);
+		for (size_t i = 0; i < numClusters; i++)
+		{
+			size_t c = order[i];
+			result.insert(result.end(), indices.begin() + clusterStart[c] * 3, indices.begin() + clusterStart[c + 1] * 3);
+		}
+		indices.swap(result);
+	}
+
+	// Renumbers the vertices in the order the indices first reference them. Unreferenced vertices are dropped.
+	static void OptimizeVertexFetch(vector<Vertex> &vertices, vector<GLuint> &indices)
+	{
+		const GLuint unused = 0xFFFFFFFF;
+		vector<GLuint> remap(vertices.size(), unused);
+		vector<Vertex> ordered;
+		ordered.reserve(vertices.size());
+
+		for (size_t i = 0; i < indices.size(); i++)
+		{
+			GLuint &index = indices[i];
+			if (remap[index] == unused)
+			{
+				remap[index] = (GLuint)ordered.size();
+				ordered.push_back(vertices[index]);
+			}
+			index = remap[index];
+		}
+		vertices.swap(ordered);
+	}
+
+private:
+	// Forsyth's vertex score: recently used vertices score higher (the last triangle's three a fixed 0.75),
+	// and vertices with few triangles left get a boost so they are finished off instead of left behind.
+	static float VertexScore(int cachePosition, GLuint activeTriangles)
+	{
+		if (activeTriangles == 0)
+		{
+			return -1.0f;
+		}
+
+		float score = 0.0f;
+		if (cachePosition >= 0)
+		{
+			if (cachePosition < 3)
+			{
+				score = 0.75f;
+			}
+			else
+			{
+				const float scaler = 1.0f / (MESH_OPTIMIZER_CACHE_SIZE - 3);
+				score = powf(1.0f - (cachePosition - 3) * scaler, 1.5f);
+			}
+		}
+
+		return score + 2.0f * powf((float)activeTriangles, -0.5f);
+	}
+
+	static glm::vec3 TriangleCentroid(const vector<GLuint> &indices, const vector<Vertex> &vertices, size_t triangle)
+	{
+		return (vertices[indices[triangle * 3]].Position + vertices[indices[triangle * 3 + 1]].Position +
+			vertices[indices[triangle * 3 + 2]].Position) / 3.0f;
+	}
+};
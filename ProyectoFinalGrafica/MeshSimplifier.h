@@ -0,0 +1,471 @@
+#pragma once
+
+#include <cmath>
+#include <string>
+#include <vector>
+#include <cstring>
+#include <cstdint>
+#include <sstream>
+#include <algorithm>
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include "Mesh.h"
+#include "MappedFile.h"
+#include "MeshOptimizer.h"
+
+using namespace std;
+
+/*
+	Level of detail generation, run at import time after MeshOptimizer (the levels end up in the mesh cache).
+
+	Every level is a coarser index buffer over the same vertices as the full mesh, so the levels of a mesh are just
+	more ranges of the model's index buffer and switching between them costs nothing. They are built with quadric
+	error metric edge collapses (Garland and Heckbert, "Surface Simplification Using Quadric Error Metrics"):
+		- every vertex accumulates the planes of its triangles, and the error of moving it is the sum of the
+		  squared distances to them;
+		- a vertex is collapsed onto one of its neighbours (half-edge collapse), so no new vertex is created;
+		- vertices on an open border, on a non-manifold edge or on a seam (same position, different normal or
+		  texture coordinates) are locked, so the silhouette and the texture mapping don't tear.
+	Collapses are applied in passes: the cheapest ones are taken as long as they don't share triangles with a
+	collapse of the same pass and don't flip any triangle.
+
+	Level i aims at MESH_SIMPLIFIER_RATIO^i of the triangles, and a level that can't remove enough of them
+	without exceeding its error limit is not kept.
+*/
+
+#define MESH_SIMPLIFIER_MIN_TRIANGLES 2000 // Smaller meshes only have the full level
+#define MESH_SIMPLIFIER_RATIO 0.5f         // Triangles kept by each level relative to the previous one
+#define MESH_SIMPLIFIER_MIN_REDUCTION 0.8f // A level with more than this fraction of the previous one is dropped
+
+// Accumulated over all the meshes of a model
+struct MeshSimplifierStats
+{
+	size_t triangles[MESH_MAX_LODS] = { 0 }; // Meshes with fewer levels count their last one for the rest
+	GLuint numLods = 1;                      // Most levels of any mesh
+
+	// One line for the console, e.g. "LOD Models/arbol/arbol.obj: triangulos 120000 | 60000 | 30000 | 15000"
+	string Report(const string &name) const
+	{
+		stringstream ss;
+		ss << "LOD " << name << ": triangulos";
+		for (GLuint i = 0; i < this->numLods; i++)
+		{
+			ss << (i == 0 ? " " : " | ") << this->triangles[i];
+		}
+		return ss.str();
+	}
+};
+
+class MeshSimplifier
+{
+public:
+	// Appends the coarser levels to the indices of a mesh that owns its geometry and fills its level table
+	static void GenerateLods(MeshData &mesh, MeshSimplifierStats &stats)
+	{
+		size_t fullIndices = mesh.indices.size() / 3 * 3;
+		mesh.indices.resize(fullIndices);
+		mesh.numLods = 1;
+		mesh.lods[0].firstIndex = 0;
+		mesh.lods[0].numIndices = (GLuint)fullIndices;
+
+		if (fullIndices / 3 >= MESH_SIMPLIFIER_MIN_TRIANGLES)
+		{
+			// Error limits are relative to the size of the mesh and double with every level
+			float radius = BoundingRadius(mesh.vertices);
+			float maxError = radius * 0.005f;
+
+			vector<GLuint> previous(mesh.indices.begin(), mesh.indices.end());
+			for (GLuint level = 1; level < MESH_MAX_LODS; level++, maxError *= 2.0f)
+			{
+				size_t target = (size_t)(previous.size() / 3 * MESH_SIMPLIFIER_RATIO) * 3;
+				vector<GLuint> simplified;
+				Simplify(mesh.vertices, previous, target, maxError, simplified);
+				if (simplified.empty() || simplified.size() > previous.size() * MESH_SIMPLIFIER_MIN_REDUCTION)
+				{
+					break;
+				}
+
+				MeshOptimizer::OptimizeVertexCache(simplified, mesh.vertices.size());
+
+				mesh.lods[level].firstIndex = (GLuint)mesh.indices.size();
+				mesh.lods[level].numIndices = (GLuint)simplified.size();
+				mesh.indices.insert(mesh.indices.end(), simplified.begin(), simplified.end());
+				mesh.numLods = level + 1;
+				previous.swap(simplified);
+			}
+		}
+
+		for (GLuint i = 0; i < MESH_MAX_LODS; i++)
+		{
+			stats.triangles[i] += mesh.lods[min(i, mesh.numLods - 1)].numIndices / 3;
+		}
+		stats.numLods = max(stats.numLods, mesh.numLods);
+
+		mesh.UseOwnedGeometry();
+	}
+
+	// Collapses edges until at most targetIndexCount indices are left or every remaining collapse would move the
+	// surface by more than maxError. result only references vertices that indices references.
+	static void Simplify(const vector<Vertex> &vertices, const vector<GLuint> &indices, size_t targetIndexCount, float maxError, vector<GLuint> &result)
+	{
+		result.assign(indices.begin(), indices.begin() + indices.size() / 3 * 3);
+
+		vector<char> locked;
+		LockedVertices(vertices, result, locked);
+
+		// Planes of the triangles around every vertex
+		vector<Quadric> quadrics(vertices.size());
+		for (size_t t = 0; t < result.size() / 3; t++)
+		{
+			Quadric plane;
+			if (TriangleQuadric(vertices, &result[t * 3], plane))
+			{
+				for (int k = 0; k < 3; k++)
+				{
+					quadrics[result[t * 3 + k]].Add(plane);
+				}
+			}
+		}
+
+		double maxCost = (double)maxError * maxError;
+		while (result.size() > targetIndexCount)
+		{
+			if (CollapsePass(vertices, locked, quadrics, maxCost, (result.size() - targetIndexCount) / 3, result) == 0)
+			{
+				break;
+			}
+		}
+	}
+
+private:
+	// Symmetric 4x4 matrix of the plane equations: a00 a01 a02 a03 a11 a12 a13 a22 a23 a33
+	struct Quadric
+	{
+		double m[10] = { 0 };
+
+		void Add(const Quadric &other)
+		{
+			for (int i = 0; i < 10; i++)
+			{
+				this->m[i] += other.m[i];
+			}
+		}
+
+		// Sum of the squared distances from p to the planes
+		double Error(const glm::vec3 &p) const
+		{
+			double x = p.x, y = p.y, z = p.z;
+			double error = this->m[0] * x * x + 2.0 * this->m[1] * x * y + 2.0 * this->m[2] * x * z + 2.0 * this->m[3] * x +
+				this->m[4] * y * y + 2.0 * this->m[5] * y * z + 2.0 * this->m[6] * y +
+				this->m[7] * z * z + 2.0 * this->m[8] * z + this->m[9];
+			return error > 0.0 ? error : 0.0;
+		}
+	};
+
+	struct Collapse
+	{
+		GLuint from;
+		GLuint to;
+		double cost;
+	};
+
+	static bool TriangleQuadric(const vector<Vertex> &vertices, const GLuint *triangle, Quadric &quadric)
+	{
+		const glm::vec3 &p0 = vertices[triangle[0]].Position;
+		glm::vec3 normal = glm::cross(vertices[triangle[1]].Position - p0, vertices[triangle[2]].Position - p0);
+		float length = glm::length(normal);
+		if (length == 0.0f)
+		{
+			return false;
+		}
+
+		double a = normal.x / length, b = normal.y / length, c = normal.z / length;
+		double d = -(a * p0.x + b * p0.y + c * p0.z);
+		double plane[4] = { a, b, c, d };
+		int n = 0;
+		for (int i = 0; i < 4; i++)
+		{
+			for (int j = i; j < 4; j++)
+			{
+				quadric.m[n++] = plane[i] * plane[j];
+			}
+		}
+		return true;
+	}
+
+	// Marks the vertices that must not move: seams, open borders and non-manifold edges
+	static void LockedVertices(const vector<Vertex> &vertices, const vector<GLuint> &indices, vector<char> &locked)
+	{
+		// Vertices at the same position share one id, so a seam looks like a single vertex to the topology
+		const GLuint empty = 0xFFFFFFFF;
+		size_t tableSize = 1;
+		while (tableSize < vertices.size() * 2)
+		{
+			tableSize <<= 1;
+		}
+		vector<GLuint> table(tableSize, empty);
+		vector<GLuint> positionId(vertices.size());
+		for (size_t i = 0; i < vertices.size(); i++)
+		{
+			const glm::vec3 &p = vertices[i].Position;
+			size_t slot = (size_t)HashBytes((const unsigned char *)&p, sizeof(glm::vec3)) & (tableSize - 1);
+			while (table[slot] != empty && memcmp(&vertices[table[slot]].Position, &p, sizeof(glm::vec3)) != 0)
+			{
+				slot = (slot + 1) & (tableSize - 1);
+			}
+			if (table[slot] == empty)
+			{
+				table[slot] = (GLuint)i;
+			}
+			positionId[i] = table[slot];
+		}
+
+		// A position used by more than one referenced vertex is a seam
+		vector<GLuint> firstVertex(vertices.size(), empty);
+		vector<char> lockedPosition(vertices.size(), 0);
+		for (size_t i = 0; i < indices.size(); i++)
+		{
+			GLuint v = indices[i];
+			GLuint &first = firstVertex[positionId[v]];
+			if (first == empty)
+			{
+				first = v;
+			}
+			else if (first != v)
+			{
+				lockedPosition[positionId[v]] = 1;
+			}
+		}
+
+		// Every edge of a closed manifold is shared by exactly two triangles
+		vector<uint64_t> edges;
+		edges.reserve(indices.size());
+		for (size_t t = 0; t < indices.size() / 3; t++)
+		{
+			for (int k = 0; k < 3; k++)
+			{
+				GLuint a = positionId[indices[t * 3 + k]];
+				GLuint b = positionId[indices[t * 3 + (k + 1) % 3]];
+				edges.push_back(a < b ? ((uint64_t)a << 32) | b : ((uint64_t)b << 32) | a);
+			}
+		}
+		sort(edges.begin(), edges.end());
+		for (size_t i = 0; i < edges.size();)
+		{
+			size_t j = i;
+			while (j < edges.size() && edges[j] == edges[i])
+			{
+				j++;
+			}
+			if (j - i != 2)
+			{
+				lockedPosition[(GLuint)(edges[i] >> 32)] = 1;
+				lockedPosition[(GLuint)(edges[i] & 0xFFFFFFFF)] = 1;
+			}
+			i = j;
+		}
+
+		locked.resize(vertices.size());
+		for (size_t i = 0; i < vertices.size(); i++)
+		{
+			locked[i] = lockedPosition[positionId[i]];
+		}
+	}
+
+	// One round of independent collapses. Returns the number of triangles removed.
+	static size_t CollapsePass(const vector<Vertex> &vertices, const vector<char> &locked, vector<Quadric> &quadrics,
+		double maxCost, size_t trianglesToRemove, vector<GLuint> &indices)
+	{
+		size_t numVertices = vertices.size();
+		size_t numTriangles = indices.size() / 3;
+
+		// Triangles around every vertex
+		vector<GLuint> adjacencyOffset(numVertices + 1, 0);
+		for (size_t i = 0; i < indices.size(); i++)
+		{
+			adjacencyOffset[indices[i] + 1]++;
+		}
+		for (size_t v = 0; v < numVertices; v++)
+		{
+			adjacencyOffset[v + 1] += adjacencyOffset[v];
+		}
+		vector<GLuint> adjacency(indices.size());
+		vector<GLuint> fill(adjacencyOffset.begin(), adjacencyOffset.end() - 1);
+		for (size_t t = 0; t < numTriangles; t++)
+		{
+			for (int k = 0; k < 3; k++)
+			{
+				adjacency[fill[indices[t * 3 + k]]++] = (GLuint)t;
+			}
+		}
+
+		// Both directions of every edge, taken once from the triangle where it goes from the lower to the higher index.
+		// Edges of an unlocked vertex are never on a border, so with a consistent winding they always have that triangle.
+		vector<Collapse> collapses;
+		collapses.reserve(indices.size());
+		for (size_t t = 0; t < numTriangles; t++)
+		{
+			for (int k = 0; k < 3; k++)
+			{
+				GLuint a = indices[t * 3 + k];
+				GLuint b = indices[t * 3 + (k + 1) % 3];
+				if (a >= b)
+				{
+					continue;
+				}
+				Quadric combined = quadrics[a];
+				combined.Add(quadrics[b]);
+				if (!locked[a])
+				{
+					Collapse collapse = { a, b, combined.Error(vertices[b].Position) };
+					collapses.push_back(collapse);
+				}
+				if (!locked[b])
+				{
+					Collapse collapse = { b, a, combined.Error(vertices[a].Position) };
+					collapses.push_back(collapse);
+				}
+			}
+		}
+		sort(collapses.begin(), collapses.end(), [](const Collapse &a, const Collapse &b) { return a.cost < b.cost; });
+
+		vector<GLuint> remap(numVertices);
+		for (size_t v = 0; v < numVertices; v++)
+		{
+			remap[v] = (GLuint)v;
+		}
+		vector<char> touched(numVertices, 0);
+		size_t removed = 0;
+
+		for (size_t i = 0; i < collapses.size() && removed < trianglesToRemove; i++)
+		{
+			const Collapse &collapse = collapses[i];
+			if (collapse.cost > maxCost)
+			{
+				break;
+			}
+			if (touched[collapse.from] || touched[collapse.to] || !ValidCollapse(vertices, indices, adjacency, adjacencyOffset, collapse))
+			{
+				continue;
+			}
+
+			// Every triangle around the removed vertex changes, so none of their vertices may move again in this pass
+			for (GLuint j = adjacencyOffset[collapse.from]; j < adjacencyOffset[collapse.from + 1]; j++)
+			{
+				const GLuint *triangle = &indices[adjacency[j] * 3];
+				touched[triangle[0]] = touched[triangle[1]] = touched[triangle[2]] = 1;
+				if (triangle[0] == collapse.to || triangle[1] == collapse.to || triangle[2] == collapse.to)
+				{
+					removed++;
+				}
+			}
+			remap[collapse.from] = collapse.to;
+			quadrics[collapse.to].Add(quadrics[collapse.from]);
+		}
+
+		if (removed == 0)
+		{
+			return 0;
+		}
+
+		// Apply the collapses and drop the triangles that became degenerate
+		size_t write = 0;
+		for (size_t t = 0; t < numTriangles; t++)
+		{
+			GLuint a = remap[indices[t * 3]], b = remap[indices[t * 3 + 1]], c = remap[indices[t * 3 + 2]];
+			if (a != b && b != c && c != a)
+			{
+				indices[write++] = a;
+				indices[write++] = b;
+				indices[write++] = c;
+			}
+		}
+		indices.resize(write);
+		return removed;
+	}
+
+	// The collapse must not flip or flatten a triangle, nor join two vertices that have more than the two
+	// neighbours of their edge in common (that would fold the surface onto itself)
+	static bool ValidCollapse(const vector<Vertex> &vertices, const vector<GLuint> &indices, const vector<GLuint> &adjacency,
+		const vector<GLuint> &adjacencyOffset, const Collapse &collapse)
+	{
+		const glm::vec3 &target = vertices[collapse.to].Position;
+
+		for (GLuint j = adjacencyOffset[collapse.from]; j < adjacencyOffset[collapse.from + 1]; j++)
+		{
+			const GLuint *triangle = &indices[adjacency[j] * 3];
+			if (triangle[0] == collapse.to || triangle[1] == collapse.to || triangle[2] == collapse.to)
+			{
+				continue;
+			}
+
+			glm::vec3 p[3], q[3];
+			for (int k = 0; k < 3; k++)
+			{
+				p[k] = vertices[triangle[k]].Position;
+				q[k] = triangle[k] == collapse.from ? target : p[k];
+			}
+			glm::vec3 before = glm::cross(p[1] - p[0], p[2] - p[0]);
+			glm::vec3 after = glm::cross(q[1] - q[0], q[2] - q[0]);
+			// Turning a triangle by more than ~75 degrees is rejected too: over several passes small turns add up to a flip
+			if (glm::dot(before, after) <= 0.25f * glm::length(before) * glm::length(after))
+			{
+				return false;
+			}
+		}
+
+		// Link condition
+		vector<GLuint> fromNeighbours, toNeighbours;
+		Neighbours(indices, adjacency, adjacencyOffset, collapse.from, fromNeighbours);
+		Neighbours(indices, adjacency, adjacencyOffset, collapse.to, toNeighbours);
+		size_t shared = 0;
+		for (size_t i = 0; i < fromNeighbours.size(); i++)
+		{
+			if (binary_search(toNeighbours.begin(), toNeighbours.end(), fromNeighbours[i]))
+			{
+				shared++;
+			}
+		}
+		return shared <= 2;
+	}
+
+	// Sorted vertices that share a triangle with v
+	static void Neighbours(const vector<GLuint> &indices, const vector<GLuint> &adjacency, const vector<GLuint> &adjacencyOffset,
+		GLuint v, vector<GLuint> &neighbours)
+	{
+		for (GLuint j = adjacencyOffset[v]; j < adjacencyOffset[v + 1]; j++)
+		{
+			const GLuint *triangle = &indices[adjacency[j] * 3];
+			for (int k = 0; k < 3; k++)
+			{
+				if (triangle[k] != v)
+				{
+					neighbours.push_back(triangle[k]);
+				}
+			}
+		}
+		sort(neighbours.begin(), neighbours.end());
+		neighbours.erase(unique(neighbours.begin(), neighbours.end()), neighbours.end());
+	}
+
+	static float BoundingRadius(const vector<Vertex> &vertices)
+	{
+		if (vertices.empty())
+		{
+			return 0.0f;
+		}
+
+		glm::vec3 minimum = vertices[0].Position, maximum = vertices[0].Position;
+		for (size_t i = 1; i < vertices.size(); i++)
+		{
+			for (int k = 0; k < 3; k++)
+			{
+				minimum[k] = min(minimum[k], vertices[i].Position[k]);
+				maximum[k] = max(maximum[k], vertices[i].Position[k]);
+			}
+		}
+		return glm::length(maximum - minimum) * 0.5f;
+	}
+};
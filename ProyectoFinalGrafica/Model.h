@@ -5,7 +5,9 @@
 #include <sstream>
 #include <iostream>
 #include <map>
+#include <memory>
 #include <vector>
+#include <chrono>
 
 #include <GL/glew.h>
 #include <glm/glm.hpp>
@@ -16,60 +18,579 @@
 #include <assimp/postprocess.h>
 
 #include "Mesh.h"
+#include "MeshCache.h"
+#include "GlbFile.h"
+#include "LoadProfiler.h"
+#include "AssetPack.h"
+#include "ObjLoader.h"
+#include "CookedAssets.h"
+#include "MeshOptimizer.h"
+#include "MeshSimplifier.h"
+#include "VertexPacking.h"
+#include "AssetLoader.h"
+#include "ModelRegistry.h"
+#include "TextureManager.h"
+#include "RenderContext.h"
+#include "RenderQueue.h"
 #include  "Shader.h"
 
 using namespace std;
 
 GLint TextureFromFile(const char *path, string directory);
 
+// Everything the CPU-only part of a model load produces. Built by Model::importModel on any thread and consumed by
+// Model::uploadModel on the GL thread.
+struct ModelData
+{
+	string path;
+	vector<MeshData> meshes;
+	vector<ImageData> images;  // One entry per distinct texture path used by the meshes
+	unique_ptr<MeshCache> cache; // Keeps the mapped cache file alive until the meshes are uploaded
+	unique_ptr<GlbFile> glb;     // Same for a processed .glb
+	PackedGeometry packed;     // Only filled when ModelLoadOptions::packedVertices is set
+	glm::vec3 boundsCenter;    // Bounding sphere of every mesh, for the level of detail
+	float boundsRadius = 0.0f;
+	bool loaded = false;
+	bool fromCache = false;
+	bool fromCooked = false;   // The cache file was written by zoo-cook
+	bool fromGlb = false;      // The meshes come processed from the .glb zoo-cook --to-glb wrote
+	double importMs = 0.0;    // Wall time of the CPU part
+	double coldImportMs = 0.0; // For cache hits: the Assimp time recorded when the cache was written
+};
+
+// Options for every model created afterwards. Set them before the first Model is created.
+struct ModelLoadOptions
+{
+	bool packedVertices = false;    // Upload PackedVertex (16 bytes) instead of Vertex (32 bytes)
+	bool validateVertices = false;  // Print the maximum position and normal error of the packing, per model
+	bool nativeObj = false;         // Read .obj files with ObjLoader instead of ASSIMP; off until zoo-cook --check-obj passes against ASSIMP
+	bool preferGlb = false;         // Load the .glb next to each model (zoo-cook --to-glb) instead of the model when there is one
+	MeshMirrorPolicy cpuMirror = MESH_MIRROR_DROP; // What the meshes keep in RAM after their upload
+};
+
 class Model
 {
 public:
+	static ModelLoadOptions &Options()
+	{
+		static ModelLoadOptions options;
+		return options;
+	}
+
+	// While this points to a list, new models are added to it instead of being loaded (see AssetStreamer)
+	static vector<Model *> *&DeferredModels()
+	{
+		static vector<Model *> *deferred = nullptr;
+		return deferred;
+	}
+
 	/*  Functions   */
 	// Constructor, expects a filepath to a 3D model.
+	// Models created from the same file share one ModelAsset through the ModelRegistry, so only the first one loads it.
+	// While the AssetLoader is active the import runs on a worker thread and the meshes only appear once
+	// AssetLoader::Finish() has uploaded them; otherwise the model is loaded right away.
 	Model(GLchar *path)
 	{
-		this->loadModel(path);
+		this->path = path;
+
+		if (DeferredModels())
+		{
+			DeferredModels()->push_back(this);
+			return;
+		}
+		this->Load();
 	}
 
-	// Draws the model, and thus all its meshes
-	void Draw(Shader shader)
+	Model(const Model &) = delete;
+	Model &operator=(const Model &) = delete;
+
+	~Model()
+	{
+		this->Unload();
+	}
+
+	// Acquires the asset of the file, loading it if no other model has it resident
+	void Load()
+	{
+		if (this->asset)
+		{
+			return;
+		}
+
+		bool created;
+		this->asset = ModelRegistry::Get().Acquire(this->path, created);
+		if (!created)
+		{
+			return;
+		}
+
+		shared_ptr<ModelAsset> asset = this->asset;
+		string modelPath = asset->path;
+
+		AssetLoader &loader = AssetLoader::Get();
+		if (loader.IsActive())
+		{
+			// The upload only holds a weak reference: if the model is unloaded before its upload runs, it is skipped
+			weak_ptr<ModelAsset> pendingAsset = asset;
+			shared_ptr<ModelData> data = make_shared<ModelData>();
+			loader.Enqueue(
+				[data, modelPath](Assimp::Importer &importer) { Model::importModel(modelPath, importer, *data); },
+				[pendingAsset, data]()
+				{
+					shared_ptr<ModelAsset> asset = pendingAsset.lock();
+					if (asset)
+					{
+						Model::uploadModel(*asset, data);
+					}
+				});
+		}
+		else
+		{
+			Assimp::Importer importer;
+			shared_ptr<ModelData> data = make_shared<ModelData>();
+			Model::importModel(modelPath, importer, *data);
+			Model::uploadModel(*asset, data);
+		}
+	}
+
+	// Gives back the asset. Its buffers and textures are freed once no other model of the same file holds it.
+	void Unload()
 	{
-		for (GLuint i = 0; i < this->meshes.size(); i++)
+		if (this->asset)
 		{
-			this->meshes[i].Draw(shader);
+			this->asset->instances--;
+			this->asset.reset();
 		}
 	}
 
-private:
-	/*  Model Data  */
-	vector<Mesh> meshes;
-	string directory;
-	vector<Texture> textures_loaded;	// Stores all the textures loaded so far, optimization to make sure textures aren't loaded more than once.
+	// Loaded and uploaded, with its geometry and textures through the UploadQueue (or failed to load, so there
+	// is nothing left to wait for)
+	bool IsReady() const
+	{
+		return this->asset && this->asset->ready && UploadQueue::Get().Done(this->asset->uploadTicket);
+	}
 
-										/*  Functions   */
-										// Loads a model with supported ASSIMP extensions from file and stores the resulting meshes in the meshes vector.
-	void loadModel(string path)
+	const ModelAsset *Asset() const
+	{
+		return this->asset.get();
+	}
+
+	bool hidden = false; // Skips Draw, e.g. while the rest of its streaming unit is still loading
+
+	// Imports a file (ReadMeshes) and processes its meshes the way the cache and zoo-cook store them:
+	// welded, optimized for the vertex cache, overdraw and fetch, and with their levels of detail
+	static bool ImportScene(const string &path, Assimp::Importer &importer, vector<MeshData> &meshes)
+	{
+		{
+			LoadProfiler::Timer timer("model", path, LOAD_PARSE);
+			if (!ReadMeshes(path, importer, Options().nativeObj, meshes))
+			{
+				return false;
+			}
+		}
+
+		// Weld, reorder for the vertex cache and overdraw, and reorder for fetch. The cache stores the result,
+		// so warm starts get the optimized meshes for free.
+		LoadProfiler::Timer timer("model", path, LOAD_CONVERT);
+		MeshOptimizerStats optimization;
+		MeshSimplifierStats simplification;
+		for (size_t i = 0; i < meshes.size(); i++)
+		{
+			MeshOptimizer::Optimize(meshes[i], optimization);
+			MeshSimplifier::GenerateLods(meshes[i], simplification);
+		}
+		cout << optimization.Report(path) + "\n" << flush;
+		if (simplification.numLods > 1)
+		{
+			cout << simplification.Report(path) + "\n" << flush;
+		}
+		return true;
+	}
+
+	// Reads the meshes of a file as they are stored, before welding or optimizing them. Wavefront files go through
+	// ObjLoader when native is set, falling back to ASSIMP if it can't read them; .glb files go through GlbFile;
+	// every other format uses ASSIMP.
+	static bool ReadMeshes(const string &path, Assimp::Importer &importer, bool native, vector<MeshData> &meshes)
 	{
+		meshes.clear();
+		if (GlbFile::IsGlb(path))
+		{
+			GlbFile glb;
+			return glb.Open(path) && glb.ReadMeshes(meshes, true);
+		}
+
+		size_t extension = path.find_last_of('.');
+		if (native && extension != string::npos && (path.compare(extension, string::npos, ".obj") == 0 || path.compare(extension, string::npos, ".OBJ") == 0) &&
+			ObjLoader::Load(path, meshes))
+		{
+			return true;
+		}
+
+		// Read the .obj and its materials from the asset pack when there is one
+		if (AssetPack::Get().IsOpen())
+		{
+			importer.SetIOHandler(new AssetPackIOSystem());
+		}
+
 		// Read file via ASSIMP
-		Assimp::Importer importer;
 		const aiScene *scene = importer.ReadFile(path, aiProcess_Triangulate | aiProcess_FlipUVs);
 
 		// Check for errors
 		if (!scene || scene->mFlags == AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode) // if is Not Zero
 		{
 			cout << "ERROR::ASSIMP:: " << importer.GetErrorString() << endl;
-			return;
+			return false;
 		}
-		// Retrieve the directory path of the filepath
-		this->directory = path.substr(0, path.find_last_of('/'));
 
 		// Process ASSIMP's root node recursively
-		this->processNode(scene->mRootNode, scene);
+		processNode(scene->mRootNode, scene, meshes);
+		return true;
+	}
+
+	// Draws the model, and thus all its meshes, at the level of detail its size on screen asks for.
+	// The model matrix is the one last given to SetModelMatrix. While the RenderQueue is recording, the meshes
+	// are queued with that matrix instead of drawn.
+	void Draw(Shader shader)
+	{
+		if (this->hidden || !this->IsReady())
+		{
+			return;
+		}
+
+		vector<Mesh> &meshes = this->asset->meshes;
+		if (meshes.empty())
+		{
+			return;
+		}
+
+		GLuint lod = this->selectLod();
+
+		// Uniform locations of the program, looked up by name only the first time it draws a model
+		const MaterialProgram &program = MaterialProgram::For(shader.Program);
+		MeshBuffer &buffer = this->asset->buffer;
+		RenderQueue &queue = RenderQueue::Get();
+		size_t drawnTriangles = 0, fullTriangles = 0;
+
+		if (queue.IsRecording())
+		{
+			RenderContext &context = RenderContext::Get();
+			RenderCommand command;
+			command.program = &program;
+			command.VAO = buffer.VAO;
+			command.packed = buffer.packed;
+			command.positionOffset = buffer.positionOffset;
+			command.positionScale = buffer.positionScale;
+			command.model = context.Model();
+			float depth = context.Distance(this->asset->boundsCenter);
+
+			for (GLuint i = 0; i < meshes.size(); i++)
+			{
+				const MeshLod &level = meshes[i].Lod(lod);
+				command.material = &meshes[i].material;
+				command.count = level.numIndices;
+				command.firstIndex = level.firstIndex;
+				command.baseVertex = meshes[i].BaseVertex();
+				queue.Submit(command, depth);
+				drawnTriangles += meshes[i].NumTriangles(lod);
+				fullTriangles += meshes[i].NumTriangles(0);
+			}
+		}
+		else
+		{
+			// Packed positions are rebuilt from the bounds of the model
+			if (buffer.packed)
+			{
+				glUniform1i(program.packedVertices, 1);
+				glUniform3f(program.positionOffset, buffer.positionOffset.x, buffer.positionOffset.y, buffer.positionOffset.z);
+				glUniform3f(program.positionScale, buffer.positionScale.x, buffer.positionScale.y, buffer.positionScale.z);
+			}
+
+			// Every mesh is a range of the same buffers, so the VAO is bound once for the whole model
+			glBindVertexArray(buffer.VAO);
+			GLuint textureBinds = 0;
+			for (GLuint i = 0; i < meshes.size(); i++)
+			{
+				meshes[i].Draw(program, lod);
+				textureBinds += meshes[i].material.NumBindings();
+				drawnTriangles += meshes[i].NumTriangles(lod);
+				fullTriangles += meshes[i].NumTriangles(0);
+			}
+			glBindVertexArray(0);
+
+			// The same shader draws the floors with the float layout
+			if (buffer.packed)
+			{
+				glUniform1i(program.packedVertices, 0);
+			}
+			queue.CountImmediate((GLuint)meshes.size(), 2, textureBinds, (GLuint)meshes.size() + (buffer.packed ? 4 : 0));
+		}
+
+		if (this->asset->numLods > 1)
+		{
+			RenderContext::Get().CountDraw(lod, drawnTriangles, fullTriangles);
+		}
+	}
+
+private:
+	/*  Model Data  */
+	string path;
+	shared_ptr<ModelAsset> asset; // Meshes and textures, shared with every other Model of the same file
+
+	// Level used by each draw of the model in the previous frame (a model can be drawn several times per frame,
+	// e.g. the trees of the Sabana), so the hysteresis of every placement is kept apart
+	vector<GLuint> lodLevels;
+	GLuint lodFrame = 0;
+	GLuint drawsThisFrame = 0;
+
+	GLuint selectLod()
+	{
+		RenderContext &context = RenderContext::Get();
+		if (this->lodFrame != context.Frame())
+		{
+			this->lodFrame = context.Frame();
+			this->drawsThisFrame = 0;
+		}
+
+		GLuint draw = this->drawsThisFrame++;
+		if (draw >= this->lodLevels.size())
+		{
+			this->lodLevels.push_back(0);
+		}
+
+		float screenSize = context.ScreenSize(this->asset->boundsCenter, this->asset->boundsRadius);
+		this->lodLevels[draw] = context.SelectLod(screenSize, this->lodLevels[draw], this->asset->numLods);
+		return this->lodLevels[draw];
+	}
+
+										/*  Functions   */
+	// CPU-only part of the load, safe to run on any thread: reads the processed meshes from the cache or imports
+	// them through ASSIMP, then decodes every texture they use. No GL call is made here.
+	static void importModel(const string &path, Assimp::Importer &importer, ModelData &data)
+	{
+		chrono::steady_clock::time_point start = chrono::steady_clock::now();
+		data.path = path;
+
+		// A .glb from zoo-cook already holds the processed meshes in the GPU layout: they are used from the mapping.
+		// One next to the model that was made from other files or with other processing settings is stale and ignored.
+		FileStamp glbStamp;
+		string glbPath = GlbFile::IsGlb(path) ? path : GlbFile::PathFor(path);
+		data.glb.reset(new GlbFile());
+		if (glbPath == path || (Model::Options().preferGlb && GetAssetStamp(glbPath, glbStamp)))
+		{
+			LoadProfiler::Timer timer("model", path, LOAD_IO);
+			data.fromGlb = data.glb->Open(glbPath) && data.glb->Processed() && (glbPath == path || data.glb->Current());
+		}
+		if (data.fromGlb)
+		{
+			LoadProfiler::Timer timer("model", path, LOAD_PARSE);
+			data.fromGlb = data.glb->ReadMeshes(data.meshes);
+		}
+		if (data.fromGlb)
+		{
+			LoadProfiler::Get().AddBytes("model", path, data.glb->Size(), 0);
+			LoadProfiler::Get().SetRoute("model", path, "glb");
+		}
+		else
+		{
+			data.glb.reset();
+			data.meshes.clear();
+		}
+
+		// Warm start: the processed meshes are mapped from the cooked file or the cache and Assimp is skipped entirely
+		const CookedEntry *cooked = data.fromGlb ? nullptr : CookedAssets::Get().Find(path, COOKED_MESH);
+		data.cache.reset(new MeshCache());
+		if (!data.fromGlb)
+		{
+			LoadProfiler::Timer timer("model", path, LOAD_IO);
+			data.fromCooked = cooked && data.cache->OpenCooked(cooked->cooked, path);
+			data.fromCache = data.fromCooked || data.cache->Open(path);
+		}
+		if (data.fromGlb)
+		{
+			data.cache.reset();
+		}
+		else if (data.fromCache)
+		{
+			LoadProfiler::Timer timer("model", path, LOAD_PARSE);
+			LoadProfiler::Get().AddBytes("model", path, data.cache->FileSize(), 0);
+			LoadProfiler::Get().SetRoute("model", path, data.fromCooked ? "cooked" : "cache");
+			data.coldImportMs = data.cache->ImportMs();
+			readCache(*data.cache, data);
+		}
+		else
+		{
+			data.cache.reset();
+			FileStamp stamp;
+			LoadProfiler::Get().AddBytes("model", path, GetAssetStamp(path, stamp) ? stamp.size : 0, 0);
+			LoadProfiler::Get().SetRoute("model", path, "import");
+			if (!ImportScene(path, importer, data.meshes))
+			{
+				return;
+			}
+		}
+
+		computeBounds(data);
+
+		// Opt-in compact vertices, packed here so the GL thread only has to upload them
+		const ModelLoadOptions &options = Model::Options();
+		if (options.packedVertices)
+		{
+			LoadProfiler::Timer timer("model", path, LOAD_CONVERT);
+			VertexPacking::Pack(data.meshes, data.packed, options.validateVertices);
+			if (options.validateVertices)
+			{
+				cout << VertexPacking::Report(path, data.packed) + "\n" << flush;
+			}
+		}
+
+		decodeImages(path.substr(0, path.find_last_of('/')), data);
+
+		data.loaded = true;
+		data.importMs = elapsedMs(start);
+
+		// Cold start: store the processed meshes so the next launch can skip Assimp
+		if (!data.fromCache && !data.fromGlb)
+		{
+			LoadProfiler::Timer timer("model", path, LOAD_IO);
+			MeshCache::Write(path, data.meshes, data.importMs);
+		}
+	}
+
+	// GL part of the load: creates the textures and buffers from the imported data. Must run on the GL thread.
+	// The bytes go through the UploadQueue, which keeps the data alive until they are copied.
+	static void uploadModel(ModelAsset &asset, const shared_ptr<ModelData> &loaded)
+	{
+		ModelData &data = *loaded;
+		asset.ready = true;
+		if (!data.loaded)
+		{
+			return;
+		}
+
+		chrono::steady_clock::time_point start = chrono::steady_clock::now();
+
+		for (size_t i = 0; i < data.images.size(); i++)
+		{
+			// Shared with every other model (or floor) that uses the same image
+			Texture texture;
+			texture.id = TextureManager::Get().Acquire(data.images[i]);
+			texture.path = aiString(data.images[i].path);
+			asset.textures_loaded.push_back(texture);  // Store it as texture loaded for entire model, to ensure we won't unnecesery load duplicate textures.
+			asset.gpuBytes += TextureManager::Get().Bytes(texture.id);
+			asset.uploadTicket = max(asset.uploadTicket, TextureManager::Get().Ticket(texture.id));
+		}
+
+		// All meshes go into one vertex and one index range of the MeshArena. For cached models the blobs are already in the GPU
+		// layout, so they are copied straight from the mapping.
+		vector<GLuint> firstIndex;
+		vector<GLint> baseVertex;
+		const PackedVertex *packedVertices = data.packed.vertices.empty() ? nullptr : data.packed.vertices.data();
+		{
+			LoadProfiler::Timer timer("model", data.path, LOAD_UPLOAD);
+			asset.buffer.Setup(data.meshes, firstIndex, baseVertex, packedVertices, loaded, data.path);
+		}
+		asset.uploadTicket = max(asset.uploadTicket, asset.buffer.uploadTicket);
+		LoadProfiler::Get().AddBytes("model", data.path, 0, asset.buffer.GpuBytes());
+		asset.buffer.positionOffset = data.packed.offset;
+		asset.buffer.positionScale = data.packed.scale;
+		asset.gpuBytes += asset.buffer.GpuBytes();
+		asset.geometryBytes = asset.buffer.GpuBytes();
+		asset.boundsCenter = data.boundsCenter;
+		asset.boundsRadius = data.boundsRadius;
+
+		// A full mirror points into the loaded meshes, so the asset keeps them (and their mapping) alive.
+		// Otherwise they go away once the UploadQueue has copied them.
+		MeshMirrorPolicy mirrorPolicy = Model::Options().cpuMirror;
+		if (mirrorPolicy == MESH_MIRROR_FULL)
+		{
+			asset.source = loaded;
+			asset.cpuBytes += data.packed.vertices.size() * sizeof(PackedVertex);
+		}
+		GLsizei vertexStride = asset.buffer.packed ? sizeof(PackedVertex) : sizeof(Vertex);
+		asset.meshes.reserve(data.meshes.size());
+		for (size_t i = 0; i < data.meshes.size(); i++)
+		{
+			const MeshData &mesh = data.meshes[i];
+			vector<Texture> textures;
+
+			for (size_t j = 0; j < mesh.textures.size(); j++)
+			{
+				textures.push_back(findTexture(asset, mesh.textures[j]));
+			}
+
+			asset.meshes.push_back(Mesh(firstIndex[i], baseVertex[i], mesh, textures, vertexStride, mirrorPolicy));
+			asset.numLods = max(asset.numLods, mesh.numLods);
+			asset.cpuBytes += asset.meshes.back().mirror.HeapBytes();
+			asset.mappedBytes += asset.meshes.back().mirror.MappedBytes();
+		}
+
+		double totalMs = data.importMs + elapsedMs(start);
+		MeshCacheStats &stats = MeshCache::Stats();
+		if (data.fromCache || data.fromGlb)
+		{
+			stats.hits++;
+			stats.cooked += data.fromCooked ? 1 : 0;
+			stats.warmMs += totalMs;
+			stats.coldMsSaved += data.coldImportMs;
+		}
+		else
+		{
+			stats.misses++;
+			stats.missMs += totalMs;
+		}
+	}
+
+	// Fills the meshes from the processed-mesh cache. The geometry keeps pointing into the mapping.
+	static void readCache(const MeshCache &cache, ModelData &data)
+	{
+		for (GLuint i = 0; i < cache.NumMeshes(); i++)
+		{
+			const MeshCacheEntry &entry = cache.Entry(i);
+			MeshData mesh;
+			mesh.vertexData = cache.Vertices(i);
+			mesh.numVertices = entry.numVertices;
+			mesh.indexData = cache.Indices(i);
+			mesh.numIndices = entry.numIndices;
+			mesh.numLods = entry.numLods;
+			memcpy(mesh.lods, entry.lods, sizeof(mesh.lods));
+
+			for (GLuint j = entry.firstTexture; j < entry.firstTexture + entry.numTextures; j++)
+			{
+				TextureRef texture;
+				texture.type = cache.TextureType(j);
+				texture.path = cache.TexturePath(j);
+				mesh.textures.push_back(texture);
+			}
+
+			data.meshes.push_back(move(mesh));
+		}
+	}
+
+	// Sphere around the box of every vertex of the model
+	static void computeBounds(ModelData &data)
+	{
+		glm::vec3 minimum(0.0f), maximum(0.0f);
+		bool first = true;
+		for (size_t i = 0; i < data.meshes.size(); i++)
+		{
+			for (GLuint j = 0; j < data.meshes[i].numVertices; j++)
+			{
+				const glm::vec3 &p = data.meshes[i].vertexData[j].Position;
+				for (int k = 0; k < 3; k++)
+				{
+					minimum[k] = first ? p[k] : min(minimum[k], p[k]);
+					maximum[k] = first ? p[k] : max(maximum[k], p[k]);
+				}
+				first = false;
+			}
+		}
+
+		data.boundsCenter = (minimum + maximum) * 0.5f;
+		data.boundsRadius = glm::length(maximum - minimum) * 0.5f;
 	}
 
 	// Processes a node in a recursive fashion. Processes each individual mesh located at the node and repeats this process on its children nodes (if any).
-	void processNode(aiNode* node, const aiScene* scene)
+	static void processNode(aiNode* node, const aiScene* scene, vector<MeshData> &meshes)
 	{
 		// Process each mesh located at the current node
 		for (GLuint i = 0; i < node->mNumMeshes; i++)
@@ -78,22 +599,24 @@ private:
 			// The scene contains all the data, node is just to keep stuff organized (like relations between nodes).
 			aiMesh* mesh = scene->mMeshes[node->mMeshes[i]];
 
-			this->meshes.push_back(this->processMesh(mesh, scene));
+			meshes.push_back(processMesh(mesh, scene));
 		}
 
 		// After we've processed all of the meshes (if any) we then recursively process each of the children nodes
 		for (GLuint i = 0; i < node->mNumChildren; i++)
 		{
-			this->processNode(node->mChildren[i], scene);
+			processNode(node->mChildren[i], scene, meshes);
 		}
 	}
 
-	Mesh processMesh(aiMesh *mesh, const aiScene *scene)
+	static MeshData processMesh(aiMesh *mesh, const aiScene *scene)
 	{
 		// Data to fill
-		vector<Vertex> vertices;
-		vector<GLuint> indices;
-		vector<Texture> textures;
+		MeshData data;
+		vector<Vertex> &vertices = data.vertices;
+		vector<GLuint> &indices = data.indices;
+		vertices.reserve(mesh->mNumVertices);
+		indices.reserve(mesh->mNumFaces * 3);
 
 		// Walk through each of the mesh's vertices
 		for (GLuint i = 0; i < mesh->mNumVertices; i++)
@@ -135,6 +658,12 @@ private:
 		for (GLuint i = 0; i < mesh->mNumFaces; i++)
 		{
 			aiFace face = mesh->mFaces[i];
+			// Lines and points (an OBJ "l" or "p") stay as they are after triangulation; they would shift every
+			// triangle after them in the index list, so only triangles are kept
+			if (face.mNumIndices != 3)
+			{
+				continue;
+			}
 			// Retrieve all indices of the face and store them in the indices vector
 			for (GLuint j = 0; j < face.mNumIndices; j++)
 			{
@@ -154,83 +683,95 @@ private:
 			// Normal: texture_normalN
 
 			// 1. Diffuse maps
-			vector<Texture> diffuseMaps = this->loadMaterialTextures(material, aiTextureType_DIFFUSE, "texture_diffuse");
-			textures.insert(textures.end(), diffuseMaps.begin(), diffuseMaps.end());
+			loadMaterialTextures(material, aiTextureType_DIFFUSE, "texture_diffuse", data.textures);
 
 			// 2. Specular maps
-			vector<Texture> specularMaps = this->loadMaterialTextures(material, aiTextureType_SPECULAR, "texture_specular");
-			textures.insert(textures.end(), specularMaps.begin(), specularMaps.end());
+			loadMaterialTextures(material, aiTextureType_SPECULAR, "texture_specular", data.textures);
 		}
 
-		// Return a mesh object created from the extracted mesh data
-		return Mesh(vertices, indices, textures);
+		// Return the extracted mesh data, uploaded later by uploadModel
+		data.UseOwnedGeometry();
+		return data;
 	}
 
-	// Checks all material textures of a given type and loads the textures if they're not loaded yet.
-	// The required info is returned as a Texture struct.
-	vector<Texture> loadMaterialTextures(aiMaterial *mat, aiTextureType type, string typeName)
+	// Collects all material textures of a given type. They are decoded by decodeImages and uploaded by uploadModel.
+	static void loadMaterialTextures(aiMaterial *mat, aiTextureType type, string typeName, vector<TextureRef> &textures)
 	{
-		vector<Texture> textures;
-
 		for (GLuint i = 0; i < mat->GetTextureCount(type); i++)
 		{
 			aiString str;
 			mat->GetTexture(type, i, &str);
 
-			// Check if texture was loaded before and if so, continue to next iteration: skip loading a new texture
-			GLboolean skip = false;
+			TextureRef texture;
+			texture.type = typeName;
+			texture.path = str.C_Str();
+			textures.push_back(texture);
+		}
+	}
 
-			for (GLuint j = 0; j < textures_loaded.size(); j++)
+	// Decodes every distinct texture used by the meshes so only the upload is left for the GL thread.
+	// Images the TextureManager already has resident are only hashed, not decoded.
+	static void decodeImages(const string &directory, ModelData &data)
+	{
+		for (size_t i = 0; i < data.meshes.size(); i++)
+		{
+			for (size_t j = 0; j < data.meshes[i].textures.size(); j++)
 			{
-				if (textures_loaded[j].path == str)
-				{
-					textures.push_back(textures_loaded[j]);
-					skip = true; // A texture with the same filepath has already been loaded, continue to next one. (optimization)
+				const string &path = data.meshes[i].textures[j].path;
 
-					break;
+				// Check if texture was decoded before and if so, skip decoding it again
+				bool skip = false;
+				for (size_t k = 0; k < data.images.size() && !skip; k++)
+				{
+					skip = data.images[k].path == path;
+				}
+				if (skip)
+				{
+					continue;
 				}
+
+				ImageData image;
+				image.path = path;
+				TextureManager::Get().Prepare(directory + '/' + path, image);
+				data.images.push_back(move(image));
 			}
+		}
+	}
 
-			if (!skip)
-			{   // If texture hasn't been loaded already, load it
-				Texture texture;
-				texture.id = TextureFromFile(str.C_Str(), this->directory);
-				texture.type = typeName;
-				texture.path = str;
-				textures.push_back(texture);
+	// Returns the uploaded texture with the path of the reference, keeping the sampler type the mesh asked for
+	static Texture findTexture(const ModelAsset &asset, const TextureRef &ref)
+	{
+		aiString str(ref.path);
 
-				this->textures_loaded.push_back(texture);  // Store it as texture loaded for entire model, to ensure we won't unnecesery load duplicate textures.
+		for (GLuint j = 0; j < asset.textures_loaded.size(); j++)
+		{
+			if (asset.textures_loaded[j].path == str)
+			{
+				Texture texture = asset.textures_loaded[j];
+				texture.type = ref.type;
+				return texture;
 			}
 		}
 
-		return textures;
+		Texture texture;
+		texture.id = 0;
+		texture.type = ref.type;
+		texture.path = str;
+		return texture;
+	}
+
+	static double elapsedMs(chrono::steady_clock::time_point start)
+	{
+		return chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
 	}
 };
 
 GLint TextureFromFile(const char *path, string directory)
 {
-	//Generate texture ID and load texture data
+	//Generate texture ID and load texture data, reusing it if the same image is already resident.
+	//While the AssetLoader is active the file is decoded on a worker and the pixels arrive later.
 	string filename = string(path);
 	filename = directory + '/' + filename;
-	GLuint textureID;
-	glGenTextures(1, &textureID);
-
-	int width, height;
-
-	unsigned char *image = SOIL_load_image(filename.c_str(), &width, &height, 0, SOIL_LOAD_RGB);
-
-	// Assign texture to ID
-	glBindTexture(GL_TEXTURE_2D, textureID);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, image);
-	glGenerateMipmap(GL_TEXTURE_2D);
-
-	// Parameters
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-	glBindTexture(GL_TEXTURE_2D, 0);
-	SOIL_free_image_data(image);
 
-	return textureID;
-}
\ No newline at end of file
+	return TextureManager::Get().LoadAsync(filename);
+}
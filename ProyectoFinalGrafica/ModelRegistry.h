@@ -0,0 +1,147 @@
+#pragma once
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+#include <iostream>
+
+#include <GL/glew.h>
+
+#include "Mesh.h"
+#include "MappedFile.h"
+#include "TextureManager.h"
+
+using namespace std;
+
+// GPU resources of one model file. Every Model created from the same path holds a reference to the same asset,
+// so N placements of a file cost one parse and one set of buffers and textures.
+struct ModelAsset
+{
+	string path;
+	string directory;
+	MeshBuffer buffer;    // Ranges of the MeshArena with the vertices and indices of every mesh
+	vector<Mesh> meshes;  // Ranges of the buffer with their textures
+	vector<Texture> textures_loaded;	// Stores all the textures loaded so far, optimization to make sure textures aren't loaded more than once.
+
+	glm::vec3 boundsCenter;  // Bounding sphere in model space
+	float boundsRadius = 0.0f;
+	GLuint numLods = 1;      // Most levels of detail of any mesh
+
+	size_t gpuBytes = 0;   // Vertex, index and texture (with mipmaps) bytes uploaded for this file
+	size_t geometryBytes = 0; // The vertex and index part of gpuBytes; the textures may be shared with other files
+	size_t cpuBytes = 0;      // Heap kept by the CPU mirrors of the meshes (see MeshMirrorPolicy)
+	size_t mappedBytes = 0;   // File pages kept mapped by full mirrors of cached meshes
+	shared_ptr<const void> source; // The loaded data, held for MESH_MIRROR_FULL
+	GLuint instances = 0;  // Model objects that hold this asset now (Model::Load and Model::Unload keep it)
+	bool ready = false;    // uploadModel has run (even if the file failed to load)
+	uint64_t uploadTicket = 0; // Drawable once the UploadQueue is done with it
+
+	ModelAsset() {}
+	ModelAsset(const ModelAsset &) = delete;
+	ModelAsset &operator=(const ModelAsset &) = delete;
+
+	~ModelAsset();
+};
+
+class ModelRegistry
+{
+public:
+	static ModelRegistry &Get()
+	{
+		static ModelRegistry registry;
+		return registry;
+	}
+
+	// Returns the shared asset of the file. created is true when the asset is new and the caller has to load it.
+	shared_ptr<ModelAsset> Acquire(const string &path, bool &created)
+	{
+		string key = CanonicalPath(path);
+
+		shared_ptr<ModelAsset> asset = this->assets[key].lock();
+		created = !asset;
+		if (created)
+		{
+			asset = make_shared<ModelAsset>();
+			asset->path = key;
+			asset->directory = key.substr(0, key.find_last_of('/'));
+			this->assets[key] = asset;
+		}
+		asset->instances++;
+
+		return asset;
+	}
+
+	// Every asset some Model still holds, in path order
+	vector<shared_ptr<ModelAsset> > Assets()
+	{
+		vector<shared_ptr<ModelAsset> > resident;
+		for (map<string, weak_ptr<ModelAsset> >::iterator it = this->assets.begin(); it != this->assets.end(); ++it)
+		{
+			shared_ptr<ModelAsset> asset = it->second.lock();
+			if (asset)
+			{
+				resident.push_back(asset);
+			}
+		}
+		return resident;
+	}
+
+	// Prints how many files were actually loaded for all the Model objects and how much was saved by sharing them.
+	// Only the geometry counts as saved: textures shared between files are already shared by the TextureManager.
+	void PrintSummary()
+	{
+		GLuint files = 0, instances = 0;
+		size_t residentBytes = 0, savedBytes = 0;
+
+		for (map<string, weak_ptr<ModelAsset> >::iterator it = this->assets.begin(); it != this->assets.end(); ++it)
+		{
+			shared_ptr<ModelAsset> asset = it->second.lock();
+			if (!asset)
+			{
+				continue;
+			}
+
+			files++;
+			instances += asset->instances;
+			residentBytes += asset->gpuBytes;
+			if (asset->instances > 1)
+			{
+				savedBytes += (asset->instances - 1) * asset->geometryBytes;
+			}
+		}
+
+		cout << "Registro de modelos: " << files << " archivos para " << instances << " instancias | GPU "
+			<< residentBytes / (1024.0 * 1024.0) << " MB | ahorro " << (instances - files) << " cargas, "
+			<< savedBytes / (1024.0 * 1024.0) << " MB" << endl;
+	}
+
+	// Called before the context is destroyed: assets released afterwards skip their GL deletes
+	void Shutdown()
+	{
+		this->contextAlive = false;
+	}
+
+	bool ContextAlive() const
+	{
+		return this->contextAlive;
+	}
+
+private:
+	map<string, weak_ptr<ModelAsset> > assets;
+	bool contextAlive = true;
+};
+
+inline ModelAsset::~ModelAsset()
+{
+	if (!ModelRegistry::Get().ContextAlive())
+	{
+		return;
+	}
+
+	this->buffer.Release();
+	for (size_t i = 0; i < this->textures_loaded.size(); i++)
+	{
+		TextureManager::Get().Release(this->textures_loaded[i].id);
+	}
+}
@@ -0,0 +1,855 @@
+#pragma once
+
+#include <map>
+#include <cmath>
+#include <string>
+#include <vector>
+#include <climits>
+#include <cstring>
+#include <cstdint>
+#include <iostream>
+#include <algorithm>
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include "Mesh.h"
+#include "AssetPack.h"
+#include "AssetLoader.h"
+
+using namespace std;
+
+/*
+	Wavefront OBJ/MTL reader that fills MeshData directly, in place of Assimp's general importer plus the copy in
+	Model::processMesh.
+
+	The output is meant to be what Assimp's OBJ importer gives with aiProcess_Triangulate | aiProcess_FlipUVs, so
+	the rest of the import (welding, optimization, levels of detail, the cache) doesn't notice the difference:
+		- a new mesh starts with every "o", every "g" that changes the group and every "usemtl" that changes the
+		  material of a mesh that already has faces; empty meshes are dropped;
+		- every face corner is its own vertex (MeshOptimizer welds them afterwards);
+		- quads are split on the diagonal that starts at their concave corner, if any, like Assimp does; larger
+		  polygons are ear-clipped;
+		- texture coordinates are flipped vertically, and missing ones are (0, 0);
+		- materials give their map_Kd as texture_diffuse and map_Ks as texture_specular.
+	Lines and points are skipped: they can't be drawn with the triangles of a mesh. zoo-cook --check-obj reads every
+	model in Models/ with both importers and fails on any mesh that differs, other than in the diagonals of an
+	ear-clipped polygon (see CompareMeshes in Cook.cpp). Models only read .obj files with it when
+	ModelLoadOptions::nativeObj is set (--native-obj); ASSIMP stays the default until that check passes.
+
+	Files larger than OBJ_LOADER_CHUNK_BYTES are cut into chunks at line boundaries, at most one per thread of the
+	AssetLoader pool, and the chunks are parsed on the idle workers (AssetLoader::ParallelFor); a file read without
+	the pool is one chunk. Negative (relative) indices are resolved once the number of elements before each chunk
+	is known, and each chunk then writes its faces straight into the final vertex and index arrays.
+*/
+
+#define OBJ_LOADER_CHUNK_BYTES (256 * 1024)
+
+class ObjLoader
+{
+public:
+	// Reads the file and the material libraries it names. Returns false (leaving meshes empty) if it can't be
+	// read or references elements it doesn't have; the caller can then fall back to Assimp.
+	static bool Load(const string &path, vector<MeshData> &meshes)
+	{
+		meshes.clear();
+
+		AssetFile file;
+		if (!file.Open(path))
+		{
+			cout << "ERROR::OBJ::FILE_NOT_FOUND " << path << endl;
+			return false;
+		}
+		const char *data = (const char *)file.Data();
+		size_t size = file.Size();
+
+		// Line-aligned chunks
+		size_t numChunks = max((size_t)1, min((size_t)AssetLoader::Get().Parallelism(), size / OBJ_LOADER_CHUNK_BYTES));
+		vector<Chunk> chunks(numChunks);
+		size_t start = 0;
+		for (size_t i = 0; i < numChunks; i++)
+		{
+			size_t end = i + 1 == numChunks ? size : max(start, size * (i + 1) / numChunks);
+			while (end < size && data[end - 1] != '\n')
+			{
+				end++;
+			}
+			chunks[i].begin = data + start;
+			chunks[i].end = data + end;
+			start = end;
+		}
+
+		ForEachChunk(chunks, [](Chunk &chunk) { ParseChunk(chunk); });
+
+		// Elements before every chunk, to resolve the relative indices
+		size_t positions = 0, texCoords = 0, normals = 0;
+		for (size_t i = 0; i < chunks.size(); i++)
+		{
+			if (chunks[i].failed)
+			{
+				cout << "ERROR::OBJ::PARSE_FAILED " << path << endl;
+				return false;
+			}
+			chunks[i].positionBase = (int)positions;
+			chunks[i].texCoordBase = (int)texCoords;
+			chunks[i].normalBase = (int)normals;
+			positions += chunks[i].positions.size();
+			texCoords += chunks[i].texCoords.size();
+			normals += chunks[i].normals.size();
+		}
+
+		vector<glm::vec3> allPositions, allNormals;
+		vector<glm::vec2> allTexCoords;
+		allPositions.reserve(positions);
+		allNormals.reserve(normals);
+		allTexCoords.reserve(texCoords);
+		for (size_t i = 0; i < chunks.size(); i++)
+		{
+			allPositions.insert(allPositions.end(), chunks[i].positions.begin(), chunks[i].positions.end());
+			allNormals.insert(allNormals.end(), chunks[i].normals.begin(), chunks[i].normals.end());
+			allTexCoords.insert(allTexCoords.end(), chunks[i].texCoords.begin(), chunks[i].texCoords.end());
+		}
+
+		// Materials, from every library the file names
+		string directory = path.substr(0, path.find_last_of('/') + 1);
+		map<string, Material> materials;
+		for (size_t i = 0; i < chunks.size(); i++)
+		{
+			for (size_t j = 0; j < chunks[i].events.size(); j++)
+			{
+				if (chunks[i].events[j].type == EVENT_LIBRARY)
+				{
+					LoadMaterials(directory + chunks[i].events[j].name, materials);
+				}
+			}
+		}
+
+		// Split the faces into meshes, in file order
+		vector<MeshRange> ranges;
+		vector<string> meshMaterials;
+		SplitMeshes(chunks, ranges, meshMaterials);
+
+		meshes.resize(meshMaterials.size());
+		vector<size_t> vertexCount(meshes.size(), 0), indexCount(meshes.size(), 0);
+		for (size_t i = 0; i < ranges.size(); i++)
+		{
+			MeshRange &range = ranges[i];
+			range.firstVertex = vertexCount[range.mesh];
+			range.firstIndex = indexCount[range.mesh];
+			const Chunk &chunk = chunks[range.chunk];
+			for (size_t f = range.firstFace; f < range.firstFace + range.numFaces; f++)
+			{
+				GLuint corners = chunk.faces[f].numCorners;
+				vertexCount[range.mesh] += corners;
+				indexCount[range.mesh] += (corners - 2) * 3;
+			}
+		}
+		for (size_t m = 0; m < meshes.size(); m++)
+		{
+			meshes[m].vertices.resize(vertexCount[m]);
+			meshes[m].indices.resize(indexCount[m]);
+
+			map<string, Material>::const_iterator material = materials.find(meshMaterials[m]);
+			if (material != materials.end())
+			{
+				AddTexture(meshes[m], "texture_diffuse", material->second.diffuse);
+				AddTexture(meshes[m], "texture_specular", material->second.specular);
+			}
+		}
+
+		// Every chunk writes its faces into the ranges it owns
+		const Geometry geometry = { &allPositions, &allNormals, &allTexCoords };
+		vector<char> valid(chunks.size(), 1);
+		for (size_t i = 0; i < chunks.size(); i++)
+		{
+			chunks[i].index = i;
+		}
+		ForEachChunk(chunks, [&](Chunk &chunk)
+		{
+			for (size_t r = 0; r < ranges.size(); r++)
+			{
+				if (ranges[r].chunk == chunk.index && !EmitRange(chunk, ranges[r], geometry, meshes[ranges[r].mesh]))
+				{
+					valid[chunk.index] = 0;
+				}
+			}
+		});
+
+		if (find(valid.begin(), valid.end(), 0) != valid.end())
+		{
+			cout << "ERROR::OBJ::INVALID_INDEX " << path << endl;
+			meshes.clear();
+			return false;
+		}
+
+		for (size_t m = 0; m < meshes.size(); m++)
+		{
+			meshes[m].UseOwnedGeometry();
+		}
+		return true;
+	}
+
+	// Parses a decimal number ("-1.5", "2e-3", ".5") and advances p past it. Returns false if there is none.
+	static bool ParseFloat(const char *&p, const char *end, float &value)
+	{
+		static const double powers[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+			1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+
+		const char *s = p;
+		bool negative = false;
+		if (s < end && (*s == '-' || *s == '+'))
+		{
+			negative = *s == '-';
+			s++;
+		}
+
+		// Up to 19 significant digits fit the mantissa; later ones only move the exponent
+		uint64_t mantissa = 0;
+		int exponent = 0, digits = 0, significant = 0;
+		for (; s < end && *s >= '0' && *s <= '9'; s++, digits++)
+		{
+			if (significant < 19)
+			{
+				mantissa = mantissa * 10 + (uint64_t)(*s - '0');
+				significant += mantissa != 0;
+			}
+			else
+			{
+				exponent++;
+			}
+		}
+		if (s < end && *s == '.')
+		{
+			for (s++; s < end && *s >= '0' && *s <= '9'; s++, digits++)
+			{
+				if (significant < 19)
+				{
+					mantissa = mantissa * 10 + (uint64_t)(*s - '0');
+					significant += mantissa != 0;
+					exponent--;
+				}
+			}
+		}
+		if (digits == 0)
+		{
+			return false;
+		}
+
+		if (s < end && (*s == 'e' || *s == 'E'))
+		{
+			const char *e = s + 1;
+			bool negativeExponent = false;
+			if (e < end && (*e == '-' || *e == '+'))
+			{
+				negativeExponent = *e == '-';
+				e++;
+			}
+			if (e < end && *e >= '0' && *e <= '9')
+			{
+				int written = 0;
+				for (; e < end && *e >= '0' && *e <= '9'; e++)
+				{
+					written = min(written * 10 + (*e - '0'), 1000);
+				}
+				exponent += negativeExponent ? -written : written;
+				s = e;
+			}
+		}
+
+		double result = (double)mantissa;
+		if (exponent < 0)
+		{
+			result = -exponent <= 22 ? result / powers[-exponent] : result * pow(10.0, exponent);
+		}
+		else if (exponent > 0)
+		{
+			result = exponent <= 22 ? result * powers[exponent] : result * pow(10.0, exponent);
+		}
+		value = (float)(negative ? -result : result);
+		p = s;
+		return true;
+	}
+
+private:
+	enum EventType
+	{
+		EVENT_OBJECT,
+		EVENT_GROUP,
+		EVENT_MATERIAL,
+		EVENT_LIBRARY
+	};
+
+	// A statement that affects how the following faces are split into meshes
+	struct Event
+	{
+		EventType type;
+		size_t face; // Faces of the chunk before it
+		string name;
+	};
+
+	static const int MISSING = INT_MIN;
+
+	// Indices of a face corner, 0-based. Relative ones are still local to their chunk until it is resolved.
+	struct Corner
+	{
+		int position;
+		int texCoord;
+		int normal;
+	};
+
+	struct Face
+	{
+		GLuint firstCorner;
+		GLuint numCorners;
+	};
+
+	struct Chunk
+	{
+		const char *begin = nullptr;
+		const char *end = nullptr;
+		size_t index = 0;
+		bool failed = false;
+
+		vector<glm::vec3> positions;
+		vector<glm::vec3> normals;
+		vector<glm::vec2> texCoords;
+		vector<Corner> corners;
+		vector<char> relative; // Per corner: bit 0 position, bit 1 texture coordinate, bit 2 normal
+		vector<Face> faces;
+		vector<Event> events;
+
+		int positionBase = 0;
+		int texCoordBase = 0;
+		int normalBase = 0;
+	};
+
+	// Faces of one chunk that belong to one mesh, and where they go in it
+	struct MeshRange
+	{
+		size_t chunk;
+		size_t mesh;
+		size_t firstFace;
+		size_t numFaces;
+		size_t firstVertex;
+		size_t firstIndex;
+	};
+
+	struct Material
+	{
+		string diffuse;
+		string specular;
+	};
+
+	struct Geometry
+	{
+		const vector<glm::vec3> *positions;
+		const vector<glm::vec3> *normals;
+		const vector<glm::vec2> *texCoords;
+	};
+
+	// Runs work on every chunk, spread over the AssetLoader pool while it is active
+	template <typename Work>
+	static void ForEachChunk(vector<Chunk> &chunks, Work work)
+	{
+		AssetLoader::Get().ParallelFor(chunks.size(), [&chunks, &work](size_t i) { work(chunks[i]); });
+	}
+
+	static bool IsSpace(char c)
+	{
+		return c == ' ' || c == '\t';
+	}
+
+	static const char *SkipSpaces(const char *p, const char *end)
+	{
+		while (p < end && IsSpace(*p))
+		{
+			p++;
+		}
+		return p;
+	}
+
+	// The rest of the line without surrounding spaces
+	static string RestOfLine(const char *p, const char *end)
+	{
+		p = SkipSpaces(p, end);
+		while (end > p && (IsSpace(end[-1]) || end[-1] == '\r'))
+		{
+			end--;
+		}
+		return string(p, end);
+	}
+
+	static bool Keyword(const char *p, const char *end, const char *keyword, size_t length)
+	{
+		return (size_t)(end - p) > length && memcmp(p, keyword, length) == 0 && IsSpace(p[length]);
+	}
+
+	// One index of a face corner. Returns false if it is malformed or 0.
+	static bool ParseIndex(const char *&p, const char *end, int count, int &index, bool &relative)
+	{
+		bool negative = p < end && *p == '-';
+		if (negative || (p < end && *p == '+'))
+		{
+			p++;
+		}
+		if (p >= end || *p < '0' || *p > '9')
+		{
+			return false;
+		}
+		int value = 0;
+		for (; p < end && *p >= '0' && *p <= '9'; p++)
+		{
+			value = value * 10 + (*p - '0');
+		}
+		if (value == 0)
+		{
+			return false;
+		}
+
+		relative = negative;
+		index = negative ? count - value : value - 1;
+		return true;
+	}
+
+	static void ParseChunk(Chunk &chunk)
+	{
+		const char *p = chunk.begin;
+		while (p < chunk.end && !chunk.failed)
+		{
+			const char *lineEnd = (const char *)memchr(p, '\n', chunk.end - p);
+			lineEnd = lineEnd ? lineEnd : chunk.end;
+			const char *line = SkipSpaces(p, lineEnd);
+			p = lineEnd + 1;
+			if (line >= lineEnd)
+			{
+				continue;
+			}
+
+			if (line[0] == 'v' && line + 1 < lineEnd)
+			{
+				// "v x y z", "vn x y z", "vt u v"; extra values (w, vertex colors) are ignored
+				char type = IsSpace(line[1]) ? 'v' : line[1];
+				const char *s = type == 'v' ? line + 2 : line + 3;
+				if (type != 'v' && (line + 2 >= lineEnd || !IsSpace(line[2])))
+				{
+					continue;
+				}
+
+				float values[3] = { 0.0f, 0.0f, 0.0f };
+				for (int i = 0; i < (type == 't' ? 2 : 3); i++)
+				{
+					s = SkipSpaces(s, lineEnd);
+					if (!ParseFloat(s, lineEnd, values[i]))
+					{
+						break;
+					}
+				}
+
+				if (type == 'v')
+				{
+					chunk.positions.push_back(glm::vec3(values[0], values[1], values[2]));
+				}
+				else if (type == 'n')
+				{
+					chunk.normals.push_back(glm::vec3(values[0], values[1], values[2]));
+				}
+				else if (type == 't')
+				{
+					chunk.texCoords.push_back(glm::vec2(values[0], values[1]));
+				}
+			}
+			else if (line[0] == 'f' && line + 1 < lineEnd && IsSpace(line[1]))
+			{
+				ParseFace(chunk, line + 2, lineEnd);
+			}
+			else if ((line[0] == 'o' || line[0] == 'g') && (line + 1 == lineEnd || IsSpace(line[1]) || line[1] == '\r'))
+			{
+				Event event = { line[0] == 'o' ? EVENT_OBJECT : EVENT_GROUP, chunk.faces.size(), RestOfLine(line + 1, lineEnd) };
+				chunk.events.push_back(event);
+			}
+			else if (Keyword(line, lineEnd, "usemtl", 6))
+			{
+				Event event = { EVENT_MATERIAL, chunk.faces.size(), RestOfLine(line + 6, lineEnd) };
+				chunk.events.push_back(event);
+			}
+			else if (Keyword(line, lineEnd, "mtllib", 6))
+			{
+				Event event = { EVENT_LIBRARY, chunk.faces.size(), RestOfLine(line + 6, lineEnd) };
+				if (!event.name.empty())
+				{
+					chunk.events.push_back(event);
+				}
+			}
+		}
+	}
+
+	// "f v/vt/vn v//vn v/vt v ..."
+	static void ParseFace(Chunk &chunk, const char *s, const char *end)
+	{
+		Face face = { (GLuint)chunk.corners.size(), 0 };
+		while (true)
+		{
+			s = SkipSpaces(s, end);
+			if (s >= end || *s == '\r' || *s == '#')
+			{
+				break;
+			}
+
+			Corner corner = { MISSING, MISSING, MISSING };
+			bool relative = false;
+			char flags = 0;
+			if (!ParseIndex(s, end, (int)chunk.positions.size(), corner.position, relative))
+			{
+				chunk.failed = true;
+				return;
+			}
+			flags |= relative ? 1 : 0;
+			if (s < end && *s == '/')
+			{
+				s++;
+				if (s < end && *s != '/')
+				{
+					if (!ParseIndex(s, end, (int)chunk.texCoords.size(), corner.texCoord, relative))
+					{
+						chunk.failed = true;
+						return;
+					}
+					flags |= relative ? 2 : 0;
+				}
+				if (s < end && *s == '/')
+				{
+					s++;
+					if (!ParseIndex(s, end, (int)chunk.normals.size(), corner.normal, relative))
+					{
+						chunk.failed = true;
+						return;
+					}
+					flags |= relative ? 4 : 0;
+				}
+			}
+			chunk.corners.push_back(corner);
+			chunk.relative.push_back(flags);
+			face.numCorners++;
+		}
+
+		// Fewer than three corners can't make a triangle
+		if (face.numCorners >= 3)
+		{
+			chunk.faces.push_back(face);
+		}
+		else
+		{
+			chunk.corners.resize(face.firstCorner);
+			chunk.relative.resize(face.firstCorner);
+		}
+	}
+
+	// Cuts the faces of every chunk into meshes following the o/g/usemtl statements
+	static void SplitMeshes(const vector<Chunk> &chunks, vector<MeshRange> &ranges, vector<string> &meshMaterials)
+	{
+		string group, material;
+		bool haveGroup = false;
+		bool newMesh = true; // The next face starts a mesh
+
+		for (size_t c = 0; c < chunks.size(); c++)
+		{
+			const Chunk &chunk = chunks[c];
+			size_t face = 0;
+			for (size_t e = 0; e <= chunk.events.size(); e++)
+			{
+				size_t until = e < chunk.events.size() ? chunk.events[e].face : chunk.faces.size();
+				if (until > face)
+				{
+					if (newMesh)
+					{
+						meshMaterials.push_back(material);
+						newMesh = false;
+					}
+					MeshRange range = { c, meshMaterials.size() - 1, face, until - face, 0, 0 };
+					ranges.push_back(range);
+					face = until;
+				}
+				if (e == chunk.events.size())
+				{
+					break;
+				}
+
+				// Meshes are only created once they get a face, so a mesh that exists always has faces
+				const Event &event = chunk.events[e];
+				if (event.type == EVENT_OBJECT || (event.type == EVENT_GROUP && (!haveGroup || event.name != group)))
+				{
+					if (event.type == EVENT_GROUP)
+					{
+						group = event.name;
+						haveGroup = true;
+					}
+					newMesh = true;
+				}
+				else if (event.type == EVENT_MATERIAL && event.name != material)
+				{
+					material = event.name;
+					newMesh = true;
+				}
+			}
+		}
+	}
+
+	// Writes the vertices and triangles of a range. Returns false if a corner references a missing element.
+	static bool EmitRange(const Chunk &chunk, const MeshRange &range, const Geometry &geometry, MeshData &mesh)
+	{
+		const vector<glm::vec3> &positions = *geometry.positions;
+		const vector<glm::vec3> &normals = *geometry.normals;
+		const vector<glm::vec2> &texCoords = *geometry.texCoords;
+
+		Vertex *vertices = mesh.vertices.data() + range.firstVertex;
+		GLuint *indices = mesh.indices.data() + range.firstIndex;
+		GLuint vertex = (GLuint)range.firstVertex;
+
+		for (size_t f = range.firstFace; f < range.firstFace + range.numFaces; f++)
+		{
+			const Face &face = chunk.faces[f];
+			for (GLuint k = 0; k < face.numCorners; k++)
+			{
+				Corner corner = chunk.corners[face.firstCorner + k];
+				char relative = chunk.relative[face.firstCorner + k];
+				corner.position += (relative & 1) ? chunk.positionBase : 0;
+				if (corner.position < 0 || corner.position >= (int)positions.size())
+				{
+					return false;
+				}
+
+				Vertex &out = *vertices++;
+				out.Position = positions[corner.position];
+				out.Normal = glm::vec3(0.0f, 0.0f, 0.0f);
+				out.TexCoords = glm::vec2(0.0f, 0.0f);
+				if (corner.normal != MISSING)
+				{
+					corner.normal += (relative & 4) ? chunk.normalBase : 0;
+					if (corner.normal < 0 || corner.normal >= (int)normals.size())
+					{
+						return false;
+					}
+					out.Normal = normals[corner.normal];
+				}
+				if (corner.texCoord != MISSING)
+				{
+					corner.texCoord += (relative & 2) ? chunk.texCoordBase : 0;
+					if (corner.texCoord < 0 || corner.texCoord >= (int)texCoords.size())
+					{
+						return false;
+					}
+					// aiProcess_FlipUVs
+					out.TexCoords = glm::vec2(texCoords[corner.texCoord].x, 1.0f - texCoords[corner.texCoord].y);
+				}
+			}
+
+			const Vertex *corners = vertices - face.numCorners;
+			indices = Triangulate(corners, face.numCorners, vertex, indices);
+			vertex += face.numCorners;
+		}
+		return true;
+	}
+
+	static GLuint *Triangulate(const Vertex *corners, GLuint numCorners, GLuint first, GLuint *indices)
+	{
+		if (numCorners == 3)
+		{
+			*indices++ = first;
+			*indices++ = first + 1;
+			*indices++ = first + 2;
+			return indices;
+		}
+
+		if (numCorners == 4)
+		{
+			// Fan from the concave corner, if there is one (the rule of Assimp's TriangulateProcess)
+			GLuint start = 0;
+			for (GLuint i = 0; i < 4; i++)
+			{
+				const glm::vec3 &v = corners[i].Position;
+				glm::vec3 left = corners[(i + 3) % 4].Position - v;
+				glm::vec3 diagonal = corners[(i + 2) % 4].Position - v;
+				glm::vec3 right = corners[(i + 1) % 4].Position - v;
+				float leftLength = glm::length(left), diagonalLength = glm::length(diagonal), rightLength = glm::length(right);
+				if (leftLength == 0.0f || diagonalLength == 0.0f || rightLength == 0.0f)
+				{
+					continue;
+				}
+				float angle = acos(glm::clamp(glm::dot(left, diagonal) / (leftLength * diagonalLength), -1.0f, 1.0f)) +
+					acos(glm::clamp(glm::dot(right, diagonal) / (rightLength * diagonalLength), -1.0f, 1.0f));
+				if (angle > 3.14159265f)
+				{
+					start = i;
+					break;
+				}
+			}
+			*indices++ = first + start;
+			*indices++ = first + (start + 1) % 4;
+			*indices++ = first + (start + 2) % 4;
+			*indices++ = first + start;
+			*indices++ = first + (start + 2) % 4;
+			*indices++ = first + (start + 3) % 4;
+			return indices;
+		}
+
+		// Ear clipping in the plane of the polygon
+		glm::vec3 normal(0.0f);
+		for (GLuint i = 0; i < numCorners; i++)
+		{
+			const glm::vec3 &a = corners[i].Position, &b = corners[(i + 1) % numCorners].Position;
+			normal += glm::vec3((a.y - b.y) * (a.z + b.z), (a.z - b.z) * (a.x + b.x), (a.x - b.x) * (a.y + b.y));
+		}
+		int axis = fabs(normal.x) > fabs(normal.y) ? (fabs(normal.x) > fabs(normal.z) ? 0 : 2) : (fabs(normal.y) > fabs(normal.z) ? 1 : 2);
+		int u = (axis + 1) % 3, v = (axis + 2) % 3;
+		float sign = normal[axis] < 0.0f ? -1.0f : 1.0f;
+
+		vector<GLuint> remaining(numCorners);
+		for (GLuint i = 0; i < numCorners; i++)
+		{
+			remaining[i] = i;
+		}
+
+		while (remaining.size() > 3)
+		{
+			size_t n = remaining.size(), ear = 0;
+			bool found = false;
+			for (size_t i = 0; i < n && !found; i++)
+			{
+				const glm::vec3 &a = corners[remaining[(i + n - 1) % n]].Position;
+				const glm::vec3 &b = corners[remaining[i]].Position;
+				const glm::vec3 &c = corners[remaining[(i + 1) % n]].Position;
+				if (Cross2D(a, b, c, u, v) * sign <= 0.0f)
+				{
+					continue; // Reflex or degenerate corner
+				}
+
+				found = true;
+				for (size_t j = 0; j < n && found; j++)
+				{
+					size_t k = remaining[j];
+					if (j != i && j != (i + n - 1) % n && j != (i + 1) % n)
+					{
+						const glm::vec3 &p = corners[k].Position;
+						found = !(Cross2D(a, b, p, u, v) * sign >= 0.0f && Cross2D(b, c, p, u, v) * sign >= 0.0f && Cross2D(c, a, p, u, v) * sign >= 0.0f);
+					}
+				}
+				ear = i;
+			}
+			if (!found)
+			{
+				ear = 0; // Self-intersecting polygon: clip anything so every corner is still used
+			}
+
+			*indices++ = first + remaining[(ear + n - 1) % n];
+			*indices++ = first + remaining[ear];
+			*indices++ = first + remaining[(ear + 1) % n];
+			remaining.erase(remaining.begin() + ear);
+		}
+		*indices++ = first + remaining[0];
+		*indices++ = first + remaining[1];
+		*indices++ = first + remaining[2];
+		return indices;
+	}
+
+	static float Cross2D(const glm::vec3 &a, const glm::vec3 &b, const glm::vec3 &c, int u, int v)
+	{
+		return (b[u] - a[u]) * (c[v] - a[v]) - (b[v] - a[v]) * (c[u] - a[u]);
+	}
+
+	static void AddTexture(MeshData &mesh, const string &type, const string &path)
+	{
+		if (!path.empty())
+		{
+			TextureRef texture;
+			texture.type = type;
+			texture.path = path;
+			mesh.textures.push_back(texture);
+		}
+	}
+
+	// Texture path of a map_ statement, skipping its options ("map_Kd -o 0 -1 0 file.png")
+	static string TexturePath(const char *p, const char *end)
+	{
+		static const struct { const char *name; int arguments; } options[] = {
+			{ "-blendu", 1 }, { "-blendv", 1 }, { "-boost", 1 }, { "-cc", 1 }, { "-clamp", 1 }, { "-imfchan", 1 },
+			{ "-type", 1 }, { "-bm", 1 }, { "-texres", 1 }, { "-mm", 2 }, { "-o", 3 }, { "-s", 3 }, { "-t", 3 }
+		};
+
+		p = SkipSpaces(p, end);
+		while (p < end && *p == '-')
+		{
+			const char *nameEnd = p;
+			while (nameEnd < end && !IsSpace(*nameEnd))
+			{
+				nameEnd++;
+			}
+			int arguments = 0;
+			for (size_t i = 0; i < sizeof(options) / sizeof(options[0]); i++)
+			{
+				if (strlen(options[i].name) == (size_t)(nameEnd - p) && memcmp(options[i].name, p, nameEnd - p) == 0)
+				{
+					arguments = options[i].arguments;
+				}
+			}
+			p = SkipSpaces(nameEnd, end);
+
+			// Options take up to their number of arguments, as long as they are numbers or on/off
+			for (int a = 0; a < arguments && p < end; a++)
+			{
+				const char *s = p;
+				float value;
+				if (!ParseFloat(s, end, value))
+				{
+					if (end - p >= 2 && (memcmp(p, "on", 2) == 0 || memcmp(p, "of", 2) == 0))
+					{
+						s = p;
+						while (s < end && !IsSpace(*s))
+						{
+							s++;
+						}
+					}
+					else
+					{
+						break;
+					}
+				}
+				p = SkipSpaces(s, end);
+			}
+		}
+		return RestOfLine(p, end);
+	}
+
+	static void LoadMaterials(const string &path, map<string, Material> &materials)
+	{
+		AssetFile file;
+		if (!file.Open(path))
+		{
+			cout << "ERROR::OBJ::MATERIAL_NOT_FOUND " << path << endl;
+			return;
+		}
+
+		const char *p = (const char *)file.Data(), *end = p + file.Size();
+		Material *material = nullptr;
+		while (p < end)
+		{
+			const char *lineEnd = (const char *)memchr(p, '\n', end - p);
+			lineEnd = lineEnd ? lineEnd : end;
+			const char *line = SkipSpaces(p, lineEnd);
+			p = lineEnd + 1;
+
+			if (Keyword(line, lineEnd, "newmtl", 6))
+			{
+				material = &materials[RestOfLine(line + 6, lineEnd)];
+				*material = Material();
+			}
+			else if (material && Keyword(line, lineEnd, "map_Kd", 6))
+			{
+				material->diffuse = TexturePath(line + 6, lineEnd);
+			}
+			else if (material && Keyword(line, lineEnd, "map_Ks", 6))
+			{
+				material->specular = TexturePath(line + 6, lineEnd);
+			}
+		}
+	}
+};
@@ -0,0 +1,201 @@
+#pragma once
+
+#include <cmath>
+#include <iostream>
+#include <algorithm>
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include "Mesh.h"
+
+using namespace std;
+
+/*
+	State of the frame being drawn that the models need to pick their level of detail: the camera, the projection
+	and the model matrix of the draw in progress (set with SetModelMatrix, see RenderQueue.h, in place of glUniformMatrix4fv).
+	It also holds the planes of the view frustum, for what is culled by its bounds (see StaticBatch).
+
+	A model's level comes from the height of its bounding sphere on screen, as a fraction of the viewport height.
+	The boundaries between levels are in SelectLod; a draw only moves to a coarser level once it is
+	LOD_HYSTERESIS below the boundary, and back to a finer one once it is that much above it, so a model sitting
+	on a boundary doesn't pop back and forth every frame.
+*/
+
+#define LOD_HYSTERESIS 0.15f
+
+// Triangles drawn during one frame by models that have levels of detail
+struct LodFrameStats
+{
+	size_t drawnTriangles = 0;
+	size_t fullTriangles = 0;  // What the same draws would have cost at full detail
+	GLuint draws[MESH_MAX_LODS] = { 0 }; // Model draws per level
+
+	size_t SavedTriangles() const
+	{
+		return this->fullTriangles - this->drawnTriangles;
+	}
+};
+
+class RenderContext
+{
+public:
+	static RenderContext &Get()
+	{
+		static RenderContext context;
+		return context;
+	}
+
+	bool lodEnabled = true; // false draws every model at full detail, to compare
+
+	// Once per frame, before the first draw
+	void BeginFrame(const glm::vec3 &cameraPosition, const glm::mat4 &projection, const glm::mat4 &view)
+	{
+		this->frame++;
+		this->lastFrameStats = this->frameStats;
+		this->frameStats = LodFrameStats();
+
+		this->cameraPosition = cameraPosition;
+		// 1 / tan(fovy / 2): the viewport is 2 / projectionScale units high at distance 1
+		this->projectionScale = projection[1][1];
+
+		// Planes of the frustum from the rows of projection * view: left, right, bottom, top, near, far, each
+		// scaled so its normal is unit and a dot product is a distance
+		glm::mat4 clip = projection * view;
+		for (int i = 0; i < 6; i++)
+		{
+			int axis = i / 2;
+			float sign = i % 2 == 0 ? 1.0f : -1.0f;
+			glm::vec4 plane;
+			for (int k = 0; k < 4; k++)
+			{
+				plane[k] = clip[k][3] + sign * clip[k][axis];
+			}
+			float length = glm::length(glm::vec3(plane));
+			this->frustum[i] = length > 0.0f ? plane / length : plane;
+		}
+	}
+
+	// A world-space sphere is at least partly inside the view frustum of the frame
+	bool SphereVisible(const glm::vec3 &center, float radius) const
+	{
+		for (int i = 0; i < 6; i++)
+		{
+			if (glm::dot(glm::vec3(this->frustum[i]), center) + this->frustum[i].w < -radius)
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	GLuint Frame() const
+	{
+		return this->frame;
+	}
+
+	void SetModel(const glm::mat4 &model)
+	{
+		this->model = model;
+	}
+
+	const glm::mat4 &Model() const
+	{
+		return this->model;
+	}
+
+	// Distance from the camera to a point given in the space of the current model matrix
+	float Distance(const glm::vec3 &point) const
+	{
+		return this->Distance(this->model, point);
+	}
+
+	float Distance(const glm::mat4 &model, const glm::vec3 &point) const
+	{
+		return glm::length(glm::vec3(model * glm::vec4(point, 1.0f)) - this->cameraPosition);
+	}
+
+	// Fraction of the viewport height covered by a sphere given in the space of the current model matrix
+	float ScreenSize(const glm::vec3 &center, float radius) const
+	{
+		return this->ScreenSize(this->model, center, radius);
+	}
+
+	float ScreenSize(const glm::mat4 &model, const glm::vec3 &center, float radius) const
+	{
+		glm::vec3 worldCenter = glm::vec3(model * glm::vec4(center, 1.0f));
+		float worldRadius = radius * MaxScale(model);
+
+		float distance = glm::length(worldCenter - this->cameraPosition);
+		if (distance <= worldRadius)
+		{
+			return 1.0f;
+		}
+		return worldRadius * this->projectionScale / distance;
+	}
+
+	// Level for a draw that used current in the previous frame
+	GLuint SelectLod(float screenSize, GLuint current, GLuint numLods) const
+	{
+		if (!this->lodEnabled || numLods <= 1)
+		{
+			return 0;
+		}
+
+		// Below these fractions of the viewport height the next level is used
+		static const float boundaries[MESH_MAX_LODS - 1] = { 0.5f, 0.25f, 0.1f };
+
+		GLuint level = min(current, numLods - 1);
+		while (level + 1 < numLods && screenSize < boundaries[level] * (1.0f - LOD_HYSTERESIS))
+		{
+			level++;
+		}
+		while (level > 0 && screenSize > boundaries[level - 1] * (1.0f + LOD_HYSTERESIS))
+		{
+			level--;
+		}
+		return level;
+	}
+
+	// Largest scale of a matrix along its axes, what a bounding sphere's radius grows by
+	static float MaxScale(const glm::mat4 &model)
+	{
+		return max(glm::length(glm::vec3(model[0])), max(glm::length(glm::vec3(model[1])), glm::length(glm::vec3(model[2]))));
+	}
+
+	void CountDraw(GLuint level, size_t drawnTriangles, size_t fullTriangles)
+	{
+		this->frameStats.draws[min(level, (GLuint)MESH_MAX_LODS - 1)]++;
+		this->frameStats.drawnTriangles += drawnTriangles;
+		this->frameStats.fullTriangles += fullTriangles;
+	}
+
+	// Stats of the last complete frame
+	const LodFrameStats &LastFrameStats() const
+	{
+		return this->lastFrameStats;
+	}
+
+	void PrintLodStats() const
+	{
+		const LodFrameStats &stats = this->lastFrameStats;
+		double saved = stats.fullTriangles ? 100.0 * stats.SavedTriangles() / stats.fullTriangles : 0.0;
+		cout << "LOD: " << stats.drawnTriangles << " triangulos dibujados de " << stats.fullTriangles << " | ahorro "
+			<< stats.SavedTriangles() << " (" << saved << "%) | dibujos por nivel";
+		for (GLuint i = 0; i < MESH_MAX_LODS; i++)
+		{
+			cout << (i == 0 ? " " : " / ") << stats.draws[i];
+		}
+		cout << (this->lodEnabled ? "" : " (LOD desactivado)") << endl;
+	}
+
+private:
+	GLuint frame = 0;
+	glm::vec3 cameraPosition;
+	float projectionScale = 1.0f;
+	glm::mat4 model = glm::mat4(1.0f);
+	glm::vec4 frustum[6]; // Unit normal in xyz, offset in w: inside where dot(normal, p) + w >= 0
+
+	LodFrameStats frameStats;
+	LodFrameStats lastFrameStats;
+};
@@ -0,0 +1,690 @@
+#pragma once
+
+#include <map>
+#include <chrono>
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <algorithm>
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include "Material.h"
+#include "RenderContext.h"
+
+using namespace std;
+
+/*
+	Draws of the frame collected and issued in the order that changes the least state.
+
+	Between Begin and Flush, Model::Draw and the floors submit one RenderCommand per mesh instead of drawing. Each
+	command gets a 64-bit key, from the high bits down: the pass, the program, the material (its first diffuse
+	texture), the VAO and the distance to the camera. Flush sorts the commands by key and issues them through a
+	filter that remembers the program, VAO, textures per unit and uniforms last set, and skips every bind or
+	uniform that would set what is already there. Opaque draws go front to back inside each state group; blended
+	ones are sorted back to front before anything else, as blending needs.
+
+	The frame stats count what was actually issued, and next to it what the same commands cost in the order they
+	were submitted with every bind made, which is what drawing them right away did. With the queue disabled
+	(--no-render-queue) everything is drawn at submission, as before, and both counts are that path's.
+
+	Where the driver has multi-draw indirect with base instance (GL 4.3, or ARB_multi_draw_indirect and
+	ARB_base_instance on the 3.3 context), Flush issues each run of sorted commands that share all their state as
+	one glMultiDrawElementsIndirect (or glMultiDrawArraysIndirect for the floors) instead of one call per command.
+	The model and normal matrices of every draw go, once per frame, into a buffer read by lighting.vs through the
+	drawData buffer texture, RENDER_DRAW_DATA_TEXELS texels per draw (lighting.vs is compiled with ShaderDefines so
+	it reads the same layout); each draw's baseInstance is its slot there, which reaches the shader through a
+	draw-index attribute of divisor 1 over an identity buffer. Textures can't change inside a call without bindless
+	textures, so the material still splits the runs and is bound between them as before. Without the extensions,
+	or with it turned off (--no-indirect, F5), every command is its own draw call, and the CPU time of Flush,
+	averaged over the last frames, is printed with the stats to compare both.
+*/
+
+#define RENDER_MAX_UNITS (MATERIAL_SPECULAR_UNIT + MATERIAL_MAX_SAMPLERS)
+#define RENDER_MAX_DEPTH 200.0f // Distances beyond this share the last depth step of the key
+#define RENDER_ATTRIBUTE_DRAW_INDEX 10 // Slot of the draw in the drawData buffer, after InstanceBatch's attributes
+#define RENDER_DRAW_DATA_TEXELS 7 // RGBA32F per draw: the model matrix's columns, then the normal matrix's
+static_assert(RENDER_DRAW_DATA_TEXELS == 4 + 3, "drawData holds a mat4 and a mat3 per draw");
+
+// Blend state of a draw, set with RenderQueue::SetPass before submitting it
+enum RenderPass
+{
+	RENDER_PASS_OPAQUE,       // No blending
+	RENDER_PASS_BLEND,        // Alpha blending
+	RENDER_PASS_BLEND_CUTOUT  // Alpha blending, discarding the fragments of low alpha (transparency = 1)
+};
+
+// One mesh (or floor) to draw with everything it needs set
+struct RenderCommand
+{
+	uint64_t key = 0;
+	RenderPass pass = RENDER_PASS_OPAQUE;
+	const MaterialProgram *program = nullptr;
+	const Material *material = nullptr;
+	GLuint VAO = 0;
+	bool indexed = true;      // glDrawElementsBaseVertex; otherwise glDrawArrays from firstVertex
+	GLsizei count = 0;
+	GLuint firstIndex = 0;
+	GLint baseVertex = 0;
+	GLint firstVertex = 0;
+	GLsizei instances = 0;    // More than 0: that many placements from the instance attributes of the VAO, see InstanceBatch
+	bool packed = false;      // PackedVertex geometry, see MeshBuffer
+	glm::vec3 positionOffset;
+	glm::vec3 positionScale;
+	glm::mat4 model;
+};
+
+// DrawElementsIndirectCommand. Array draws read the first four fields as a DrawArraysIndirectCommand (count,
+// instanceCount, first vertex, baseInstance), so both kinds share one buffer and one stride.
+struct RenderIndirectCommand
+{
+	GLuint count;
+	GLuint instanceCount;
+	GLuint first;
+	GLint baseVertex;    // Base instance of an array draw
+	GLuint baseInstance; // Unused by an array draw
+};
+
+// GL calls of one frame
+struct RenderFrameStats
+{
+	GLuint draws = 0;
+	GLuint programBinds = 0;
+	GLuint vaoBinds = 0;
+	GLuint textureBinds = 0;
+	GLuint uniforms = 0;
+	GLuint passChanges = 0; // Blend enable/disable and the transparency uniform
+	GLuint indirectDraws = 0; // Commands drawn inside multi-draw calls, each call counting once in draws
+
+	GLuint StateChanges() const
+	{
+		return this->programBinds + this->vaoBinds + this->textureBinds + this->uniforms + this->passChanges;
+	}
+};
+
+class RenderQueue
+{
+public:
+	static RenderQueue &Get()
+	{
+		static RenderQueue queue;
+		return queue;
+	}
+
+	bool enabled = true; // false draws at submission, in source order, as before
+	bool indirect = true; // false gives every command its own draw call even where multi-draw indirect exists
+
+	// The driver has what the multi-draw path needs. Call on the GL thread after glewInit.
+	bool IndirectSupported() const
+	{
+		return GLEW_VERSION_4_3 || (GLEW_ARB_multi_draw_indirect && GLEW_ARB_base_instance);
+	}
+
+	// Defines to compile lighting.vs with (see Shader), so it reads drawData with the layout written here
+	static string ShaderDefines()
+	{
+		return "#define RENDER_DRAW_DATA_TEXELS " + to_string(RENDER_DRAW_DATA_TEXELS) + "\n";
+	}
+
+	// Switches the multi-draw path, restarting the average time of Flush
+	void SetIndirect(bool indirect)
+	{
+		this->indirect = indirect;
+		this->flushMs = 0.0;
+	}
+
+	// Once per frame, with the program that draws the scene in use
+	void Begin(GLuint program)
+	{
+		this->lastFrameStats = this->frameStats;
+		this->lastSubmitStats = this->submitStats;
+		this->frameStats = RenderFrameStats();
+		this->submitStats = RenderFrameStats();
+
+		this->program = &MaterialProgram::For(program);
+		this->pass = RENDER_PASS_OPAQUE;
+		this->commands.clear();
+		this->recording = this->enabled;
+	}
+
+	// Draws are being collected for Flush rather than drawn
+	bool IsRecording() const
+	{
+		return this->recording;
+	}
+
+	// Program given to Begin
+	const MaterialProgram &Program() const
+	{
+		return *this->program;
+	}
+
+	// Blend state of the draws submitted from now on. Drawing right away, it is applied at once.
+	void SetPass(RenderPass pass)
+	{
+		if (!this->recording && pass != this->pass)
+		{
+			this->applyPass(pass, *this->program);
+			this->count(this->frameStats.passChanges, this->submitStats.passChanges, 1);
+		}
+		this->pass = pass;
+	}
+
+	RenderPass Pass() const
+	{
+		return this->pass;
+	}
+
+	// Queues a draw. depth is its distance to the camera.
+	void Submit(RenderCommand &command, float depth)
+	{
+		command.pass = this->pass;
+		command.key = makeKey(command, depth);
+		this->commands.push_back(command);
+
+		// What the command costs drawn on its own, every bind made
+		this->submitStats.draws++;
+		this->submitStats.vaoBinds++;
+		this->submitStats.textureBinds += command.material->NumBindings();
+		this->submitStats.uniforms += (command.instances > 0 ? 3 : 2) + (command.packed ? 3 : 0);
+	}
+
+	// Material of a floor or wall: its texture and the shininess the frame sets for the scene's own geometry
+	const Material &SurfaceMaterial(GLuint texture, GLfloat shininess)
+	{
+		map<GLuint, Material>::iterator it = this->surfaces.find(texture);
+		if (it == this->surfaces.end())
+		{
+			vector<Texture> textures(1);
+			textures[0].id = texture;
+			textures[0].type = "texture_diffuse";
+			it = this->surfaces.insert(make_pair(texture, Material(textures, shininess))).first;
+		}
+		return it->second;
+	}
+
+	// Calls made by the draws that don't go through the queue, counted for both sides of the stats
+	void CountImmediate(GLuint draws, GLuint vaoBinds, GLuint textureBinds, GLuint uniforms)
+	{
+		this->count(this->frameStats.draws, this->submitStats.draws, draws);
+		this->count(this->frameStats.vaoBinds, this->submitStats.vaoBinds, vaoBinds);
+		this->count(this->frameStats.textureBinds, this->submitStats.textureBinds, textureBinds);
+		this->count(this->frameStats.uniforms, this->submitStats.uniforms, uniforms);
+	}
+
+	// Sorts and draws the queued commands, then leaves the program of Begin in use, no VAO bound, unit 0 active
+	// and the opaque pass set
+	void Flush()
+	{
+		if (!this->recording)
+		{
+			this->SetPass(RENDER_PASS_OPAQUE);
+			return;
+		}
+		this->recording = false;
+		chrono::steady_clock::time_point start = chrono::steady_clock::now();
+
+		// Sorted through an index list so the commands (with their matrices) aren't moved around
+		this->order.resize(this->commands.size());
+		for (size_t i = 0; i < this->order.size(); i++)
+		{
+			this->order[i] = (GLuint)i;
+		}
+		const vector<RenderCommand> &commands = this->commands;
+		stable_sort(this->order.begin(), this->order.end(), [&commands](GLuint a, GLuint b) { return commands[a].key < commands[b].key; });
+
+		// Whatever was bound before is unknown, so the first command sets everything
+		State state;
+		bool indirect = this->indirect && this->IndirectSupported();
+		if (indirect)
+		{
+			this->executeIndirect(state);
+		}
+		else
+		{
+			for (size_t i = 0; i < this->order.size(); i++)
+			{
+				this->execute(this->commands[this->order[i]], state);
+			}
+		}
+
+		if (state.program != this->program->program)
+		{
+			glUseProgram(this->program->program);
+			this->frameStats.programBinds++;
+		}
+		if (state.pass != RENDER_PASS_OPAQUE)
+		{
+			this->applyPass(RENDER_PASS_OPAQUE, *this->program);
+			this->frameStats.passChanges++;
+		}
+		// The float layout and the matrices from the model uniform, which is what the draws made outside the queue expect
+		if (state.packed == 1)
+		{
+			glUniform1i(this->program->packedVertices, 0);
+			this->frameStats.uniforms++;
+		}
+		if (state.instanced == 1)
+		{
+			glUniform1i(this->program->instanced, 0);
+			this->frameStats.uniforms++;
+		}
+		if (state.indirect == 1)
+		{
+			glUniform1i(this->program->indirect, 0);
+			this->frameStats.uniforms++;
+		}
+		this->pass = RENDER_PASS_OPAQUE;
+		glBindVertexArray(0);
+		glActiveTexture(GL_TEXTURE0);
+		if (indirect)
+		{
+			glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+			glBindBuffer(GL_ARRAY_BUFFER, 0);
+		}
+		this->commands.clear();
+
+		// Sorting and issuing, averaged over roughly the last 30 frames
+		double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+		this->flushMs = this->flushMs == 0.0 ? ms : this->flushMs + (ms - this->flushMs) / 30.0;
+	}
+
+	void PrintStats() const
+	{
+		const RenderFrameStats &before = this->lastSubmitStats, &after = this->lastFrameStats;
+		cout << "Render" << (this->enabled ? "" : " (cola desactivada)") << ": " << after.draws << " dibujos";
+		if (after.indirectDraws)
+		{
+			cout << " (" << after.indirectDraws << " mallas en llamadas indirectas)";
+		}
+		if (this->enabled)
+		{
+			cout << " | envio CPU " << this->flushMs << " ms" << (this->indirect && this->IndirectSupported() ? " (indirecto)" : " (directo)");
+		}
+		cout << " | estado "
+			<< before.StateChanges() << " -> " << after.StateChanges() << " | texturas " << before.textureBinds << " -> " << after.textureBinds
+			<< " | VAOs " << before.vaoBinds << " -> " << after.vaoBinds << " | programas " << before.programBinds << " -> " << after.programBinds
+			<< " | uniforms " << before.uniforms << " -> " << after.uniforms << " | blend " << before.passChanges << " -> " << after.passChanges << endl;
+	}
+
+	// Stats of the last complete frame: as issued, and in submission order without the filter
+	const RenderFrameStats &LastFrameStats() const
+	{
+		return this->lastFrameStats;
+	}
+
+	const RenderFrameStats &LastSubmitStats() const
+	{
+		return this->lastSubmitStats;
+	}
+
+private:
+	// What the filter knows to be set. ~0 is unknown.
+	struct State
+	{
+		GLuint program = ~0u;
+		GLuint pass = ~0u;
+		GLuint VAO = ~0u;
+		GLuint textures[RENDER_MAX_UNITS];
+		GLuint activeUnit = ~0u;
+		GLfloat shininess = -1.0f;
+		GLuint packed = ~0u;
+		glm::vec3 positionOffset, positionScale;
+		GLuint instanced = ~0u;
+		GLuint indirect = 0; // Only the multi-draw path sets it, and Flush clears it again
+		GLuint drawIndexVAO = ~0u; // VAO whose draw-index attribute was last pointed at drawIndexBuffer
+		bool hasModel = false;
+		glm::mat4 model;
+
+		State()
+		{
+			for (GLuint i = 0; i < RENDER_MAX_UNITS; i++)
+			{
+				this->textures[i] = ~0u;
+			}
+		}
+	};
+
+	vector<RenderCommand> commands;
+	vector<GLuint> order;
+	map<GLuint, Material> surfaces;
+	const MaterialProgram *program = nullptr;
+	RenderPass pass = RENDER_PASS_OPAQUE;
+	bool recording = false;
+
+	RenderFrameStats frameStats, submitStats;
+	RenderFrameStats lastFrameStats, lastSubmitStats;
+	double flushMs = 0.0;
+
+	// Sorted commands drawn together: by one multi-draw call, or on their own if instanced
+	struct Run
+	{
+		GLuint first;         // In order
+		GLuint count;
+		GLuint firstIndirect; // In indirectCommands
+		bool indirect;
+	};
+
+	vector<Run> runs;
+	vector<RenderIndirectCommand> indirectCommands;
+	vector<glm::vec4> drawData;
+	GLuint indirectBuffer = 0;
+	GLuint drawDataBuffer = 0, drawDataTexture = 0;
+	GLuint drawIndexBuffer = 0;
+	GLuint drawIndexCapacity = 0;
+
+	void count(GLuint &issued, GLuint &submitted, GLuint n)
+	{
+		issued += n;
+		submitted += n;
+	}
+
+	static uint64_t makeKey(const RenderCommand &command, float depth)
+	{
+		uint64_t steps = (uint64_t)(min(max(depth, 0.0f), RENDER_MAX_DEPTH) / RENDER_MAX_DEPTH * 0x3FFFFF); // 22 bits
+		uint64_t pass = command.pass;
+		uint64_t program = min(command.program->index, 0xFFu);
+		uint64_t material = min(command.material->SortId(), 0xFFFFFu);
+		uint64_t vao = min(command.VAO, 0xFFFu);
+
+		// pass 2 | program 8 | material 20 | VAO 12 | depth 22
+		if (command.pass == RENDER_PASS_OPAQUE)
+		{
+			return pass << 62 | program << 54 | material << 34 | vao << 22 | steps;
+		}
+		// Blending: farthest first, the state only breaks ties
+		return pass << 62 | (0x3FFFFF - steps) << 40 | program << 32 | material << 12 | vao;
+	}
+
+	void applyPass(RenderPass pass, const MaterialProgram &program)
+	{
+		if (pass == RENDER_PASS_OPAQUE)
+		{
+			glDisable(GL_BLEND);
+		}
+		else
+		{
+			glEnable(GL_BLEND);
+			glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+		}
+		glUniform1i(program.transparency, pass == RENDER_PASS_BLEND_CUTOUT ? 1 : 0);
+	}
+
+	// Everything a command needs set except its matrices
+	void bind(const RenderCommand &command, State &state)
+	{
+		RenderFrameStats &stats = this->frameStats;
+		const MaterialProgram &program = *command.program;
+
+		if (state.program != program.program)
+		{
+			// Outside the multi-draw path every program has the indirect flag clear
+			if (state.indirect == 1)
+			{
+				glUniform1i(MaterialProgram::For(state.program).indirect, 0);
+				stats.uniforms++;
+			}
+			glUseProgram(program.program);
+			stats.programBinds++;
+			// Uniforms are state of the program
+			state = State();
+			state.program = program.program;
+		}
+		if (state.pass != (GLuint)command.pass)
+		{
+			this->applyPass(command.pass, program);
+			stats.passChanges++;
+			state.pass = command.pass;
+		}
+		if (state.VAO != command.VAO)
+		{
+			glBindVertexArray(command.VAO);
+			stats.vaoBinds++;
+			state.VAO = command.VAO;
+		}
+
+		const Material &material = *command.material;
+		for (GLuint i = 0; i < material.NumBindings(); i++)
+		{
+			GLuint unit, id;
+			material.GetBinding(i, unit, id);
+			if (state.textures[unit] != id)
+			{
+				if (state.activeUnit != unit)
+				{
+					glActiveTexture(GL_TEXTURE0 + unit);
+					state.activeUnit = unit;
+				}
+				glBindTexture(GL_TEXTURE_2D, id);
+				stats.textureBinds++;
+				state.textures[unit] = id;
+			}
+		}
+		if (state.shininess != material.Shininess())
+		{
+			glUniform1f(program.shininess, material.Shininess());
+			stats.uniforms++;
+			state.shininess = material.Shininess();
+		}
+
+		if (state.packed != (GLuint)command.packed)
+		{
+			glUniform1i(program.packedVertices, command.packed ? 1 : 0);
+			stats.uniforms++;
+			state.packed = command.packed;
+		}
+		if (command.packed && (state.positionOffset != command.positionOffset || state.positionScale != command.positionScale))
+		{
+			glUniform3f(program.positionOffset, command.positionOffset.x, command.positionOffset.y, command.positionOffset.z);
+			glUniform3f(program.positionScale, command.positionScale.x, command.positionScale.y, command.positionScale.z);
+			stats.uniforms += 2;
+			state.positionOffset = command.positionOffset;
+			state.positionScale = command.positionScale;
+		}
+	}
+
+	// Sets a flag uniform of the program if the filter doesn't know it to have that value already
+	void setFlag(GLint location, GLuint value, GLuint &known)
+	{
+		if (known != value)
+		{
+			glUniform1i(location, (GLint)value);
+			this->frameStats.uniforms++;
+			known = value;
+		}
+	}
+
+	// One command as its own draw call
+	void execute(const RenderCommand &command, State &state)
+	{
+		RenderFrameStats &stats = this->frameStats;
+		const MaterialProgram &program = *command.program;
+		this->bind(command, state);
+		this->setFlag(program.indirect, 0, state.indirect);
+
+		GLuint instanced = command.instances > 0 ? 1 : 0;
+		this->setFlag(program.instanced, instanced, state.instanced);
+		if (!instanced && (!state.hasModel || memcmp(&state.model, &command.model, sizeof(glm::mat4)) != 0))
+		{
+			glUniformMatrix4fv(program.model, 1, GL_FALSE, glm::value_ptr(command.model));
+			stats.uniforms++;
+			state.hasModel = true;
+			state.model = command.model;
+		}
+
+		if (instanced)
+		{
+			glDrawElementsInstancedBaseVertex(GL_TRIANGLES, command.count, GL_UNSIGNED_INT, (GLvoid *)(command.firstIndex * sizeof(GLuint)), command.instances, command.baseVertex);
+		}
+		else if (command.indexed)
+		{
+			glDrawElementsBaseVertex(GL_TRIANGLES, command.count, GL_UNSIGNED_INT, (GLvoid *)(command.firstIndex * sizeof(GLuint)), command.baseVertex);
+		}
+		else
+		{
+			glDrawArrays(GL_TRIANGLES, command.firstVertex, command.count);
+		}
+		stats.draws++;
+	}
+
+	// The commands of a run draw with a single call: same state and the same kind of draw
+	static bool sameRun(const RenderCommand &a, const RenderCommand &b)
+	{
+		return a.instances == 0 && b.instances == 0 && a.program == b.program && a.pass == b.pass && a.VAO == b.VAO
+			&& a.indexed == b.indexed && a.packed == b.packed
+			&& (!a.packed || (a.positionOffset == b.positionOffset && a.positionScale == b.positionScale))
+			&& a.material->SameAs(*b.material);
+	}
+
+	// The sorted commands as multi-draw calls
+	void executeIndirect(State &state)
+	{
+		RenderFrameStats &stats = this->frameStats;
+
+		// Runs, and the indirect command and matrices of every draw in them. Its index in both is the
+		// baseInstance that tells the shader where its matrices are.
+		this->runs.clear();
+		this->indirectCommands.clear();
+		this->drawData.clear();
+		for (size_t i = 0; i < this->order.size(); i++)
+		{
+			const RenderCommand &command = this->commands[this->order[i]];
+			if (command.instances > 0)
+			{
+				Run run = { (GLuint)i, 1, 0, false };
+				this->runs.push_back(run);
+				continue;
+			}
+			if (this->runs.empty() || !this->runs.back().indirect || !sameRun(this->commands[this->order[this->runs.back().first]], command))
+			{
+				Run run = { (GLuint)i, 0, (GLuint)this->indirectCommands.size(), true };
+				this->runs.push_back(run);
+			}
+			this->runs.back().count++;
+
+			GLuint slot = (GLuint)this->indirectCommands.size();
+			RenderIndirectCommand indirect;
+			indirect.count = command.count;
+			indirect.instanceCount = 1;
+			if (command.indexed)
+			{
+				indirect.first = command.firstIndex;
+				indirect.baseVertex = command.baseVertex;
+				indirect.baseInstance = slot;
+			}
+			else
+			{
+				indirect.first = command.firstVertex;
+				indirect.baseVertex = (GLint)slot;
+				indirect.baseInstance = 0;
+			}
+			this->indirectCommands.push_back(indirect);
+
+			glm::vec4 *texels = &*this->drawData.insert(this->drawData.end(), RENDER_DRAW_DATA_TEXELS, glm::vec4(0.0f));
+			glm::mat3 normal = glm::transpose(glm::inverse(glm::mat3(command.model)));
+			for (int k = 0; k < 4; k++)
+			{
+				texels[k] = command.model[k];
+			}
+			for (int k = 0; k < 3; k++)
+			{
+				texels[4 + k] = glm::vec4(normal[k], 0.0f);
+			}
+		}
+
+		this->upload();
+		glActiveTexture(GL_TEXTURE0 + MATERIAL_DRAW_DATA_UNIT);
+		glBindTexture(GL_TEXTURE_BUFFER, this->drawDataTexture);
+		state.activeUnit = MATERIAL_DRAW_DATA_UNIT;
+
+		for (size_t r = 0; r < this->runs.size(); r++)
+		{
+			const Run &run = this->runs[r];
+			const RenderCommand &first = this->commands[this->order[run.first]];
+			if (!run.indirect)
+			{
+				this->execute(first, state);
+				continue;
+			}
+
+			const MaterialProgram &program = *first.program;
+			this->bind(first, state);
+			if (state.drawIndexVAO != first.VAO)
+			{
+				// Set on every VAO the path binds, since a VAO deleted and created again may get the same name
+				glBindBuffer(GL_ARRAY_BUFFER, this->drawIndexBuffer);
+				glEnableVertexAttribArray(RENDER_ATTRIBUTE_DRAW_INDEX);
+				glVertexAttribIPointer(RENDER_ATTRIBUTE_DRAW_INDEX, 1, GL_UNSIGNED_INT, sizeof(GLuint), (GLvoid *)0);
+				glVertexAttribDivisor(RENDER_ATTRIBUTE_DRAW_INDEX, 1);
+				state.drawIndexVAO = first.VAO;
+			}
+			this->setFlag(program.instanced, 0, state.instanced);
+			this->setFlag(program.indirect, 1, state.indirect);
+
+			GLvoid *offset = (GLvoid *)(run.firstIndirect * sizeof(RenderIndirectCommand));
+			if (first.indexed)
+			{
+				glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, offset, run.count, sizeof(RenderIndirectCommand));
+			}
+			else
+			{
+				glMultiDrawArraysIndirect(GL_TRIANGLES, offset, run.count, sizeof(RenderIndirectCommand));
+			}
+			stats.draws++;
+			stats.indirectDraws += run.count;
+		}
+	}
+
+	// Uploads the frame's indirect commands and matrices, creating the buffers the first time, and grows the
+	// identity buffer behind the draw-index attribute to the number of draws
+	void upload()
+	{
+		if (!this->indirectBuffer)
+		{
+			glGenBuffers(1, &this->indirectBuffer);
+			glGenBuffers(1, &this->drawDataBuffer);
+			glGenBuffers(1, &this->drawIndexBuffer);
+			glGenTextures(1, &this->drawDataTexture);
+
+			glBindBuffer(GL_TEXTURE_BUFFER, this->drawDataBuffer);
+			glBufferData(GL_TEXTURE_BUFFER, sizeof(glm::vec4), nullptr, GL_STREAM_DRAW);
+			glActiveTexture(GL_TEXTURE0 + MATERIAL_DRAW_DATA_UNIT);
+			glBindTexture(GL_TEXTURE_BUFFER, this->drawDataTexture);
+			glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, this->drawDataBuffer);
+		}
+
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, this->indirectBuffer);
+		glBufferData(GL_DRAW_INDIRECT_BUFFER, this->indirectCommands.size() * sizeof(RenderIndirectCommand), this->indirectCommands.data(), GL_STREAM_DRAW);
+		glBindBuffer(GL_TEXTURE_BUFFER, this->drawDataBuffer);
+		glBufferData(GL_TEXTURE_BUFFER, this->drawData.size() * sizeof(glm::vec4), this->drawData.data(), GL_STREAM_DRAW);
+		glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+		GLuint draws = (GLuint)this->indirectCommands.size();
+		if (draws > this->drawIndexCapacity)
+		{
+			this->drawIndexCapacity = max(draws, this->drawIndexCapacity * 2);
+			vector<GLuint> indices(this->drawIndexCapacity);
+			for (GLuint i = 0; i < this->drawIndexCapacity; i++)
+			{
+				indices[i] = i;
+			}
+			glBindBuffer(GL_ARRAY_BUFFER, this->drawIndexBuffer);
+			glBufferData(GL_ARRAY_BUFFER, indices.size() * sizeof(GLuint), indices.data(), GL_STATIC_DRAW);
+		}
+	}
+};
+
+// Remembers the model matrix for the level of detail of the next Model::Draw and uploads it, unless the draws
+// are being queued: then each command carries its matrix and Flush uploads it
+inline void SetModelMatrix(GLint location, const glm::mat4 &model)
+{
+	RenderContext::Get().SetModel(model);
+	if (!RenderQueue::Get().IsRecording())
+	{
+		glUniformMatrix4fv(location, 1, GL_FALSE, glm::value_ptr(model));
+		RenderQueue::Get().CountImmediate(0, 0, 0, 1);
+	}
+}
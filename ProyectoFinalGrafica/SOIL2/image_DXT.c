@@ -19,6 +19,16 @@
 	method fails for finding the largest eigenvector	*/
 #define USE_COV_MAT	1
 
+/*	SSE2 block encoders, used unless DXT_use_SIMD( 0 ) is called	*/
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#define DXT_HAVE_SSE2	1
+#include <emmintrin.h>
+#else
+#define DXT_HAVE_SSE2	0
+#endif
+
+static int use_SIMD = DXT_HAVE_SSE2;
+
 /********* Function Prototypes *********/
 /*
 	Takes a 4x4 block of pixels and compresses it into 8 bytes
@@ -37,8 +47,41 @@ void compress_DDS_color_block(
 void compress_DDS_alpha_block(
 				const unsigned char *const uncompressed,
 				unsigned char compressed[8] );
+/*
+	Copies the 4x4 block at (i,j) into ublock with out_channels
+	per pixel (3 = RGB, 4 = RGBA), repeating its first pixel where
+	the block sticks out of the image.
+*/
+static void gather_DDS_block(
+				const unsigned char *const uncompressed,
+				int width, int height, int channels,
+				int i, int j, int out_channels,
+				unsigned char *ublock );
+#if DXT_HAVE_SSE2
+/*
+	The same encoders, four pixels at a time.  They take an
+	RGBA block and give exactly the blocks of the scalar ones.
+*/
+static void compress_DDS_color_block_SSE2(
+				const unsigned char *const uncompressed,
+				unsigned char compressed[8] );
+static void compress_DDS_alpha_block_SSE2(
+				const unsigned char *const uncompressed,
+				unsigned char compressed[8] );
+#endif
 
 /********* Actual Exposed Functions *********/
+int
+	DXT_use_SIMD
+	(
+		int enabled
+	)
+{
+	int previous = use_SIMD;
+	use_SIMD = DXT_HAVE_SSE2 && enabled;
+	return previous;
+}
+
 int
 	save_image_as_DDS
 	(
@@ -104,10 +147,10 @@ unsigned char* convert_image_to_DXT1(
 		int *out_size )
 {
 	unsigned char *compressed;
-	int i, j, x, y;
-	unsigned char ublock[16*3];
+	int i, j, x;
+	unsigned char ublock[16*4];
 	unsigned char cblock[8];
-	int index = 0, chan_step = 1;
+	int index = 0;
 	int block_count = 0;
 	/*	error check	*/
 	*out_size = 0;
@@ -117,11 +160,6 @@ unsigned char* convert_image_to_DXT1(
 	{
 		return NULL;
 	}
-	/*	for channels == 1 or 2, I do not step forward for R,G,B values	*/
-	if( channels < 3 )
-	{
-		chan_step = 0;
-	}
 	/*	get the RAM for the compressed image
 		(8 bytes per 4x4 pixel block)	*/
 	*out_size = ((width+3) >> 2) * ((height+3) >> 2) * 8;
@@ -131,44 +169,19 @@ unsigned char* convert_image_to_DXT1(
 	{
 		for( i = 0; i < width; i += 4 )
 		{
-			/*	copy this block into a new one	*/
-			int idx = 0;
-			int mx = 4, my = 4;
-			if( j+4 >= height )
-			{
-				my = height - j;
-			}
-			if( i+4 >= width )
-			{
-				mx = width - i;
-			}
-			for( y = 0; y < my; ++y )
+			/*	compress the block (the SSE2 encoder wants 4 channels)	*/
+			++block_count;
+			#if DXT_HAVE_SSE2
+			if( use_SIMD )
 			{
-				for( x = 0; x < mx; ++x )
-				{
-					ublock[idx++] = uncompressed[(j+y)*width*channels+(i+x)*channels];
-					ublock[idx++] = uncompressed[(j+y)*width*channels+(i+x)*channels+chan_step];
-					ublock[idx++] = uncompressed[(j+y)*width*channels+(i+x)*channels+chan_step+chan_step];
-				}
-				for( x = mx; x < 4; ++x )
-				{
-					ublock[idx++] = ublock[0];
-					ublock[idx++] = ublock[1];
-					ublock[idx++] = ublock[2];
-				}
-			}
-			for( y = my; y < 4; ++y )
+				gather_DDS_block( uncompressed, width, height, channels, i, j, 4, ublock );
+				compress_DDS_color_block_SSE2( ublock, cblock );
+			} else
+			#endif
 			{
-				for( x = 0; x < 4; ++x )
-				{
-					ublock[idx++] = ublock[0];
-					ublock[idx++] = ublock[1];
-					ublock[idx++] = ublock[2];
-				}
+				gather_DDS_block( uncompressed, width, height, channels, i, j, 3, ublock );
+				compress_DDS_color_block( 3, ublock, cblock );
 			}
-			/*	compress the block	*/
-			++block_count;
-			compress_DDS_color_block( 3, ublock, cblock );
 			/*	copy the data from the block into the main block	*/
 			for( x = 0; x < 8; ++x )
 			{
@@ -185,11 +198,11 @@ unsigned char* convert_image_to_DXT5(
 		int *out_size )
 {
 	unsigned char *compressed;
-	int i, j, x, y;
+	int i, j, x;
 	unsigned char ublock[16*4];
 	unsigned char cblock[8];
-	int index = 0, chan_step = 1;
-	int block_count = 0, has_alpha;
+	int index = 0;
+	int block_count = 0;
 	/*	error check	*/
 	*out_size = 0;
 	if( (width < 1) || (height < 1) ||
@@ -198,13 +211,6 @@ unsigned char* convert_image_to_DXT5(
 	{
 		return NULL;
 	}
-	/*	for channels == 1 or 2, I do not step forward for R,G,B vales	*/
-	if( channels < 3 )
-	{
-		chan_step = 0;
-	}
-	/*	# channels = 1 or 3 have no alpha, 2 & 4 do have alpha	*/
-	has_alpha = 1 - (channels & 1);
 	/*	get the RAM for the compressed image
 		(16 bytes per 4x4 pixel block)	*/
 	*out_size = ((width+3) >> 2) * ((height+3) >> 2) * 16;
@@ -214,48 +220,17 @@ unsigned char* convert_image_to_DXT5(
 	{
 		for( i = 0; i < width; i += 4 )
 		{
-			/*	local variables, and my block counter	*/
-			int idx = 0;
-			int mx = 4, my = 4;
-			if( j+4 >= height )
-			{
-				my = height - j;
-			}
-			if( i+4 >= width )
+			gather_DDS_block( uncompressed, width, height, channels, i, j, 4, ublock );
+			/*	now compress the alpha block	*/
+			#if DXT_HAVE_SSE2
+			if( use_SIMD )
 			{
-				mx = width - i;
-			}
-			for( y = 0; y < my; ++y )
+				compress_DDS_alpha_block_SSE2( ublock, cblock );
+			} else
+			#endif
 			{
-				for( x = 0; x < mx; ++x )
-				{
-					ublock[idx++] = uncompressed[(j+y)*width*channels+(i+x)*channels];
-					ublock[idx++] = uncompressed[(j+y)*width*channels+(i+x)*channels+chan_step];
-					ublock[idx++] = uncompressed[(j+y)*width*channels+(i+x)*channels+chan_step+chan_step];
-					ublock[idx++] =
-						has_alpha * uncompressed[(j+y)*width*channels+(i+x)*channels+channels-1]
-						+ (1-has_alpha)*255;
-				}
-				for( x = mx; x < 4; ++x )
-				{
-					ublock[idx++] = ublock[0];
-					ublock[idx++] = ublock[1];
-					ublock[idx++] = ublock[2];
-					ublock[idx++] = ublock[3];
-				}
+				compress_DDS_alpha_block( ublock, cblock );
 			}
-			for( y = my; y < 4; ++y )
-			{
-				for( x = 0; x < 4; ++x )
-				{
-					ublock[idx++] = ublock[0];
-					ublock[idx++] = ublock[1];
-					ublock[idx++] = ublock[2];
-					ublock[idx++] = ublock[3];
-				}
-			}
-			/*	now compress the alpha block	*/
-			compress_DDS_alpha_block( ublock, cblock );
 			/*	copy the data from the compressed alpha block into the main buffer	*/
 			for( x = 0; x < 8; ++x )
 			{
@@ -263,7 +238,15 @@ unsigned char* convert_image_to_DXT5(
 			}
 			/*	then compress the color block	*/
 			++block_count;
-			compress_DDS_color_block( 4, ublock, cblock );
+			#if DXT_HAVE_SSE2
+			if( use_SIMD )
+			{
+				compress_DDS_color_block_SSE2( ublock, cblock );
+			} else
+			#endif
+			{
+				compress_DDS_color_block( 4, ublock, cblock );
+			}
 			/*	copy the data from the compressed color block into the main buffer	*/
 			for( x = 0; x < 8; ++x )
 			{
@@ -274,6 +257,65 @@ unsigned char* convert_image_to_DXT5(
 	return compressed;
 }
 
+static void gather_DDS_block(
+		const unsigned char *const uncompressed,
+		int width, int height, int channels,
+		int i, int j, int out_channels,
+		unsigned char *ublock )
+{
+	int x, y, c;
+	int idx = 0, chan_step = 1;
+	int mx = 4, my = 4;
+	/*	# channels = 1 or 3 have no alpha, 2 & 4 do have alpha	*/
+	int has_alpha = 1 - (channels & 1);
+	/*	for channels == 1 or 2, I do not step forward for R,G,B values	*/
+	if( channels < 3 )
+	{
+		chan_step = 0;
+	}
+	if( j+4 >= height )
+	{
+		my = height - j;
+	}
+	if( i+4 >= width )
+	{
+		mx = width - i;
+	}
+	for( y = 0; y < my; ++y )
+	{
+		for( x = 0; x < mx; ++x )
+		{
+			const unsigned char *pixel = uncompressed + (j+y)*width*channels + (i+x)*channels;
+			ublock[idx++] = pixel[0];
+			ublock[idx++] = pixel[chan_step];
+			ublock[idx++] = pixel[chan_step+chan_step];
+			if( out_channels == 4 )
+			{
+				ublock[idx++] =
+					has_alpha * pixel[channels-1]
+					+ (1-has_alpha)*255;
+			}
+		}
+		for( x = mx; x < 4; ++x )
+		{
+			for( c = 0; c < out_channels; ++c )
+			{
+				ublock[idx++] = ublock[c];
+			}
+		}
+	}
+	for( y = my; y < 4; ++y )
+	{
+		for( x = 0; x < 4; ++x )
+		{
+			for( c = 0; c < out_channels; ++c )
+			{
+				ublock[idx++] = ublock[c];
+			}
+		}
+	}
+}
+
 /********* Helper Functions *********/
 int convert_bit_range( int c, int from_bits, int to_bits )
 {
@@ -296,30 +338,18 @@ void rgb_888_from_565( unsigned int c, int *r, int *g, int *b )
 	*b = convert_bit_range( (c >> 00) & 31, 5, 8 );
 }
 
-void compute_color_line_STDEV(
-		const unsigned char *const uncompressed,
-		int channels,
+/*
+	The color line from the sums of a block.  The sums are
+	integers below 2^24, so they are exact in any order, and
+	the scalar and the SSE2 encoders share everything after them.
+*/
+static void color_line_from_sums(
+		float sum_r, float sum_g, float sum_b,
+		float sum_rr, float sum_gg, float sum_bb,
+		float sum_rg, float sum_rb, float sum_gb,
 		float point[3], float direction[3] )
 {
 	const float inv_16 = 1.0f / 16.0f;
-	int i;
-	float sum_r = 0.0f, sum_g = 0.0f, sum_b = 0.0f;
-	float sum_rr = 0.0f, sum_gg = 0.0f, sum_bb = 0.0f;
-	float sum_rg = 0.0f, sum_rb = 0.0f, sum_gb = 0.0f;
-	/*	calculate all data needed for the covariance matrix
-		( to compare with _rygdxt code)	*/
-	for( i = 0; i < 16*channels; i += channels )
-	{
-		sum_r += uncompressed[i+0];
-		sum_rr += uncompressed[i+0] * uncompressed[i+0];
-		sum_g += uncompressed[i+1];
-		sum_gg += uncompressed[i+1] * uncompressed[i+1];
-		sum_b += uncompressed[i+2];
-		sum_bb += uncompressed[i+2] * uncompressed[i+2];
-		sum_rg += uncompressed[i+0] * uncompressed[i+1];
-		sum_rb += uncompressed[i+0] * uncompressed[i+2];
-		sum_gb += uncompressed[i+1] * uncompressed[i+2];
-	}
 	/*	convert the sums to averages	*/
 	sum_r *= inv_16;
 	sum_g *= inv_16;
@@ -408,52 +438,50 @@ void compute_color_line_STDEV(
 	#endif
 }
 
-void LSE_master_colors_max_min(
-		int *cmax, int *cmin,
+void compute_color_line_STDEV(
+		const unsigned char *const uncompressed,
 		int channels,
-		const unsigned char *const uncompressed )
+		float point[3], float direction[3] )
 {
-	int i, j;
-	/*	the master colors	*/
-	int c0[3], c1[3];
-	/*	used for fitting the line	*/
-	float sum_x[] = { 0.0f, 0.0f, 0.0f };
-	float sum_x2[] = { 0.0f, 0.0f, 0.0f };
-	float dot_max = 1.0f, dot_min = -1.0f;
-	float vec_len2 = 0.0f;
-	float dot;
-	/*	error check	*/
-	if( (channels < 3) || (channels > 4) )
+	int i;
+	float sum_r = 0.0f, sum_g = 0.0f, sum_b = 0.0f;
+	float sum_rr = 0.0f, sum_gg = 0.0f, sum_bb = 0.0f;
+	float sum_rg = 0.0f, sum_rb = 0.0f, sum_gb = 0.0f;
+	/*	calculate all data needed for the covariance matrix
+		( to compare with _rygdxt code)	*/
+	for( i = 0; i < 16*channels; i += channels )
 	{
-		return;
+		sum_r += uncompressed[i+0];
+		sum_rr += uncompressed[i+0] * uncompressed[i+0];
+		sum_g += uncompressed[i+1];
+		sum_gg += uncompressed[i+1] * uncompressed[i+1];
+		sum_b += uncompressed[i+2];
+		sum_bb += uncompressed[i+2] * uncompressed[i+2];
+		sum_rg += uncompressed[i+0] * uncompressed[i+1];
+		sum_rb += uncompressed[i+0] * uncompressed[i+2];
+		sum_gb += uncompressed[i+1] * uncompressed[i+2];
 	}
-	compute_color_line_STDEV( uncompressed, channels, sum_x, sum_x2 );
-	vec_len2 = 1.0f / ( 0.00001f +
+	color_line_from_sums(
+		sum_r, sum_g, sum_b,
+		sum_rr, sum_gg, sum_bb,
+		sum_rg, sum_rb, sum_gb,
+		point, direction );
+}
+
+/*
+	The master colors (as 565, cmax >= cmin) from the color
+	line of a block and the extent of its pixels along it.
+*/
+static void master_colors_from_line(
+		const float sum_x[3], const float sum_x2[3],
+		float dot_min, float dot_max,
+		int *cmax, int *cmin )
+{
+	int i, j;
+	int c0[3], c1[3];
+	float vec_len2 = 1.0f / ( 0.00001f +
 			sum_x2[0]*sum_x2[0] + sum_x2[1]*sum_x2[1] + sum_x2[2]*sum_x2[2] );
-	/*	finding the max and min vector values	*/
-	dot_max =
-			(
-				sum_x2[0] * uncompressed[0] +
-				sum_x2[1] * uncompressed[1] +
-				sum_x2[2] * uncompressed[2]
-			);
-	dot_min = dot_max;
-	for( i = 1; i < 16; ++i )
-	{
-		dot =
-			(
-				sum_x2[0] * uncompressed[i*channels+0] +
-				sum_x2[1] * uncompressed[i*channels+1] +
-				sum_x2[2] * uncompressed[i*channels+2]
-			);
-		if( dot < dot_min )
-		{
-			dot_min = dot;
-		} else if( dot > dot_max )
-		{
-			dot_max = dot;
-		}
-	}
+	float dot;
 	/*	and the offset (from the average location)	*/
 	dot = sum_x2[0]*sum_x[0] + sum_x2[1]*sum_x[1] + sum_x2[2]*sum_x[2];
 	dot_min -= dot;
@@ -497,25 +525,64 @@ void LSE_master_colors_max_min(
 	}
 }
 
-void
-	compress_DDS_color_block
-	(
+void LSE_master_colors_max_min(
+		int *cmax, int *cmin,
 		int channels,
-		const unsigned char *const uncompressed,
-		unsigned char compressed[8]
-	)
+		const unsigned char *const uncompressed )
+{
+	int i;
+	/*	used for fitting the line	*/
+	float sum_x[] = { 0.0f, 0.0f, 0.0f };
+	float sum_x2[] = { 0.0f, 0.0f, 0.0f };
+	float dot_max = 1.0f, dot_min = -1.0f;
+	float dot;
+	/*	error check	*/
+	if( (channels < 3) || (channels > 4) )
+	{
+		return;
+	}
+	compute_color_line_STDEV( uncompressed, channels, sum_x, sum_x2 );
+	/*	finding the max and min vector values	*/
+	dot_max =
+			(
+				sum_x2[0] * uncompressed[0] +
+				sum_x2[1] * uncompressed[1] +
+				sum_x2[2] * uncompressed[2]
+			);
+	dot_min = dot_max;
+	for( i = 1; i < 16; ++i )
+	{
+		dot =
+			(
+				sum_x2[0] * uncompressed[i*channels+0] +
+				sum_x2[1] * uncompressed[i*channels+1] +
+				sum_x2[2] * uncompressed[i*channels+2]
+			);
+		if( dot < dot_min )
+		{
+			dot_min = dot;
+		} else if( dot > dot_max )
+		{
+			dot_max = dot;
+		}
+	}
+	master_colors_from_line( sum_x, sum_x2, dot_min, dot_max, cmax, cmin );
+}
+
+/*
+	Stores the master colors of a color block and zeroes its
+	indices.  Gives the line between the two colors, scaled so
+	that a pixel's dot product with it, minus dot_offset, is 0
+	at color 0 and 1 at color 1.
+*/
+static void color_block_line(
+		int enc_c0, int enc_c1,
+		unsigned char compressed[8],
+		float color_line[3], float *dot_offset )
 {
-	/*	variables	*/
 	int i;
-	int next_bit;
-	int enc_c0, enc_c1;
 	int c0[4], c1[4];
-	float color_line[] = { 0.0f, 0.0f, 0.0f, 0.0f };
-	float vec_len2 = 0.0f, dot_offset = 0.0f;
-	/*	stupid order	*/
-	int swizzle4[] = { 0, 2, 3, 1 };
-	/*	get the master colors	*/
-	LSE_master_colors_max_min( &enc_c0, &enc_c1, channels, uncompressed );
+	float vec_len2 = 0.0f;
 	/*	store the 565 color 0 and color 1	*/
 	compressed[0] = (enc_c0 >> 0) & 255;
 	compressed[1] = (enc_c0 >> 8) & 255;
@@ -545,7 +612,28 @@ void
 	color_line[1] *= vec_len2;
 	color_line[2] *= vec_len2;
 	/*	compute the offset (constant) portion of the dot product	*/
-	dot_offset = color_line[0]*c0[0] + color_line[1]*c0[1] + color_line[2]*c0[2];
+	*dot_offset = color_line[0]*c0[0] + color_line[1]*c0[1] + color_line[2]*c0[2];
+}
+
+void
+	compress_DDS_color_block
+	(
+		int channels,
+		const unsigned char *const uncompressed,
+		unsigned char compressed[8]
+	)
+{
+	/*	variables	*/
+	int i;
+	int next_bit;
+	int enc_c0, enc_c1;
+	float color_line[] = { 0.0f, 0.0f, 0.0f, 0.0f };
+	float dot_offset = 0.0f;
+	/*	stupid order	*/
+	int swizzle4[] = { 0, 2, 3, 1 };
+	/*	get the master colors	*/
+	LSE_master_colors_max_min( &enc_c0, &enc_c1, channels, uncompressed );
+	color_block_line( enc_c0, enc_c1, compressed, color_line, &dot_offset );
 	/*	store the rest of the bits	*/
 	next_bit = 8*4;
 	for( i = 0; i < 16; ++i )
@@ -630,3 +718,185 @@ void
 	}
 	/*	done compressing to DXT1	*/
 }
+
+#if DXT_HAVE_SSE2
+/********* SSE2 Block Encoders *********/
+/*
+	A block is 16 RGBA pixels, so it fits in four registers per
+	channel.  Every product and sum is done in the same order as
+	in the scalar code, so each lane gives the bits the scalar
+	code would (as long as the compiler does not fuse a multiply
+	and an add in one of the two paths).
+*/
+
+/*	4 RGBA pixels, one float vector per color channel	*/
+static void load_pixels_SSE2(
+		const unsigned char *const rgba,
+		__m128 *r, __m128 *g, __m128 *b )
+{
+	const __m128i mask = _mm_set1_epi32( 255 );
+	__m128i p = _mm_loadu_si128( (const __m128i*)rgba );
+	*r = _mm_cvtepi32_ps( _mm_and_si128( p, mask ) );
+	*g = _mm_cvtepi32_ps( _mm_and_si128( _mm_srli_epi32( p, 8 ), mask ) );
+	*b = _mm_cvtepi32_ps( _mm_and_si128( _mm_srli_epi32( p, 16 ), mask ) );
+}
+
+/*	only used on integer valued sums, which are exact in any order	*/
+static float sum_SSE2( __m128 v )
+{
+	float lanes[4];
+	_mm_storeu_ps( lanes, v );
+	return (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+}
+
+static float min_SSE2( __m128 v )
+{
+	v = _mm_min_ps( v, _mm_shuffle_ps( v, v, _MM_SHUFFLE( 1, 0, 3, 2 ) ) );
+	v = _mm_min_ps( v, _mm_shuffle_ps( v, v, _MM_SHUFFLE( 2, 3, 0, 1 ) ) );
+	return _mm_cvtss_f32( v );
+}
+
+static float max_SSE2( __m128 v )
+{
+	v = _mm_max_ps( v, _mm_shuffle_ps( v, v, _MM_SHUFFLE( 1, 0, 3, 2 ) ) );
+	v = _mm_max_ps( v, _mm_shuffle_ps( v, v, _MM_SHUFFLE( 2, 3, 0, 1 ) ) );
+	return _mm_cvtss_f32( v );
+}
+
+static void compress_DDS_color_block_SSE2(
+		const unsigned char *const uncompressed,
+		unsigned char compressed[8] )
+{
+	/*	variables	*/
+	int i;
+	int enc_c0, enc_c1;
+	int values[16];
+	unsigned int indices = 0;
+	__m128 r[4], g[4], b[4];
+	__m128 sum_r, sum_g, sum_b, sum_rr, sum_gg, sum_bb, sum_rg, sum_rb, sum_gb;
+	__m128 dot, dot_min, dot_max;
+	__m128 line_r, line_g, line_b, offset;
+	float point[3], direction[3];
+	float color_line[] = { 0.0f, 0.0f, 0.0f, 0.0f };
+	float dot_offset = 0.0f;
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i three = _mm_set1_epi32( 3 );
+	/*	stupid order	*/
+	static const int swizzle4[] = { 0, 2, 3, 1 };
+	/*	the sums for the covariance matrix	*/
+	sum_r = sum_g = sum_b = _mm_setzero_ps();
+	sum_rr = sum_gg = sum_bb = _mm_setzero_ps();
+	sum_rg = sum_rb = sum_gb = _mm_setzero_ps();
+	for( i = 0; i < 4; ++i )
+	{
+		load_pixels_SSE2( uncompressed + 16*i, &r[i], &g[i], &b[i] );
+		sum_r = _mm_add_ps( sum_r, r[i] );
+		sum_g = _mm_add_ps( sum_g, g[i] );
+		sum_b = _mm_add_ps( sum_b, b[i] );
+		sum_rr = _mm_add_ps( sum_rr, _mm_mul_ps( r[i], r[i] ) );
+		sum_gg = _mm_add_ps( sum_gg, _mm_mul_ps( g[i], g[i] ) );
+		sum_bb = _mm_add_ps( sum_bb, _mm_mul_ps( b[i], b[i] ) );
+		sum_rg = _mm_add_ps( sum_rg, _mm_mul_ps( r[i], g[i] ) );
+		sum_rb = _mm_add_ps( sum_rb, _mm_mul_ps( r[i], b[i] ) );
+		sum_gb = _mm_add_ps( sum_gb, _mm_mul_ps( g[i], b[i] ) );
+	}
+	color_line_from_sums(
+		sum_SSE2( sum_r ), sum_SSE2( sum_g ), sum_SSE2( sum_b ),
+		sum_SSE2( sum_rr ), sum_SSE2( sum_gg ), sum_SSE2( sum_bb ),
+		sum_SSE2( sum_rg ), sum_SSE2( sum_rb ), sum_SSE2( sum_gb ),
+		point, direction );
+	/*	finding the max and min vector values	*/
+	line_r = _mm_set1_ps( direction[0] );
+	line_g = _mm_set1_ps( direction[1] );
+	line_b = _mm_set1_ps( direction[2] );
+	dot_min = dot_max = _mm_add_ps( _mm_add_ps( _mm_mul_ps( line_r, r[0] ), _mm_mul_ps( line_g, g[0] ) ), _mm_mul_ps( line_b, b[0] ) );
+	for( i = 1; i < 4; ++i )
+	{
+		dot = _mm_add_ps( _mm_add_ps( _mm_mul_ps( line_r, r[i] ), _mm_mul_ps( line_g, g[i] ) ), _mm_mul_ps( line_b, b[i] ) );
+		dot_min = _mm_min_ps( dot_min, dot );
+		dot_max = _mm_max_ps( dot_max, dot );
+	}
+	master_colors_from_line( point, direction, min_SSE2( dot_min ), max_SSE2( dot_max ), &enc_c0, &enc_c1 );
+	color_block_line( enc_c0, enc_c1, compressed, color_line, &dot_offset );
+	/*	place every pixel on the line, mapped to [0,3]	*/
+	line_r = _mm_set1_ps( color_line[0] );
+	line_g = _mm_set1_ps( color_line[1] );
+	line_b = _mm_set1_ps( color_line[2] );
+	offset = _mm_set1_ps( dot_offset );
+	for( i = 0; i < 4; ++i )
+	{
+		__m128i value, above, below;
+		dot = _mm_sub_ps( _mm_add_ps( _mm_add_ps( _mm_mul_ps( line_r, r[i] ), _mm_mul_ps( line_g, g[i] ) ), _mm_mul_ps( line_b, b[i] ) ), offset );
+		value = _mm_cvttps_epi32( _mm_add_ps( _mm_mul_ps( dot, _mm_set1_ps( 3.0f ) ), _mm_set1_ps( 0.5f ) ) );
+		/*	clamp (SSE2 has no 32 bit min / max)	*/
+		above = _mm_cmpgt_epi32( value, three );
+		value = _mm_or_si128( _mm_and_si128( above, three ), _mm_andnot_si128( above, value ) );
+		below = _mm_cmpgt_epi32( zero, value );
+		value = _mm_andnot_si128( below, value );
+		_mm_storeu_si128( (__m128i*)(values + 4*i), value );
+	}
+	/*	OK, store the values	*/
+	for( i = 0; i < 16; ++i )
+	{
+		indices |= (unsigned int)swizzle4[ values[i] ] << (2*i);
+	}
+	compressed[4] = (indices >> 0) & 255;
+	compressed[5] = (indices >> 8) & 255;
+	compressed[6] = (indices >> 16) & 255;
+	compressed[7] = (indices >> 24) & 255;
+}
+
+static void compress_DDS_alpha_block_SSE2(
+		const unsigned char *const uncompressed,
+		unsigned char compressed[8] )
+{
+	/*	variables	*/
+	int i;
+	int a0, a1;
+	int values[16];
+	unsigned int low = 0, high = 0;
+	float scale_me;
+	__m128i alpha[4], alpha_max, alpha_min, base;
+	__m128 scale;
+	/*	stupid order	*/
+	static const int swizzle8[] = { 1, 7, 6, 5, 4, 3, 2, 0 };
+	/*	get the alpha limits (a0 > a1); the values fit in
+		16 bits, so the 16 bit min / max work on them	*/
+	for( i = 0; i < 4; ++i )
+	{
+		alpha[i] = _mm_srli_epi32( _mm_loadu_si128( (const __m128i*)(uncompressed + 16*i) ), 24 );
+	}
+	alpha_max = _mm_max_epi16( _mm_max_epi16( alpha[0], alpha[1] ), _mm_max_epi16( alpha[2], alpha[3] ) );
+	alpha_min = _mm_min_epi16( _mm_min_epi16( alpha[0], alpha[1] ), _mm_min_epi16( alpha[2], alpha[3] ) );
+	alpha_max = _mm_max_epi16( alpha_max, _mm_shuffle_epi32( alpha_max, _MM_SHUFFLE( 1, 0, 3, 2 ) ) );
+	alpha_max = _mm_max_epi16( alpha_max, _mm_shuffle_epi32( alpha_max, _MM_SHUFFLE( 2, 3, 0, 1 ) ) );
+	alpha_min = _mm_min_epi16( alpha_min, _mm_shuffle_epi32( alpha_min, _MM_SHUFFLE( 1, 0, 3, 2 ) ) );
+	alpha_min = _mm_min_epi16( alpha_min, _mm_shuffle_epi32( alpha_min, _MM_SHUFFLE( 2, 3, 0, 1 ) ) );
+	a0 = _mm_cvtsi128_si32( alpha_max );
+	a1 = _mm_cvtsi128_si32( alpha_min );
+	/*	store those limits, and zero the rest of the compressed dataset	*/
+	compressed[0] = a0;
+	compressed[1] = a1;
+	/*	convert the alpha values to 3 bit numbers	*/
+	scale_me = 7.9999f / (a0 - a1);
+	scale = _mm_set1_ps( scale_me );
+	base = _mm_set1_epi32( a1 );
+	for( i = 0; i < 4; ++i )
+	{
+		__m128 offset = _mm_cvtepi32_ps( _mm_sub_epi32( alpha[i], base ) );
+		_mm_storeu_si128( (__m128i*)(values + 4*i), _mm_cvttps_epi32( _mm_mul_ps( offset, scale ) ) );
+	}
+	/*	OK, store them: 48 bits, the first 8 values in the low 24	*/
+	for( i = 0; i < 8; ++i )
+	{
+		low |= (unsigned int)swizzle8[ values[i]&7 ] << (3*i);
+		high |= (unsigned int)swizzle8[ values[8+i]&7 ] << (3*i);
+	}
+	compressed[2] = (low >> 0) & 255;
+	compressed[3] = (low >> 8) & 255;
+	compressed[4] = (low >> 16) & 255;
+	compressed[5] = (high >> 0) & 255;
+	compressed[6] = (high >> 8) & 255;
+	compressed[7] = (high >> 16) & 255;
+}
+#endif
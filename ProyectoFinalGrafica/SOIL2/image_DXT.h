@@ -45,6 +45,19 @@ convert_image_to_DXT5
     int *out_size
 );
 
+/**
+	Selects the block encoder used by convert_image_to_DXT1 / DXT5:
+	1 for the SSE2 one (the default when the compiler targets SSE2),
+	0 for the original scalar code.  Both run the same arithmetic and
+	give the same blocks.  Set it before compressing from any thread.
+	\return the previous setting (always 0 without SSE2)
+**/
+int
+DXT_use_SIMD
+(
+    int enabled
+);
+
 /**	A bunch of DirectDraw Surface structures and flags **/
 typedef struct
 {
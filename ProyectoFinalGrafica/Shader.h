@@ -8,14 +8,18 @@
 
 #include <GL/glew.h>
 
+#include "LoadProfiler.h"
+
 class Shader
 {
 public:
 	GLuint Program;
 	GLuint uniformColor;
-	// Constructor generates the shader on the fly
-	Shader(const GLchar *vertexPath, const GLchar *fragmentPath)
+	// Constructor generates the shader on the fly. defines (e.g. "#define NAME value\n") go into both stages, right
+	// after their #version line.
+	Shader(const GLchar *vertexPath, const GLchar *fragmentPath, const std::string &defines = std::string())
 	{
+		std::string profileName = std::string(vertexPath) + " + " + fragmentPath;
 		// 1. Retrieve the vertex/fragment source code from filePath
 		std::string vertexCode;
 		std::string fragmentCode;
@@ -26,6 +30,7 @@ public:
 		fShaderFile.exceptions(std::ifstream::badbit);
 		try
 		{
+			LoadProfiler::Timer readTimer("shader", profileName, LOAD_IO);
 			// Open files
 			vShaderFile.open(vertexPath);
 			fShaderFile.open(fragmentPath);
@@ -37,13 +42,15 @@ public:
 			vShaderFile.close();
 			fShaderFile.close();
 			// Convert stream into string
-			vertexCode = vShaderStream.str();
-			fragmentCode = fShaderStream.str();
+			vertexCode = InsertDefines(vShaderStream.str(), defines);
+			fragmentCode = InsertDefines(fShaderStream.str(), defines);
 		}
 		catch (std::ifstream::failure e)
 		{
 			std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ" << std::endl;
 		}
+		LoadProfiler::Get().AddBytes("shader", profileName, vertexCode.size() + fragmentCode.size(), 0);
+		LoadProfiler::Timer compileTimer("shader", profileName, LOAD_CONVERT);
 		const GLchar *vShaderCode = vertexCode.c_str();
 		const GLchar *fShaderCode = fragmentCode.c_str();
 		// 2. Compile shaders
@@ -101,6 +108,22 @@ public:
 	{
 		return uniformColor;
 	}
+
+private:
+	// The #version line has to stay the first one of the source
+	static std::string InsertDefines(const std::string &code, const std::string &defines)
+	{
+		if (defines.empty())
+		{
+			return code;
+		}
+		size_t versionEnd = code.compare(0, 8, "#version") == 0 ? code.find('\n') : std::string::npos;
+		if (versionEnd == std::string::npos)
+		{
+			return defines + code;
+		}
+		return code.substr(0, versionEnd + 1) + defines + code.substr(versionEnd + 1);
+	}
 };
 
 #endif
\ No newline at end of file
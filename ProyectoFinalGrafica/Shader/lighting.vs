@@ -2,6 +2,12 @@
 layout (location = 0) in vec3 position;
 layout (location = 1) in vec3 normal;
 layout (location = 2) in vec2 texCoords;
+// Instanced draws (InstanceBatch.h): model matrix and normal matrix of each placement
+layout (location = 3) in mat4 instanceModel;
+layout (location = 7) in mat3 instanceNormal;
+// Multi-draw indirect (RenderQueue.h): slot of the draw in drawData, RENDER_DRAW_DATA_TEXELS texels per draw.
+// RenderQueue::ShaderDefines gives the define.
+layout (location = 10) in uint drawIndex;
 
 out vec3 Normal;
 out vec3 FragPos;
@@ -11,10 +17,46 @@ uniform mat4 model;
 uniform mat4 view;
 uniform mat4 projection;
 
+// Packed vertices (PackedVertex in Mesh.h): position in [0, 1] inside the model bounds, octahedral normal
+uniform bool packedVertices;
+uniform vec3 positionOffset;
+uniform vec3 positionScale;
+
+uniform bool instanced;
+
+uniform bool indirect;
+uniform samplerBuffer drawData;
+
+vec3 decodeOctahedral(vec2 e)
+{
+    vec3 n = vec3(e.xy, 1.0 - abs(e.x) - abs(e.y));
+    float t = max(-n.z, 0.0);
+    n.x += n.x >= 0.0 ? -t : t;
+    n.y += n.y >= 0.0 ? -t : t;
+    return normalize(n);
+}
+
 void main()
 {
-    gl_Position = projection * view *  model * vec4(position, 1.0f);
-    FragPos = vec3(model * vec4(position, 1.0f));
-    Normal = mat3(transpose(inverse(model))) * normal;
+    vec3 localPosition = packedVertices ? position * positionScale + positionOffset : position;
+    vec3 localNormal = packedVertices ? decodeOctahedral(normal.xy) : normal;
+
+    mat4 world;
+    mat3 normalMatrix;
+    if (indirect)
+    {
+        int base = int(drawIndex) * RENDER_DRAW_DATA_TEXELS;
+        world = mat4(texelFetch(drawData, base), texelFetch(drawData, base + 1), texelFetch(drawData, base + 2), texelFetch(drawData, base + 3));
+        normalMatrix = mat3(texelFetch(drawData, base + 4).xyz, texelFetch(drawData, base + 5).xyz, texelFetch(drawData, base + 6).xyz);
+    }
+    else
+    {
+        world = instanced ? instanceModel : model;
+        normalMatrix = instanced ? instanceNormal : mat3(transpose(inverse(model)));
+    }
+
+    gl_Position = projection * view *  world * vec4(localPosition, 1.0f);
+    FragPos = vec3(world * vec4(localPosition, 1.0f));
+    Normal = normalMatrix * localNormal;
     TexCoords = texCoords;
 }
\ No newline at end of file
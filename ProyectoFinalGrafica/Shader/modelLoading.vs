@@ -9,8 +9,15 @@ uniform mat4 model;
 uniform mat4 view;
 uniform mat4 projection;
 
+// Packed vertices (PackedVertex in Mesh.h): position in [0, 1] inside the model bounds
+// (the normal is octahedral-encoded, but this shader doesn't use it)
+uniform bool packedVertices;
+uniform vec3 positionOffset;
+uniform vec3 positionScale;
+
 void main()
 {
     TexCoords = aTexCoords;    
-    gl_Position = projection * view * model * vec4(aPos, 1.0);
+    vec3 localPosition = packedVertices ? aPos * positionScale + positionOffset : aPos;
+    gl_Position = projection * view * model * vec4(localPosition, 1.0);
 }
\ No newline at end of file
@@ -0,0 +1,455 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <iostream>
+#include <algorithm>
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include "Model.h"
+#include "RenderQueue.h"
+#include "VertexPacking.h"
+
+using namespace std;
+
+/*
+	Objects that never move, baked into world space and merged per material at load time.
+
+	Each source is a model with the one placement it ever has, or a block of triangles (a floor or a wall cube)
+	with its placement and material. Once every source model is loaded, its meshes are read back from their
+	MeshArena range (the full level, whatever the vertex layout and the CPU mirror policy), every vertex is moved
+	to world space with the placement, normals with its normal matrix, and the triangles of all sources are
+	appended to one group per material (Material::SameAs). The groups go into a single range of the arena with the
+	float Vertex layout, so a group is one draw with the identity model matrix, and through the RenderQueue groups
+	of different batches that share a material still sort together.
+
+	Every group keeps the bounding sphere of its triangles and isn't drawn while the sphere is outside the view
+	frustum (RenderContext::SphereVisible).
+
+	The batch follows its models: nothing is drawn while one of them is hidden or loading, and if one is unloaded
+	(its streaming unit went away) the baked range is given back and baked again when it returns, as its textures
+	may have been freed with it. The models stay loaded meanwhile because the groups bind their textures; they
+	are just not drawn on their own. The groups draw at full detail, since the levels of detail of the models
+	were simplified per mesh and don't merge.
+
+	With Enabled() false (--no-static-batch) nothing is baked and Draw draws every source on its own with its
+	placement, as the scene did before, to compare.
+*/
+
+class StaticBatch
+{
+public:
+	explicit StaticBatch(const string &name) : name(name) {}
+
+	StaticBatch(const StaticBatch &) = delete;
+	StaticBatch &operator=(const StaticBatch &) = delete;
+
+	// false draws every source on its own instead of baking. Set it before the first Draw.
+	static bool &Enabled()
+	{
+		static bool enabled = true;
+		return enabled;
+	}
+
+	~StaticBatch()
+	{
+		// Destroyed after the context is gone (see ModelRegistry::Shutdown), the range goes with the arena
+		if (ModelRegistry::Get().ContextAlive())
+		{
+			this->release();
+		}
+	}
+
+	// A model drawn once with a model matrix that never changes. Call Draw of the batch instead of the model's.
+	void AddModel(Model &model, const glm::mat4 &placement)
+	{
+		Source source;
+		source.model = &model;
+		source.placement = placement;
+		this->sources.push_back(source);
+		this->release();
+	}
+
+	// Triangles given as 8 floats per vertex (position, normal, texture coordinates), e.g. the cube of a floor.
+	// VAO holds the same vertices, for drawing the surface on its own when the batch is disabled.
+	void AddSurface(const GLfloat *vertices, GLuint numVertices, GLuint VAO, const glm::mat4 &placement, const Material &material)
+	{
+		Surface surface;
+		surface.vertices.resize(numVertices);
+		for (GLuint i = 0; i < numVertices; i++)
+		{
+			const GLfloat *v = vertices + i * 8;
+			surface.vertices[i].Position = glm::vec3(v[0], v[1], v[2]);
+			surface.vertices[i].Normal = glm::vec3(v[3], v[4], v[5]);
+			surface.vertices[i].TexCoords = glm::vec2(v[6], v[7]);
+		}
+		surface.VAO = VAO;
+		surface.placement = placement;
+		surface.material = material;
+		this->surfaces.push_back(surface);
+		this->release();
+	}
+
+	// Draws the groups inside the view, or queues them while the RenderQueue is recording
+	void Draw(Shader shader)
+	{
+		if (!Enabled())
+		{
+			this->drawSources(shader);
+			return;
+		}
+		if (!this->update())
+		{
+			return;
+		}
+
+		RenderContext &context = RenderContext::Get();
+		const MaterialProgram &program = MaterialProgram::For(shader.Program);
+		RenderQueue &queue = RenderQueue::Get();
+		glm::mat4 identity(1.0f);
+		GLuint drawn = 0, textureBinds = 0;
+
+		for (size_t i = 0; i < this->groups.size(); i++)
+		{
+			const Group &group = this->groups[i];
+			if (!context.SphereVisible(group.boundsCenter, group.boundsRadius))
+			{
+				continue;
+			}
+
+			if (queue.IsRecording())
+			{
+				RenderCommand command;
+				command.program = &program;
+				command.material = &group.material;
+				command.VAO = this->VAO;
+				command.count = group.numIndices;
+				command.firstIndex = group.firstIndex;
+				command.baseVertex = group.baseVertex;
+				command.model = identity;
+				queue.Submit(command, context.Distance(identity, group.boundsCenter));
+			}
+			else
+			{
+				// The vertices are already in world space
+				if (drawn == 0)
+				{
+					SetModelMatrix(program.model, identity);
+					glBindVertexArray(this->VAO);
+				}
+				group.material.Bind(program);
+				glDrawElementsBaseVertex(GL_TRIANGLES, group.numIndices, GL_UNSIGNED_INT, (GLvoid *)(group.firstIndex * sizeof(GLuint)), group.baseVertex);
+				textureBinds += group.material.NumBindings();
+			}
+			drawn++;
+		}
+
+		if (!queue.IsRecording() && drawn > 0)
+		{
+			glBindVertexArray(0);
+			queue.CountImmediate(drawn, 2, textureBinds, drawn);
+		}
+	}
+
+private:
+	struct Source
+	{
+		Model *model;
+		glm::mat4 placement;
+		const ModelAsset *asset = nullptr; // What the batch was baked from
+	};
+
+	struct Surface
+	{
+		vector<Vertex> vertices;
+		GLuint VAO;
+		glm::mat4 placement;
+		Material material;
+	};
+
+	// Triangles of one material, as drawn
+	struct Group
+	{
+		Material material;
+		GLuint firstIndex;
+		GLuint numIndices;
+		GLint baseVertex;
+		glm::vec3 boundsCenter; // World sphere around the group's vertices
+		float boundsRadius;
+	};
+
+	// Triangles of one material while baking
+	struct GroupData
+	{
+		Material material;
+		vector<Vertex> vertices;
+		vector<GLuint> indices;
+	};
+
+	// Everything baked, kept alive until the UploadQueue has copied it
+	struct BakedGeometry
+	{
+		vector<Vertex> vertices;
+		vector<GLuint> indices;
+	};
+
+	string name;
+	vector<Source> sources;
+	vector<Surface> surfaces;
+
+	bool built = false;
+	vector<Group> groups;
+	MeshAllocation allocation;
+	GLuint VAO = 0;
+	uint64_t uploadTicket = 0;
+
+	// Every source as a draw of its own
+	void drawSources(Shader shader)
+	{
+		const MaterialProgram &program = MaterialProgram::For(shader.Program);
+		RenderQueue &queue = RenderQueue::Get();
+		for (size_t i = 0; i < this->sources.size(); i++)
+		{
+			SetModelMatrix(program.model, this->sources[i].placement);
+			this->sources[i].model->Draw(shader);
+		}
+
+		for (size_t i = 0; i < this->surfaces.size(); i++)
+		{
+			const Surface &surface = this->surfaces[i];
+			SetModelMatrix(program.model, surface.placement);
+			if (queue.IsRecording())
+			{
+				RenderCommand command;
+				command.program = &program;
+				command.material = &surface.material;
+				command.VAO = surface.VAO;
+				command.indexed = false;
+				command.count = (GLsizei)surface.vertices.size();
+				command.model = surface.placement;
+				queue.Submit(command, RenderContext::Get().Distance(glm::vec3(0.0f)));
+			}
+			else
+			{
+				surface.material.Bind(program);
+				glBindVertexArray(surface.VAO);
+				glDrawArrays(GL_TRIANGLES, 0, (GLsizei)surface.vertices.size());
+				glBindVertexArray(0);
+				queue.CountImmediate(1, 2, surface.material.NumBindings(), 1);
+			}
+		}
+	}
+
+	// Bakes the batch when its models are ready, and unbakes it when one of them was unloaded or loaded again.
+	// True if it can be drawn.
+	bool update()
+	{
+		bool ready = true, changed = false;
+		for (size_t i = 0; i < this->sources.size(); i++)
+		{
+			const Source &source = this->sources[i];
+			changed = changed || source.model->Asset() != source.asset;
+			ready = ready && !source.model->hidden && source.model->IsReady() && source.model->Asset();
+		}
+
+		if (changed && this->built)
+		{
+			this->release();
+		}
+		if (!ready)
+		{
+			return false;
+		}
+		if (!this->built)
+		{
+			this->build();
+		}
+		return !this->groups.empty() && UploadQueue::Get().Done(this->uploadTicket);
+	}
+
+	void release()
+	{
+		if (this->built)
+		{
+			MeshArena::Get().Free(this->allocation);
+		}
+		this->built = false;
+		this->groups.clear();
+		this->VAO = 0;
+	}
+
+	void build()
+	{
+		vector<GroupData> data;
+		vector<Vertex> vertices;
+		vector<GLuint> indices;
+		GLuint numMeshes = 0;
+
+		for (size_t i = 0; i < this->sources.size(); i++)
+		{
+			Source &source = this->sources[i];
+			source.asset = source.model->Asset();
+			for (size_t j = 0; j < source.asset->meshes.size(); j++)
+			{
+				const Mesh &mesh = source.asset->meshes[j];
+				readMesh(source.asset->buffer, mesh, vertices, indices);
+				transform(vertices, source.placement);
+				append(data, mesh.material, vertices, indices);
+				numMeshes++;
+			}
+		}
+		for (size_t i = 0; i < this->surfaces.size(); i++)
+		{
+			vertices = this->surfaces[i].vertices;
+			indices.resize(vertices.size());
+			for (GLuint k = 0; k < indices.size(); k++)
+			{
+				indices[k] = k;
+			}
+			transform(vertices, this->surfaces[i].placement);
+			append(data, this->surfaces[i].material, vertices, indices);
+		}
+
+		// One range for every group; a group's indices stay relative to its own vertices
+		shared_ptr<BakedGeometry> baked = make_shared<BakedGeometry>();
+		this->groups.clear();
+		for (size_t i = 0; i < data.size(); i++)
+		{
+			if (data[i].indices.empty())
+			{
+				continue;
+			}
+			Group group;
+			group.material = data[i].material;
+			group.firstIndex = (GLuint)baked->indices.size();
+			group.numIndices = (GLuint)data[i].indices.size();
+			group.baseVertex = (GLint)baked->vertices.size();
+			bounds(data[i].vertices, group.boundsCenter, group.boundsRadius);
+			this->groups.push_back(group);
+
+			baked->vertices.insert(baked->vertices.end(), data[i].vertices.begin(), data[i].vertices.end());
+			baked->indices.insert(baked->indices.end(), data[i].indices.begin(), data[i].indices.end());
+		}
+		this->built = true;
+		if (this->groups.empty())
+		{
+			return;
+		}
+
+		MeshArena &arena = MeshArena::Get();
+		this->allocation = arena.Allocate(MeshBuffer::Layout(false), (GLuint)baked->vertices.size(), (GLuint)baked->indices.size());
+		this->VAO = arena.VAO(this->allocation);
+		for (size_t i = 0; i < this->groups.size(); i++)
+		{
+			this->groups[i].firstIndex += this->allocation.firstIndex;
+			this->groups[i].baseVertex += (GLint)this->allocation.firstVertex;
+		}
+
+		UploadQueue &queue = UploadQueue::Get();
+		string profileName = "static:" + this->name;
+		queue.EnqueueBuffer(arena.VBO(this->allocation), this->allocation.firstVertex * sizeof(Vertex), baked->vertices.data(), baked->vertices.size() * sizeof(Vertex), baked, profileName);
+		this->uploadTicket = queue.EnqueueBuffer(arena.EBO(this->allocation), this->allocation.firstIndex * sizeof(GLuint), baked->indices.data(), baked->indices.size() * sizeof(GLuint), baked, profileName);
+
+		size_t bytes = baked->vertices.size() * sizeof(Vertex) + baked->indices.size() * sizeof(GLuint);
+		cout << "Lote estatico " << this->name << ": " << this->sources.size() << " modelos (" << numMeshes << " mallas) y " << this->surfaces.size()
+			<< " superficies -> " << this->groups.size() << " dibujos por material, " << baked->vertices.size() << " vertices, "
+			<< bytes / 1024 << " KB" << endl;
+	}
+
+	// Vertices (in the float layout) and indices of the full level of a mesh, read back from its arena range.
+	// The indices come relative to the mesh's first vertex.
+	static void readMesh(const MeshBuffer &buffer, const Mesh &mesh, vector<Vertex> &vertices, vector<GLuint> &indices)
+	{
+		const MeshLod &level = mesh.Lod(0);
+		indices.resize(level.numIndices);
+		vertices.clear();
+		if (indices.empty())
+		{
+			return;
+		}
+
+		// The copy target leaves the VAO and array buffer bindings alone
+		glBindBuffer(GL_COPY_READ_BUFFER, buffer.EBO);
+		glGetBufferSubData(GL_COPY_READ_BUFFER, level.firstIndex * sizeof(GLuint), indices.size() * sizeof(GLuint), indices.data());
+		GLuint numVertices = *max_element(indices.begin(), indices.end()) + 1;
+		vertices.resize(numVertices);
+
+		glBindBuffer(GL_COPY_READ_BUFFER, buffer.VBO);
+		if (!buffer.packed)
+		{
+			glGetBufferSubData(GL_COPY_READ_BUFFER, mesh.BaseVertex() * sizeof(Vertex), numVertices * sizeof(Vertex), vertices.data());
+		}
+		else
+		{
+			vector<PackedVertex> packed(numVertices);
+			glGetBufferSubData(GL_COPY_READ_BUFFER, mesh.BaseVertex() * sizeof(PackedVertex), numVertices * sizeof(PackedVertex), packed.data());
+			for (GLuint i = 0; i < numVertices; i++)
+			{
+				for (int k = 0; k < 3; k++)
+				{
+					vertices[i].Position[k] = buffer.positionOffset[k] + packed[i].Position[k] / 65535.0f * buffer.positionScale[k];
+				}
+				vertices[i].Normal = VertexPacking::DecodeOctahedral(packed[i].Normal);
+				vertices[i].TexCoords = glm::vec2(VertexPacking::HalfToFloat(packed[i].TexCoords[0]), VertexPacking::HalfToFloat(packed[i].TexCoords[1]));
+			}
+		}
+		glBindBuffer(GL_COPY_READ_BUFFER, 0);
+	}
+
+	static void transform(vector<Vertex> &vertices, const glm::mat4 &placement)
+	{
+		glm::mat3 normalMatrix = glm::transpose(glm::inverse(glm::mat3(placement)));
+		for (size_t i = 0; i < vertices.size(); i++)
+		{
+			vertices[i].Position = glm::vec3(placement * glm::vec4(vertices[i].Position, 1.0f));
+			glm::vec3 normal = normalMatrix * vertices[i].Normal;
+			float length = glm::length(normal);
+			vertices[i].Normal = length > 0.0f ? normal / length : normal;
+		}
+	}
+
+	static void append(vector<GroupData> &data, const Material &material, const vector<Vertex> &vertices, const vector<GLuint> &indices)
+	{
+		size_t group = 0;
+		while (group < data.size() && !data[group].material.SameAs(material))
+		{
+			group++;
+		}
+		if (group == data.size())
+		{
+			data.push_back(GroupData());
+			data.back().material = material;
+		}
+
+		GroupData &target = data[group];
+		GLuint base = (GLuint)target.vertices.size();
+		target.vertices.insert(target.vertices.end(), vertices.begin(), vertices.end());
+		for (size_t i = 0; i < indices.size(); i++)
+		{
+			target.indices.push_back(base + indices[i]);
+		}
+	}
+
+	// Sphere around the box of the vertices
+	static void bounds(const vector<Vertex> &vertices, glm::vec3 &center, float &radius)
+	{
+		glm::vec3 minimum = vertices[0].Position, maximum = vertices[0].Position;
+		for (size_t i = 1; i < vertices.size(); i++)
+		{
+			for (int k = 0; k < 3; k++)
+			{
+				minimum[k] = min(minimum[k], vertices[i].Position[k]);
+				maximum[k] = max(maximum[k], vertices[i].Position[k]);
+			}
+		}
+		center = (minimum + maximum) * 0.5f;
+		radius = 0.0f;
+		for (size_t i = 0; i < vertices.size(); i++)
+		{
+			radius = max(radius, glm::length(vertices[i].Position - center));
+		}
+	}
+};
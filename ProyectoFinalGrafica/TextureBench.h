@@ -0,0 +1,167 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <chrono>
+#include <iostream>
+#include <algorithm>
+
+#include <GL/glew.h>
+#include "SOIL2/SOIL2.h"
+
+#include "MappedFile.h"
+#include "AssetPack.h"
+#include "AssetLoader.h"
+#include "CookedAssets.h"
+#include "UploadQueue.h"
+#include "TextureManager.h"
+
+using namespace std;
+
+/*
+	Textures loaded per second by the old path and by the pipeline (--bench-textures).
+
+	Every source image under images/ and Models/ is loaded three times, always from source (cooked DDS files are
+	ignored) and with the file cache warm:
+		- the way TextureFromFile used to work: read, decode to RGB and glTexImage2D + glGenerateMipmap, one file after
+		  another on the GL thread;
+		- through TextureManager::LoadAsync, decoding to RGB on the AssetLoader threads and uploading through the
+		  ring of staging buffers of the UploadQueue;
+		- the same, decoding to RGBA.
+	Each pass ends with glFinish, so the GPU side of the transfer is included, and deletes its textures.
+*/
+
+class TextureBench
+{
+public:
+	static void Run()
+	{
+		vector<string> files;
+		ListImages("images", files);
+		ListImages("Models", files);
+
+		// Read everything once so no pass pays for the disk (the hash touches every page of the mapping)
+		size_t sourceBytes = 0;
+		volatile uint64_t touched = 0;
+		for (size_t i = 0; i < files.size(); i++)
+		{
+			AssetFile file;
+			if (file.Open(files[i]))
+			{
+				sourceBytes += file.Size();
+				touched = touched ^ HashBytes(file.Data(), file.Size());
+			}
+		}
+		cout << "Banco de texturas: " << files.size() << " imagenes, " << sourceBytes / (1024.0 * 1024.0) << " MB en disco" << endl;
+
+		bool cooked = CookedAssets::Get().enabled;
+		bool rgba = TextureManager::Get().rgbaUploads;
+		CookedAssets::Get().enabled = false;
+
+		Report("sincrono RGB (hilo de GL)", files.size(), RunSync(files));
+		TextureManager::Get().rgbaUploads = false;
+		Report("hilos + anillo de PBO, RGB", files.size(), RunPipeline(files));
+		TextureManager::Get().rgbaUploads = true;
+		Report("hilos + anillo de PBO, RGBA", files.size(), RunPipeline(files));
+
+		CookedAssets::Get().enabled = cooked;
+		TextureManager::Get().rgbaUploads = rgba;
+	}
+
+private:
+	struct Pass
+	{
+		double ms;
+		size_t pixelBytes; // Decoded bytes uploaded, without the mipmaps
+	};
+
+	static void ListImages(const string &directory, vector<string> &images)
+	{
+		vector<string> files;
+		ListFiles(directory, true, files);
+		for (size_t i = 0; i < files.size(); i++)
+		{
+			size_t dot = files[i].find_last_of('.');
+			string extension = dot == string::npos ? "" : files[i].substr(dot);
+			transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+			if (extension == ".png" || extension == ".jpg" || extension == ".jpeg" || extension == ".bmp" || extension == ".tga")
+			{
+				images.push_back(files[i]);
+			}
+		}
+	}
+
+	static Pass RunSync(const vector<string> &files)
+	{
+		chrono::steady_clock::time_point start = chrono::steady_clock::now();
+		vector<GLuint> textures;
+		Pass pass = { 0.0, 0 };
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+		for (size_t i = 0; i < files.size(); i++)
+		{
+			AssetFile file;
+			int width, height;
+			unsigned char *pixels = file.Open(files[i]) ?
+				SOIL_load_image_from_memory(file.Data(), (int)file.Size(), &width, &height, 0, SOIL_LOAD_RGB) : nullptr;
+			if (!pixels)
+			{
+				continue;
+			}
+
+			GLuint id;
+			glGenTextures(1, &id);
+			glBindTexture(GL_TEXTURE_2D, id);
+			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, pixels);
+			glGenerateMipmap(GL_TEXTURE_2D);
+			glBindTexture(GL_TEXTURE_2D, 0);
+			SOIL_free_image_data(pixels);
+			textures.push_back(id);
+			pass.pixelBytes += (size_t)width * height * 3;
+		}
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+		glFinish();
+		pass.ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+
+		glDeleteTextures((GLsizei)textures.size(), textures.data());
+		return pass;
+	}
+
+	static Pass RunPipeline(const vector<string> &files)
+	{
+		AssetLoader &loader = AssetLoader::Get();
+		bool started = !loader.IsActive();
+		loader.Start();
+
+		size_t uploaded = UploadQueue::Get().Stats().totalBytes;
+		chrono::steady_clock::time_point start = chrono::steady_clock::now();
+		vector<GLuint> textures;
+		for (size_t i = 0; i < files.size(); i++)
+		{
+			textures.push_back(TextureManager::Get().LoadAsync(files[i]));
+		}
+		loader.Wait();
+		UploadQueue::Get().Flush();
+		glFinish();
+
+		Pass pass;
+		pass.ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+		pass.pixelBytes = UploadQueue::Get().Stats().totalBytes - uploaded;
+
+		for (size_t i = 0; i < textures.size(); i++)
+		{
+			TextureManager::Get().Release(textures[i]);
+		}
+		if (started)
+		{
+			loader.Finish();
+		}
+		return pass;
+	}
+
+	static void Report(const char *name, size_t files, const Pass &pass)
+	{
+		double seconds = max(pass.ms, 0.001) / 1000.0;
+		cout << "  " << name << ": " << pass.ms << " ms | " << files / seconds << " texturas/s | " << pass.pixelBytes / (1024.0 * 1024.0) / seconds
+			<< " MB/s subidos" << endl;
+	}
+};
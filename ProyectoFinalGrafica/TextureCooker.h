@@ -0,0 +1,325 @@
+#pragma once
+
+#include <cmath>
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+
+#include <GL/glew.h>
+#include "stb_image.h"
+
+#include "MappedFile.h"
+#include "DdsFile.h"
+#include "AssetLoader.h"
+
+using namespace std;
+
+/*
+	Turns a source image into a DXT1 (no alpha) or DXT5 (alpha) DDS with its whole mip chain, as zoo-cook and the
+	first-run cook of the game (CookedAssets::CookTextures) write them.
+
+	The mip levels are box filtered here, so a cooked texture never needs glGenerateMipmap. Every level is
+	compressed with SOIL2's encoder and decoded back right away to measure what the compression cost: the RMSE and
+	PSNR over all the channels of all the levels, and the largest error of a single channel.
+
+	Large levels are split into strips of block rows compressed on the AssetLoader workers (one after another when
+	the pool isn't running). Blocks never cross a strip, so the result is the same as compressing the level at once.
+*/
+
+// Block rows a strip gets at least, so small levels aren't split for nothing
+#define DXT_MIN_STRIP_ROWS 16
+
+// What cooking one image gave
+struct TextureCookStats
+{
+	GLenum format = 0;
+	GLsizei width = 0;
+	GLsizei height = 0;
+	GLuint levels = 0;
+	size_t uncompressedBytes = 0; // RGBA8 with the same mip chain, as the source path keeps it in video memory
+	size_t cookedBytes = 0;       // Every DXT level
+	double rmse = 0.0;            // In 0-255 units
+	double psnr = 0.0;            // dB, INFINITY if nothing was lost
+	int maxError = 0;
+
+	double Ratio() const
+	{
+		return this->cookedBytes == 0 ? 0.0 : (double)this->uncompressedBytes / this->cookedBytes;
+	}
+
+	// "DXT1 512x512, 10 niveles, x8.0 menos memoria, PSNR 38.2 dB, error max 21"
+	string Describe() const
+	{
+		char text[160];
+		snprintf(text, sizeof(text), "%s %dx%d, %u niveles, x%.1f menos memoria, PSNR %.1f dB, error max %d",
+			this->format == GL_COMPRESSED_RGB_S3TC_DXT1_EXT ? "DXT1" : "DXT5", this->width, this->height, this->levels, this->Ratio(),
+			isinf(this->psnr) ? 99.0 : this->psnr, this->maxError);
+		return text;
+	}
+};
+
+class TextureCooker
+{
+public:
+	static bool IsImage(const string &path)
+	{
+		size_t dot = path.find_last_of('.');
+		if (dot == string::npos)
+		{
+			return false;
+		}
+		string extension = path.substr(dot);
+		for (size_t i = 0; i < extension.size(); i++)
+		{
+			extension[i] = (char)tolower((unsigned char)extension[i]);
+		}
+		return extension == ".jpg" || extension == ".jpeg" || extension == ".png" || extension == ".tga" || extension == ".bmp";
+	}
+
+	// Decodes the image, builds all its mipmaps, compresses them in up to numThreads strips and writes the DDS.
+	// channels is the channel count of the source.
+	static bool Cook(const string &source, const string &cookedPath, GLuint &channels, TextureCookStats &stats, unsigned numThreads = 1)
+	{
+		MappedFile file;
+		if (!file.Open(source))
+		{
+			return false;
+		}
+
+		int width, height, numChannels;
+		unsigned char *data = stbi_load_from_memory(file.Data(), (int)file.Size(), &width, &height, &numChannels, 0);
+		if (!data)
+		{
+			return false;
+		}
+		channels = (GLuint)numChannels;
+
+		// As in SOIL: an odd channel count has no alpha
+		bool alpha = (numChannels & 1) == 0;
+		stats = TextureCookStats();
+		stats.format = alpha ? GL_COMPRESSED_RGBA_S3TC_DXT5_EXT : GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+		stats.width = width;
+		stats.height = height;
+
+		vector<unsigned char> level(data, data + (size_t)width * height * numChannels), next;
+		stbi_image_free(data);
+
+		vector<vector<unsigned char> > levels;
+		double squaredError = 0.0;
+		size_t samples = 0;
+		int levelWidth = width, levelHeight = height;
+		while (true)
+		{
+			levels.push_back(vector<unsigned char>());
+			if (!Compress(level.data(), levelWidth, levelHeight, numChannels, stats.format, numThreads, levels.back()))
+			{
+				return false;
+			}
+
+			measure(level, levelWidth, levelHeight, numChannels, levels.back(), stats.format, squaredError, samples, stats.maxError);
+			stats.uncompressedBytes += (size_t)levelWidth * levelHeight * 4;
+			stats.cookedBytes += levels.back().size();
+
+			if (levelWidth == 1 && levelHeight == 1)
+			{
+				break;
+			}
+			Downsample(level, levelWidth, levelHeight, numChannels, next);
+			level.swap(next);
+			levelWidth = max(levelWidth / 2, 1);
+			levelHeight = max(levelHeight / 2, 1);
+		}
+
+		stats.levels = (GLuint)levels.size();
+		stats.rmse = samples == 0 ? 0.0 : sqrt(squaredError / samples);
+		stats.psnr = stats.rmse == 0.0 ? INFINITY : 20.0 * log10(255.0 / stats.rmse);
+		return DdsImage::Write(cookedPath, stats.format, width, height, levels);
+	}
+
+	// Compresses an image to DXT1 or DXT5 blocks, in up to numThreads strips of block rows (see AssetLoader::ParallelFor)
+	static bool Compress(const unsigned char *pixels, int width, int height, int channels, GLenum format, unsigned numThreads,
+		vector<unsigned char> &blocks)
+	{
+		int blockRows = (height + 3) / 4;
+		size_t rowBytes = (size_t)((width + 3) / 4) * DdsImage::BlockBytes(format);
+		int numStrips = max(1, min((int)numThreads, blockRows / DXT_MIN_STRIP_ROWS));
+		blocks.resize(rowBytes * blockRows);
+
+		vector<char> ok(numStrips, 0);
+		AssetLoader::Get().ParallelFor(numStrips, [=, &blocks, &ok](size_t strip)
+		{
+			int firstRow = blockRows * strip / numStrips, lastRow = blockRows * (strip + 1) / numStrips;
+			int y = firstRow * 4, stripHeight = min(lastRow * 4, height) - y, size = 0;
+			const unsigned char *stripPixels = pixels + (size_t)y * width * channels;
+			unsigned char *compressed = format == GL_COMPRESSED_RGBA_S3TC_DXT5_EXT ? convert_image_to_DXT5(stripPixels, width, stripHeight, channels, &size) :
+				convert_image_to_DXT1(stripPixels, width, stripHeight, channels, &size);
+			if (compressed)
+			{
+				memcpy(&blocks[rowBytes * firstRow], compressed, size);
+				free(compressed);
+				ok[strip] = 1;
+			}
+		});
+		return find(ok.begin(), ok.end(), 0) == ok.end();
+	}
+
+	// PSNR in dB of compressed blocks against the pixels they came from (INFINITY if nothing was lost)
+	static double Psnr(const vector<unsigned char> &pixels, int width, int height, int channels, const vector<unsigned char> &blocks, GLenum format)
+	{
+		double squaredError = 0.0;
+		size_t samples = 0;
+		int maxError = 0;
+		measure(pixels, width, height, channels, blocks, format, squaredError, samples, maxError);
+		return squaredError == 0.0 ? INFINITY : 20.0 * log10(255.0 / sqrt(squaredError / samples));
+	}
+
+	// Halves an image averaging 2x2 blocks (on odd edges the last row or column is repeated)
+	static void Downsample(const vector<unsigned char> &pixels, int width, int height, int channels, vector<unsigned char> &result)
+	{
+		int newWidth = max(width / 2, 1), newHeight = max(height / 2, 1);
+		result.resize((size_t)newWidth * newHeight * channels);
+
+		for (int y = 0; y < newHeight; y++)
+		{
+			int y0 = min(y * 2, height - 1), y1 = min(y * 2 + 1, height - 1);
+			for (int x = 0; x < newWidth; x++)
+			{
+				int x0 = min(x * 2, width - 1), x1 = min(x * 2 + 1, width - 1);
+				for (int c = 0; c < channels; c++)
+				{
+					int sum = pixels[((size_t)y0 * width + x0) * channels + c] + pixels[((size_t)y0 * width + x1) * channels + c] +
+						pixels[((size_t)y1 * width + x0) * channels + c] + pixels[((size_t)y1 * width + x1) * channels + c];
+					result[((size_t)y * newWidth + x) * channels + c] = (unsigned char)((sum + 2) / 4);
+				}
+			}
+		}
+	}
+
+	// Decodes a level of DXT1 or DXT5 blocks to RGBA8, as the GPU samples it
+	static void Decode(const unsigned char *blocks, GLenum format, int width, int height, vector<unsigned char> &rgba)
+	{
+		bool dxt1 = format == GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+		size_t blockBytes = dxt1 ? 8 : 16;
+		rgba.resize((size_t)width * height * 4);
+
+		unsigned char block[16 * 4];
+		for (int by = 0; by < height; by += 4)
+		{
+			for (int bx = 0; bx < width; bx += 4, blocks += blockBytes)
+			{
+				decodeColorBlock(dxt1 ? blocks : blocks + 8, dxt1, block);
+				if (!dxt1)
+				{
+					decodeAlphaBlock(blocks, block);
+				}
+
+				for (int y = 0; y < 4 && by + y < height; y++)
+				{
+					for (int x = 0; x < 4 && bx + x < width; x++)
+					{
+						memcpy(&rgba[((size_t)(by + y) * width + bx + x) * 4], &block[(y * 4 + x) * 4], 4);
+					}
+				}
+			}
+		}
+	}
+
+private:
+	// Decodes a level and adds its squared error against the pixels it was compressed from, seen the way SOIL's
+	// encoder reads them: one or two channels are grey, and only two or four channels have alpha
+	static void measure(const vector<unsigned char> &pixels, int width, int height, int channels, const vector<unsigned char> &blocks, GLenum format,
+		double &squaredError, size_t &samples, int &maxError)
+	{
+		vector<unsigned char> decoded;
+		Decode(blocks.data(), format, width, height, decoded);
+
+		bool alpha = (channels & 1) == 0;
+		int step = channels < 3 ? 0 : 1;
+		size_t numPixels = (size_t)width * height;
+		for (size_t i = 0; i < numPixels; i++)
+		{
+			const unsigned char *source = &pixels[i * channels];
+			const unsigned char *result = &decoded[i * 4];
+			int expected[4] = { source[0], source[step], source[2 * step], alpha ? source[channels - 1] : 255 };
+			for (int c = 0; c < (alpha ? 4 : 3); c++)
+			{
+				int error = abs(expected[c] - result[c]);
+				squaredError += (double)error * error;
+				maxError = max(maxError, error);
+			}
+			samples += alpha ? 4 : 3;
+		}
+	}
+
+	static void decodeColorBlock(const unsigned char *block, bool dxt1, unsigned char rgba[16 * 4])
+	{
+		unsigned int c0 = block[0] | (block[1] << 8), c1 = block[2] | (block[3] << 8);
+		int colors[4][4];
+		expand565(c0, colors[0]);
+		expand565(c1, colors[1]);
+
+		// DXT1 with c0 <= c1 has three colors and transparent black; DXT5 always has four
+		bool fourColors = !dxt1 || c0 > c1;
+		for (int c = 0; c < 3; c++)
+		{
+			colors[2][c] = fourColors ? (2 * colors[0][c] + colors[1][c] + 1) / 3 : (colors[0][c] + colors[1][c]) / 2;
+			colors[3][c] = fourColors ? (colors[0][c] + 2 * colors[1][c] + 1) / 3 : 0;
+		}
+		colors[0][3] = colors[1][3] = colors[2][3] = 255;
+		colors[3][3] = fourColors ? 255 : 0;
+
+		unsigned int indices = block[4] | (block[5] << 8) | (block[6] << 16) | ((unsigned int)block[7] << 24);
+		for (int i = 0; i < 16; i++)
+		{
+			const int *color = colors[(indices >> (2 * i)) & 3];
+			for (int c = 0; c < 4; c++)
+			{
+				rgba[i * 4 + c] = (unsigned char)color[c];
+			}
+		}
+	}
+
+	static void decodeAlphaBlock(const unsigned char *block, unsigned char rgba[16 * 4])
+	{
+		int a0 = block[0], a1 = block[1];
+		int alphas[8] = { a0, a1 };
+		if (a0 > a1)
+		{
+			for (int i = 1; i < 7; i++)
+			{
+				alphas[i + 1] = ((7 - i) * a0 + i * a1 + 3) / 7;
+			}
+		}
+		else
+		{
+			for (int i = 1; i < 5; i++)
+			{
+				alphas[i + 1] = ((5 - i) * a0 + i * a1 + 2) / 5;
+			}
+			alphas[6] = 0;
+			alphas[7] = 255;
+		}
+
+		unsigned long long indices = 0;
+		for (int i = 0; i < 6; i++)
+		{
+			indices |= (unsigned long long)block[2 + i] << (8 * i);
+		}
+		for (int i = 0; i < 16; i++)
+		{
+			rgba[i * 4 + 3] = (unsigned char)alphas[(indices >> (3 * i)) & 7];
+		}
+	}
+
+	// 5:6:5 to 8 bits per channel by repeating the high bits, as the hardware does
+	static void expand565(unsigned int color, int rgb[4])
+	{
+		int r = (color >> 11) & 31, g = (color >> 5) & 63, b = color & 31;
+		rgb[0] = (r << 3) | (r >> 2);
+		rgb[1] = (g << 2) | (g >> 4);
+		rgb[2] = (b << 3) | (b >> 2);
+	}
+};
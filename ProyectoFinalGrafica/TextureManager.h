@@ -0,0 +1,851 @@
+#pragma once
+
+#include <map>
+#include <mutex>
+#include <memory>
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstdint>
+#include <iostream>
+
+#include <GL/glew.h>
+#include "SOIL2/SOIL2.h"
+#include "stb_image.h"
+
+#include "MappedFile.h"
+#include "AssetPack.h"
+#include "DdsFile.h"
+#include "CookedAssets.h"
+#include "LoadProfiler.h"
+#include "UploadQueue.h"
+#include "AssetLoader.h"
+
+using namespace std;
+
+// How the pixels of a file are turned into a texture. The same file loaded two different ways gives two textures.
+enum TextureKind
+{
+	TEXTURE_RGB,     // Forced to RGB with SOIL, mipmapped and repeating (TextureFromFile, model materials)
+	TEXTURE_NATIVE,  // Native channel count with stb_image, mipmapped and repeating (TextureLoading::LoadTexture)
+	TEXTURE_CUBEMAP  // Six faces with native channels, uploaded as RGB (TextureLoading::LoadCubemap)
+};
+
+// Image decoded on any thread, waiting for TextureManager::Acquire on the GL thread
+struct ImageData
+{
+	string path;          // Path as referenced by the caller (e.g. relative to the model directory)
+	string canonicalPath; // File it was read from, in canonical form
+	uint64_t contentHash = 0;
+	bool resident = false; // The texture was already resident when it was prepared, so nothing was decoded
+	int width = 0;
+	int height = 0;
+	int channels = 3;     // Of pixels: 3, or 4 with TextureManager::rgbaUploads
+	unsigned char *pixels = nullptr;
+
+	// Cooked DXT texture: the mapped DDS and its levels, uploaded as they are instead of pixels
+	unique_ptr<MappedFile> cookedFile;
+	DdsImage dds;
+
+	ImageData() {}
+	ImageData(ImageData &&other) noexcept : path(move(other.path)), canonicalPath(move(other.canonicalPath)),
+		contentHash(other.contentHash), resident(other.resident), width(other.width), height(other.height), channels(other.channels), pixels(other.pixels),
+		cookedFile(move(other.cookedFile)), dds(move(other.dds))
+	{
+		other.pixels = nullptr;
+	}
+	ImageData(const ImageData &) = delete;
+	ImageData &operator=(const ImageData &) = delete;
+
+	~ImageData()
+	{
+		if (this->pixels)
+		{
+			SOIL_free_image_data(this->pixels);
+		}
+	}
+};
+
+// A resident texture as the memory report sees it. Textures keep nothing in RAM once uploaded.
+struct TextureMemory
+{
+	GLuint id;
+	string path;
+	GLuint refs;
+	size_t gpuBytes;
+};
+
+/*
+	Process-wide texture cache.
+
+	Textures are keyed by the content hash of their file (plus how they are loaded), so the same image stored under
+	different model directories is uploaded once. A second map from canonical path to texture avoids re-reading a
+	file that is already known. Every Load/Acquire adds a reference that is given back with Release; the texture is
+	deleted when the last reference goes away.
+
+	Files cooked by zoo-cook (see CookedAssets.h) are preferred: their DXT mip chain is uploaded straight from the
+	mapped DDS, and the content hash comes from the manifest, so the source isn't even read.
+
+	Prepare() only reads, hashes and decodes, so it can run on the loader threads. Everything that touches GL
+	(Acquire, Load, LoadCubemap, Release) must run on the GL thread.
+
+	Acquire and Load create the texture right away but its pixels go through the UploadQueue; Ticket() tells when
+	they are there. LoadAsync also moves the reading and decoding to the AssetLoader threads. Cubemaps and
+	LoadNative, only used at startup, upload immediately; the six faces of a cubemap are decoded in parallel.
+
+	Images are decoded to RGBA unless rgbaUploads is cleared: rows of 4-byte pixels are always aligned, and RGBA8 is
+	the layout drivers keep textures in, so the upload needs no conversion on the CPU.
+*/
+class TextureManager
+{
+public:
+	static TextureManager &Get()
+	{
+		static TextureManager manager;
+		return manager;
+	}
+
+	bool rgbaUploads = true; // Decode color textures to 4 channels instead of 3. Set it before loading anything.
+
+	// Reads, hashes and decodes the file unless a texture with the same path or content is already resident.
+	void Prepare(const string &filename, ImageData &image)
+	{
+		image.canonicalPath = CanonicalPath(filename);
+
+		{
+			lock_guard<mutex> lock(this->lookupMutex);
+			if (this->byPath.count(PathKey(image.canonicalPath, TEXTURE_RGB)))
+			{
+				image.resident = true;
+				return;
+			}
+		}
+
+		const CookedEntry *cooked = CookedAssets::Get().Find(filename, COOKED_TEXTURE);
+		if (cooked && openCookedProfiled(*cooked, image, "texture"))
+		{
+			lock_guard<mutex> lock(this->lookupMutex);
+			if (this->byContent.count(ContentKey(image.contentHash, TEXTURE_RGB)))
+			{
+				image.resident = true;
+				image.cookedFile.reset();
+				image.dds = DdsImage();
+			}
+			return;
+		}
+
+		AssetFile file;
+		if (!openProfiled(filename, image.canonicalPath, "texture", file, image.contentHash))
+		{
+			cout << "ERROR::TEXTURE::FILE_NOT_FOUND " << filename << endl;
+			return;
+		}
+
+		{
+			lock_guard<mutex> lock(this->lookupMutex);
+			if (this->byContent.count(ContentKey(image.contentHash, TEXTURE_RGB)))
+			{
+				image.resident = true;
+				return;
+			}
+		}
+
+		this->decode(filename, file, image);
+	}
+
+	// Returns a reference to the texture of a prepared image, uploading it if it isn't resident yet.
+	GLuint Acquire(ImageData &image)
+	{
+		// Known path or known content: share the resident texture
+		GLuint id = this->acquireExisting(image.canonicalPath, image.contentHash, TEXTURE_RGB);
+		if (id != 0)
+		{
+			return id;
+		}
+
+		if (image.pixels)
+		{
+			return this->upload(image);
+		}
+		if (!image.dds.levels.empty())
+		{
+			return this->uploadCompressed(image, TEXTURE_RGB);
+		}
+
+		// It was resident when it was prepared but has been released since then: read it again
+		if (image.resident)
+		{
+			ImageData reloaded;
+			reloaded.path = image.path;
+			this->Prepare(image.canonicalPath, reloaded);
+			if (reloaded.pixels)
+			{
+				return this->upload(reloaded);
+			}
+			if (!reloaded.dds.levels.empty())
+			{
+				return this->uploadCompressed(reloaded, TEXTURE_RGB);
+			}
+			return this->acquireExisting(reloaded.canonicalPath, reloaded.contentHash, TEXTURE_RGB);
+		}
+
+		return 0;
+	}
+
+	// Synchronous load of an RGB texture (TextureFromFile)
+	GLuint Load(const string &filename)
+	{
+		ImageData image;
+		image.path = filename;
+		this->Prepare(filename, image);
+		return this->Acquire(image);
+	}
+
+	// Like Load, but while the AssetLoader is active the file is read and decoded on one of its threads. The texture
+	// name is returned right away; its storage and pixels come once the AssetLoader has run the upload (Wait or
+	// Poll) and the UploadQueue has copied them, and until then it samples as black. Ticket() is 0 meanwhile.
+	// If the file turns out to hold an image that is already resident, nothing is uploaded and the name stands for
+	// that texture: bind Resolve(id) once the AssetLoader is done with it.
+	GLuint LoadAsync(const string &filename)
+	{
+		AssetLoader &loader = AssetLoader::Get();
+		if (!loader.IsActive())
+		{
+			return this->Load(filename);
+		}
+
+		string canonicalPath = CanonicalPath(filename);
+		GLuint id = this->acquireExisting(canonicalPath, 0, TEXTURE_RGB);
+		if (id != 0)
+		{
+			return id;
+		}
+
+		// Known by path from now on; by content once it has been read
+		glGenTextures(1, &id);
+		this->add(id, canonicalPath, 0, TEXTURE_RGB, 0);
+		uint64_t generation;
+		{
+			lock_guard<mutex> lock(this->lookupMutex);
+			Entry &entry = this->entries[id];
+			entry.decoding = true;
+			entry.generation = generation = ++this->generations;
+		}
+
+		shared_ptr<ImageData> image = make_shared<ImageData>();
+		image->path = filename;
+		image->canonicalPath = canonicalPath;
+		loader.Enqueue(
+			[this, filename, image](Assimp::Importer &)
+			{
+				const CookedEntry *cooked = CookedAssets::Get().Find(filename, COOKED_TEXTURE);
+				if (cooked && openCookedProfiled(*cooked, *image, "texture"))
+				{
+					return;
+				}
+				AssetFile file;
+				if (!openProfiled(filename, image->canonicalPath, "texture", file, image->contentHash))
+				{
+					cout << "ERROR::TEXTURE::FILE_NOT_FOUND " << filename << endl;
+					return;
+				}
+				this->decode(filename, file, *image);
+			},
+			[this, id, generation, image]() { this->fillAsync(id, generation, *image); });
+		return id;
+	}
+
+	// Synchronous load keeping the channel count of the file (TextureLoading::LoadTexture)
+	GLuint LoadNative(const string &filename)
+	{
+		string canonicalPath = CanonicalPath(filename);
+		GLuint id = this->acquireExisting(canonicalPath, 0, TEXTURE_NATIVE);
+		if (id != 0)
+		{
+			return id;
+		}
+
+		// One or two channel sources would be red or red-green textures here, but the cooker made them grey
+		const CookedEntry *cooked = CookedAssets::Get().Find(filename, COOKED_TEXTURE);
+		ImageData image;
+		image.canonicalPath = canonicalPath;
+		if (cooked && cooked->channels >= 3 && openCookedProfiled(*cooked, image, "texture"))
+		{
+			id = this->acquireExisting(canonicalPath, image.contentHash, TEXTURE_NATIVE);
+			return id != 0 ? id : this->uploadCompressed(image, TEXTURE_NATIVE);
+		}
+
+		AssetFile file;
+		uint64_t contentHash;
+		if (!openProfiled(filename, canonicalPath, "texture", file, contentHash))
+		{
+			std::cout << "Texture failed to load at path: " << filename << std::endl;
+			return 0;
+		}
+		id = this->acquireExisting(canonicalPath, contentHash, TEXTURE_NATIVE);
+		if (id != 0)
+		{
+			return id;
+		}
+
+		int width, height, nrComponents;
+		unsigned char *data;
+		{
+			LoadProfiler::Timer timer("texture", canonicalPath, LOAD_PARSE);
+			data = stbi_load_from_memory(file.Data(), (int)file.Size(), &width, &height, &nrComponents, 0);
+		}
+		if (!data)
+		{
+			std::cout << "Texture failed to load at path: " << filename << std::endl;
+			return 0;
+		}
+
+		GLenum format = GL_RGB;
+		if (nrComponents == 1)
+			format = GL_RED;
+		else if (nrComponents == 3)
+			format = GL_RGB;
+		else if (nrComponents == 4)
+			format = GL_RGBA;
+
+		{
+			LoadProfiler::Timer timer("texture", canonicalPath, LOAD_UPLOAD);
+			glGenTextures(1, &id);
+			glBindTexture(GL_TEXTURE_2D, id);
+			glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
+			glGenerateMipmap(GL_TEXTURE_2D);
+			setRepeatParameters();
+			glBindTexture(GL_TEXTURE_2D, 0);
+		}
+		stbi_image_free(data);
+		LoadProfiler::Get().AddBytes("texture", canonicalPath, 0, (uint64_t)width * height * nrComponents);
+
+		this->add(id, canonicalPath, contentHash, TEXTURE_NATIVE, (size_t)width * height * nrComponents * 4 / 3);
+		return id;
+	}
+
+	// Loads the six faces of a cubemap. The cubemap is shared when the same six files (or identical images) are requested again.
+	GLuint LoadCubemap(const vector<const GLchar *> &faces)
+	{
+		// A cubemap is identified by its face list and by the combined hash of the face contents
+		string key;
+		for (size_t i = 0; i < faces.size(); i++)
+		{
+			key += CanonicalPath(faces[i]) + "|";
+		}
+		GLuint id = this->acquireExisting(key, 0, TEXTURE_CUBEMAP);
+		if (id != 0)
+		{
+			return id;
+		}
+
+		// Cooked faces are only used when all six are there
+		vector<ImageData> cookedFaces(faces.size());
+		bool cooked = !faces.empty();
+		uint64_t contentHash = 14695981039346656037ULL;
+		for (size_t i = 0; i < faces.size() && cooked; i++)
+		{
+			const CookedEntry *entry = CookedAssets::Get().Find(faces[i], COOKED_TEXTURE);
+			cooked = entry && openCookedProfiled(*entry, cookedFaces[i], "cubemap", key);
+			contentHash = cooked ? (contentHash ^ cookedFaces[i].contentHash) * 1099511628211ULL : contentHash;
+		}
+		if (cooked)
+		{
+			id = this->acquireExisting(key, contentHash, TEXTURE_CUBEMAP);
+			return id != 0 ? id : this->uploadCompressedCubemap(key, contentHash, cookedFaces);
+		}
+
+		vector<AssetFile> files(faces.size());
+		contentHash = 14695981039346656037ULL;
+		for (size_t i = 0; i < faces.size(); i++)
+		{
+			uint64_t faceHash;
+			if (openProfiled(faces[i], key, "cubemap", files[i], faceHash))
+			{
+				contentHash = (contentHash ^ faceHash) * 1099511628211ULL;
+			}
+		}
+		id = this->acquireExisting(key, contentHash, TEXTURE_CUBEMAP);
+		if (id != 0)
+		{
+			return id;
+		}
+
+		glGenTextures(1, &id);
+		glBindTexture(GL_TEXTURE_CUBE_MAP, id);
+
+		// The faces are decoded on the AssetLoader workers (inline when the pool isn't running) and uploaded in order afterwards
+		int channels = this->rgbaUploads ? 4 : 3;
+		vector<ImageData> decoded(faces.size());
+		AssetLoader::Get().ParallelFor(faces.size(), [&files, &decoded, &key, channels](size_t i)
+		{
+			if (files[i].IsOpen())
+			{
+				LoadProfiler::Timer timer("cubemap", key, LOAD_PARSE);
+				int fileChannels;
+				decoded[i].pixels = stbi_load_from_memory(files[i].Data(), (int)files[i].Size(), &decoded[i].width, &decoded[i].height, &fileChannels, channels);
+			}
+		});
+
+		LoadProfiler::Get().SetRoute("cubemap", key, "source");
+		size_t bytes = 0;
+		GLenum format = channels == 4 ? GL_RGBA : GL_RGB;
+		for (unsigned int i = 0; i < faces.size(); i++)
+		{
+			if (decoded[i].pixels)
+			{
+				LoadProfiler::Timer timer("cubemap", key, LOAD_UPLOAD);
+				glTexImage2D(
+					GL_TEXTURE_CUBE_MAP_POSITIVE_X + i,
+					0, channels == 4 ? GL_RGBA8 : GL_RGB8, decoded[i].width, decoded[i].height, 0, format, GL_UNSIGNED_BYTE, decoded[i].pixels
+				);
+				bytes += (size_t)decoded[i].width * decoded[i].height * channels;
+			}
+			else
+			{
+				std::cout << "Cubemap texture failed to load at path: " << faces[i] << std::endl;
+			}
+		}
+
+		setCubemapParameters();
+		glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
+		LoadProfiler::Get().AddBytes("cubemap", key, 0, bytes);
+
+		this->add(id, key, contentHash, TEXTURE_CUBEMAP, bytes);
+		return id;
+	}
+
+	// Gives back one reference. The texture is deleted when nobody uses it anymore.
+	void Release(GLuint id)
+	{
+		lock_guard<mutex> lock(this->lookupMutex);
+		this->release(id);
+	}
+
+	// The texture to bind for a name given by LoadAsync: the resident texture with the same image when the file was
+	// a duplicate of it under another path, otherwise the name itself
+	GLuint Resolve(GLuint id)
+	{
+		lock_guard<mutex> lock(this->lookupMutex);
+		map<GLuint, Entry>::iterator it = this->entries.find(id);
+		return it == this->entries.end() || it->second.alias == 0 ? id : it->second.alias;
+	}
+
+	// Upload ticket of a texture (see UploadQueue): its pixels are in place once the queue is done with it
+	uint64_t Ticket(GLuint id)
+	{
+		lock_guard<mutex> lock(this->lookupMutex);
+		map<GLuint, Entry>::iterator it = this->entries.find(id);
+		if (it != this->entries.end() && it->second.alias != 0)
+		{
+			it = this->entries.find(it->second.alias);
+		}
+		return it == this->entries.end() ? 0 : it->second.ticket;
+	}
+
+	// Every resident texture with the first path it was requested with, for the memory report
+	vector<TextureMemory> Textures()
+	{
+		lock_guard<mutex> lock(this->lookupMutex);
+		vector<TextureMemory> textures;
+		for (map<GLuint, Entry>::const_iterator it = this->entries.begin(); it != this->entries.end(); ++it)
+		{
+			// An alias takes no memory, its texture is listed on its own
+			if (it->second.alias != 0)
+			{
+				continue;
+			}
+			TextureMemory texture;
+			texture.id = it->first;
+			texture.refs = it->second.refs;
+			texture.gpuBytes = it->second.bytes;
+			// Path keys are "kind:path"
+			texture.path = it->second.pathKeys.empty() ? "" : it->second.pathKeys[0].substr(it->second.pathKeys[0].find(':') + 1);
+			textures.push_back(texture);
+		}
+		return textures;
+	}
+
+	// Bytes of GPU memory taken by a resident texture
+	size_t Bytes(GLuint id)
+	{
+		lock_guard<mutex> lock(this->lookupMutex);
+		map<GLuint, Entry>::iterator it = this->entries.find(id);
+		return it == this->entries.end() ? 0 : it->second.bytes;
+	}
+
+	size_t ResidentBytes()
+	{
+		lock_guard<mutex> lock(this->lookupMutex);
+		return this->residentBytes;
+	}
+
+	void PrintSummary()
+	{
+		lock_guard<mutex> lock(this->lookupMutex);
+		size_t resident = 0;
+		for (map<GLuint, Entry>::const_iterator it = this->entries.begin(); it != this->entries.end(); ++it)
+		{
+			resident += it->second.alias == 0 ? 1 : 0;
+		}
+		cout << "Texturas: " << resident << " residentes (" << this->residentBytes / (1024.0 * 1024.0)
+			<< " MB) | reutilizadas " << this->pathHits << " por ruta, " << this->contentHits << " por contenido" << endl;
+	}
+
+private:
+	struct Entry
+	{
+		GLuint refs;
+		size_t bytes;
+		uint64_t ticket;
+		bool decoding;           // Created by LoadAsync, waiting for its pixels
+		uint64_t generation;     // Which LoadAsync created it, as a released name can be handed to a newer one
+		GLuint alias;            // Texture with the same image this LoadAsync name stands for (0 if none)
+		string contentKey;
+		vector<string> pathKeys; // Every path this texture was requested with
+	};
+
+	mutex lookupMutex;
+	map<GLuint, Entry> entries;
+	map<string, GLuint> byPath;
+	map<string, GLuint> byContent;
+	size_t residentBytes = 0;
+	uint64_t generations = 0;
+	GLuint pathHits = 0;
+	GLuint contentHits = 0;
+
+	static string PathKey(const string &canonicalPath, TextureKind kind)
+	{
+		return to_string((int)kind) + ":" + canonicalPath;
+	}
+
+	static string ContentKey(uint64_t contentHash, TextureKind kind)
+	{
+		return to_string((int)kind) + ":" + to_string(contentHash);
+	}
+
+	// Adds a reference to the texture known by path or, if contentHash isn't 0, by content. Returns 0 if there is none.
+	GLuint acquireExisting(const string &canonicalPath, uint64_t contentHash, TextureKind kind)
+	{
+		lock_guard<mutex> lock(this->lookupMutex);
+
+		string pathKey = PathKey(canonicalPath, kind);
+		map<string, GLuint>::iterator it = this->byPath.find(pathKey);
+		if (it != this->byPath.end())
+		{
+			this->entries[it->second].refs++;
+			this->pathHits++;
+			return it->second;
+		}
+
+		if (contentHash == 0)
+		{
+			return 0;
+		}
+
+		it = this->byContent.find(ContentKey(contentHash, kind));
+		if (it != this->byContent.end())
+		{
+			// Same image under another path: remember the new path too
+			Entry &entry = this->entries[it->second];
+			entry.refs++;
+			entry.pathKeys.push_back(pathKey);
+			this->byPath[pathKey] = it->second;
+			this->contentHits++;
+			return it->second;
+		}
+
+		return 0;
+	}
+
+	// Release with lookupMutex held. An alias gives back its reference to the texture it stands for when it goes.
+	void release(GLuint id)
+	{
+		map<GLuint, Entry>::iterator it = this->entries.find(id);
+		if (it == this->entries.end() || --it->second.refs > 0)
+		{
+			return;
+		}
+
+		Entry &entry = it->second;
+		for (size_t i = 0; i < entry.pathKeys.size(); i++)
+		{
+			this->byPath.erase(entry.pathKeys[i]);
+		}
+		if (!entry.contentKey.empty())
+		{
+			this->byContent.erase(entry.contentKey);
+		}
+		this->residentBytes -= entry.bytes;
+		GLuint alias = entry.alias;
+		UploadQueue::Get().Cancel(id, true);
+		glDeleteTextures(1, &id);
+		this->entries.erase(it);
+
+		if (alias != 0)
+		{
+			this->release(alias);
+		}
+	}
+
+	void add(GLuint id, const string &canonicalPath, uint64_t contentHash, TextureKind kind, size_t bytes, uint64_t ticket = 0)
+	{
+		lock_guard<mutex> lock(this->lookupMutex);
+
+		Entry &entry = this->entries[id];
+		entry.refs = 1;
+		entry.bytes = bytes;
+		entry.ticket = ticket;
+		entry.decoding = false;
+		entry.generation = 0;
+		entry.alias = 0;
+		entry.pathKeys.push_back(PathKey(canonicalPath, kind));
+		this->byPath[entry.pathKeys.back()] = id;
+
+		// Without a hash (LoadAsync before reading the file) it is only known by path
+		if (contentHash != 0)
+		{
+			entry.contentKey = ContentKey(contentHash, kind);
+			this->byContent[entry.contentKey] = id;
+		}
+		this->residentBytes += bytes;
+	}
+
+	// Decodes a source image for an RGB texture (RGBA with rgbaUploads)
+	void decode(const string &filename, const AssetFile &file, ImageData &image)
+	{
+		{
+			LoadProfiler::Timer timer("texture", image.canonicalPath, LOAD_PARSE);
+			image.channels = this->rgbaUploads ? 4 : 3;
+			image.pixels = SOIL_load_image_from_memory(file.Data(), (int)file.Size(), &image.width, &image.height, 0,
+				this->rgbaUploads ? SOIL_LOAD_RGBA : SOIL_LOAD_RGB);
+		}
+		if (!image.pixels)
+		{
+			cout << "ERROR::TEXTURE::DECODE_FAILED " << filename << endl;
+		}
+	}
+
+	GLuint upload(ImageData &image)
+	{
+		GLuint id;
+		uint64_t ticket;
+		glGenTextures(1, &id);
+		size_t bytes = this->fill(id, image, ticket);
+		this->add(id, image.canonicalPath, image.contentHash, TEXTURE_RGB, bytes, ticket);
+		return id;
+	}
+
+	// Makes id a mipmapped, repeating texture for decoded pixels. The pixels and the mipmaps follow through the upload
+	// queue, which keeps the decoded image until then. Returns the bytes the texture takes.
+	size_t fill(GLuint id, ImageData &image, uint64_t &ticket)
+	{
+		shared_ptr<ImageData> source = takeSource(image);
+		GLenum format = source->channels == 4 ? GL_RGBA : GL_RGB;
+		size_t size = (size_t)source->width * source->height * source->channels;
+		LoadProfiler::Get().AddBytes("texture", image.canonicalPath, 0, size);
+
+		glBindTexture(GL_TEXTURE_2D, id);
+		glTexImage2D(GL_TEXTURE_2D, 0, source->channels == 4 ? GL_RGBA8 : GL_RGB8, source->width, source->height, 0, format, GL_UNSIGNED_BYTE, NULL);
+		setRepeatParameters();
+		glBindTexture(GL_TEXTURE_2D, 0);
+
+		ticket = UploadQueue::Get().EnqueueTexture(id, 0, source->width, source->height, format, GL_UNSIGNED_BYTE, source->pixels, size,
+			false, 0, true, source, image.canonicalPath);
+
+		// Mip chain adds a third on top of the base level
+		return size * 4 / 3;
+	}
+
+	GLuint uploadCompressed(ImageData &image, TextureKind kind)
+	{
+		GLuint id;
+		uint64_t ticket;
+		glGenTextures(1, &id);
+		size_t bytes = this->fillCompressed(id, image, ticket);
+		this->add(id, image.canonicalPath, image.contentHash, kind, bytes, ticket);
+		return id;
+	}
+
+	// Makes id a texture with the mip chain of a cooked DDS. Every level is allocated now and filled by the upload
+	// queue straight from the mapped file, which it keeps open until then. Returns the bytes the texture takes.
+	size_t fillCompressed(GLuint id, ImageData &image, uint64_t &ticket)
+	{
+		shared_ptr<ImageData> source = takeSource(image);
+		const DdsImage &dds = source->dds;
+		LoadProfiler::Get().AddBytes("texture", image.canonicalPath, 0, dds.Bytes());
+
+		glBindTexture(GL_TEXTURE_2D, id);
+		for (size_t i = 0; i < dds.levels.size(); i++)
+		{
+			const DdsLevel &level = dds.levels[i];
+			glCompressedTexImage2D(GL_TEXTURE_2D, (GLint)i, dds.format, level.width, level.height, 0, (GLsizei)level.size, NULL);
+		}
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, (GLint)dds.levels.size() - 1);
+		setRepeatParameters();
+		glBindTexture(GL_TEXTURE_2D, 0);
+
+		ticket = 0;
+		size_t blockBytes = DdsImage::BlockBytes(dds.format);
+		for (size_t i = 0; i < dds.levels.size(); i++)
+		{
+			const DdsLevel &level = dds.levels[i];
+			ticket = UploadQueue::Get().EnqueueTexture(id, (GLint)i, level.width, level.height, dds.format, 0, source->cookedFile->Data() + level.offset,
+				level.size, true, blockBytes, false, source, image.canonicalPath);
+		}
+		return dds.Bytes();
+	}
+
+	// Upload of LoadAsync, on the GL thread once the image is decoded
+	void fillAsync(GLuint id, uint64_t generation, ImageData &image)
+	{
+		{
+			// Released before its file was read, and maybe the name was given to a newer LoadAsync since then
+			lock_guard<mutex> lock(this->lookupMutex);
+			map<GLuint, Entry>::iterator it = this->entries.find(id);
+			if (it == this->entries.end() || !it->second.decoding || it->second.generation != generation)
+			{
+				return;
+			}
+
+			// The same image is already resident under another path: share it instead of uploading a copy
+			map<string, GLuint>::iterator existing = this->byContent.find(ContentKey(image.contentHash, TEXTURE_RGB));
+			if (image.contentHash != 0 && existing != this->byContent.end())
+			{
+				this->makeAlias(it->second, existing->second);
+				return;
+			}
+		}
+
+		uint64_t ticket = 0;
+		size_t bytes = image.pixels ? this->fill(id, image, ticket) : (!image.dds.levels.empty() ? this->fillCompressed(id, image, ticket) : 0);
+
+		lock_guard<mutex> lock(this->lookupMutex);
+		Entry &entry = this->entries[id];
+		entry.decoding = false;
+		entry.bytes = bytes;
+		entry.ticket = ticket;
+		this->residentBytes += bytes;
+		if (image.contentHash != 0)
+		{
+			entry.contentKey = ContentKey(image.contentHash, TEXTURE_RGB);
+			this->byContent[entry.contentKey] = id;
+		}
+	}
+
+	// Turns the name of a LoadAsync whose image was already resident as target into an alias of it, with lookupMutex
+	// held. The name keeps no storage and one reference to target; its paths lead to target from now on.
+	void makeAlias(Entry &entry, GLuint target)
+	{
+		Entry &existing = this->entries[target];
+		existing.refs++;
+		for (size_t i = 0; i < entry.pathKeys.size(); i++)
+		{
+			existing.pathKeys.push_back(entry.pathKeys[i]);
+			this->byPath[entry.pathKeys[i]] = target;
+		}
+		entry.pathKeys.clear();
+		entry.decoding = false;
+		entry.alias = target;
+		this->contentHits++;
+	}
+
+	// Moves the pixels (or the mapped DDS) of an image into a block the upload queue holds until it has copied them
+	static shared_ptr<ImageData> takeSource(ImageData &image)
+	{
+		shared_ptr<ImageData> source = make_shared<ImageData>();
+		source->width = image.width;
+		source->height = image.height;
+		source->channels = image.channels;
+		source->pixels = image.pixels;
+		source->cookedFile = move(image.cookedFile);
+		source->dds = move(image.dds);
+		image.pixels = nullptr;
+		return source;
+	}
+
+	// Cubemap from six cooked faces. Only their first level is used, as the skybox isn't mipmapped.
+	GLuint uploadCompressedCubemap(const string &key, uint64_t contentHash, const vector<ImageData> &faces)
+	{
+		LoadProfiler::Timer timer("cubemap", key, LOAD_UPLOAD);
+		GLuint id;
+		glGenTextures(1, &id);
+		glBindTexture(GL_TEXTURE_CUBE_MAP, id);
+
+		size_t bytes = 0;
+		for (unsigned int i = 0; i < faces.size(); i++)
+		{
+			const DdsImage &dds = faces[i].dds;
+			const DdsLevel &level = dds.levels[0];
+			glCompressedTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, dds.format, level.width, level.height, 0, (GLsizei)level.size,
+				faces[i].cookedFile->Data() + level.offset);
+			bytes += level.size;
+		}
+
+		setCubemapParameters();
+		glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
+		LoadProfiler::Get().AddBytes("cubemap", key, 0, bytes);
+
+		this->add(id, key, contentHash, TEXTURE_CUBEMAP, bytes);
+		return id;
+	}
+
+	// Maps the cooked DDS of an entry into image. The content hash is the one of the source.
+	static bool OpenCooked(const CookedEntry &entry, ImageData &image)
+	{
+		image.cookedFile.reset(new MappedFile());
+		if (!image.cookedFile->Open(entry.cooked) || !DdsImage::Parse(image.cookedFile->Data(), image.cookedFile->Size(), image.dds))
+		{
+			cout << "ERROR::TEXTURE::COOKED_FILE_INVALID " << entry.cooked << endl;
+			image.cookedFile.reset();
+			return false;
+		}
+		image.contentHash = entry.contentHash;
+		return true;
+	}
+
+	// Opens and hashes a source image, which reads all of it, as the I/O of the record kind/name
+	static bool openProfiled(const string &filename, const string &name, const char *kind, AssetFile &file, uint64_t &contentHash)
+	{
+		LoadProfiler::Timer timer(kind, name, LOAD_IO);
+		if (!file.Open(filename))
+		{
+			return false;
+		}
+		contentHash = HashBytes(file.Data(), file.Size());
+		LoadProfiler::Get().AddBytes(kind, name, file.Size(), 0);
+		LoadProfiler::Get().SetRoute(kind, name, "source");
+		return true;
+	}
+
+	// OpenCooked as the I/O of the record kind/name (the canonical path of the image by default)
+	static bool openCookedProfiled(const CookedEntry &entry, ImageData &image, const char *kind, const string &name = string())
+	{
+		const string &record = name.empty() ? image.canonicalPath : name;
+		LoadProfiler::Timer timer(kind, record, LOAD_IO);
+		if (!OpenCooked(entry, image))
+		{
+			return false;
+		}
+		LoadProfiler::Get().AddBytes(kind, record, image.cookedFile->Size(), 0);
+		LoadProfiler::Get().SetRoute(kind, record, "cooked");
+		return true;
+	}
+
+	static void setCubemapParameters()
+	{
+		glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+	}
+
+	static void setRepeatParameters()
+	{
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	}
+};
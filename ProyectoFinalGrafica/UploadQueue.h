@@ -0,0 +1,393 @@
+#pragma once
+
+#include <deque>
+#include <memory>
+#include <string>
+#include <chrono>
+#include <cstring>
+#include <cstdint>
+#include <iostream>
+#include <algorithm>
+
+#include <GL/glew.h>
+
+#include "LoadProfiler.h"
+
+using namespace std;
+
+/*
+	Time-sliced transfer of geometry and pixels to the GPU.
+
+	The GL objects are created (and their storage allocated) as soon as an asset is uploaded, so ids, sizes and
+	memory accounting are known right away, but the bytes are queued here. Process() runs once per frame and
+	copies in steps of at most UPLOAD_STEP_BYTES until the frame's time or byte budget is spent, so a habitat
+	that finishes decoding doesn't stall the frame that uploads it. Flush() copies everything, for loading screens.
+
+	Every step goes through the next staging buffer of a ring of UPLOAD_RING_SIZE, and the copy into the destination
+	(glCopyBufferSubData for buffers, an unpack buffer for textures) happens on the GPU timeline. A fence after each
+	step tells when its buffer has been read: the memcpy of the next steps goes into the other buffers meanwhile,
+	unsynchronized, and a buffer that is still busy when its turn comes is orphaned (glBufferData with no data, so
+	the driver hands out fresh storage) rather than waited for. Persistent mapping would need GL 4.4, and the
+	context is 3.3.
+
+	Enqueue returns a ticket. Jobs complete in order, so an asset is drawable once Done() is true for the last
+	ticket it got. Jobs of an object that is deleted before they run must be cancelled, as GL may hand its name out
+	again.
+*/
+
+#define UPLOAD_STEP_BYTES (1024 * 1024)
+#define UPLOAD_DEFAULT_BUDGET_MS 2.0
+#define UPLOAD_DEFAULT_BUDGET_BYTES (16 * 1024 * 1024)
+#define UPLOAD_RING_SIZE 4 // Staging buffers that can be in flight at once
+
+// Cost of the uploads, as a stat for the frame time
+struct UploadStats
+{
+	double lastFrameMs = 0.0;
+	size_t lastFrameBytes = 0;
+	double maxFrameMs = 0.0;
+	size_t maxFrameBytes = 0;
+	double totalMs = 0.0;
+	size_t totalBytes = 0;
+	GLuint framesWithUploads = 0;
+	GLuint jobs = 0;
+	GLuint cancelled = 0;
+	size_t peakPendingBytes = 0; // Most bytes ever waiting in RAM to be copied
+	GLuint busyStaging = 0;      // Steps whose staging buffer was still being read and had to be orphaned
+};
+
+class UploadQueue
+{
+public:
+	static UploadQueue &Get()
+	{
+		static UploadQueue queue;
+		return queue;
+	}
+
+	// Per-frame limits; 0 leaves that one unlimited. At least one step runs every frame so the queue always advances.
+	double budgetMs = UPLOAD_DEFAULT_BUDGET_MS;
+	size_t budgetBytes = UPLOAD_DEFAULT_BUDGET_BYTES;
+
+	// Copies size bytes into buffer at offset. owner keeps data alive until the copy is done.
+	uint64_t EnqueueBuffer(GLuint buffer, size_t offset, const void *data, size_t size, const shared_ptr<const void> &owner, const string &profileName)
+	{
+		Job job = this->newJob(JOB_BUFFER, buffer, data, size, owner, profileName);
+		job.offset = offset;
+		return this->push(job);
+	}
+
+	// Fills a level of a texture whose storage is already allocated, rows bottom to top as glTexImage2D takes them.
+	// Uncompressed data is tightly packed; compressed data is in 4x4 blocks of blockBytes each.
+	uint64_t EnqueueTexture(GLuint texture, GLint level, GLsizei width, GLsizei height, GLenum format, GLenum type, const void *data, size_t size,
+		bool compressed, size_t blockBytes, bool generateMipmap, const shared_ptr<const void> &owner, const string &profileName)
+	{
+		Job job = this->newJob(JOB_TEXTURE, texture, data, size, owner, profileName);
+		job.level = level;
+		job.width = width;
+		job.height = height;
+		job.format = format;
+		job.type = type;
+		job.compressed = compressed;
+		job.generateMipmap = generateMipmap;
+		// A band is a whole number of rows, or of rows of blocks for compressed data
+		job.rowBytes = compressed ? (size_t)((width + 3) / 4) * blockBytes : (size_t)width * (format == GL_RGBA ? 4 : (format == GL_RED ? 1 : 3));
+		job.rowsPerRow = compressed ? 4 : 1;
+		return this->push(job);
+	}
+
+	// Every job enqueued up to ticket has run (or was cancelled). Ticket 0 is always done.
+	bool Done(uint64_t ticket) const
+	{
+		return ticket <= this->completed;
+	}
+
+	// Skips the jobs of a deleted buffer or texture
+	void Cancel(GLuint object, bool texture)
+	{
+		for (size_t i = 0; i < this->jobs.size(); i++)
+		{
+			if (this->jobs[i].object == object && (this->jobs[i].kind == JOB_TEXTURE) == texture && !this->jobs[i].cancelled)
+			{
+				this->jobs[i].cancelled = true;
+				this->jobs[i].owner.reset();
+				this->pendingBytes -= this->jobs[i].size - this->jobs[i].done;
+				this->stats.cancelled++;
+			}
+		}
+	}
+
+	// Skips the jobs that write inside a range of a buffer that was freed, for buffers shared by several owners
+	void CancelRange(GLuint buffer, size_t offset, size_t size)
+	{
+		for (size_t i = 0; i < this->jobs.size(); i++)
+		{
+			Job &job = this->jobs[i];
+			if (job.kind == JOB_BUFFER && job.object == buffer && !job.cancelled && job.offset < offset + size && offset < job.offset + job.size)
+			{
+				job.cancelled = true;
+				job.owner.reset();
+				this->pendingBytes -= job.size - job.done;
+				this->stats.cancelled++;
+			}
+		}
+	}
+
+	// Once per frame on the GL thread: copies until the budget is spent
+	void Process()
+	{
+		this->run(this->budgetMs, this->budgetBytes);
+	}
+
+	// Copies everything that is queued
+	void Flush()
+	{
+		this->run(0.0, 0);
+	}
+
+	size_t Pending() const
+	{
+		return this->jobs.size();
+	}
+
+	// Bytes still to be copied, kept in RAM by the owners of the jobs until then
+	size_t PendingBytes() const
+	{
+		return this->pendingBytes;
+	}
+
+	const UploadStats &Stats() const
+	{
+		return this->stats;
+	}
+
+	void PrintSummary() const
+	{
+		cout << "Subidas a la GPU: " << this->stats.jobs << " trabajos, " << this->stats.totalBytes / (1024.0 * 1024.0) << " MB en "
+			<< this->stats.totalMs << " ms repartidos en " << this->stats.framesWithUploads << " cuadros | peor cuadro " << this->stats.maxFrameMs << " ms, "
+			<< this->stats.maxFrameBytes / (1024.0 * 1024.0) << " MB | presupuesto " << this->budgetMs << " ms, " << this->budgetBytes / (1024.0 * 1024.0)
+			<< " MB por cuadro | " << this->stats.cancelled << " cancelados | pico en espera " << this->stats.peakPendingBytes / (1024.0 * 1024.0) << " MB | "
+			<< this->stats.busyStaging << " buffers intermedios ocupados" << endl;
+	}
+
+private:
+	enum JobKind
+	{
+		JOB_BUFFER,
+		JOB_TEXTURE
+	};
+
+	struct Job
+	{
+		JobKind kind;
+		uint64_t ticket;
+		GLuint object;
+		const unsigned char *data;
+		size_t size;
+		size_t done; // Bytes copied so far
+		shared_ptr<const void> owner;
+		string profileName;
+		bool cancelled;
+
+		// Buffers
+		size_t offset;
+
+		// Textures
+		GLint level;
+		GLsizei width, height;
+		GLenum format, type;
+		bool compressed;
+		bool generateMipmap;
+		size_t rowBytes;
+		GLsizei rowsPerRow; // Pixel rows in one row of data: 4 for compressed blocks
+	};
+
+	deque<Job> jobs;
+	uint64_t nextTicket = 1;
+	uint64_t completed = 0;
+	size_t pendingBytes = 0;
+	UploadStats stats;
+
+	struct StagingBuffer
+	{
+		GLuint buffer = 0;
+		size_t capacity = 0;
+		GLsync fence = 0; // Set after the last step that read it
+	};
+
+	StagingBuffer ring[UPLOAD_RING_SIZE];
+	GLuint ringNext = 0;
+
+	Job newJob(JobKind kind, GLuint object, const void *data, size_t size, const shared_ptr<const void> &owner, const string &profileName)
+	{
+		Job job;
+		job.kind = kind;
+		job.object = object;
+		job.data = (const unsigned char *)data;
+		job.size = size;
+		job.done = 0;
+		job.owner = owner;
+		job.profileName = profileName;
+		job.cancelled = false;
+		job.offset = 0;
+		job.level = 0;
+		job.width = job.height = 0;
+		job.format = job.type = 0;
+		job.compressed = job.generateMipmap = false;
+		job.rowBytes = 0;
+		job.rowsPerRow = 1;
+		return job;
+	}
+
+	uint64_t push(Job &job)
+	{
+		job.ticket = this->nextTicket++;
+		this->jobs.push_back(job);
+		this->stats.jobs++;
+		this->pendingBytes += job.size;
+		this->stats.peakPendingBytes = max(this->stats.peakPendingBytes, this->pendingBytes);
+		return job.ticket;
+	}
+
+	void run(double maxMs, size_t maxBytes)
+	{
+		if (this->jobs.empty())
+		{
+			this->stats.lastFrameMs = 0.0;
+			this->stats.lastFrameBytes = 0;
+			return;
+		}
+
+		chrono::steady_clock::time_point start = chrono::steady_clock::now();
+		double elapsed = 0.0;
+		size_t bytes = 0;
+		bool first = true;
+		while (!this->jobs.empty() && (first || ((maxMs <= 0.0 || elapsed < maxMs) && (maxBytes == 0 || bytes < maxBytes))))
+		{
+			Job &job = this->jobs.front();
+			chrono::steady_clock::time_point stepStart = chrono::steady_clock::now();
+			size_t copied = job.cancelled ? 0 : this->step(job);
+			bytes += copied;
+			this->pendingBytes -= copied;
+			first = first && job.cancelled;
+
+			bool finished = job.cancelled || job.done >= job.size;
+			if (finished && !job.cancelled && job.generateMipmap)
+			{
+				glBindTexture(GL_TEXTURE_2D, job.object);
+				glGenerateMipmap(GL_TEXTURE_2D);
+				glBindTexture(GL_TEXTURE_2D, 0);
+			}
+
+			double stepMs = chrono::duration<double, milli>(chrono::steady_clock::now() - stepStart).count();
+			if (!job.cancelled)
+			{
+				LoadProfiler::Get().AddTime(job.kind == JOB_TEXTURE ? "texture" : "model", job.profileName, LOAD_UPLOAD, stepMs);
+			}
+			if (finished)
+			{
+				this->completed = job.ticket;
+				this->jobs.pop_front();
+			}
+			elapsed = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+		}
+
+		this->stats.lastFrameMs = elapsed;
+		this->stats.lastFrameBytes = bytes;
+		this->stats.maxFrameMs = max(this->stats.maxFrameMs, elapsed);
+		this->stats.maxFrameBytes = max(this->stats.maxFrameBytes, bytes);
+		this->stats.totalMs += elapsed;
+		this->stats.totalBytes += bytes;
+		this->stats.framesWithUploads++;
+	}
+
+	// Writes the next part of a job into the next staging buffer of the ring, bound to target
+	void stage(GLenum target, const unsigned char *data, size_t size)
+	{
+		StagingBuffer &staging = this->ring[this->ringNext];
+		if (staging.buffer == 0)
+		{
+			glGenBuffers(1, &staging.buffer);
+		}
+		glBindBuffer(target, staging.buffer);
+
+		// Written in place once the GPU is done with the step that last read it; otherwise (or if it's too small for
+		// a step of one very wide row) it gets fresh storage
+		bool idle = true;
+		if (staging.fence)
+		{
+			GLenum status = glClientWaitSync(staging.fence, 0, 0);
+			idle = status == GL_ALREADY_SIGNALED || status == GL_CONDITION_SATISFIED;
+			glDeleteSync(staging.fence);
+			staging.fence = 0;
+		}
+		GLbitfield access = GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT;
+		if (!idle || staging.capacity < size)
+		{
+			this->stats.busyStaging += idle ? 0 : 1;
+			staging.capacity = max(staging.capacity, max(size, (size_t)UPLOAD_STEP_BYTES));
+			glBufferData(target, staging.capacity, NULL, GL_STREAM_DRAW);
+			access = GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT;
+		}
+		void *mapped = glMapBufferRange(target, 0, size, access);
+		if (mapped)
+		{
+			memcpy(mapped, data, size);
+			glUnmapBuffer(target);
+		}
+		else
+		{
+			glBufferSubData(target, 0, size, data);
+		}
+	}
+
+	// After the commands that read the current staging buffer: fences it and moves on to the next one
+	void advance()
+	{
+		this->ring[this->ringNext].fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		this->ringNext = (this->ringNext + 1) % UPLOAD_RING_SIZE;
+	}
+
+	// Copies one step of the job. Returns the bytes copied.
+	size_t step(Job &job)
+	{
+		if (job.kind == JOB_BUFFER)
+		{
+			size_t size = min((size_t)UPLOAD_STEP_BYTES, job.size - job.done);
+			this->stage(GL_COPY_READ_BUFFER, job.data + job.done, size);
+			// The copy targets leave the VAO's element buffer binding alone
+			glBindBuffer(GL_COPY_WRITE_BUFFER, job.object);
+			glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, job.offset + job.done, size);
+			this->advance();
+			glBindBuffer(GL_COPY_READ_BUFFER, 0);
+			glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+			job.done += size;
+			return size;
+		}
+
+		// A band of whole rows; a single row larger than a step still goes in one piece
+		size_t rows = max((size_t)1, UPLOAD_STEP_BYTES / max(job.rowBytes, (size_t)1));
+		size_t size = min(rows * job.rowBytes, job.size - job.done);
+		GLint y = (GLint)(job.done / job.rowBytes) * job.rowsPerRow;
+		GLsizei height = min((GLsizei)((size + job.rowBytes - 1) / job.rowBytes) * job.rowsPerRow, job.height - y);
+
+		this->stage(GL_PIXEL_UNPACK_BUFFER, job.data + job.done, size);
+		glBindTexture(GL_TEXTURE_2D, job.object);
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+		if (job.compressed)
+		{
+			glCompressedTexSubImage2D(GL_TEXTURE_2D, job.level, 0, y, job.width, height, job.format, (GLsizei)size, (const GLvoid *)0);
+		}
+		else
+		{
+			glTexSubImage2D(GL_TEXTURE_2D, job.level, 0, y, job.width, height, job.format, job.type, (const GLvoid *)0);
+		}
+		this->advance();
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+		glBindTexture(GL_TEXTURE_2D, 0);
+		// Unpack buffers change what a pointer means in every later glTexImage call, so none may stay bound
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+		job.done += size;
+		return size;
+	}
+};
@@ -0,0 +1,258 @@
+#pragma once
+
+#include <cmath>
+#include <string>
+#include <vector>
+#include <cstring>
+#include <cstdint>
+#include <sstream>
+#include <algorithm>
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include "Mesh.h"
+
+using namespace std;
+
+/*
+	Packed vertex format (PackedVertex, 16 bytes per vertex instead of 32).
+
+	- Position: each component quantized to an unsigned normalized 16-bit value inside the bounding box of the
+	  model. The shader gets it in [0, 1] and rebuilds it with the positionScale/positionOffset uniforms.
+	- Normal: octahedral encoding (the unit sphere folded onto a square), two signed normalized 16-bit values.
+	- Texture coordinates: two half floats, so tiling UVs outside [0, 1] keep working.
+
+	The bounds are per model rather than per submesh, since every submesh lives in the same MeshBuffer and is
+	drawn with the same uniforms.
+*/
+
+// Packed vertices of a whole model, in the same order as the Vertex data of its meshes
+struct PackedGeometry
+{
+	vector<PackedVertex> vertices;
+	glm::vec3 offset; // Minimum corner of the bounds
+	glm::vec3 scale;  // Size of the bounds
+
+	// Filled by VertexPacking::Pack when it validates
+	bool validated = false;
+	float maxPositionError = 0.0f; // Distance between the original and the decoded position, in model units
+	float maxNormalError = 0.0f;   // Angle between the original and the decoded normal, in degrees
+};
+
+class VertexPacking
+{
+public:
+	// Packs the vertices of every mesh. With validate, every vertex is decoded back and the maximum error recorded.
+	static void Pack(const vector<MeshData> &meshes, PackedGeometry &packed, bool validate)
+	{
+		packed.vertices.clear();
+
+		// Bounds of the model
+		glm::vec3 minimum(0.0f), maximum(0.0f);
+		bool first = true;
+		for (size_t i = 0; i < meshes.size(); i++)
+		{
+			for (GLuint j = 0; j < meshes[i].numVertices; j++)
+			{
+				const glm::vec3 &p = meshes[i].vertexData[j].Position;
+				for (int k = 0; k < 3; k++)
+				{
+					minimum[k] = first ? p[k] : min(minimum[k], p[k]);
+					maximum[k] = first ? p[k] : max(maximum[k], p[k]);
+				}
+				first = false;
+			}
+		}
+		packed.offset = minimum;
+		packed.scale = glm::vec3(maximum.x - minimum.x, maximum.y - minimum.y, maximum.z - minimum.z);
+
+		packed.validated = validate;
+		packed.maxPositionError = 0.0f;
+		packed.maxNormalError = 0.0f;
+
+		for (size_t i = 0; i < meshes.size(); i++)
+		{
+			for (GLuint j = 0; j < meshes[i].numVertices; j++)
+			{
+				const Vertex &vertex = meshes[i].vertexData[j];
+				PackedVertex out;
+
+				for (int k = 0; k < 3; k++)
+				{
+					float t = packed.scale[k] > 0.0f ? (vertex.Position[k] - packed.offset[k]) / packed.scale[k] : 0.0f;
+					out.Position[k] = (GLushort)floorf(min(max(t, 0.0f), 1.0f) * 65535.0f + 0.5f);
+				}
+				out.Position[3] = 0;
+				EncodeOctahedral(vertex.Normal, out.Normal);
+				out.TexCoords[0] = FloatToHalf(vertex.TexCoords.x);
+				out.TexCoords[1] = FloatToHalf(vertex.TexCoords.y);
+
+				if (validate)
+				{
+					packed.maxPositionError = max(packed.maxPositionError, PositionError(vertex.Position, out, packed));
+					packed.maxNormalError = max(packed.maxNormalError, NormalError(vertex.Normal, out));
+				}
+
+				packed.vertices.push_back(out);
+			}
+		}
+	}
+
+	// One line for the console with the saving and, if validated, the error of the packing
+	static string Report(const string &name, const PackedGeometry &packed)
+	{
+		stringstream ss;
+		ss << "Empaquetado " << name << ": " << packed.vertices.size() << " vertices, " << sizeof(Vertex) << " -> "
+			<< sizeof(PackedVertex) << " bytes por vertice";
+		if (packed.validated)
+		{
+			ss << " | error maximo: posicion " << packed.maxPositionError << ", normal " << packed.maxNormalError << " grados";
+		}
+		return ss.str();
+	}
+
+	// Octahedral encoding: project onto the octahedron |x| + |y| + |z| = 1 and fold the lower half over the upper one
+	static void EncodeOctahedral(const glm::vec3 &normal, GLshort out[2])
+	{
+		float l1 = fabsf(normal.x) + fabsf(normal.y) + fabsf(normal.z);
+		float x = l1 > 0.0f ? normal.x / l1 : 0.0f;
+		float y = l1 > 0.0f ? normal.y / l1 : 0.0f;
+
+		if (normal.z < 0.0f)
+		{
+			float foldedX = (1.0f - fabsf(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+			float foldedY = (1.0f - fabsf(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+			x = foldedX;
+			y = foldedY;
+		}
+
+		out[0] = (GLshort)floorf(min(max(x, -1.0f), 1.0f) * 32767.0f + 0.5f);
+		out[1] = (GLshort)floorf(min(max(y, -1.0f), 1.0f) * 32767.0f + 0.5f);
+	}
+
+	// Same decode as decodeOctahedral() in lighting.vs
+	static glm::vec3 DecodeOctahedral(const GLshort encoded[2])
+	{
+		glm::vec3 n(max(encoded[0] / 32767.0f, -1.0f), max(encoded[1] / 32767.0f, -1.0f), 0.0f);
+		n.z = 1.0f - fabsf(n.x) - fabsf(n.y);
+
+		float t = max(-n.z, 0.0f);
+		n.x += n.x >= 0.0f ? -t : t;
+		n.y += n.y >= 0.0f ? -t : t;
+
+		float length = sqrtf(n.x * n.x + n.y * n.y + n.z * n.z);
+		return glm::vec3(n.x / length, n.y / length, n.z / length);
+	}
+
+	// IEEE 754 single to half precision, rounding to nearest even
+	static GLushort FloatToHalf(float value)
+	{
+		uint32_t bits;
+		memcpy(&bits, &value, sizeof(bits));
+
+		uint32_t sign = (bits >> 16) & 0x8000;
+		uint32_t floatExponent = (bits >> 23) & 0xFF;
+		uint32_t mantissa = bits & 0x7FFFFF;
+		int exponent = (int)floatExponent - 127 + 15;
+
+		// Infinity and NaN
+		if (floatExponent == 0xFF)
+		{
+			return (GLushort)(sign | 0x7C00 | (mantissa ? 0x200 : 0));
+		}
+		// Too large: infinity
+		if (exponent >= 31)
+		{
+			return (GLushort)(sign | 0x7C00);
+		}
+		// Too small for a normal half: denormal or zero
+		if (exponent <= 0)
+		{
+			if (exponent < -10)
+			{
+				return (GLushort)sign;
+			}
+			mantissa |= 0x800000;
+			uint32_t shift = (uint32_t)(14 - exponent);
+			uint32_t half = mantissa >> shift;
+			uint32_t remainder = mantissa & ((1u << shift) - 1);
+			uint32_t halfway = 1u << (shift - 1);
+			if (remainder > halfway || (remainder == halfway && (half & 1)))
+			{
+				half++;
+			}
+			return (GLushort)(sign | half);
+		}
+
+		uint32_t half = sign | ((uint32_t)exponent << 10) | (mantissa >> 13);
+		uint32_t remainder = mantissa & 0x1FFF;
+		if (remainder > 0x1000 || (remainder == 0x1000 && (half & 1)))
+		{
+			half++; // A carry into the exponent is still the correctly rounded value
+		}
+		return (GLushort)half;
+	}
+
+	// Half to single precision, exact for every half value
+	static float HalfToFloat(GLushort half)
+	{
+		uint32_t sign = (uint32_t)(half & 0x8000) << 16;
+		uint32_t exponent = (half >> 10) & 0x1F;
+		uint32_t mantissa = half & 0x3FF;
+		uint32_t bits;
+
+		if (exponent == 0x1F)
+		{
+			bits = sign | 0x7F800000 | (mantissa << 13); // Infinity and NaN
+		}
+		else if (exponent != 0)
+		{
+			bits = sign | ((exponent - 15 + 127) << 23) | (mantissa << 13);
+		}
+		else if (mantissa == 0)
+		{
+			bits = sign;
+		}
+		else
+		{
+			// Denormal half: normalize it, as every value it can hold is a normal float
+			int shift = 0;
+			while (!(mantissa & 0x400))
+			{
+				mantissa <<= 1;
+				shift++;
+			}
+			bits = sign | ((uint32_t)(127 - 15 + 1 - shift) << 23) | ((mantissa & 0x3FF) << 13);
+		}
+
+		float value;
+		memcpy(&value, &bits, sizeof(value));
+		return value;
+	}
+
+private:
+	static float PositionError(const glm::vec3 &original, const PackedVertex &packed, const PackedGeometry &geometry)
+	{
+		float squared = 0.0f;
+		for (int k = 0; k < 3; k++)
+		{
+			float decoded = geometry.offset[k] + packed.Position[k] / 65535.0f * geometry.scale[k];
+			squared += (decoded - original[k]) * (decoded - original[k]);
+		}
+		return sqrtf(squared);
+	}
+
+	static float NormalError(const glm::vec3 &original, const PackedVertex &packed)
+	{
+		float length = sqrtf(original.x * original.x + original.y * original.y + original.z * original.z);
+		if (length == 0.0f)
+		{
+			return 0.0f;
+		}
+
+		glm::vec3 decoded = DecodeOctahedral(packed.Normal);
+		float cosine = (original.x * decoded.x + original.y * decoded.y + original.z * decoded.z) / length;
+		return acosf(min(max(cosine, -1.0f), 1.0f)) * 180.0f / 3.14159265f;
+	}
+};